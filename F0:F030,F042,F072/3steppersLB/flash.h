@@ -52,6 +52,7 @@ typedef struct{
     uint8_t donthold : 1;       // bit3 - clear power @ stop (don't hold motor when stopped)
     uint8_t eswinv : 1;         // bit4 - inverse end-switches
     uint8_t keeppos : 1;        // bit5 - keep current position (as servo motor)
+    uint8_t closedloop : 1;     // bit6 - correct step rate and lost steps by encoder (need haveencoder)
 } motflags_t;
 
 /*
@@ -57,6 +57,13 @@ void gpio_setup(void){
     GPIOB->AFR[0] = (1 << (4*4)) | (1 << (5*4)) | (1 << (6*4)) | (1 << (7*4));
     GPIOC->PUPDR = GPIO_PUPDR13_PU | GPIO_PUPDR14_PU | GPIO_PUPDR15_PU;
     GPIOF->MODER = GPIO_MODER_MODER0_O;
+    // end-switches -> EXTI13..15 (both edges), interrupts are unmasked only while moving to zero
+    RCC->APB2ENR |= RCC_APB2ENR_SYSCFGEN;
+    SYSCFG->EXTICR[3] = (SYSCFG->EXTICR[3] & ~(SYSCFG_EXTICR4_EXTI13 | SYSCFG_EXTICR4_EXTI14 | SYSCFG_EXTICR4_EXTI15))
+                      | SYSCFG_EXTICR4_EXTI13_PC | SYSCFG_EXTICR4_EXTI14_PC | SYSCFG_EXTICR4_EXTI15_PC;
+    EXTI->RTSR |= EXTI_RTSR_TR13 | EXTI_RTSR_TR14 | EXTI_RTSR_TR15;
+    EXTI->FTSR |= EXTI_FTSR_TR13 | EXTI_FTSR_TR14 | EXTI_FTSR_TR15;
+    NVIC_EnableIRQ(EXTI4_15_IRQn);
 }
 
 void iwdg_setup(){
@@ -201,6 +208,23 @@ uint8_t ESW_state(uint8_t x){
     return val;
 }
 
+// turn on/off end-switch interrupt of x'th motor (pin number is the same as EXTI line)
+void ESW_latch(uint8_t x, uint8_t on){
+    if(on){
+        EXTI->PR = ESWpins[x];
+        EXTI->IMR |= ESWpins[x];
+    }else EXTI->IMR &= ~ESWpins[x];
+}
+
+// end-switches changed their state
+void exti4_15_isr(){
+    uint32_t pr = EXTI->PR;
+    EXTI->PR = pr;
+    for(int i = 0; i < ESWNO; ++i){
+        if(pr & ESWpins[i]) esw_latch(i);
+    }
+}
+
 void tim14_isr(){
     //TIM14->CR1 &= ~TIM_CR1_CEN;
     addmicrostep(1);
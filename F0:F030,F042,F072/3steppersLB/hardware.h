@@ -200,6 +200,7 @@ extern volatile TIM_TypeDef *mottimers[];
 extern volatile TIM_TypeDef *enctimers[];
 
 uint8_t ESW_state(uint8_t x);
+void ESW_latch(uint8_t x, uint8_t on);
 void gpio_setup();
 void iwdg_setup();
 void timers_setup();
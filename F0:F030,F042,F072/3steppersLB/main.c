@@ -31,6 +31,7 @@ volatile uint32_t Tms = 0;
 /* Called when systick fires */
 void sys_tick_handler(void){
     ++Tms;
+    steppers_servo();
 }
 
 #define USBBUF 63
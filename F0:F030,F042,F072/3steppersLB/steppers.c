@@ -73,6 +73,28 @@ static mvto0state mvzerostate[MOTORSNO];
 
 static int8_t Nstalled[MOTORSNO] = {0}; // counter of STALL
 
+// current microsteps position
+static volatile uint16_t ustepctr[MOTORSNO] = {0};
+
+// closed-loop mode variables
+// encoder positions for last CL_VWINDOW milliseconds
+static int32_t clsamples[MOTORSNO][CL_VWINDOW];
+static uint8_t clsampidx = 0;
+// current speed correction (steps per second), speed = curspeed - clcorr
+static volatile uint16_t clcorr[MOTORSNO] = {0};
+// integral of rotor's lag
+static int32_t cllagsum[MOTORSNO] = {0};
+// ==1 when rotor lost synchronism (step counter was corrected)
+static volatile uint8_t clslipped[MOTORSNO] = {0};
+// amount of slips in current moving
+static uint8_t clslips[MOTORSNO] = {0};
+// tries rest to reach target position after moving
+static uint8_t clrecover[MOTORSNO] = {0};
+
+// position (in microsteps) and encoder position latched by ESW interrupt while moving to zero
+static volatile int32_t eswlatch[MOTORSNO], enclatch[MOTORSNO];
+static volatile uint8_t eswlatched[MOTORSNO] = {0};
+
 // lowest ARR value (highest speed), highest (lowest speed)
 //static uint16_t stphighARR[MOTORSNO];
 // microsteps=1<<ustepsshift
@@ -83,13 +105,25 @@ static uint32_t accdecsteps[MOTORSNO];
 // time when acceleration or deceleration starts
 static uint32_t Taccel[MOTORSNO] = {0};
 
-// recalculate ARR according to new speed
-TRUE_INLINE void recalcARR(int i){
-    uint32_t ARR = (((PCLK/(MOTORTIM_PSC+1)) / curspeed[i]) >> ustepsshift[i]) - 1;
+// calculate ARR value for given speed
+static uint32_t speed2ARR(int i, uint32_t speed){
+    uint32_t ARR = (((PCLK/(MOTORTIM_PSC+1)) / speed) >> ustepsshift[i]) - 1;
     if(ARR < MOTORTIM_ARRMIN) ARR = MOTORTIM_ARRMIN;
     else if(ARR > 0xffff) ARR = 0xffff;
-    mottimers[i]->ARR = ARR;
+    return ARR;
+}
+
+// recalculate ARR according to new speed
+TRUE_INLINE void recalcARR(int i){
+    uint32_t ARR = speed2ARR(i, curspeed[i]);
     curspeed[i] = (((PCLK/(MOTORTIM_PSC+1)) / (ARR+1)) >> ustepsshift[i]); // recalculate speed due to new val
+    uint16_t corr = clcorr[i];
+    if(corr){ // closed-loop correction
+        int32_t v = (int32_t)curspeed[i] - corr;
+        if(v < the_conf.minspd[i]) v = the_conf.minspd[i];
+        ARR = speed2ARR(i, v);
+    }
+    mottimers[i]->ARR = ARR;
 }
 
 // update stepper's settings
@@ -220,6 +254,7 @@ static int esw_block(uint8_t i){
                 ret = TRUE;
             break;
             case ESW_STOPMINUS: // stop only @ minus
+            case ESW_FASTZERO:
                 if(motdir[i] == -1) ret = TRUE;
             break;
             default: // ESW_IGNORE
@@ -259,6 +294,11 @@ errcodes motor_absmove(uint8_t i, int32_t newpos){
     }
     Nstalled[i] = (state[i] == STP_STALL) ? -(NSTALLEDMAX*4) : 0; // give some more chances to go out of stall state
     stopflag[i] = 0;
+    clslips[i] = 0;
+    clslipped[i] = 0;
+    cllagsum[i] = 0;
+    clcorr[i] = 0;
+    clrecover[i] = CL_RECOVERMAX;
     targstppos[i] = newpos;
     prevencpos[i] = encoder_position(i);
     prevstppos[i] = stppos[i];
@@ -312,10 +352,9 @@ stp_state getmotstate(uint8_t i){
 
 // count steps @tim 14/15/16
 void addmicrostep(uint8_t i){
-    static volatile uint16_t microsteps[MOTORSNO] = {0}; // current microsteps position
     if(esw_block(i)) stopflag[i] = 1; // turn on stop flag if end-switch was active
-    if(++microsteps[i] == the_conf.microsteps[i]){
-        microsteps[i] = 0;
+    if(++ustepctr[i] == the_conf.microsteps[i]){
+        ustepctr[i] = 0;
         stppos[i] += motdir[i];
         uint8_t stop_at_pos = 0;
         if(motdir[i] > 0){
@@ -329,8 +368,12 @@ void addmicrostep(uint8_t i){
         }
         if(stopflag[i] || stop_at_pos){ // stop NOW
             mottimers[i]->CR1 &= ~TIM_CR1_CEN; // stop timer
-            if(stopflag[i]) targstppos[i] = stppos[i]; // keep position (for keep flag)
+            if(stopflag[i]){
+                targstppos[i] = stppos[i]; // keep position (for keep flag)
+                clrecover[i] = 0; // don't try to reach old target
+            }
             stopflag[i] = 0;
+            clcorr[i] = 0;
             if(the_conf.motflags[i].donthold)
                 MOTOR_DIS(i); // turn off power
             if(stallflags[i] == STALL_STOP){
@@ -346,6 +389,14 @@ void addmicrostep(uint8_t i){
     }
 }
 
+// called from EXTI interrupt: latch position of end-switch activation
+void esw_latch(uint8_t i){
+    if(eswlatched[i] || !ESW_state(i)) return;
+    eswlatch[i] = stppos[i] * the_conf.microsteps[i] + motdir[i] * ustepctr[i];
+    enclatch[i] = encoder_position(i);
+    eswlatched[i] = 1;
+}
+
 void encoders_UPD(uint8_t i){
     if(enctimers[i]->SR & TIM_SR_UIF){
         int8_t d = 1; // positive (-1 - negative)
@@ -357,10 +408,90 @@ void encoders_UPD(uint8_t i){
     enctimers[i]->SR = 0;
 }
 
+/**
+ * @brief steppers_servo - closed-loop control (called from SysTick handler every 1ms)
+ * Encoder position is compared with commanded (by STEP pulses) position; when rotor lags more than
+ * CL_DEADBAND, step rate reduced by PI-controller; step rate can't be much greater than measured speed.
+ * If lag is more than CL_SLIPSTEPS, step counter is corrected by encoder (lost steps will be made up).
+ */
+void steppers_servo(){
+    clsampidx = (clsampidx + 1) & (CL_VWINDOW - 1);
+    for(int i = 0; i < MOTORSNO; ++i){
+        motflags_t f = the_conf.motflags[i];
+        if(!f.closedloop || !f.haveencoder) continue;
+        int32_t enc = encoder_position(i);
+        int32_t oldenc = clsamples[i][clsampidx]; // encoder position CL_VWINDOW ms ago
+        clsamples[i][clsampidx] = enc;
+        switch(state[i]){
+            case STP_ACCEL:
+            case STP_MOVE:
+            case STP_DECEL:
+            case STP_MVSLOW:
+            break;
+            default:
+                continue;
+        }
+        int32_t eps = encperstep[i];
+        if(eps < 1) continue;
+        // commanded position in encoder ticks
+        int32_t cmd = stppos[i] * eps + ((motdir[i] * (int32_t)ustepctr[i] * eps) >> ustepsshift[i]);
+        // rotor's lag in 1/256 of step (positive - rotor is behind field)
+        int32_t lag = ((cmd - enc) * motdir[i] * 256) / eps;
+        if(lag >= CL_SLIPSTEPS*256){ // lost synchronism: correct steps counter and let `chkSTALL` slow down
+            int32_t p = enc;
+            if(p < 0) p -= eps >> 1;
+            else p += eps >> 1;
+            p /= eps;
+            __disable_irq();
+            stppos[i] = p;
+            __enable_irq();
+            cllagsum[i] = 0;
+            clslipped[i] = 1;
+            continue;
+        }
+        int32_t corr = 0;
+        if(lag > CL_DEADBAND){
+            lag -= CL_DEADBAND;
+            cllagsum[i] += lag;
+            if(cllagsum[i] > CL_IMAX) cllagsum[i] = CL_IMAX;
+            corr = (CL_KP * lag) >> 8;
+        }else cllagsum[i] -= cllagsum[i] >> 4; // forget integral when rotor follows field
+        corr += (CL_KI * (cllagsum[i] >> 8)) >> 8;
+        // measured speed (steps per second)
+        int32_t vmeas = ((enc - oldenc) * motdir[i] * (1000/CL_VWINDOW)) / eps;
+        int32_t v = (int32_t)curspeed[i] - corr;
+        int32_t vlim = vmeas + the_conf.minspd[i] + the_conf.accel[i]/64; // don't overrun rotor
+        if(v > vlim) v = vlim;
+        if(v < the_conf.minspd[i]) v = the_conf.minspd[i];
+        corr = (int32_t)curspeed[i] - v;
+        if(corr < 0) corr = 0;
+        if(corr != clcorr[i]){
+            clcorr[i] = corr;
+            mottimers[i]->ARR = speed2ARR(i, v);
+        }
+    }
+}
+
 // check if motor is stalled
 // @return 0 if moving OK,
 static t_stalled chkSTALL(uint8_t i){
     if(!the_conf.motflags[i].haveencoder) return STALL_NO;
+    if(the_conf.motflags[i].closedloop){ // steps are corrected by `steppers_servo`, check only slips
+        if(!clslipped[i]) return STALL_NO;
+        clslipped[i] = 0;
+        if(++clslips[i] > CL_MAXSLIPS){
+            DBG("Closed loop: too much slips");
+            stallflags[i] = STALL_STOP;
+            stalleddir[i] = motdir[i];
+            return STALL_STOP;
+        }
+        // slow down and accelerate again
+        uint16_t spd = curspeed[i] >> 1;
+        curspeed[i] = (spd > the_conf.minspd[i]) ? spd : the_conf.minspd[i];
+        calcacceleration(i);
+        stallflags[i] = STALL_ONCE;
+        return STALL_ONCE;
+    }
     int32_t curencpos = encoder_position(i), Denc = curencpos - prevencpos[i];
     int32_t curstppos = stppos[i], Dstp = curstppos - prevstppos[i];
     int difsign = 1;
@@ -461,6 +592,16 @@ static void chkstepper(int i){
 #endif
                     stppos[i] = i32;
                 }
+                if(the_conf.motflags[i].closedloop && clrecover[i] && targstppos[i] != i32){ // lost steps
+                    uint8_t r = clrecover[i] - 1;
+#ifdef EBUG
+                    SEND("MOTOR"); bufputchar('0'+i);
+                    SEND(" recover "); printi(targstppos[i] - i32); SEND(" steps"); NL();
+#endif
+                    if(ERR_OK != motor_relslow(i, targstppos[i] - i32)) r = 0;
+                    clrecover[i] = r;
+                    break;
+                }
                 if(the_conf.motflags[i].keeppos){ // keep old position
                     diff = targstppos[i] - i32; // check whether we need to change position
                     if(diff){ // try to correct position
@@ -559,7 +700,27 @@ static void chkstepper(int i){
     }
     switch(mvzerostate[i]){
         case M0FAST:
+            if(the_conf.ESW_reaction[i] == ESW_FASTZERO && eswlatched[i] &&
+                (state[i] == STP_RELAX || state[i] == STP_STALL)){ // zero is latched position
+                ESW_latch(i, 0);
+                state[i] = STP_RELAX;
+                if(the_conf.motflags[i].haveencoder){
+                    setencpos(i, encoder_position(i) - enclatch[i]);
+                }else{ // round position relative to latched to nearest step
+                    int32_t ms = the_conf.microsteps[i], d = stppos[i] * ms - eswlatch[i];
+                    if(d < 0) d = -((ms/2 - d) / ms);
+                    else d = (d + ms/2) / ms;
+                    prevstppos[i] = targstppos[i] = stppos[i] = d;
+                }
+#ifdef EBUG
+                bufputchar('M'); bufputchar('0'+i); SEND("FAST: zero latched, pos="); printi(stppos[i]); NL();
+#endif
+                ESW_reaction[i] = the_conf.ESW_reaction[i];
+                mvzerostate[i] = M0RELAX;
+                break;
+            }
             if(state[i] == STP_RELAX || state[i] == STP_STALL){ // stopped -> move to +
+                ESW_latch(i, 0); // not latched: find zero by slow moving
 #ifdef EBUG
                 bufputchar('M'); bufputchar('0'+i); SEND("FAST: motor stopped\n");
 #endif
@@ -598,8 +759,11 @@ static void chkstepper(int i){
 }
 
 errcodes motor_goto0(uint8_t i){
+    eswlatched[i] = 0;
+    if(the_conf.ESW_reaction[i] == ESW_FASTZERO) ESW_latch(i, 1);
     errcodes e = motor_absmove(i, -the_conf.maxsteps[i]);
     if(ERR_OK != e){
+        ESW_latch(i, 0);
         if(!ESW_state(i)) return e; // not @ limit switch -> error
     }else  ESW_reaction[i] = ESW_STOPMINUS;
     mvzerostate[i] = M0FAST;
@@ -38,6 +38,23 @@
 // amount of tries to keep current position (need for states near problem places)
 #define KEEPPOSMAX      (10)
 
+// closed-loop mode (motflags.closedloop): encoder sampled @ SysTick (1ms)
+// amount of samples for speed measurement (power of 2)
+#define CL_VWINDOW      (8)
+// lag of rotor (in 1/256 of step) which is normal (no speed correction)
+#define CL_DEADBAND     (256)
+// proportional and integral coefficients: correction (steps/s) = (KP*lag)>>8 + (KI*sum(lag))>>16
+#define CL_KP           (64)
+#define CL_KI           (256)
+// integral limit (1/256 steps * ms)
+#define CL_IMAX         (1<<20)
+// lag (in full steps) when rotor lost synchronism: step counter corrected by encoder
+#define CL_SLIPSTEPS    (2)
+// max amount of slips during one moving (more -> STALL)
+#define CL_MAXSLIPS     (10)
+// max amount of tries to reach target after moving
+#define CL_RECOVERMAX   (3)
+
 // stepper states
 typedef enum{
     STP_RELAX,      // 0 - no moving
@@ -54,6 +71,7 @@ enum{
     ESW_IGNORE,     // don't stop @ end-switch
     ESW_ANYSTOP,    // stop @ esw in any moving direction
     ESW_STOPMINUS,  // stop only in negative moving
+    ESW_FASTZERO,   // like ESW_STOPMINUS, but zero is position latched by ESW interrupt (no slow pass)
     ESW_AMOUNT      // number of records
 };
 
@@ -61,6 +79,8 @@ enum{
 
 void addmicrostep(uint8_t i);
 void encoders_UPD(uint8_t i);
+void esw_latch(uint8_t i);
+void steppers_servo();
 
 void init_steppers();
 void update_stepper(uint8_t i);
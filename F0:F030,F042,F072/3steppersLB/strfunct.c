@@ -22,6 +22,7 @@
 #include "commonproto.h"
 #include "flash.h"
 #include "hardware.h"
+#include "strfunc.h"
 #include "strfunct.h"
 #include "usb.h"
 #include "version.inc"
@@ -98,7 +99,7 @@ static CAN_message *parseCANmsg(char *txt){
     canmsg.ID = 0xffff;
     do{
         txt = omit_spaces(txt);
-        n = getnum(txt, &N);
+        n = getint(txt, &N);
         if(txt == n) break;
         txt = n;
         if(ctr == -1){
@@ -144,7 +145,7 @@ static void CANini(char *txt){
     txt = omit_spaces(txt);
     int32_t N;
     if(!txt) goto eofunc;
-    char *n = getnum(txt, &N);
+    char *n = getint(txt, &N);
     if(txt == n)  goto eofunc;
     if(N < 50){
         SEND("Lowest speed is 50kbps");
@@ -166,7 +167,7 @@ static void addIGN(char *txt){
     }
     txt = omit_spaces(txt);
     int32_t N;
-    char *n = getnum(txt, &N);
+    char *n = getint(txt, &N);
     if(txt == n){
         SEND("No ID given");
         return;
@@ -265,7 +266,7 @@ static void list_filters(_U_ char *txt){
 static void add_filter(char *str){
     int32_t N;
     str = omit_spaces(str);
-    char *n = getnum(str, &N);
+    char *n = getint(str, &N);
     if(n == str){
         SEND("No bank# given");
         return;
@@ -302,7 +303,7 @@ static void add_filter(char *str){
     uint32_t filters[4];
     uint32_t nfilt;
     for(nfilt = 0; nfilt < 4; ++nfilt){
-        n = getnum(str, &N);
+        n = getint(str, &N);
         if(n == str) break;
         filters[nfilt] = N;
         str = omit_spaces(n);
@@ -353,7 +354,7 @@ void canid(char *txt){
             eq = omit_spaces(eq+1);
             if(eq){
                 int32_t N;
-                if(eq != getnum(eq, &N) && N > -1 && N < 0xfff){
+                if(eq != getint(eq, &N) && N > -1 && N < 0xfff){
                     the_conf.CANID = (uint16_t)N;
                     CAN_reinit(the_conf.CANspeed);
                     good = TRUE;
@@ -642,7 +643,7 @@ void cmd_parser(char *txt){
                 uint8_t par = CANMESG_NOPAR;
                 int32_t val = 0;
                 if(eptr && *eptr){
-                    char *nxt = getnum(eptr, &val);
+                    char *nxt = getint(eptr, &val);
                     if(nxt && nxt != eptr){ // command has parameter?
                         if(val < 0 || val >= CANMESG_NOPAR){
                             SEND("Command parameter should be 0..126!"); NL();
@@ -653,7 +654,7 @@ void cmd_parser(char *txt){
                     eptr = getchr(nxt, '=');
                     if(eptr){ // command has value?
                         eptr = omit_spaces(eptr + 1);
-                        nxt = getnum(eptr, &val);
+                        nxt = getint(eptr, &val);
                         if(nxt != eptr){
                             par |= 0x80; // setter
                         }
@@ -683,25 +684,12 @@ void cmd_parser(char *txt){
 
 // print 32bit unsigned int
 void printu(uint32_t val){
-    char buf[11], *bufptr = &buf[10];
-    *bufptr = 0;
-    if(!val){
-        *(--bufptr) = '0';
-    }else{
-        while(val){
-            register uint32_t o = val;
-            val /= 10;
-            *(--bufptr) = (o - 10*val) + '0';
-        }
-    }
-    addtobuf(bufptr);
+    char buf[STR_BUFSZ];
+    addtobuf(u2str_r(val, buf));
 }
 void printi(int32_t val){
-    if(val < 0){
-        val = -val;
-        bufputchar('-');
-    }
-    printu((uint32_t)val);
+    char buf[STR_BUFSZ];
+    addtobuf(i2str_r(val, buf));
 }
 
 // print 32bit unsigned int as hex
@@ -716,9 +704,8 @@ void printuhex(uint32_t val){
         }
         else z = 0;
         for(j = 1; j > -1; --j){
-            uint8_t half = (*ptr >> (4*j)) & 0x0f;
-            if(half < 10) bufputchar(half + '0');
-            else bufputchar(half - 10 + 'a');
+            int8_t half = (*ptr >> (4*j)) & 0x0f;
+            bufputchar(half + '0' + (((9 - half) >> 7) & ('a' - '0' - 10)));
         }
     }
 }
@@ -729,86 +716,3 @@ uint8_t isgood(uint16_t ID){
         if(Ignore_IDs[i] == ID) return 0;
     return 1;
 }
-
-char *omit_spaces(char *buf){
-    while(*buf){
-        if(*buf > ' ') break;
-        ++buf;
-    }
-    return buf;
-}
-
-// THERE'S NO OVERFLOW PROTECTION IN NUMBER READ PROCEDURES!
-// read decimal number
-static char *getdec(const char *buf, int32_t *N){
-    int32_t num = 0;
-    int positive = TRUE;
-    if(*buf == '-'){
-        positive = FALSE;
-        ++buf;
-    }
-    while(*buf){
-        char c = *buf;
-        if(c < '0' || c > '9'){
-            break;
-        }
-        num *= 10;
-        num += c - '0';
-        ++buf;
-    }
-    *N = (positive) ? num : -num;
-    return (char *)buf;
-}
-// read hexadecimal number (without 0x prefix!)
-static char *gethex(const char *buf, int32_t *N){
-    uint32_t num = 0;
-    while(*buf){
-        char c = *buf;
-        uint8_t M = 0;
-        if(c >= '0' && c <= '9'){
-            M = '0';
-        }else if(c >= 'A' && c <= 'F'){
-            M = 'A' - 10;
-        }else if(c >= 'a' && c <= 'f'){
-            M = 'a' - 10;
-        }
-        if(M){
-            num <<= 4;
-            num += c - M;
-        }else{
-            break;
-        }
-        ++buf;
-    }
-    *N = (int32_t)num;
-    return (char *)buf;
-}
-// read binary number (without 0b prefix!)
-static char *getbin(const char *buf, int32_t *N){
-    uint32_t num = 0;
-    while(*buf){
-        char c = *buf;
-        if(c < '0' || c > '1'){
-            break;
-        }
-        num <<= 1;
-        if(c == '1') num |= 1;
-        ++buf;
-    }
-    *N = (int32_t)num;
-    return (char *)buf;
-}
-
-/**
- * @brief getnum - read uint32_t from string (dec, hex or bin: 127, 0x7f, 0b1111111)
- * @param buf - buffer with number and so on
- * @param N   - the number read
- * @return pointer to first non-number symbol in buf (if it is == buf, there's no number)
- */
-char *getnum(char *txt, int32_t *N){
-    if(*txt == '0'){
-        if(txt[1] == 'x' || txt[1] == 'X') return gethex(txt+2, N);
-        if(txt[1] == 'b' || txt[1] == 'B') return getbin(txt+2, N);
-    }
-    return getdec(txt, N);
-}
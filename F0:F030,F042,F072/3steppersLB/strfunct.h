@@ -52,8 +52,6 @@ void printuhex(uint32_t val);
 void sendbuf();
 int cmpstr(const char *s1, const char *s2);
 char *getchr(const char *str, char symbol);
-char *omit_spaces(char *buf);
-char *getnum(char *buf, int32_t *N);
 
 
 uint8_t isgood(uint16_t ID);
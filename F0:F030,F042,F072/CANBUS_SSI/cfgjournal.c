@@ -0,0 +1 @@
+../../snippets/cfgjournal.c
\ No newline at end of file
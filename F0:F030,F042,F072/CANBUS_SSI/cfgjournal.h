@@ -0,0 +1 @@
+../../snippets/cfgjournal.h
\ No newline at end of file
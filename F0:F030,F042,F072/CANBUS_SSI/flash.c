@@ -36,13 +36,11 @@
 */
 #include <stm32f0.h>
 #include "adc.h"
+#include "cfgjournal.h"
 #include "flash.h"
 #include "proto.h"  // printout
 #include <string.h> // memcpy
 
-// max amount of Config records stored (will be recalculate in flashstorage_init()
-static uint32_t maxCnum = FLASH_BLOCK_SIZE / sizeof(user_conf);
-
 #define USERCONF_INITIALIZER  {             \
      .userconf_sz = sizeof(user_conf)       \
     ,.CANspeed = 100                        \
@@ -50,15 +48,26 @@ static uint32_t maxCnum = FLASH_BLOCK_SIZE / sizeof(user_conf);
     ,.limitsID = 0xe                        \
     }
 
-static int erase_flash(const void*, const void*);
-static int write2flash(const void*, const void*, uint32_t);
 // don't write `static` here, or get error:
 //      'memcpy' forming offset 8 is out of the bounds [0, 4] of object '__varsstart' with type 'uint32_t'
 const user_conf *Flash_Data = (const user_conf *)(&__varsstart);
 
 user_conf the_conf = USERCONF_INITIALIZER;
 
-static int currentconfidx = -1; // index of current configuration
+// configuration journal (see cfgjournal.h): two banks of 2k
+#define JBANKSZ     (2048)
+static user_conf storedconf; // data stored in flash
+static uint16_t jbuf[CJ_BUFSZ(sizeof(user_conf))];
+static int write2flash(const void *addr, const uint16_t *data, uint32_t n);
+static int erase_page(const void *addr);
+static cj_journal journal = {
+    .write = write2flash,
+    .erase = erase_page,
+    .image = (uint8_t*)&the_conf,
+    .shadow = (uint8_t*)&storedconf,
+    .buf = jbuf,
+    .size = sizeof(user_conf)
+};
 
 /**
  * @brief binarySearch - binary search in flash for last non-empty cell
@@ -87,38 +96,42 @@ static int binarySearch(int r, const uint8_t *start, int stor_size){
     return -1; // not found
 }
 
+// size of storage in bytes (0 if FLASH_SIZE is wrong)
+static uint32_t storagesize(){
+    if(FLASH_SIZE < 1 || FLASH_SIZE > 20000) return 0;
+    uint32_t flsz = FLASH_SIZE * 1024 - ((uint32_t)(&__varsstart) - FLASH_BASE);
+    return flsz - flsz % FLASH_BLOCK_SIZE;
+}
+
 /**
  * @brief flashstorage_init - initialization of user conf storage
  * run in once @ start
  */
 void flashstorage_init(){
-    if(FLASH_SIZE > 0 && FLASH_SIZE < 20000){
-        uint32_t flsz = FLASH_SIZE * 1024; // size in bytes
-        flsz -= (uint32_t)(&__varsstart) - FLASH_BASE;
-        maxCnum = flsz / sizeof(user_conf);
-//SEND("flsz="); printu(flsz);
-//SEND("\nmaxCnum="); printu(maxCnum); newline(); sendbuf();
+    journal.base = (const uint8_t*)Flash_Data;
+    journal.pagesize = FLASH_BLOCK_SIZE;
+    journal.banksize = JBANKSZ;
+    if(storagesize() < 2 * JBANKSZ){ // no place for two banks
+        journal.base = NULL;
+        return;
     }
-    // -1 if there's no data at all & flash is clear; maxnum-1 if flash is full
-    currentconfidx = binarySearch((int)maxCnum-2, (const uint8_t*)Flash_Data, sizeof(user_conf));
-    if(currentconfidx > -1){
-        memcpy(&the_conf, &Flash_Data[currentconfidx], sizeof(user_conf));
+    if(cj_mount(&journal) == CJ_EMPTY){
+        // old storage format: array of full user_conf copies (it will be replaced at first saving)
+        if(Flash_Data->userconf_sz != sizeof(user_conf)) return;
+        int idx = binarySearch((int)(storagesize() / sizeof(user_conf)) - 2, (const uint8_t*)Flash_Data, sizeof(user_conf));
+        if(idx > -1) memcpy(&the_conf, &Flash_Data[idx], sizeof(user_conf));
     }
 }
 
-// store new configuration
+// save changes of configuration
 // @return 0 if all OK
 int store_userconf(){
-    // maxnum - 3 means that there always should be at least one empty record after last data
-    // for binarySearch() checking that there's nothing more after it!
-    if(currentconfidx > (int)maxCnum - 3){ // there's no more place
-        currentconfidx = 0;
-        if(erase_flash(Flash_Data, (&__varsstart))) return 1;
-    }else ++currentconfidx; // take next data position (0 - within first run after firmware flashing)
-    return write2flash((const void*)&Flash_Data[currentconfidx], &the_conf, sizeof(the_conf));
+    if(!journal.base) return 1;
+    return (CJ_OK != cj_save(&journal));
 }
 
-static int write2flash(const void *start, const void *wrdata, uint32_t stor_size){
+// program `n` halfwords; @return 0 if OK
+static int write2flash(const void *addr, const uint16_t *data, uint32_t n){
     int ret = 0;
     if (FLASH->CR & FLASH_CR_LOCK){ // unloch flash
         FLASH->KEYR = FLASH_KEY1;
@@ -131,87 +144,51 @@ static int write2flash(const void *start, const void *wrdata, uint32_t stor_size
     }
     FLASH->SR = FLASH_SR_EOP | FLASH_SR_PGERR | FLASH_SR_WRPRTERR; // clear all flags
     FLASH->CR |= FLASH_CR_PG;
-    const uint16_t *data = (const uint16_t*) wrdata;
-    volatile uint16_t *address = (volatile uint16_t*) start;
-    uint32_t i, count = (stor_size + 1) / 2;
-    for (i = 0; i < count; ++i){
+    volatile uint16_t *address = (volatile uint16_t*) addr;
+    for (uint32_t i = 0; i < n; ++i){
         IWDG->KR = IWDG_REFRESH;
-        *(volatile uint16_t*)(address + i) = data[i];
+        address[i] = data[i];
         while (FLASH->SR & FLASH_SR_BSY);
-        if(FLASH->SR &  FLASH_SR_PGERR){
+        if((FLASH->SR & FLASH_SR_PGERR) || address[i] != data[i]){
             ret = 1; // program error - meet not 0xffff
             MSG("FLASH_SR_PGERR\n");
             break;
-        }else while (!(FLASH->SR & FLASH_SR_EOP));
+        }
         FLASH->SR = FLASH_SR_EOP | FLASH_SR_PGERR | FLASH_SR_WRPRTERR;
     }
-    FLASH->CR |= FLASH_CR_LOCK; // lock it back
+    FLASH->SR = FLASH_SR_EOP | FLASH_SR_PGERR | FLASH_SR_WRPRTERR;
     FLASH->CR &= ~(FLASH_CR_PG);
-    MSG("Flash stored\n");
     return ret;
 }
 
-/**
- * @brief erase_flash - erase N pages of flash memory
- * @param start  - first address
- * @param end    - last address (or NULL if need to erase all flash remaining)
- * @return 0 if succeed
- */
-static int erase_flash(const void *start, const void *end){
+// erase page @ `addr`; @return 0 if succeed
+static int erase_page(const void *addr){
     int ret = 0;
-    uint32_t nblocks = 1, flsz = 0;
-    if(!end){ // erase all remaining
-        if(FLASH_SIZE > 0 && FLASH_SIZE < 20000){
-            flsz = FLASH_SIZE * 1024; // size in bytes
-            flsz -= (uint32_t)start - FLASH_BASE;
-        }
-    }else{ // erase a part
-        flsz = (uint32_t)end - (uint32_t)start;
+    IWDG->KR = IWDG_REFRESH;
+    while ((FLASH->SR & FLASH_SR_BSY) != 0){}
+    FLASH->SR = FLASH_SR_EOP | FLASH_SR_PGERR | FLASH_SR_WRPRTERR;
+    if ((FLASH->CR & FLASH_CR_LOCK) != 0){
+        FLASH->KEYR = FLASH_KEY1;
+        FLASH->KEYR = FLASH_KEY2;
     }
-    nblocks = flsz / FLASH_BLOCK_SIZE;
-    if(nblocks == 0 || nblocks >= FLASH_SIZE) return 1;
-    for(uint32_t i = 0; i < nblocks; ++i){
-#ifdef EBUG
-        SEND("Try to erase page #"); printu(i); newline(); sendbuf();
-#endif
-        IWDG->KR = IWDG_REFRESH;
-        /* (1) Wait till no operation is on going */
-        /* (2) Clear error & EOP bits */
-        /* (3) Check that the Flash is unlocked */
-        /* (4) Perform unlock sequence */
-        while ((FLASH->SR & FLASH_SR_BSY) != 0){} /* (1) */
-        FLASH->SR = FLASH_SR_EOP | FLASH_SR_PGERR | FLASH_SR_WRPRTERR;  /* (2) */
-      /*  if (FLASH->SR & FLASH_SR_EOP){
-            FLASH->SR |= FLASH_SR_EOP;
-        }*/
-        if ((FLASH->CR & FLASH_CR_LOCK) != 0){ /* (3) */
-            FLASH->KEYR = FLASH_KEY1; /* (4) */
-            FLASH->KEYR = FLASH_KEY2;
-        }
-        /* (1) Set the PER bit in the FLASH_CR register to enable page erasing */
-        /* (2) Program the FLASH_AR register to select a page to erase */
-        /* (3) Set the STRT bit in the FLASH_CR register to start the erasing */
-        /* (4) Wait until the  EOP flag in the FLASH_SR register set */
-        /* (5) Clear EOP flag by software by writing EOP at 1 */
-        /* (6) Reset the PER Bit to disable the page erase */
-        FLASH->CR |= FLASH_CR_PER; /* (1) */
-        FLASH->AR = (uint32_t)Flash_Data + i*FLASH_BLOCK_SIZE; /* (2) */
-        FLASH->CR |= FLASH_CR_STRT; /* (3) */
-        while(!(FLASH->SR & FLASH_SR_EOP));
-        FLASH->SR |= FLASH_SR_EOP; /* (5)*/
-        if(FLASH->SR & FLASH_SR_WRPRTERR){ /* Check Write protection error */
-            ret = 1;
-            MSG("Write protection error!\n");
-            FLASH->SR |= FLASH_SR_WRPRTERR; /* Clear the flag by software by writing it at 1*/
-            break;
-        }
-        FLASH->CR &= ~FLASH_CR_PER; /* (6) */
+    FLASH->CR |= FLASH_CR_PER;
+    FLASH->AR = (uint32_t)addr;
+    FLASH->CR |= FLASH_CR_STRT;
+    while(!(FLASH->SR & FLASH_SR_EOP));
+    FLASH->SR = FLASH_SR_EOP;
+    if(FLASH->SR & FLASH_SR_WRPRTERR){ /* Check Write protection error */
+        ret = 1;
+        MSG("Write protection error!\n");
+        FLASH->SR = FLASH_SR_WRPRTERR;
     }
+    FLASH->CR &= ~FLASH_CR_PER;
     return ret;
 }
 
 void dump_userconf(){
     SEND("userconf_addr="); printuhex((uint32_t)Flash_Data);
+    SEND("\nuserconf_bank="); printu(journal.bank);
+    SEND("\nuserconf_tail="); printu(journal.tail);
     SEND("\nuserconf_sz="); printu(the_conf.userconf_sz);
     SEND("\nCANspeed="); printu(the_conf.CANspeed);
     SEND("\nencoderID="); printuhex(the_conf.encoderID);
@@ -26,6 +26,7 @@
 #include "hardware.h"
 #include "proto.h"
 #include "spi.h"
+#include "strfunc.h"
 #include "usart.h"
 #include "usb.h"
 #include <string.h> // strlen, strcpy(
@@ -38,14 +39,6 @@ static char buff[BUFSZ+1], *bptr = buff;
 static uint8_t blen = 0, // length of data in `buff`
     USBcmd = 0; // ==1 if buffer prepared for USB
 
-char *omit_spaces(char *buf){
-    while(*buf){
-        if(*buf > ' ') break;
-        ++buf;
-    }
-    return buf;
-}
-
 void buftgt(uint8_t isUSB){
     USBcmd = isUSB;
 }
@@ -403,17 +396,8 @@ eof:
 
 // print 32bit unsigned int
 void printu(uint32_t val){
-    char buf[11], *bufptr = &buf[10];
-    *bufptr = 0;
-    if(!val){
-        *(--bufptr) = '0';
-    }else{
-        while(val){
-            *(--bufptr) = val % 10 + '0';
-            val /= 10;
-        }
-    }
-    addtobuf(bufptr);
+    char buf[STR_BUFSZ];
+    addtobuf(u2str_r(val, buf));
 }
 
 // print 32bit unsigned int as hex
@@ -423,80 +407,8 @@ void printuhex(uint32_t val){
     int8_t i, j;
     for(i = 0; i < 4; ++i, --ptr){
         for(j = 1; j > -1; --j){
-            uint8_t half = (*ptr >> (4*j)) & 0x0f;
-            if(half < 10) bufputchar(half + '0');
-            else bufputchar(half - 10 + 'a');
+            int8_t half = (*ptr >> (4*j)) & 0x0f;
+            bufputchar(half + '0' + (((9 - half) >> 7) & ('a' - '0' - 10)));
         }
     }
 }
-
-// THERE'S NO OVERFLOW PROTECTION IN NUMBER READ PROCEDURES!
-// read decimal number
-static char *getdec(char *buf, uint32_t *N){
-    uint32_t num = 0;
-    while(*buf){
-        char c = *buf;
-        if(c < '0' || c > '9'){
-            break;
-        }
-        num *= 10;
-        num += c - '0';
-        ++buf;
-    }
-    *N = num;
-    return buf;
-}
-// read hexadecimal number (without 0x prefix!)
-static char *gethex(char *buf, uint32_t *N){
-    uint32_t num = 0;
-    while(*buf){
-        char c = *buf;
-        uint8_t M = 0;
-        if(c >= '0' && c <= '9'){
-            M = '0';
-        }else if(c >= 'A' && c <= 'F'){
-            M = 'A' - 10;
-        }else if(c >= 'a' && c <= 'f'){
-            M = 'a' - 10;
-        }
-        if(M){
-            num <<= 4;
-            num += c - M;
-        }else{
-            break;
-        }
-        ++buf;
-    }
-    *N = num;
-    return buf;
-}
-// read binary number (without 0b prefix!)
-static char *getbin(char *buf, uint32_t *N){
-    uint32_t num = 0;
-    while(*buf){
-        char c = *buf;
-        if(c < '0' || c > '1'){
-            break;
-        }
-        num <<= 1;
-        if(c == '1') num |= 1;
-        ++buf;
-    }
-    *N = num;
-    return buf;
-}
-
-/**
- * @brief getnum - read uint32_t from string (dec, hex or bin: 127, 0x7f, 0b1111111)
- * @param buf - buffer with number and so on
- * @param N   - the number read
- * @return pointer to first non-number symbol in buf (if it is == buf, there's no number)
- */
-char *getnum(char *txt, uint32_t *N){
-    txt = omit_spaces(txt);
-    if(*txt == '0'){
-        if(txt[1] == 'x' || txt[1] == 'X') return gethex(txt+2, N);
-        if(txt[1] == 'b' || txt[1] == 'B') return getbin(txt+2, N);
-    }
-    return getdec(txt, N);
-}
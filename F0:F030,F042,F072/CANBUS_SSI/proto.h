@@ -39,15 +39,12 @@
 
 extern uint8_t monitCAN;
 
-char *omit_spaces(char *buf);
-
 void cmd_parser(char *buf, uint8_t isUSB);
 void addtobuf(const char *txt);
 void bufputchar(char ch);
 void sendbuf();
 void printu(uint32_t val);
 void printuhex(uint32_t val);
-char *getnum(char *txt, uint32_t *N);
 
 #define TARGET_USB   1
 #define TARGET_USART 0
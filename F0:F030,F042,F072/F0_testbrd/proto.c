@@ -29,11 +29,12 @@
 // local buffer for I2C and SPI data to send
 static uint8_t locBuffer[LOCBUFFSZ];
 
-void USB_sendstr(const char *str){
+int USB_sendstr(const char *str){
     uint16_t l = 0;
     const char *b = str;
     while(*b++) ++l;
     USB_send((const uint8_t*)str, l);
+    return l;
 }
 
 static inline char *chPWM(volatile uint32_t *reg, char *buf){
@@ -98,29 +99,6 @@ static uint16_t readNnumbers(char *buf){
     return N;
 }
 
-// dump memory buffer
-static void hexdump(uint8_t *arr, uint16_t len){
-    char buf[52], *bptr = buf;
-    for(uint16_t l = 0; l < len; ++l, ++arr){
-        for(int16_t j = 1; j > -1; --j){
-            register uint8_t half = (*arr >> (4*j)) & 0x0f;
-            if(half < 10) *bptr++ = half + '0';
-            else *bptr++ = half - 10 + 'a';
-        }
-        if(l % 16 == 15){
-            *bptr++ = '\n';
-            *bptr = 0;
-            USB_sendstr(buf);
-            bptr = buf;
-        }else *bptr++ = ' ';
-    }
-    if(bptr != buf){
-        *bptr++ = '\n';
-        *bptr = 0;
-        USB_sendstr(buf);
-    }
-}
-
 static uint8_t i2cinited = 0;
 static inline char *setupI2C(char *buf){
     buf = omit_spaces(buf);
@@ -158,7 +136,7 @@ static inline void rdI2C(char *buf){
     }
     if(N == 0){ USND("OK"); return; }
     USND("Register "); USB_sendstr(uhex2str(reg)); USND(":\n");
-    hexdump(locBuffer, N);
+    hexdump(USB_sendstr, locBuffer, N);
     /*for(uint32_t i = 0; i < N; ++i){
         if(i < 10) USND(" ");
         USB_sendstr(u2str(i)); USND(": "); USB_sendstr(uhex2str(locBuffer[i]));
@@ -204,7 +182,7 @@ static inline void rdSPI(int SPIidx){
     }
     if(len > LOCBUFFSZ) USND("Can't get full message: buffer too small\n");
     USND("SPI data:\n");
-    hexdump(locBuffer, len);
+    hexdump(USB_sendstr, locBuffer, len);
 }
 
 static inline char *procSPI(char *buf){
@@ -365,185 +343,3 @@ char *get_USB(){
     }
     return NULL;
 }
-
-
-static char *_2str(uint32_t  val, uint8_t minus){
-    static char strbuf[12];
-    char *bufptr = &strbuf[11];
-    *bufptr = 0;
-    if(!val){
-        *(--bufptr) = '0';
-    }else{
-        while(val){
-            *(--bufptr) = val % 10 + '0';
-            val /= 10;
-        }
-    }
-    if(minus) *(--bufptr) = '-';
-    return bufptr;
-}
-
-// return string with number `val`
-char *u2str(uint32_t val){
-    return _2str(val, 0);
-}
-char *i2str(int32_t i){
-    uint8_t minus = 0;
-    uint32_t val;
-    if(i < 0){
-        minus = 1;
-        val = -i;
-    }else val = i;
-    return _2str(val, minus);
-}
-// print 32bit unsigned int as hex
-char *uhex2str(uint32_t val){
-    static char buf[12] = "0x";
-    int npos = 2;
-    uint8_t *ptr = (uint8_t*)&val + 3;
-    int8_t i, j, z=1;
-    for(i = 0; i < 4; ++i, --ptr){
-        if(*ptr == 0){ // omit leading zeros
-            if(i == 3) z = 0;
-            if(z) continue;
-        }
-        else z = 0;
-        for(j = 1; j > -1; --j){
-            uint8_t half = (*ptr >> (4*j)) & 0x0f;
-            if(half < 10) buf[npos++] = half + '0';
-            else buf[npos++] = half - 10 + 'a';
-        }
-    }
-    buf[npos] = 0;
-    return buf;
-}
-
-char *omit_spaces(const char *buf){
-    while(*buf){
-        if(*buf > ' ') break;
-        ++buf;
-    }
-    return (char*)buf;
-}
-
-// In case of overflow return `buf` and N==0xffffffff
-// read decimal number & return pointer to next non-number symbol
-static char *getdec(const char *buf, uint32_t *N){
-    char *start = (char*)buf;
-    uint32_t num = 0;
-    while(*buf){
-        char c = *buf;
-        if(c < '0' || c > '9'){
-            break;
-        }
-        if(num > 429496729 || (num == 429496729 && c > '5')){ // overflow
-            *N = 0xffffff;
-            return start;
-        }
-        num *= 10;
-        num += c - '0';
-        ++buf;
-    }
-    *N = num;
-    return (char*)buf;
-}
-// read hexadecimal number (without 0x prefix!)
-static char *gethex(const char *buf, uint32_t *N){
-    char *start = (char*)buf;
-    uint32_t num = 0;
-    while(*buf){
-        char c = *buf;
-        uint8_t M = 0;
-        if(c >= '0' && c <= '9'){
-            M = '0';
-        }else if(c >= 'A' && c <= 'F'){
-            M = 'A' - 10;
-        }else if(c >= 'a' && c <= 'f'){
-            M = 'a' - 10;
-        }
-        if(M){
-            if(num & 0xf0000000){ // overflow
-                *N = 0xffffff;
-                return start;
-            }
-            num <<= 4;
-            num += c - M;
-        }else{
-            break;
-        }
-        ++buf;
-    }
-    *N = num;
-    return (char*)buf;
-}
-// read octal number (without 0 prefix!)
-static char *getoct(const char *buf, uint32_t *N){
-    char *start = (char*)buf;
-    uint32_t num = 0;
-    while(*buf){
-        char c = *buf;
-        if(c < '0' || c > '7'){
-            break;
-        }
-        if(num & 0xe0000000){ // overflow
-            *N = 0xffffff;
-            return start;
-        }
-        num <<= 3;
-        num += c - '0';
-        ++buf;
-    }
-    *N = num;
-    return (char*)buf;
-}
-// read binary number (without b prefix!)
-static char *getbin(const char *buf, uint32_t *N){
-    char *start = (char*)buf;
-    uint32_t num = 0;
-    while(*buf){
-        char c = *buf;
-        if(c < '0' || c > '1'){
-            break;
-        }
-        if(num & 0x80000000){ // overflow
-            *N = 0xffffff;
-            return start;
-        }
-        num <<= 1;
-        if(c == '1') num |= 1;
-        ++buf;
-    }
-    *N = num;
-    return (char*)buf;
-}
-
-/**
- * @brief getnum - read uint32_t from string (dec, hex or bin: 127, 0x7f, 0b1111111)
- * @param buf - buffer with number and so on
- * @param N   - the number read
- * @return pointer to first non-number symbol in buf
- *      (if it is == buf, there's no number or if *N==0xffffffff there was overflow)
- */
-char *getnum(const char *txt, uint32_t *N){
-    char *nxt = NULL;
-    char *s = omit_spaces(txt);
-    if(*s == '0'){ // hex, oct or 0
-        if(s[1] == 'x' || s[1] == 'X'){ // hex
-            nxt = gethex(s+2, N);
-            if(nxt == s+2) nxt = (char*)txt;
-        }else if(s[1] > '0'-1 && s[1] < '8'){ // oct
-            nxt = getoct(s+1, N);
-            if(nxt == s+1) nxt = (char*)txt;
-        }else{ // 0
-            nxt = s+1;
-            *N = 0;
-        }
-    }else if(*s == 'b' || *s == 'B'){
-        nxt = getbin(s+1, N);
-        if(nxt == s+1) nxt = (char*)txt;
-    }else{
-        nxt = getdec(s, N);
-        if(nxt == s) nxt = (char*)txt;
-    }
-    return nxt;
-}
@@ -20,21 +20,16 @@
 #define PROTO_H__
 
 #include "stm32f0.h"
+#include "strfunc.h"
 
 #define USND(str)  do{USB_send((uint8_t*)str, sizeof(str)-1);}while(0)
 
 extern volatile uint8_t ADCmon;
 
-void USB_sendstr(const char *str);
+int USB_sendstr(const char *str);
 char *get_USB();
 const char *parse_cmd(char *buf);
 
 void printADCvals();
 
-char *u2str(uint32_t val);
-char *i2str(int32_t i);
-char *uhex2str(uint32_t val);
-char *getnum(const char *txt, uint32_t *N);
-char *omit_spaces(const char *buf);
-
 #endif // PROTO_H__
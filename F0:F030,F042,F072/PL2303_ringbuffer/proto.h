@@ -23,9 +23,5 @@
 #include <stm32f0.h>
 
 const char *parse_cmd(const char *buf);
-char *omit_spaces(const char *buf);
-char *getnum(const char *buf, uint32_t *N);
-char *u2str(uint32_t val);
-char *u2hexstr(uint32_t val);
 
 #endif // PROTO_H__
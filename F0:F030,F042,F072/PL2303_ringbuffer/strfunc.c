@@ -0,0 +1 @@
+../../snippets/strfunc.c
\ No newline at end of file
@@ -0,0 +1,210 @@
+/*
+ * This file is part of the MLX90640 project.
+ * Copyright 2022 Edward V. Emelianov <edward.emelianoff@gmail.com>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// fixed-point calculations of mlx90640_calc.c against double reference by datasheet formulas
+// usage: ./calctest [N [seed]] - N synthetic frames (default 100)
+//        ./calctest -d eeprom.dump frame.dump ... - recorded dumps (output of 'g'/'d' commands: "reg value")
+//        ./calctest -b - benchmark
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "mlx90640_calc.h"
+#include "mlx90640_regs.h"
+#include "synth.h"
+
+#define REAL        double
+#define SQRT        sqrt
+#define FN(x)       x ## _d
+#include "ref.h"
+#undef REAL
+#undef SQRT
+#undef FN
+#define REAL        float
+#define SQRT        sqrtf
+#define FN(x)       x ## _f
+#include "ref.h"
+
+// max allowed error of temperature, degrC
+#define MAXERR      (0.02)
+
+static uint16_t eeprom[REG_CALIDATA_LEN];
+static MLX90640_params params;
+static refpar_d rpar_d;
+static refpar_f rpar_f;
+
+static double nsnow(){
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+// synthetic frame with random pixels temperatures in [Tmin, Tmax]
+static void rand_frame(uint16_t *data, double Tmin, double Tmax){
+    static double T[MLX_PIXNO];
+    for(int pix = 0; pix < MLX_PIXNO; ++pix) T[pix] = drand(Tmin, Tmax);
+    synth_frame(data, T);
+}
+
+static int init_params(){
+    if(!mlx90640_get_parameters(eeprom, &params)){
+        printf("mlx90640_get_parameters() failed\n");
+        return FALSE;
+    }
+    if(!ref_params_d(eeprom, &rpar_d) || !ref_params_f(eeprom, &rpar_f) || !synth_init(eeprom)){
+        printf("ref_params() failed\n");
+        return FALSE;
+    }
+    return TRUE;
+}
+
+// statistics of errors
+static double maxerr = 0., maxerr_f = 0., maxvir = 0., sumerr = 0.;
+static long npix = 0;
+
+// compare both subpages of frame; @return max error
+static double check_frame(const uint16_t *data, double *Ta){
+    static int16_t image[MLX_PIXNO], simple[MLX_PIXNO];
+    double fmaxerr = 0.;
+    for(int sp = 0; sp < 2; ++sp){
+        MLX90640_subpage s;
+        refsub_d rs_d;
+        refsub_f rs_f;
+        mlx90640_prepare_subpage(&params, data, sp, &s);
+        mlx90640_process_rows(&params, &s, data, 0, MLX_H, image, 0);
+        mlx90640_process_rows(&params, &s, data, 0, MLX_H, simple, 1);
+        *Ta = ref_prepare_d(&rpar_d, data, sp, &rs_d);
+        ref_prepare_f(&rpar_f, data, sp, &rs_f);
+        for(int pix = 0; pix < MLX_PIXNO; ++pix){
+            if((((pix / MLX_W) ^ pix) & 1) != sp) continue;
+            double T = ref_pixel_d(&rpar_d, &rs_d, data, pix, 0);
+            if(isnan(T)) continue; // out of range
+            double e = fabs(image[pix] / (double)MLX_TSCALE - T);
+            if(e > fmaxerr) fmaxerr = e;
+            sumerr += e; ++npix;
+            e = fabs(ref_pixel_f(&rpar_f, &rs_f, data, pix, 0) - T);
+            if(e > maxerr_f) maxerr_f = e;
+            double vir = ref_pixel_d(&rpar_d, &rs_d, data, pix, 1);
+            if(fabs(vir) * MLX_VIRSCALE > INT16_MAX) continue; // saturated
+            e = fabs(simple[pix] / (double)MLX_VIRSCALE - vir);
+            if(e > maxvir) maxvir = e;
+        }
+    }
+    if(fmaxerr > maxerr) maxerr = fmaxerr;
+    return fmaxerr;
+}
+
+// max relative error of fourth root
+static double check_root4(){
+    double maxe = 0.;
+    for(uint64_t x = 1<<20; x < (1ULL<<32); x += 1 + (x >> 16)){
+        double r = pow(x / 16777216., 0.25), e = fabs(mlx90640_root4((uint32_t)x) / 16777216. - r) / r;
+        if(e > maxe) maxe = e;
+    }
+    return maxe;
+}
+
+#define NBENCH  (64)
+static void bench(){
+    static uint16_t frames[NBENCH][MLX_PIXARRSZ];
+    static int16_t image[MLX_PIXNO];
+    double dsum = 0., fsum = 0.;
+    synth_eeprom(eeprom);
+    if(!init_params()) return;
+    for(int i = 0; i < NBENCH; ++i) rand_frame(frames[i], -20., 300.);
+    double t0 = nsnow();
+    for(int r = 0; r < 16; ++r) for(int i = 0; i < NBENCH; ++i) for(int sp = 0; sp < 2; ++sp){
+        MLX90640_subpage s;
+        mlx90640_prepare_subpage(&params, frames[i], sp, &s);
+        mlx90640_process_rows(&params, &s, frames[i], 0, MLX_H, image, 0);
+    }
+    double pix = 16. * NBENCH * MLX_PIXNO;
+    printf("  fixed point  %8.0f pixels/ms\n", pix / (nsnow() - t0) * 1e6);
+    t0 = nsnow();
+    for(int r = 0; r < 16; ++r) for(int i = 0; i < NBENCH; ++i) for(int sp = 0; sp < 2; ++sp){
+        refsub_f s;
+        ref_prepare_f(&rpar_f, frames[i], sp, &s);
+        for(int p = 0; p < MLX_PIXNO; ++p) if((((p / MLX_W) ^ p) & 1) == sp)
+            fsum += ref_pixel_f(&rpar_f, &s, frames[i], p, 0);
+    }
+    printf("  float        %8.0f pixels/ms (mean T=%.1f)\n", pix / (nsnow() - t0) * 1e6, fsum / pix);
+    t0 = nsnow();
+    for(int r = 0; r < 16; ++r) for(int i = 0; i < NBENCH; ++i) for(int sp = 0; sp < 2; ++sp){
+        refsub_d s;
+        ref_prepare_d(&rpar_d, frames[i], sp, &s);
+        for(int p = 0; p < MLX_PIXNO; ++p) if((((p / MLX_W) ^ p) & 1) == sp)
+            dsum += ref_pixel_d(&rpar_d, &s, frames[i], p, 0);
+    }
+    printf("  double       %8.0f pixels/ms (mean T=%.1f)\n", pix / (nsnow() - t0) * 1e6, dsum / pix);
+    printf("(host FPU: on F103 float is emulated, so compare on MCU by `mlx_tproc`)\n");
+}
+
+static void report(){
+    printf("Max error: %.4f degrC (float: %.4f), mean: %.5f degrC; max error of Vir: %.4f\n",
+           maxerr, maxerr_f, sumerr / npix, maxvir);
+}
+
+int main(int argc, char **argv){
+    static uint16_t data[MLX_PIXARRSZ];
+    double Ta, root4err = check_root4();
+    printf("Max relative error of mlx90640_root4(): %.3g\n", root4err);
+    printf("Calibration parameters: %zu bytes, image: %zu bytes\n", sizeof(MLX90640_params),
+           MLX_PIXNO * sizeof(int16_t));
+    if(argc > 1 && 0 == strcmp(argv[1], "-b")){
+        srandom(time(NULL));
+        bench();
+        return 0;
+    }
+    if(argc > 2 && 0 == strcmp(argv[1], "-d")){ // recorded data
+        if(REG_CALIDATA_LEN != read_dump(argv[2], eeprom, NULL)){
+            printf("%s: not full EEPROM dump\n", argv[2]);
+            return 1;
+        }
+        if(!init_params()) return 1;
+        for(int i = 3; i < argc; ++i){
+            if(MLX_PIXARRSZ != read_dump(argv[i], NULL, data)){
+                printf("%s: not full frame dump\n", argv[i]);
+                continue;
+            }
+            double e = check_frame(data, &Ta);
+            printf("%s: Ta=%.2f, max error %.4f\n", argv[i], Ta, e);
+        }
+        report();
+        return (maxerr > MAXERR || root4err > 1e-6);
+    }
+    long N = (argc > 1) ? atol(argv[1]) : 100;
+    unsigned seed = (argc > 2) ? (unsigned)atol(argv[2]) : (unsigned)time(NULL);
+    srandom(seed);
+    for(long i = 0; i < N; ++i){
+        if(i % 10 == 0){ // new sensor
+            synth_eeprom(eeprom);
+            if(!init_params()) return 1;
+        }
+        rand_frame(data, -40., 300.);
+        check_frame(data, &Ta);
+    }
+    report();
+    if(maxerr > MAXERR || root4err > 1e-6){
+        printf("FAIL (seed %u)\n", seed);
+        return 1;
+    }
+    printf("Test passed (%ld synthetic frames, seed %u)\n", N, seed);
+    return 0;
+}
@@ -0,0 +1 @@
+../mlx90640_calc.h
\ No newline at end of file
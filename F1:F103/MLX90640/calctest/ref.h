@@ -0,0 +1,117 @@
+/*
+ * This file is part of the MLX90640 project.
+ * Copyright 2022 Edward V. Emelianov <edward.emelianoff@gmail.com>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Reference calculation by datasheet formulas (basic temperature range, emissivity 1) like old
+// floating point code of mlx90640.c. Included twice: with REAL=double (reference) and REAL=float (old math).
+// Define REAL, SQRT and FN(name) before including.
+
+typedef struct{
+    REAL kVdd, vdd25, KvPTAT, KtPTAT, vPTAT25, alphaPTAT, gainEE, tgc, cpKv, cpKta, KsTa, KsTo2;
+    REAL kv[4], cpAlpha[2], cpOffset[2];
+    REAL offset[MLX_PIXNO], kta[MLX_PIXNO], alpha[MLX_PIXNO];
+} FN(refpar);
+
+// values common for subpage
+typedef struct{
+    REAL dVdd, dTa, Kgain, TaK4, pixOScp;
+} FN(refsub);
+
+#define EE(reg)     ee[CREG_IDX(reg)]
+// signed value of `bits` bits
+#define SGN(v, bits) ((int)(v) >= (1<<((bits)-1)) ? (int)(v) - (1<<(bits)) : (int)(v))
+#define P2(x)       ((REAL)(1LL<<(x)))
+
+static inline int FN(ref_params)(const uint16_t *ee, FN(refpar) *p){
+    p->kVdd = SGN(EE(REG_VDD) >> 8, 8) * 32;
+    if(p->kVdd == 0) return FALSE;
+    p->vdd25 = ((int)(EE(REG_VDD) & 0xff) - 256) * 32 - 8192;
+    p->KvPTAT = SGN(EE(REG_KVTPTAT) >> 10, 6) / P2(12);
+    p->KtPTAT = SGN(EE(REG_KVTPTAT) & 0x3ff, 10) / P2(3);
+    p->vPTAT25 = (int16_t)EE(REG_PTAT);
+    p->alphaPTAT = (EE(REG_APTATOCCS) >> 12) / P2(2) + 8;
+    p->gainEE = (int16_t)EE(REG_GAIN);
+    int occRemScale = EE(REG_APTATOCCS) & 0xf, occColScale = (EE(REG_APTATOCCS) >> 4) & 0xf,
+        occRowScale = (EE(REG_APTATOCCS) >> 8) & 0xf;
+    int accRemScale = EE(REG_SCALEACC) & 0xf, accColScale = (EE(REG_SCALEACC) >> 4) & 0xf,
+        accRowScale = (EE(REG_SCALEACC) >> 8) & 0xf, alphaScale = (EE(REG_SCALEACC) >> 12) + 30;
+    int ktaScale1 = ((EE(REG_KTAVSCALE) >> 4) & 0xf) + 8, ktaScale2 = EE(REG_KTAVSCALE) & 0xf,
+        kvScale = (EE(REG_KTAVSCALE) >> 8) & 0xf;
+    // Kta_RC_EE and Kv: index is 2*(row&1) + (col&1) for rows and columns starting from 0
+    int ktarc[4] = {SGN(EE(REG_KTAAVGODDCOL) >> 8, 8), SGN(EE(REG_KTAAVGEVENCOL) >> 8, 8),
+                    SGN(EE(REG_KTAAVGODDCOL) & 0xff, 8), SGN(EE(REG_KTAAVGEVENCOL) & 0xff, 8)};
+    uint16_t kvavg = EE(REG_KVAVG);
+    int kvrc[4] = {SGN(kvavg >> 12, 4), SGN((kvavg >> 4) & 0xf, 4), SGN((kvavg >> 8) & 0xf, 4), SGN(kvavg & 0xf, 4)};
+    for(int i = 0; i < 4; ++i) p->kv[i] = kvrc[i] / P2(kvScale);
+    p->tgc = SGN(EE(REG_KSTATGC) & 0xff, 8) / P2(5);
+    p->KsTa = SGN(EE(REG_KSTATGC) >> 8, 8) / P2(13);
+    p->KsTo2 = SGN(EE(REG_KSTO12) >> 8, 8) / P2((EE(REG_CT34) & 0xf) + 8);
+    p->cpOffset[0] = SGN(EE(REG_CPOFF) & 0x3ff, 10);
+    p->cpOffset[1] = p->cpOffset[0] + SGN(EE(REG_CPOFF) >> 10, 6);
+    p->cpAlpha[0] = (EE(REG_ALPHA) & 0x3ff) / P2((EE(REG_SCALEACC) >> 12) + 27);
+    p->cpAlpha[1] = p->cpAlpha[0] * (1 + SGN(EE(REG_ALPHA) >> 10, 6) / P2(7));
+    p->cpKta = SGN(EE(REG_KVTACP) & 0xff, 8) / P2(ktaScale1);
+    p->cpKv = SGN(EE(REG_KVTACP) >> 8, 8) / P2(kvScale);
+    for(int row = 0; row < MLX_H; ++row){
+        int occrow = SGN((EE(REG_OCCROW14 + row/4) >> (4*(row%4))) & 0xf, 4);
+        int accrow = SGN((EE(REG_ACCROW14 + row/4) >> (4*(row%4))) & 0xf, 4);
+        for(int col = 0; col < MLX_W; ++col){
+            int occcol = SGN((EE(REG_OCCCOL14 + col/4) >> (4*(col%4))) & 0xf, 4);
+            int acccol = SGN((EE(REG_ACCCOL14 + col/4) >> (4*(col%4))) & 0xf, 4);
+            int pix = row*MLX_W + col;
+            uint16_t v = EE(REG_OFFAK1 + pix);
+            p->offset[pix] = (int16_t)EE(REG_OSAVG) + occrow*P2(occRowScale) + occcol*P2(occColScale)
+                    + SGN(v >> 10, 6)*P2(occRemScale);
+            p->kta[pix] = (ktarc[2*(row&1) + (col&1)] + SGN((v >> 1) & 7, 3)*P2(ktaScale2)) / P2(ktaScale1);
+            p->alpha[pix] = (EE(REG_SENSIVITY) + accrow*P2(accRowScale) + acccol*P2(accColScale)
+                    + SGN((v >> 4) & 0x3f, 6)*P2(accRemScale)) / P2(alphaScale);
+        }
+    }
+    return TRUE;
+}
+
+// @return Ta
+static inline REAL FN(ref_prepare)(const FN(refpar) *p, const uint16_t *data, int sp, FN(refsub) *s){
+    s->dVdd = ((int16_t)data[IMD_IDX(REG_IVDDPIX)] - p->vdd25) / p->kVdd;
+    REAL ptat = (int16_t)data[IMD_IDX(REG_ITAPTAT)], vbe = (int16_t)data[IMD_IDX(REG_ITAVBE)];
+    REAL vptatart = ptat / (ptat * p->alphaPTAT + vbe) * P2(18);
+    s->dTa = (vptatart / (1 + p->KvPTAT * s->dVdd) - p->vPTAT25) / p->KtPTAT;
+    s->Kgain = p->gainEE / (REAL)(int16_t)data[IMD_IDX(REG_IGAIN)];
+    REAL TaK = s->dTa + 25 + (REAL)273.15;
+    s->TaK4 = TaK*TaK*TaK*TaK;
+    REAL cp = (int16_t)data[IMD_IDX(sp ? REG_ICPSP1 : REG_ICPSP0)] * s->Kgain;
+    s->pixOScp = cp - p->cpOffset[sp] * (1 + p->cpKta * s->dTa) * (1 + p->cpKv * s->dVdd);
+    return s->dTa + 25;
+}
+
+// temperature of pixel (or IR compensated signal if `simple`)
+static inline REAL FN(ref_pixel)(const FN(refpar) *p, const FN(refsub) *s, const uint16_t *data, int pix, int simple){
+    int row = pix / MLX_W, col = pix % MLX_W, sp = (row ^ col) & 1;
+    REAL pixos = (int16_t)data[pix] * s->Kgain
+            - p->offset[pix] * (1 + p->kta[pix] * s->dTa) * (1 + p->kv[2*(row&1) + (col&1)] * s->dVdd);
+    REAL vir = pixos - p->tgc * s->pixOScp;
+    if(simple) return vir;
+    REAL alpha = (p->alpha[pix] - p->tgc * p->cpAlpha[sp]) * (1 + p->KsTa * s->dTa);
+    REAL Sx = alpha*alpha*alpha * vir + alpha*alpha*alpha*alpha * s->TaK4;
+    Sx = p->KsTo2 * SQRT(SQRT(Sx));
+    REAL To = vir / (alpha * (1 - p->KsTo2 * (REAL)273.15) + Sx) + s->TaK4;
+    return SQRT(SQRT(To)) - (REAL)273.15;
+}
+
+#undef EE
+#undef SGN
+#undef P2
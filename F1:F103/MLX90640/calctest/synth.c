@@ -0,0 +1,127 @@
+/*
+ * This file is part of the MLX90640 project.
+ * Copyright 2022 Edward V. Emelianov <edward.emelianoff@gmail.com>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// synthetic and recorded data of sensor (used by calctest and emulator)
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "mlx90640_calc.h"
+#include "mlx90640_regs.h"
+#include "synth.h"
+
+#define REAL        double
+#define SQRT        sqrt
+#define FN(x)       x ## _d
+#include "ref.h"
+
+static refpar_d rpar; // reference parameters of current EEPROM for synth_frame()
+
+double drand(double min, double max){
+    return min + (max - min) * random() / (double)RAND_MAX;
+}
+
+#define EEW(reg)    ee[CREG_IDX(reg)]
+
+// synthetic EEPROM: common words like in datasheet example, random per-pixel values
+void synth_eeprom(uint16_t *ee){
+    EEW(REG_APTATOCCS) = 0x4210;
+    EEW(REG_OSAVG) = (uint16_t)(-60 - random() % 20);
+    for(int i = 0; i < 14; ++i){ // OCC and ACC rows/columns
+        uint16_t occ = 0, acc = 0;
+        for(int n = 0; n < 4; ++n){
+            occ |= (random() & 0xf) << (4*n);
+            acc |= ((random() % 7 - 3) & 0xf) << (4*n);
+        }
+        EEW(REG_OCCROW14 + i) = occ;
+        EEW(REG_ACCROW14 + i) = acc;
+    }
+    EEW(REG_SCALEACC) = 0x79a6;
+    EEW(REG_SENSIVITY) = 11000 + random() % 2000;
+    EEW(REG_GAIN) = 6000 + random() % 500;
+    EEW(REG_PTAT) = 12273;
+    EEW(REG_KVTPTAT) = 0x5952;
+    EEW(REG_VDD) = 0x9d68;
+    EEW(REG_KVAVG) = 0x2363;
+    EEW(REG_KTAAVGODDCOL) = 0x5354;
+    EEW(REG_KTAAVGEVENCOL) = 0x5554;
+    EEW(REG_KTAVSCALE) = 0x2363;
+    EEW(REG_ALPHA) = (2<<10) | (60 + random() % 30);
+    EEW(REG_CPOFF) = 0x0bb5;
+    EEW(REG_KVTACP) = 0x0444;
+    EEW(REG_KSTATGC) = 0xf000 | (random() % 32);
+    EEW(REG_KSTO12) = 0x9797;
+    EEW(REG_KSTO34) = 0x9797;
+    EEW(REG_CT34) = 0x2cb9;
+    for(int i = 0; i < MLX_PIXNO; ++i) EEW(REG_OFFAK1 + i) = (uint16_t)(random() & 0xfffe);
+}
+
+// reference parameters for synth_frame(); @return FALSE if EEPROM data is wrong
+int synth_init(const uint16_t *ee){
+    return ref_params_d(ee, &rpar);
+}
+
+// synthetic frame with given temperatures of pixels (degrC): inverse of reference formula
+void synth_frame(uint16_t *data, const double *T){
+    const refpar_d *p = &rpar;
+    refsub_d s[2];
+    data[IMD_IDX(REG_IVDDPIX)] = (uint16_t)(int16_t)(p->vdd25 + random() % 600 - 300);
+    data[IMD_IDX(REG_ITAPTAT)] = 1650 + random() % 110;
+    data[IMD_IDX(REG_ITAVBE)] = 19000 + random() % 800;
+    data[IMD_IDX(REG_IGAIN)] = (uint16_t)(p->gainEE * drand(0.97, 1.03));
+    data[IMD_IDX(REG_ICPSP0)] = (uint16_t)(int16_t)(p->cpOffset[0] + random() % 40 - 20);
+    data[IMD_IDX(REG_ICPSP1)] = (uint16_t)(int16_t)(p->cpOffset[1] + random() % 40 - 20);
+    ref_prepare_d(p, data, 0, &s[0]);
+    ref_prepare_d(p, data, 1, &s[1]);
+    for(int pix = 0; pix < MLX_PIXNO; ++pix){
+        int row = pix / MLX_W, col = pix % MLX_W, sp = (row ^ col) & 1;
+        const refsub_d *S = &s[sp];
+        double To = T[pix] + 273.15, Y = To*To*To*To - S->TaK4, X = Y;
+        // X/(1 + KsTo2*(T1 - 273.15)) = Y, T1 = root4(X + Ta^4)
+        for(int i = 0; i < 20; ++i) X = Y * (1. + p->KsTo2 * (pow(X + S->TaK4, 0.25) - 273.15));
+        double alpha = (p->alpha[pix] - p->tgc * p->cpAlpha[sp]) * (1 + p->KsTa * S->dTa);
+        double pixos = X * alpha + p->tgc * S->pixOScp;
+        double gain = pixos + p->offset[pix] * (1 + p->kta[pix] * S->dTa) * (1 + p->kv[2*(row&1) + (col&1)] * S->dVdd);
+        double raw = round(gain / S->Kgain);
+        if(raw > 32767) raw = 32767;
+        if(raw < -32768) raw = -32768;
+        data[pix] = (uint16_t)(int16_t)raw;
+    }
+}
+
+// read dump made by 'g' or 'd' command; @return amount of values read
+int read_dump(const char *name, uint16_t *ee, uint16_t *data){
+    FILE *f = fopen(name, "r");
+    if(!f){
+        perror(name);
+        return 0;
+    }
+    unsigned reg, val;
+    int n = 0;
+    char line[128];
+    while(fgets(line, sizeof(line), f)){
+        if(2 != sscanf(line, "%x %x", &reg, &val)) continue;
+        if(ee && reg >= REG_CALIDATA && reg < REG_CALIDATA + REG_CALIDATA_LEN){
+            ee[reg - REG_CALIDATA] = (uint16_t)val; ++n;
+        }else if(data && reg >= REG_IMAGEDATA && reg < REG_IMAGEDATA + MLX_PIXARRSZ){
+            data[reg - REG_IMAGEDATA] = (uint16_t)val; ++n;
+        }
+    }
+    fclose(f);
+    return n;
+}
@@ -0,0 +1,30 @@
+/*
+ * This file is part of the MLX90640 project.
+ * Copyright 2022 Edward V. Emelianov <edward.emelianoff@gmail.com>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+#ifndef SYNTH_H__
+#define SYNTH_H__
+
+#include <stdint.h>
+
+double drand(double min, double max);
+void synth_eeprom(uint16_t *ee);
+int synth_init(const uint16_t *ee);
+void synth_frame(uint16_t *data, const double *T);
+int read_dump(const char *name, uint16_t *ee, uint16_t *data);
+
+#endif // SYNTH_H__
@@ -32,15 +32,16 @@ volatile i2c_dma_status i2cDMAr = I2C_DMA_NOTINIT;
 // current addresses for read/write (should be set with i2c_set_addr7)
 static uint8_t addr7r = 0, addr7w = 0;
 
-// setup DMA receiver
+// setup DMA receiver (and stop previous receiving if any)
 static void i2c_DMAr_setup(){
     /* Enable the peripheral clock DMA1 */
     RCC->AHBENR |= RCC_AHBENR_DMA1EN;
+    DMA1_Channel7->CCR = 0;
+    DMA1->IFCR = DMA_IFCR_CGIF7;
     DMA1_Channel7->CPAR = (uint32_t)&(I2C1->DR);
-    DMA1_Channel7->CCR |= DMA_CCR_MINC | DMA_CCR_TCIE;
+    DMA1_Channel7->CCR = DMA_CCR_MINC | DMA_CCR_TCIE | DMA_CCR_TEIE;
     NVIC_SetPriority(DMA1_Channel7_IRQn, 0);
     NVIC_EnableIRQ(DMA1_Channel7_IRQn);
-    I2C1->CR2 |= I2C_CR2_DMAEN;
     i2cDMAr = I2C_DMA_RELAX;
 }
 
@@ -57,12 +58,10 @@ void i2c_setup(uint8_t withDMA){
     I2C1->SR1 = 0;
     RCC->APB1RSTR |=  RCC_APB1RSTR_I2C1RST; // reset peripherial
     RCC->APB1RSTR &= ~RCC_APB1RSTR_I2C1RST;
-    I2C1->CR2 = 8; // FREQR=8MHz, T=125ns
-    //I2C1->CR2 = 10; // FREQR=10MHz, T=100ns
-    I2C1->TRISE = 9; // (9-1)*125 = 1us
-    //I2C1->TRISE = 4; // (4-1)*100 = 300ns
-    I2C1->CCR = 40; // normal mode, 8MHz/2/40 = 100kHz
-    //I2C1->CCR = I2C_CCR_FS | 10; // fast mode, 10MHz/2/10 = 500kHz
+    // F1 has no Fast-mode Plus, so use max speed of 400kHz: 1664 bytes of subpage are read in 37ms
+    I2C1->CR2 = 36; // FREQR=36MHz (APB1), T=27.8ns
+    I2C1->TRISE = 11; // 300ns/27.8ns + 1
+    I2C1->CCR = I2C_CCR_FS | 30; // fast mode, Tlow/Thigh=2, 36MHz/3/30 = 400kHz
     if(withDMA) i2c_DMAr_setup();
     I2C1->CR1 |= I2C_CR1_PE; // enable periph
 }
@@ -235,12 +234,14 @@ eotr:
  */
 i2c_status i2c_7bit_receive_DMA(uint8_t *data, uint16_t nbytes){
     if(i2cDMAr == I2C_DMA_BUSY) return I2C_LINEBUSY; // previous receiving still works
+    if(nbytes < 2) return I2C_HWPROBLEM; // LAST bit works only for 2 bytes and more
     if(i2cDMAr == I2C_DMA_NOTINIT) i2c_DMAr_setup();
     i2c_status ret = I2C_LINEBUSY;
     DBG("Conf DMA");
     DMA1_Channel7->CCR &= ~DMA_CCR_EN;
     DMA1_Channel7->CMAR = (uint32_t)data;
     DMA1_Channel7->CNDTR = nbytes;
+    I2C1->CR2 |= I2C_CR2_DMAEN | I2C_CR2_LAST; // NACK after last byte will be sent by hardware
     // now send address and start I2C receiving
     //DBG("linew");
     //I2C_LINEWAIT();
@@ -252,19 +253,26 @@ i2c_status i2c_7bit_receive_DMA(uint8_t *data, uint16_t nbytes){
     I2C1->DR = addr7r;
     DBG("wait addr");
     I2C_WAIT(I2C1->SR1 & I2C_SR1_ADDR);
-    if(I2C1->SR1 & I2C_SR1_AF) return I2C_NACK;
+    if(I2C1->SR1 & I2C_SR1_AF){
+        ret = I2C_NACK;
+        goto eotr;
+    }
+    DMA1_Channel7->CCR |= DMA_CCR_EN;   // enable DMA before clearing ADDR: first byte comes just after it
+    i2cDMAr = I2C_DMA_BUSY;
     (void) I2C1->SR2;
     DBG("start");
-    DMA1_Channel7->CCR |= DMA_CCR_EN;
-    i2cDMAr = I2C_DMA_BUSY;
-    ret = I2C_OK;
+    return I2C_OK;
 eotr:
+    I2C1->CR2 &= ~(I2C_CR2_DMAEN | I2C_CR2_LAST);
     return ret;
 }
 
+// end of DMA receiving: all data is in buffer or transfer error occured
 void dma1_channel7_isr(){
     I2C1->CR1 |= I2C_CR1_STOP; // send STOP
-    DMA1->IFCR = DMA_IFCR_CTCIF7;
+    I2C1->CR2 &= ~(I2C_CR2_DMAEN | I2C_CR2_LAST);
     DMA1_Channel7->CCR &= ~DMA_CCR_EN;
-    i2cDMAr = I2C_DMA_READY;
+    if(DMA1->ISR & DMA_ISR_TEIF7) i2cDMAr = I2C_DMA_ERROR;
+    else i2cDMAr = I2C_DMA_READY;
+    DMA1->IFCR = DMA_IFCR_CGIF7;
 }
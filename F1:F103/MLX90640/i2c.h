@@ -33,7 +33,8 @@ typedef enum{
     I2C_DMA_NOTINIT,
     I2C_DMA_RELAX,
     I2C_DMA_BUSY,
-    I2C_DMA_READY
+    I2C_DMA_READY,
+    I2C_DMA_ERROR
 } i2c_dma_status;
 
 extern volatile i2c_dma_status i2cDMAr;
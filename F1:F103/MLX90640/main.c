@@ -46,7 +46,6 @@ int main(void){
 #endif
     USBPU_ON();
     i2c_setup(TRUE);
-    i2c_set_addr7(MLX_DEFAULT_ADDR);
 
     while(1){
         IWDG->KR = IWDG_REFRESH; // refresh watchdog
@@ -65,6 +64,7 @@ int main(void){
             }
         }
         mlx90640_process();
+        stream_proc();
     }
     return 0;
 }
@@ -20,6 +20,7 @@
 #define MLX90640__
 
 #include <stm32f1.h>
+#include "mlx90640_calc.h"
 
 // timeout for reading operations, ms
 #define MLX_TIMEOUT         1000
@@ -29,38 +30,13 @@
 #define MLX_POWOFF_WAIT     500
 // wait after power on, ms
 #define MLX_POWON_WAIT      2000
+// amount of rows processed by one call of mlx90640_process()
+#define MLX_PROCROWS        (4)
 
-// amount of pixels
-#define MLX_W               (32)
-#define MLX_H               (24)
-#define MLX_PIXNO           (MLX_W*MLX_H)
-// pixels + service data
-#define MLX_PIXARRSZ        (MLX_PIXNO + 64)
-
-typedef struct{
-    int16_t kVdd;
-    int16_t vdd25;
-    float KvPTAT;
-    float KtPTAT;
-    int16_t vPTAT25;
-    float alphaPTAT;
-    int16_t gainEE;
-    float tgc;
-    float cpKv;     // K_V_CP
-    float cpKta;    // K_Ta_CP
-    float KsTa;
-    float CT[3]; // range borders (0, 160, 320 degrC?)
-    float ksTo[4]; // K_S_To for each range * 273.15
-    float alphacorr[4]; // Alpha_corr for each range
-    float alpha[MLX_PIXNO]; // full - with alpha_scale
-    float offset[MLX_PIXNO];
-    float kta[MLX_PIXNO]; // full K_ta - with scale1&2
-    float kv[4];  // full - with scale; 0 - odd row, odd col; 1 - odd row even col; 2 - even row, odd col; 3 - even row, even col
-    float cpAlpha[2];   // alpha_CP_subpage 0 and 1
-    int16_t cpOffset[2];
-} MLX90640_params;
-
-extern MLX90640_params params;
+// max amount of sensors on I2C bus (each needs ~7.8k of RAM, so 20k MCU serves only one)
+#ifndef MLX_MAXSENSORS
+#define MLX_MAXSENSORS      (1)
+#endif
 
 typedef enum{
     M_ERROR,            // error: need to reboot sensor
@@ -77,20 +53,52 @@ typedef enum{
     M_STATES_AMOUNT     // amount of states
 } mlx90640_state;
 
-extern mlx90640_state mlx_state;
-extern float mlx_image[MLX_PIXNO];
+// context of one sensor
+typedef struct{
+    MLX90640_params params;         // calibration parameters
+    int16_t imbuf[2][MLX_PIXNO];    // image: one buffer is filled by subpages while another holds last complete frame
+    mlx90640_state state;
+    uint32_t subpages, frames;      // amount of subpages and full frames (both subpages) processed
+    uint32_t tread, tproc;          // time of last subpage readout and processing, ms
+    uint32_t Tlast, Tpoll;          // time of last state change and of last status polling
+    float Ta, Vdd;                  // ambient temperature and supply voltage of last subpage
+    uint8_t addr;                   // 7-bit I2C address
+    uint8_t simpleimage;            // ==1 if last complete image contains IR signal instead of T
+    uint8_t simple;                 // ==1 not to calibrate T in image being taken
+    uint8_t subpageno;              // subpage number
+    uint8_t continuous;             // ==1 in continuous mode
+    uint8_t refresh;                // refresh rate code (0 - 0.5Hz, 1 - 1Hz, ..., 5 - 16Hz, 7 - 64Hz)
+    uint8_t reconf;                 // ==1 to rewrite REG_CONTROL in continuous mode
+    uint8_t imagereq;               // ==1 if image was requested before calibration data was read
+    uint8_t fillbuf;                // image buffer being filled
+    uint8_t spdone;                 // bitmask of subpages processed into `fillbuf`
+    uint8_t errctr;                 // counter of errors
+} mlx_sensor;
+
+// last complete image of sensor `s` (degrC*MLX_TSCALE or Vir*MLX_VIRSCALE)
+#define MLX_IMAGE(s)        ((s)->imbuf[!(s)->fillbuf])
+
+extern mlx_sensor mlx_sensors[MLX_MAXSENSORS];
+extern uint8_t mlx_nsensors, mlx_roisensor;
+extern const int16_t *mlx_spimage;
+extern uint8_t mlx_lastsp, mlx_spsimple, mlx_spsensor;
+extern uint32_t mlx_subpages;
+extern uint8_t mlx_roialarm;
 
 // default I2C address
 #define MLX_DEFAULT_ADDR    (0x33)
 // max datalength by one read (in 16-bit values)
 #define MLX_DMA_MAXLEN      (832)
 
-int read_reg(uint16_t reg, uint16_t *val);
-int write_reg(uint16_t reg, uint16_t val);
-uint16_t *read_data(uint16_t reg, uint16_t *N);
-int read_data_dma(uint16_t reg, int N);
+int read_reg(uint8_t n, uint16_t reg, uint16_t *val);
+int write_reg(uint8_t n, uint16_t reg, uint16_t val);
+uint16_t *read_data(uint8_t n, uint16_t reg, uint16_t *N);
+uint16_t *read_data_dma(uint8_t n, uint16_t reg, int N);
 void mlx90640_process();
-int mlx90640_take_image(uint8_t simple);
+int mlx90640_take_image(uint8_t n, uint8_t simple);
+int mlx90640_continuous(uint8_t n, int rate);
 void mlx90640_restart();
+int mlx90640_setaddr(uint8_t n, uint8_t addr);
+int mlx90640_discover();
 
 #endif // MLX90640__
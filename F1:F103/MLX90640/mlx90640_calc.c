@@ -0,0 +1,387 @@
+/*
+ * This file is part of the MLX90640 project.
+ * Copyright 2022 Edward V. Emelianov <edward.emelianoff@gmail.com>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "mlx90640_calc.h"
+#include "mlx90640_regs.h"
+
+// F103 has no FPU, so all per-pixel calculations are in fixed point:
+// floats are used only once per calibration or subpage. Temperature of pixel (datasheet, basic range):
+//   To^4 = Vir/alpha' / (1 + KsTo2*(T1 - 273.15)) + Ta^4, where T1^4 = Vir/alpha' + Ta^4;
+// this is equivalent to datasheet formula with Sx = KsTo2*alpha'*T1, so To = Ta*root4(1 + X/Ta^4)
+
+#define CREG(reg)   eeprom[CREG_IDX(reg)]
+#define IMD(reg)    data[IMD_IDX(reg)]
+
+// float -> int32 with rounding and saturation
+static int32_t f2i(float x){
+    if(x >= 2147483520.f) return INT32_MAX;
+    if(x <= -2147483520.f) return INT32_MIN;
+    return (int32_t)(x < 0.f ? x - 0.5f : x + 0.5f);
+}
+
+// max n <= nmax for which val*2^n < lim
+static int fitexp(float val, float lim, int nmax){
+    int n = 0;
+    if(val <= 0.f) return nmax;
+    while(n < nmax && val < lim * 0.5f){ val *= 2.f; ++n; }
+    while(val >= lim){ val *= 0.5f; --n; }
+    return n;
+}
+
+// 2^n
+static float p2(int n){
+    return (n < 0) ? 1.f / (float)(1<<(-n)) : (float)(1<<n);
+}
+
+// scales of per-pixel calibration values
+typedef struct{
+    int8_t occRow[MLX_H], occColumn[MLX_W], accRow[MLX_H], accColumn[MLX_W];
+    int8_t ktaavg[4];
+    float occRowScale, occColumnScale, occRemScale, offavg;
+    float accRowScale, accColumnScale, accRemScale, a_r, diva;
+    float ktamul, ktadiv;
+} pixscales;
+
+// calculate offset, offset*K_ta and alpha - TGC*alpha_CP of pixel by its EEPROM value `rv`
+static void pixcalib(const pixscales *sc, const MLX90640_params *p, uint16_t rv, int row, int col,
+                     float *o, float *okta, float *a){
+    int16_t i16 = (rv & 0xFC00) >> 10;
+    if(i16 > 0x1F) i16 -= 0x40;
+    *o = sc->offavg + (float)sc->occRow[row]*sc->occRowScale + (float)sc->occColumn[col]*sc->occColumnScale
+            + (float)i16*sc->occRemScale;
+    i16 = (rv & 0xF) >> 1;
+    if(i16  > 0x03) i16 -= 0x08;
+    *okta = *o * (sc->ktaavg[((row&1)<<1)|(col&1)] + i16*sc->ktamul) / sc->ktadiv;
+    i16 = (rv & 0x3F0) >> 4;
+    if(i16 > 0x1F) i16 -= 0x40;
+    *a = (sc->a_r + sc->accRow[row]*sc->accRowScale + sc->accColumn[col]*sc->accColumnScale
+            + i16*sc->accRemScale) / sc->diva;
+    *a -= p->tgc * p->cpAlpha[(row^col)&1];
+}
+
+// fill OCC/ACC row/col arrays
+static void occacc(int8_t *arr, int l, const uint16_t *regstart){
+    int n = l >> 2; // divide by 4
+    int8_t *p = arr;
+    for(int i = 0; i < n; ++i){
+        register uint16_t val = *regstart++;
+        *p++ = (val & 0x000F) >> 0;
+        *p++ = (val & 0x00F0) >> 4;
+        *p++ = (val & 0x0F00) >> 8;
+        *p++ = (val         ) >> 12;
+    }
+    for(int i = 0; i < l; ++i, ++arr){
+        if(*arr > 0x07) *arr -= 0x10;
+    }
+}
+
+/**
+ * @brief mlx90640_get_parameters - calculate parameters and per-pixel constants from EEPROM data
+ * @param eeprom - REG_CALIDATA_LEN words starting from REG_CALIDATA (little endian)
+ * @param p (o)  - parameters
+ * @return FALSE if something failed
+ */
+int mlx90640_get_parameters(const uint16_t *eeprom, MLX90640_params *p){
+    int8_t i8;
+    int16_t i16;
+    const uint16_t *pu16;
+    uint16_t val = CREG(REG_VDD);
+    i8 = (int8_t) (val >> 8);
+    p->kVdd = i8 << 5;
+    if(p->kVdd == 0) return FALSE;
+    i16 = val & 0xFF;
+    p->vdd25 = ((i16 - 0x100) << 5) - (1<<13);
+    val = CREG(REG_KVTPTAT);
+    i16 = (val & 0xFC00) >> 10;
+    if(i16 > 0x1F) i16 -= 0x40;
+    p->KvPTAT = (float)i16 / (1<<12);
+    i16 = (val & 0x03FF);
+    if(i16 > 0x1FF) i16 -= 0x400;
+    p->KtPTAT = (float)i16 / 8.f;
+    if(i16 == 0) return FALSE;
+    p->vPTAT25 = (int16_t) CREG(REG_PTAT);
+    val = CREG(REG_APTATOCCS) >> 12;
+    p->alphaPTAT = val / 4.f + 8.f;
+    p->gainEE = (int16_t)CREG(REG_GAIN);
+    if(p->gainEE == 0) return FALSE;
+    pixscales sc;
+    occacc(sc.occRow, MLX_H, &CREG(REG_OCCROW14));
+    occacc(sc.occColumn, MLX_W, &CREG(REG_OCCCOL14));
+    occacc(sc.accRow, MLX_H, &CREG(REG_ACCROW14));
+    occacc(sc.accColumn, MLX_W, &CREG(REG_ACCCOL14));
+    val = CREG(REG_APTATOCCS);
+    // need to do multiplication instead of bitshift, so:
+    sc.occRemScale = 1<<(val&0x0F);
+    sc.occColumnScale = 1<<((val>>4)&0x0F);
+    sc.occRowScale = 1<<((val>>8)&0x0F);
+    sc.offavg = (int16_t) CREG(REG_OSAVG);
+    // even/odd column/row numbers are for starting from 1, so for starting from 0 we chould swap them:
+    // even - for 1,3,5,...; odd - for 0,2,4,... etc
+    // 0 - odd row, odd col; 1 - odd row even col; 2 - even row, odd col; 3 - even row, even col
+    val = CREG(REG_KTAAVGODDCOL);
+    sc.ktaavg[2] = (int8_t)(val & 0xFF); // odd col, even row -> col 0,2,..; row 1,3,..
+    sc.ktaavg[0] = (int8_t)(val >> 8);; // odd col, odd row -> col 0,2,..; row 0,2,..
+    val = CREG(REG_KTAAVGEVENCOL);
+    sc.ktaavg[3] = (int8_t)(val & 0xFF); // even col, even row -> col 1,3,..; row 1,3,..
+    sc.ktaavg[1] = (int8_t)(val >> 8); // even col, odd row -> col 1,3,..; row 0,2,..
+    // so index of ktaavg is 2*(row&1)+(col&1)
+    val = CREG(REG_KTAVSCALE);
+    uint8_t scale1 = ((val & 0xFF)>>4) + 8, scale2 = (val&0xF);
+    if(scale1 == 0 || scale2 == 0) return FALSE;
+    sc.ktamul = (float)(1<<scale2);
+    sc.ktadiv = (float)(1<<scale1); // kta_scales
+    // CP parameters are needed for alpha compensation
+    val = CREG(REG_CPOFF);
+    p->cpOffset[0] = (val & 0x03ff);
+    if(p->cpOffset[0] > 0x1ff) p->cpOffset[0] -= 0x400;
+    p->cpOffset[1] = val >> 10;
+    if(p->cpOffset[1] > 0x1f) p->cpOffset[1] -= 0x40;
+    p->cpOffset[1] += p->cpOffset[0];
+    val = ((CREG(REG_KTAVSCALE) & 0xF0) >> 4) + 8;
+    i8 = (int8_t)(CREG(REG_KVTACP) & 0xFF);
+    p->cpKta = (float)i8 / (1<<val);
+    val = (CREG(REG_KTAVSCALE) & 0x0F00) >> 8;
+    i16 = CREG(REG_KVTACP) >> 8;
+    if(i16 > 0x7F) i16 -= 0x100;
+    p->cpKv = (float)i16 / (1<<val);
+    i16 = CREG(REG_KSTATGC) & 0xFF;
+    if(i16 > 0x7F) i16 -= 0x100;
+    p->tgc = (float)i16;
+    p->tgc /= 32.f;
+    val = (CREG(REG_SCALEACC)>>12); // alpha_scale_CP
+    i16 = CREG(REG_ALPHA)>>10; // cp_P1_P0_ratio
+    if(i16 > 0x1F) i16 -= 0x40;
+    float diva = (float)(1<<val);
+    diva *= (float)(1<<27);
+    p->cpAlpha[0] = (float)(CREG(REG_ALPHA) & 0x03FF) / diva;
+    p->cpAlpha[1] = p->cpAlpha[0] * (1.f + (float)i16/(1<<7));
+    // alpha: alpha_scale = (EE[0x2420] >> 12) + 30
+    sc.a_r = CREG(REG_SENSIVITY); // alpha_ref
+    val = CREG(REG_SCALEACC);
+    sc.diva = (float)(1<<(val >> 12)) * (float)(1<<30);
+    sc.accRowScale = 1<<((val & 0x0f00)>>8);
+    sc.accColumnScale = 1<<((val & 0x00f0)>>4);
+    sc.accRemScale = 1<<(val & 0x0f);
+    // first pass: max values to choose exponents of arrays
+    float omax = 0.f, oktamax = 0.f, amin = 1.f, o, okta, a;
+    pu16 = &CREG(REG_OFFAK1);
+    for(int row = 0; row < MLX_H; ++row){
+        for(int col = 0; col < MLX_W; ++col){
+            pixcalib(&sc, p, *pu16++, row, col, &o, &okta, &a);
+            if(o < 0.f) o = -o;
+            if(okta < 0.f) okta = -okta;
+            if(o > omax) omax = o;
+            if(okta > oktamax) oktamax = okta;
+            if(a > 0.f && a < amin) amin = a;
+        }
+    }
+    int E = fitexp(omax, 32767.f, 8);
+    if(E < -7) return FALSE;
+    p->off_q = (int8_t)E;
+    float oscale = p2(E);
+    E = fitexp(oktamax, 32767.f, 24);
+    if(E < 0) return FALSE;
+    p->okta_q = (uint8_t)E;
+    float oktascale = p2(E);
+    E = fitexp(1.f / amin, 65535.f, 24);
+    if(E < -18) return FALSE;
+    p->ia_shift = (uint8_t)(18 + E);
+    float iascale = p2(E);
+    pu16 = &CREG(REG_OFFAK1);
+    int16_t *offset = p->offset, *offkta = p->offkta;
+    uint16_t *ialpha = p->ialpha;
+    for(int row = 0; row < MLX_H; ++row){
+        for(int col = 0; col < MLX_W; ++col){
+            pixcalib(&sc, p, *pu16++, row, col, &o, &okta, &a);
+            *offset++ = (int16_t)f2i(o * oscale);
+            *offkta++ = (int16_t)f2i(okta * oktascale);
+            *ialpha++ = (a > 0.f) ? (uint16_t)f2i(iascale / a) : 0; // broken pixel will show Ta
+        }
+    }
+    scale1 = (CREG(REG_KTAVSCALE) >> 8) & 0xF; // kvscale
+    float div = (float)(1<<scale1);
+    val = CREG(REG_KVAVG);
+    int8_t ktaavg[4];
+    i16 = val >> 12; if(i16 > 0x07) i16 -= 0x10;
+    ktaavg[0] = i16; // odd col, odd row
+    i16 = (val & 0xF0) >> 4; if(i16 > 0x07) i16 -= 0x10;
+    ktaavg[1] = i16; // even col, odd row
+    i16 = (val & 0x0F00) >> 8; if(i16 > 0x07) i16 -= 0x10;
+    ktaavg[2] = i16; // odd col, even row
+    i16 = val & 0x0F; if(i16 > 0x07) i16 -= 0x10;
+    ktaavg[3] = i16; // even col, even row
+    for(int i = 0; i < 4; ++i) p->kv[i] = ktaavg[i] / div;
+    i8 = (int8_t)(CREG(REG_KSTATGC) >> 8);
+    p->KsTa = (float)i8/(1<<13);
+    div = 1<<((CREG(REG_CT34) & 0x0F) + 8); // kstoscale
+    val = CREG(REG_KSTO12);
+    i8 = (int8_t)(val & 0xFF);
+    p->ksTo[0] = 273.15f * i8 / div;
+    i8 = (int8_t)(val >> 8);
+    p->ksTo[1] = 273.15f * i8 / div;
+    val = CREG(REG_KSTO34);
+    i8 = (int8_t)(val & 0xFF);
+    p->ksTo[2] = 273.15f * i8 / div;
+    i8 = (int8_t)(val >> 8);
+    p->ksTo[3] = 273.15f * i8 / div;
+    p->CT[0] = 0.f; // 0degr - between ranges 1 and 2
+    val = CREG(REG_CT34);
+    float mul = ((val & 0x3000)>>12)*10.f; // step
+    p->CT[1] = ((val & 0xF0)>>4)*mul; // CT3 - between ranges 2 and 3
+    p->CT[2] = ((val & 0x0F00) >> 8)*mul + p->CT[1]; // CT4 - between ranges 3 and 4
+    p->alphacorr[0] = 1.f/(1.f + p->ksTo[0] * 40.f);
+    p->alphacorr[1] = 1.f;
+    p->alphacorr[2] = (1.f + p->ksTo[2] * p->CT[1]);
+    p->alphacorr[3] = (1.f + p->ksTo[3] * (p->CT[2] - p->CT[1])) * p->alphacorr[2];
+    // Don't forget to check 'outlier' flags for wide purpose
+    return TRUE;
+}
+
+/**
+ * @brief mlx90640_prepare_subpage - calculate values common for all pixels of subpage
+ * @param p - parameters
+ * @param data - MLX_PIXARRSZ words starting from REG_IMAGEDATA (little endian)
+ * @param subpage - subpage number
+ * @param s (o) - subpage values
+ */
+void mlx90640_prepare_subpage(const MLX90640_params *p, const uint16_t *data, uint8_t subpage, MLX90640_subpage *s){
+    int16_t i16a = (int16_t)IMD(REG_IVDDPIX);
+    float dvdd = i16a - p->vdd25;
+    dvdd = dvdd / p->kVdd;
+    s->Vdd = dvdd + 3.3f;
+    i16a = (int16_t)IMD(REG_ITAPTAT);
+    int16_t i16b = (int16_t)IMD(REG_ITAVBE);
+    float dTa = (float)i16a / (i16a * p->alphaPTAT + i16b); // vptatart
+    dTa *= (float)(1<<18);
+    dTa = (dTa / (1 + p->KvPTAT*dvdd) - p->vPTAT25);
+    dTa = dTa / p->KtPTAT; // without 25degr - Ta0
+    s->Ta = dTa + 25.f;
+    s->dTa = f2i(dTa * 256.f);
+    i16a = (int16_t)IMD(REG_IGAIN);
+    float Kgain = (i16a) ? p->gainEE / (float)i16a : 1.f;
+    s->kgain = f2i(Kgain * 16777216.f);
+    for(int i = 0; i < 4; ++i) s->kvf[i] = f2i((1.f + p->kv[i]*dvdd) * 16777216.f);
+    // compensated CP of subpage: pix_OS_CP = pix_CP*Kgain - offset_CP*(1 + Kta_CP*dTa)*(1 + Kv_CP*dVdd)
+    float cp = (float)(int16_t)(subpage ? IMD(REG_ICPSP1) : IMD(REG_ICPSP0)) * Kgain;
+    cp -= p->cpOffset[subpage] * (1.f + p->cpKta * dTa) * (1.f + p->cpKv * dvdd);
+    s->cpos = f2i(p->tgc * cp * 256.f);
+    float TaK = s->Ta + 273.15f;
+    s->TaK = f2i(TaK * 65536.f);
+    TaK *= TaK;
+    TaK *= TaK;
+    float fx = 4.6116860e18f / (TaK * (1.f + p->KsTa * dTa)); // 2^62/(Ta^4*(1 + KsTa*dTa))
+    s->fx = (fx < 1.f) ? 1 : f2i(fx);
+    s->ksto = f2i(p->ksTo[1] / 273.15f * 4294967296.f);
+    s->subpage = subpage;
+}
+
+// (k/64)^(-1/4) for k = 16..64, Q30
+static const uint32_t r4tbl[49] = {
+    1518500250, 1495659153, 1474438753, 1454643140, 1436108870, 1418698272,
+    1402294379, 1386797035, 1372119868, 1358187913, 1344935715, 1332305812,
+    1320247505, 1308715855, 1297670852, 1287076734, 1276901417, 1267116011,
+    1257694420, 1248613000, 1239850262, 1231386626, 1223204202, 1215286607,
+    1207618800, 1200186947, 1192978291, 1185981049, 1179184316, 1172577982,
+    1166152655, 1159899601, 1153810679, 1147878294, 1142095347, 1136455198,
+    1130951621, 1125578778, 1120331181, 1115203673, 1110191395, 1105289768,
+    1100494471, 1095801424, 1091206768, 1086706850, 1082298212, 1077977574,
+    1073741824,
+};
+
+/**
+ * @brief mlx90640_root4 - fourth root: table of x^(-1/4) with linear interpolation + one Newton step
+ * @param x - argument, Q24
+ * @return x^(1/4), Q24 (relative error < 1e-6 for x >= 2^-4)
+ */
+uint32_t mlx90640_root4(uint32_t x){
+    if(!x) return 0;
+    int s = __builtin_clz(x) & ~1;
+    uint32_t m = x << s; // mantissa: m/2^32 in [1/4, 1)
+    uint32_t i = (m >> 26) - 16, f = (m >> 10) & 0xffff;
+    uint32_t r = r4tbl[i] - (uint32_t)(((uint64_t)(r4tbl[i] - r4tbl[i+1]) * f) >> 16); // m^(-1/4), Q30
+    // Newton: r = r*(5 - m*r^4)/4
+    uint32_t r2 = (uint32_t)(((uint64_t)r * r) >> 30);
+    uint32_t t = (uint32_t)(((uint64_t)m * r2) >> 32);
+    t = (uint32_t)(((uint64_t)t * r2) >> 30);
+    r = (uint32_t)(((uint64_t)r * ((5u<<28) - (t>>2))) >> 30);
+    // m^(1/4) = m*r^3
+    r2 = (uint32_t)(((uint64_t)r * r) >> 30);
+    t = (uint32_t)(((uint64_t)m * r2) >> 32);
+    uint32_t y = (uint32_t)(((uint64_t)t * r) >> 30); // Q30
+    // x = m * 2^(8-s) (in Q24 units), so root4(x) = root4(m) * 2^((8-s)/4)
+    int e = 8 - s;
+    if(e & 2){ // odd power of 2^(1/2)
+        y = (uint32_t)(((uint64_t)y * 759250125u) >> 30); // *2^(-1/2)
+        e += 2;
+    }
+    int sh = 6 - e/4;
+    return (y + (1u << (sh - 1))) >> sh;
+}
+
+// 2^24 + x with saturation for fourth root argument
+static uint32_t root4arg(int64_t x){
+    if(x <= -(1<<24)) return 1;
+    if(x > INT32_MAX - (1<<24)) return INT32_MAX;
+    return (uint32_t)((1<<24) + x);
+}
+
+// int32 -> int16 with saturation
+static int16_t sat16(int32_t x){
+    if(x > INT16_MAX) return INT16_MAX;
+    if(x < INT16_MIN) return INT16_MIN;
+    return (int16_t)x;
+}
+
+/**
+ * @brief mlx90640_process_rows - calculate pixels of subpage in rows [row0, row1)
+ * @param p - parameters
+ * @param s - subpage values (from mlx90640_prepare_subpage)
+ * @param data - image data from sensor
+ * @param image (o) - temperatures, degrC*MLX_TSCALE (or IR compensated signal*MLX_VIRSCALE if `simple`)
+ * @param simple - ==1 not to calculate temperature
+ */
+void mlx90640_process_rows(const MLX90640_params *p, const MLX90640_subpage *s, const uint16_t *data,
+                           int row0, int row1, int16_t *image, uint8_t simple){
+    int32_t omul = 1 << (8 - p->off_q);
+    for(int row = row0; row < row1; ++row){
+        int col0 = (row ^ s->subpage) & 1; // chess pattern: only pixels of given subpage
+        int32_t kvf = s->kvf[((row&1)<<1) | col0];
+        for(int pixno = row * MLX_W + col0; pixno < (row + 1) * MLX_W; pixno += 2){
+            int32_t o = p->offset[pixno] * omul + ((p->offkta[pixno] * s->dTa) >> p->okta_q); // Q8
+            int32_t vir = (int32_t)(((int64_t)(int16_t)data[pixno] * s->kgain) >> 16)
+                    - (int32_t)(((int64_t)o * kvf) >> 24) - s->cpos; // IR compensated, Q8
+            if(simple){
+                image[pixno] = sat16((vir * MLX_VIRSCALE + 128) >> 8);
+                continue;
+            }
+            int64_t x = ((int64_t)vir * p->ialpha[pixno]) >> p->ia_shift; // Vir/alpha'/1024
+            if(x > INT32_MAX) x = INT32_MAX;
+            else if(x < INT32_MIN) x = INT32_MIN;
+            int64_t u = (x * s->fx) >> 28; // (T1^4 - Ta^4)/Ta^4, Q24
+            int32_t T1 = (int32_t)(((int64_t)s->TaK * mlx90640_root4(root4arg(u))) >> 24); // Q16
+            // w = 1 + KsTo2*(T1 - 273.15) in Q16 and 1/w in Q30
+            uint32_t w = 65536 + (int32_t)(((int64_t)s->ksto * (T1 - MLX_T0_Q16)) >> 32);
+            if((int32_t)w < (1<<15)) w = 1<<15;
+            else if(w > (1<<17) - 1) w = (1<<17) - 1;
+            uint32_t iw = ((0x80000000u / w) << 15) | (((0x80000000u % w) << 15) / w);
+            u = (u * iw) >> 30;
+            int32_t To = (int32_t)(((int64_t)s->TaK * mlx90640_root4(root4arg(u))) >> 24);
+            image[pixno] = sat16((int32_t)(((int64_t)(To - MLX_T0_Q16) * MLX_TSCALE + 32768) >> 16));
+        }
+    }
+}
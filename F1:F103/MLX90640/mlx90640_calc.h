@@ -0,0 +1,93 @@
+/*
+ * This file is part of the MLX90640 project.
+ * Copyright 2022 Edward V. Emelianov <edward.emelianoff@gmail.com>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+#ifndef MLX90640_CALC_H__
+#define MLX90640_CALC_H__
+
+// calibration and temperature calculation: pure math without hardware (used in host tests too)
+
+#include <stdint.h>
+
+#ifndef TRUE
+#define TRUE    1
+#endif
+#ifndef FALSE
+#define FALSE   0
+#endif
+
+// amount of pixels
+#define MLX_W               (32)
+#define MLX_H               (24)
+#define MLX_PIXNO           (MLX_W*MLX_H)
+// pixels + service data
+#define MLX_PIXARRSZ        (MLX_PIXNO + 64)
+
+// 273.15 in Q16
+#define MLX_T0_Q16          (17901158)
+// image values: temperature in hundredths of degrC or IR compensated signal in tenths of counts (simple image)
+#define MLX_TSCALE          (100)
+#define MLX_VIRSCALE        (10)
+
+typedef struct{
+    int16_t kVdd;
+    int16_t vdd25;
+    float KvPTAT;
+    float KtPTAT;
+    int16_t vPTAT25;
+    float alphaPTAT;
+    int16_t gainEE;
+    float tgc;
+    float cpKv;     // K_V_CP
+    float cpKta;    // K_Ta_CP
+    float KsTa;
+    float CT[3]; // range borders (0, 160, 320 degrC?)
+    float ksTo[4]; // K_S_To for each range * 273.15
+    float alphacorr[4]; // Alpha_corr for each range
+    float kv[4];  // full - with scale; 0 - odd row, odd col; 1 - odd row even col; 2 - even row, odd col; 3 - even row, even col
+    float cpAlpha[2];   // alpha_CP_subpage 0 and 1
+    int16_t cpOffset[2];
+    // per-pixel constants for fixed-point calculations with common exponent for each array
+    int16_t offset[MLX_PIXNO];  // pixel offset, Q(off_q)
+    int16_t offkta[MLX_PIXNO];  // offset*K_ta, Q(okta_q)
+    uint16_t ialpha[MLX_PIXNO]; // 1/(alpha - TGC*alpha_CP), scaled by 2^(ia_shift - 18)
+    int8_t off_q;               // exponent of offset (<= 8)
+    uint8_t okta_q;             // exponent of offkta
+    uint8_t ia_shift;           // (Vir_Q8*ialpha >> ia_shift) == Vir/alpha/1024
+} MLX90640_params;
+
+// values common for all pixels of subpage (calculated once per subpage)
+typedef struct{
+    float Ta;           // ambient temperature, degrC
+    float Vdd;          // supply voltage, V
+    int32_t kgain;      // gain compensation coefficient, Q24
+    int32_t dTa;        // Ta - 25, Q8
+    int32_t kvf[4];     // (1 + Kv*dVdd) for each Kv pattern, Q24
+    int32_t cpos;       // TGC * compensated CP offset of subpage, Q8
+    int32_t fx;         // 2^62 / (Ta^4 * (1 + KsTa*dTa)), Ta in Kelvins
+    int32_t TaK;        // Ta in Kelvins, Q16
+    int32_t ksto;       // K_S_To2 * 2^32
+    uint8_t subpage;    // subpage number
+} MLX90640_subpage;
+
+int mlx90640_get_parameters(const uint16_t *eeprom, MLX90640_params *p);
+void mlx90640_prepare_subpage(const MLX90640_params *p, const uint16_t *data, uint8_t subpage, MLX90640_subpage *s);
+void mlx90640_process_rows(const MLX90640_params *p, const MLX90640_subpage *s, const uint16_t *data,
+                           int row0, int row1, int16_t *image, uint8_t simple);
+uint32_t mlx90640_root4(uint32_t x);
+
+#endif // MLX90640_CALC_H__
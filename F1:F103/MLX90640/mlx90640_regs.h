@@ -30,11 +30,16 @@
 #define REG_CONTROL_RES18       (2<<10)
 #define REG_CONTROL_RESMASK     (3<<10)
 #define REG_CONTROL_REFR_2HZ    (2<<7)
+#define REG_CONTROL_REFR(x)     (((x)&7)<<7)
+#define REG_CONTROL_REFRMASK    (7<<7)
 #define REG_CONTROL_SUBP1       (1<<4)
 #define REG_CONTROL_SUBPMASK    (3<<4)
 #define REG_CONTROL_SUBPSEL     (1<<3)
 #define REG_CONTROL_DATAHOLD    (1<<2)
 #define REG_CONTROL_SUBPEN      (1<<0)
+// EEPROM copy of I2C address (low byte)
+#define REG_I2CADDR             0x240F
+#define REG_I2CADDR_MASK        (0x7f)
 
 // calibration data start & len
 #define REG_CALIDATA            0x2410
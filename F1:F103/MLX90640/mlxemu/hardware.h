@@ -0,0 +1,32 @@
+/*
+ * This file is part of the MLX90640 project.
+ * Copyright 2022 Edward V. Emelianov <edward.emelianoff@gmail.com>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+#ifndef __HARDWARE_H__
+#define __HARDWARE_H__
+
+// host replacement of hardware.h: sensor power is a flag of mock
+
+#include "stm32f1.h"
+
+extern uint8_t mock_power;
+
+#define MLXPOW_ON()     do{mock_power = 1;}while(0)
+#define MLXPOW_OFF()    do{mock_power = 0;}while(0)
+#define MLXPOW_VAL()    (mock_power)
+
+#endif // __HARDWARE_H__
@@ -0,0 +1 @@
+../i2c.h
\ No newline at end of file
@@ -0,0 +1,442 @@
+/*
+ * This file is part of the MLX90640 project.
+ * Copyright 2022 Edward V. Emelianov <edward.emelianoff@gmail.com>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// host emulator of ../mlx90640.c: driver works with model of sensor (mock.c), each processed subpage is
+// compared with double reference calculated from data which was read by DMA
+// usage: ./mlxemu [N [seed]] - N frames in each test on synthetic sensors and scenes (default 20): each sensor
+//                              alone and then all of them on one bus
+//        ./mlxemu -d eeprom.dump frame.dump ... - sensor serves recorded dumps (output of 'g'/'d' commands)
+//        ./mlxemu -b - benchmark of mlx90640_process()
+//        ./mlxemu -v ... - print debugging output of driver (build with `make DEF=-DEBUG`)
+
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "i2c.h"
+#include "mlx90640.h"
+#include "mlx90640_regs.h"
+#include "mlxroi.h"
+#include "mock.h"
+#include "synth.h"
+
+#define REAL        double
+#define SQRT        sqrt
+#define FN(x)       x ## _d
+#include "ref.h"
+
+// max allowed error of temperature, degrC
+#define MAXERR      (0.02)
+// max allowed error of simple image (Vir)
+#define MAXVIR      (0.1)
+// time of main loop iteration (USB and other work), us
+#define LOOPUS      (100)
+// max amount of synthetic sensors
+#define NSENSORS    (3)
+#if NSENSORS > MOCK_MAXDEVS
+#error "NSENSORS should be <= MOCK_MAXDEVS"
+#endif
+// ROI threshold, degrC
+#define ROIHI       (60)
+
+static uint16_t eeprom[NSENSORS][REG_CALIDATA_LEN];
+static refpar_d rpar[NSENSORS];
+static int devee[MOCK_MAXDEVS]; // index of EEPROM and reference parameters of each sensor on mock bus
+static int errors = 0;
+static uint32_t restarts = 0; // restarts of continuous mode after M_ERROR
+
+// recorded frames
+static uint16_t (*dumps)[MLX_PIXARRSZ] = NULL;
+static int ndumps = 0;
+
+static void error(const char *fmt, ...){
+    va_list ap;
+    if(++errors > 20) return;
+    printf("  ERROR (Tms=%u, states", Tms);
+    for(int i = 0; i < mlx_nsensors; ++i) printf(" %d", mlx_sensors[i].state);
+    printf("): ");
+    va_start(ap, fmt);
+    vprintf(fmt, ap);
+    va_end(ap);
+    printf("\n");
+}
+
+// synthetic scene: background and hot spot moving by circle (each sensor has its own phase)
+static void synth_scene(int dev, uint16_t *data){
+    static double T[MLX_PIXNO];
+    static int lastee = -1;
+    if(devee[dev] != lastee){ // synth_frame() serves one sensor
+        lastee = devee[dev];
+        synth_init(eeprom[lastee]);
+    }
+    double phi = Tms * 1e-3 + dev * 2.1, xc = 15.5 + 10. * cos(phi), yc = 11.5 + 7. * sin(phi);
+    for(int pix = 0; pix < MLX_PIXNO; ++pix){
+        double dx = pix % MLX_W - xc, dy = pix / MLX_W - yc;
+        T[pix] = 22. + drand(-0.5, 0.5) + 150. * exp(-(dx*dx + dy*dy) / 8.);
+    }
+    synth_frame(data, T);
+}
+
+// recorded scene: dumps by turn
+static void recorded_scene(int dev, uint16_t *data){
+    static int cur = 0;
+    (void) dev;
+    memcpy(data, dumps[cur], sizeof(dumps[0]));
+    if(++cur == ndumps) cur = 0;
+}
+
+// results of one test
+static struct{
+    uint32_t subpages;              // value of mlx_subpages at last check
+    uint32_t frames[MLX_MAXSENSORS];// and `frames` of each sensor
+    uint32_t nsp, nframes;          // subpages and frames checked
+    double maxerr, maxvir;          // max errors of T and Vir
+} st;
+
+static void stat_reset(){
+    memset(&st, 0, sizeof(st));
+    st.subpages = mlx_subpages;
+    for(int i = 0; i < mlx_nsensors; ++i) st.frames[i] = mlx_sensors[i].frames;
+}
+
+// compare just processed subpage with reference
+static void check_subpage(){
+    static uint16_t data[MLX_PIXARRSZ];
+    uint8_t sp, late, n = mlx_spsensor;
+    const refpar_d *p = &rpar[devee[n]];
+    refsub_d s;
+    if(!mock_getread(n, data, &sp, &late)){
+        error("subpage %d of sensor %d was processed but not read", mlx_lastsp, n);
+        return;
+    }
+    if(sp != mlx_lastsp){
+        if(late){ // race of real sensor too: new subpage was measured just after status was polled
+            ++mock_stats.late;
+            return;
+        }
+        error("subpage %d of sensor %d was read, but %d processed", sp, n, mlx_lastsp);
+        return;
+    }
+    ++st.nsp;
+    ref_prepare_d(p, data, sp, &s);
+    double maxe = 0.;
+    for(int pix = 0; pix < MLX_PIXNO; ++pix){
+        if((((pix / MLX_W) ^ pix) & 1) != sp) continue;
+        double v = ref_pixel_d(p, &s, data, pix, mlx_spsimple);
+        if(isnan(v)) continue;
+        if(mlx_spsimple){
+            if(fabs(v) * MLX_VIRSCALE > INT16_MAX) continue; // saturated
+            double e = fabs(mlx_spimage[pix] / (double)MLX_VIRSCALE - v);
+            if(e > st.maxvir) st.maxvir = e;
+        }else{
+            double e = fabs(mlx_spimage[pix] / (double)MLX_TSCALE - v);
+            if(e > maxe) maxe = e;
+        }
+    }
+    if(maxe > st.maxerr) st.maxerr = maxe;
+    if(maxe > MAXERR) error("subpage %d of sensor %d: error %.4f degrC", sp, n, maxe);
+}
+
+// compare ROI statistics with full image of sensor `n`
+static void check_frame(int n){
+    int16_t max = INT16_MIN;
+    const int16_t *image = MLX_IMAGE(&mlx_sensors[n]);
+    ++st.nframes;
+    if(!(mlx_roiactive & 1) || n != mlx_roisensor) return;
+    for(int pix = 0; pix < MLX_PIXNO; ++pix) if(image[pix] > max) max = image[pix];
+    const mlxroi_result *r = &mlx_roires[0];
+    if(r->max != max) error("ROI max=%d, image max=%d", r->max, max);
+    if(!(r->alarm & MLXROI_ALARM_HI) != !(max > mlx_roicfg[0].hi)) error("wrong ROI alarm %d", r->alarm);
+}
+
+// check new data after mlx90640_process()
+static void check(){
+    if(st.subpages != mlx_subpages){
+        if(mlx_subpages - st.subpages != 1) error("%u subpages processed at once", mlx_subpages - st.subpages);
+        st.subpages = mlx_subpages;
+        check_subpage();
+    }
+    for(int i = 0; i < mlx_nsensors; ++i){
+        if(st.frames[i] == mlx_sensors[i].frames) continue;
+        st.frames[i] = mlx_sensors[i].frames;
+        check_frame(i);
+    }
+}
+
+// one main loop iteration
+static void loop(uint32_t us){
+    mlx90640_process();
+    check();
+    mock_step(us);
+}
+
+// ==1 if all sensors got `nframes` new frames (since `f0`) and are in `state`
+static int done(const uint32_t *f0, uint32_t nframes, mlx90640_state state){
+    for(int i = 0; i < mlx_nsensors; ++i){
+        const mlx_sensor *s = &mlx_sensors[i];
+        if(s->frames - f0[i] < nframes) return FALSE;
+        if(state != M_STATES_AMOUNT && s->state != state) return FALSE;
+    }
+    return TRUE;
+}
+
+/**
+ * @brief run - run main loop until `nframes` new frames of each sensor are processed or they are in `state`
+ * @param nframes - amount of frames (0 - don't wait for frames)
+ * @param state - state to wait (M_STATES_AMOUNT - any)
+ * @param us - time of loop iteration
+ * @param recover - ==1 to restart continuous mode from M_ERROR with refresh rate `recover - 1`
+ * @return FALSE if timeout
+ */
+static int run(uint32_t nframes, mlx90640_state state, uint32_t us, int recover){
+    uint32_t f0[MLX_MAXSENSORS], T0 = Tms, tmout = 4000 * (nframes + 1) + 10000;
+    int ret = TRUE;
+    for(int i = 0; i < mlx_nsensors; ++i) f0[i] = mlx_sensors[i].frames;
+    while(!done(f0, nframes, state)){
+        if(Tms - T0 > tmout){
+            for(int i = 0; i < mlx_nsensors; ++i)
+                error("sensor %d: timeout (%u of %u frames)", i, mlx_sensors[i].frames - f0[i], nframes);
+            ret = FALSE;
+            break;
+        }
+        if(recover) for(int i = 0; i < mlx_nsensors; ++i){
+            if(mlx_sensors[i].state != M_ERROR) continue;
+            ++restarts;
+            mlx90640_continuous(i, -1);
+            if(!mlx90640_continuous(i, recover - 1)) error("can't restart continuous mode");
+        }
+        loop(us);
+    }
+    return ret;
+}
+
+static void report(const char *name){
+    printf("%-24s %4u subpages, %3u frames, max error %.4f degrC, Vir %.4f\n", name, st.nsp, st.nframes,
+           st.maxerr, st.maxvir);
+    if(st.maxvir > MAXVIR) error("error of Vir is %.4f", st.maxvir);
+}
+
+// stop continuous mode of all sensors and wait for last subpages
+static void stop(){
+    for(int i = 0; i < mlx_nsensors; ++i) mlx90640_continuous(i, -1);
+    run(0, M_RELAX, LOOPUS, 0);
+    for(int i = 0; i < 2*MLX_H/MLX_PROCROWS; ++i) loop(LOOPUS); // process last subpages
+    mock_clearreads();
+}
+
+// find sensors connected to mock and check the table
+static void discover(int n){
+    int found = mlx90640_discover();
+    if(found != n){
+        error("found %d sensors instead of %d", found, n);
+        return;
+    }
+    for(int i = 0; i < n; ++i)
+        if(mlx_sensors[i].addr != MLX_DEFAULT_ADDR + i) error("sensor %d has address 0x%x", i, mlx_sensors[i].addr);
+}
+
+// tests of one sensor `n` (its EEPROM is eeprom[n])
+static void test_sensor(int n, uint32_t N){
+    char name[48];
+    mock_init();
+    mock_add(MLX_DEFAULT_ADDR, eeprom[n], dumps ? recorded_scene : synth_scene);
+    devee[0] = n;
+    discover(1); // new sensor: read its calibration
+    mlx_roisensor = 0;
+    mlxroi_set(0, 0, 0, MLX_W - 1, MLX_H - 1, -40*MLX_TSCALE, ROIHI*MLX_TSCALE);
+    stat_reset();
+    // first image: calibration is read by DMA
+    if(!mlx90640_take_image(0, 0)) error("can't take image");
+    run(1, M_RELAX, LOOPUS, 0);
+    static MLX90640_params p;
+    memset(&p, 0, sizeof(p));
+    if(!mlx90640_get_parameters(eeprom[n], &p) || memcmp(&p, &mlx_sensors[0].params, sizeof(p)))
+        error("wrong calibration parameters");
+    if(!mlx90640_take_image(0, 1)) error("can't take simple image");
+    run(1, M_RELAX, LOOPUS, 0);
+    report("single images");
+    // continuous mode with all refresh rates
+    for(int rate = 0; rate < 8; ++rate){
+        stat_reset();
+        if(!mlx90640_continuous(0, rate)) error("can't start continuous mode");
+        run(rate < 2 ? 2 : N, M_STATES_AMOUNT, LOOPUS, 0);
+        stop();
+        snprintf(name, sizeof(name), "continuous, rate %d", rate);
+        report(name);
+    }
+    // slow main loop: both buffers are busy sometimes
+    stat_reset();
+    mlx90640_continuous(0, 6);
+    run(N, M_STATES_AMOUNT, 8000, 0);
+    stop();
+    report("slow main loop");
+    // I2C errors: driver should restart from M_ERROR
+    stat_reset();
+    mock_stats.nacks = mock_stats.dmaerrs = restarts = 0;
+    mock_nack = 5;
+    mock_dmaerr = 50;
+    mlx90640_continuous(0, 4);
+    run(N/2, M_STATES_AMOUNT, LOOPUS, 5);
+    mock_nack = 1000; // sensor doesn't answer for 100ms: M_ERROR
+    for(int i = 0; i < 100; ++i) loop(1000);
+    if(mlx_sensors[0].state != M_ERROR) error("no M_ERROR when sensor doesn't answer");
+    mock_nack = 5;
+    run(N - N/2, M_STATES_AMOUNT, LOOPUS, 5);
+    mock_nack = mock_dmaerr = 0;
+    stop();
+    if(mlx_sensors[0].state != M_RELAX){ // stopped in M_ERROR
+        mlx90640_take_image(0, 0);
+        run(1, M_RELAX, LOOPUS, 0);
+    }
+    snprintf(name, sizeof(name), "faults (%u/%u/%u)", mock_stats.nacks, mock_stats.dmaerrs, restarts);
+    report(name);
+    // power cycle: calibration isn't read again
+    stat_reset();
+    mlx90640_restart();
+    run(0, M_RELAX, LOOPUS, 0);
+    if(!mlx90640_take_image(0, 0)) error("can't take image after power cycle");
+    run(1, M_RELAX, LOOPUS, 0);
+    report("power cycle");
+}
+
+#if MLX_MAXSENSORS > 1
+// all synthetic sensors on one bus: they share I2C and buffers, so their subpages are read by turn
+static void test_bus(uint32_t N){
+    const int rates[] = {3, 4, 2, 5}; // 0.14 .. 0.3 of bus time each
+    int n = (NSENSORS < MLX_MAXSENSORS) ? NSENSORS : MLX_MAXSENSORS;
+    printf("Bus of %d sensors:\n", n);
+    mock_init();
+    for(int i = 0; i < n; ++i){
+        mock_add(MLX_DEFAULT_ADDR + i, eeprom[i], synth_scene);
+        devee[i] = i;
+    }
+    discover(n);
+    mlx_roisensor = n - 1;
+    mlxroi_reset();
+    // single images of all sensors at once
+    stat_reset();
+    for(int i = 0; i < n; ++i) if(!mlx90640_take_image(i, 0)) error("can't take image of sensor %d", i);
+    run(1, M_RELAX, LOOPUS, 0);
+    report("single images");
+    // continuous mode with different rates
+    stat_reset();
+    for(int i = 0; i < n; ++i) if(!mlx90640_continuous(i, rates[i])) error("can't start sensor %d", i);
+    run(N, M_STATES_AMOUNT, LOOPUS, 0);
+    stop();
+    report("continuous, mixed rates");
+    // 32Hz on all: bus is overloaded, sensors lose subpages but each one gets frames
+    stat_reset();
+    for(int i = 0; i < n; ++i) mlx90640_continuous(i, 6);
+    run(N, M_STATES_AMOUNT, LOOPUS, 0);
+    stop();
+    report("overloaded bus");
+    for(int i = 0; i < n; ++i) if(mlx_sensors[i].state != M_RELAX) error("sensor %d in state %d", i, mlx_sensors[i].state);
+}
+#endif
+
+static double nsnow(){
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+// host time of mlx90640_process() in continuous mode
+static void bench(){
+    double tsum = 0., tmax = 0.;
+    const mlx_sensor *s = &mlx_sensors[0];
+    synth_eeprom(eeprom[0]);
+    mock_init();
+    mock_add(MLX_DEFAULT_ADDR, eeprom[0], synth_scene);
+    devee[0] = 0;
+    mlx90640_setaddr(0, MLX_DEFAULT_ADDR);
+    mlx90640_continuous(0, 7);
+    run(1, M_STATES_AMOUNT, LOOPUS, 0);
+    uint32_t sp0 = mlx_subpages, ncalls = 0;
+    while(mlx_subpages - sp0 < 200){
+        double t0 = nsnow();
+        mlx90640_process();
+        double t = nsnow() - t0;
+        tsum += t;
+        if(t > tmax) tmax = t;
+        ++ncalls;
+        mock_step(LOOPUS);
+    }
+    mlx90640_continuous(0, -1);
+    printf("%u calls, %u subpages: %.0f ns per subpage, max %.0f ns per call\n", ncalls, mlx_subpages - sp0,
+           tsum / (mlx_subpages - sp0), tmax);
+    printf("simulated time of last subpage: readout %u ms, processing %u ms\n", s->tread, s->tproc);
+}
+
+int main(int argc, char **argv){
+    if(argc > 1 && 0 == strcmp(argv[1], "-v")){
+        mock_verbose = 1;
+        --argc; ++argv;
+    }
+    i2c_setup(TRUE);
+    if(argc > 1 && 0 == strcmp(argv[1], "-b")){
+        srandom(time(NULL));
+        bench();
+        return 0;
+    }
+    if(argc > 2 && 0 == strcmp(argv[1], "-d")){ // recorded data
+        if(REG_CALIDATA_LEN != read_dump(argv[2], eeprom[0], NULL)){
+            printf("%s: not full EEPROM dump\n", argv[2]);
+            return 1;
+        }
+        dumps = calloc(argc - 3, sizeof(dumps[0]));
+        for(int i = 3; i < argc; ++i){
+            if(MLX_PIXARRSZ != read_dump(argv[i], NULL, dumps[ndumps])){
+                printf("%s: not full frame dump\n", argv[i]);
+                continue;
+            }
+            ++ndumps;
+        }
+        if(!ndumps || !ref_params_d(eeprom[0], &rpar[0])){
+            printf("No frames or wrong EEPROM\n");
+            return 1;
+        }
+        test_sensor(0, ndumps > 10 ? ndumps : 10);
+    }else{
+        uint32_t N = (argc > 1) ? (uint32_t)atol(argv[1]) : 20;
+        unsigned seed = (argc > 2) ? (unsigned)atol(argv[2]) : (unsigned)time(NULL);
+        srandom(seed);
+        for(int i = 0; i < NSENSORS; ++i){
+            printf("Sensor %d:\n", i);
+            synth_eeprom(eeprom[i]);
+            if(!ref_params_d(eeprom[i], &rpar[i])){
+                printf("Wrong synthetic EEPROM\n");
+                return 1;
+            }
+            test_sensor(i, N);
+        }
+#if MLX_MAXSENSORS > 1
+        test_bus(N);
+#endif
+        if(errors) printf("FAIL (seed %u)\n", seed);
+    }
+    printf("I2C transfers: %u, subpages measured: %u, read: %u (%u changed before readout); simulated time %.1f s\n",
+           mock_stats.transfers, mock_stats.measured, mock_stats.reads, mock_stats.late, mock_ns * 1e-9);
+    if(errors){
+        printf("%d errors\n", errors);
+        return 1;
+    }
+    printf("Test passed\n");
+    return 0;
+}
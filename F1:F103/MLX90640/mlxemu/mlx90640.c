@@ -0,0 +1 @@
+../mlx90640.c
\ No newline at end of file
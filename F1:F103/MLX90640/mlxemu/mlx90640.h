@@ -0,0 +1 @@
+../mlx90640.h
\ No newline at end of file
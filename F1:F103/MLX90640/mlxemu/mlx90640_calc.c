@@ -0,0 +1 @@
+../mlx90640_calc.c
\ No newline at end of file
@@ -0,0 +1 @@
+../mlx90640_regs.h
\ No newline at end of file
@@ -0,0 +1 @@
+../mlxroi.c
\ No newline at end of file
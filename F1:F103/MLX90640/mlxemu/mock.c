@@ -0,0 +1,320 @@
+/*
+ * This file is part of the MLX90640 project.
+ * Copyright 2022 Edward V. Emelianov <edward.emelianoff@gmail.com>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hardware.h"
+#include "i2c.h"
+#include "mlx90640.h"
+#include "mlx90640_regs.h"
+#include "mock.h"
+#include "strfunct.h"
+
+volatile uint32_t Tms = 0;
+static IWDG_TypeDef iwdg;
+IWDG_TypeDef *IWDG = &iwdg;
+volatile i2c_dma_status i2cDMAr = I2C_DMA_NOTINIT;
+
+uint8_t mock_power = 1;             // power of sensors (common for all)
+uint8_t mock_verbose = 0;           // ==1 to print debug output of driver
+uint16_t mock_nack = 0;             // probability of NACK on each transfer, 1/1000
+uint16_t mock_dmaerr = 0;           // probability of DMA error, 1/1000
+uint64_t mock_ns = 0;               // simulated time, ns
+mock_stat mock_stats;
+
+// REG_CONTROL after power on
+#define CONTROL_DEFAULT     (REG_CONTROL_CHESS | REG_CONTROL_RES18 | REG_CONTROL_REFR(2) | REG_CONTROL_SUBPEN)
+// shift of measurements of next sensor (they aren't synchronized), ns
+#define DEVPHASE            (3700000ULL)
+
+typedef struct{
+    uint8_t addr;                   // I2C address
+    const uint16_t *eeprom;         // calibration data (REG_CALIDATA..)
+    mock_scene scene;
+    uint16_t ram[MLX_PIXARRSZ];     // REG_IMAGEDATA..
+    uint16_t newdata[MLX_PIXARRSZ]; // frame from `scene`
+    uint16_t status, control;
+    uint16_t regptr;                // register pointer set by last write
+    uint8_t nextsp;                 // next subpage in continuous mode
+    uint64_t tmeas;                 // time of end of current measurement
+    uint8_t changed;                // ==1 if new subpage was measured after last reading of REG_STATUS
+    // subpages read but not taken by mock_getread()
+    uint16_t reads[MOCK_MAXREADS][MLX_PIXARRSZ];
+    uint8_t readsp[MOCK_MAXREADS], readlate[MOCK_MAXREADS];
+    int nreads;
+} mock_dev;
+
+static mock_dev devs[MOCK_MAXDEVS];
+static int ndevs = 0;
+static uint8_t powered = 1;         // power state at last check
+static uint8_t addr = 0;            // current I2C address
+static mock_dev *cur = NULL;        // device answered on last transfer
+// DMA transfer
+static mock_dev *dmadev = NULL;     // device being read
+static uint64_t dmaend = 0;         // time of end
+static uint8_t dmafail = 0;         // ==1 to end it with error
+static int8_t dmaimage = -1;        // subpage number if whole RAM is being read
+static uint8_t dmalate = 0;         // value of `changed` at start
+static uint16_t dmacopy[MLX_PIXARRSZ]; // RAM at start of reading
+
+// measurement time of one subpage, ns
+static uint64_t period(const mock_dev *d){
+    return 2000000000ULL >> ((d->control & REG_CONTROL_REFRMASK) >> 7);
+}
+
+static int fault(uint16_t permille){
+    return permille && (uint16_t)(random() % 1000) < permille;
+}
+
+// registers after power on
+static void devreset(mock_dev *d){
+    d->status = 0;
+    d->control = CONTROL_DEFAULT;
+    d->regptr = 0;
+    d->nextsp = 0;
+    d->changed = 0;
+    d->tmeas = mock_ns + period(d) + (d - devs) * DEVPHASE;
+}
+
+// end of subpage measurement: put new data of this subpage into RAM
+static void measure(mock_dev *d){
+    uint8_t sp;
+    if(d->control & REG_CONTROL_SUBPSEL) sp = (d->control & REG_CONTROL_SUBP1) ? 1 : 0;
+    else{
+        sp = d->nextsp;
+        d->nextsp = !d->nextsp;
+    }
+    ++mock_stats.measured;
+    if((d->status & REG_STATUS_NEWDATA) && !(d->status & REG_STATUS_OVWEN)) return; // old data isn't read yet
+    d->scene(d - devs, d->newdata);
+    for(int pix = 0; pix < MLX_PIXNO; ++pix)
+        if((((pix / MLX_W) ^ pix) & 1) == sp) d->ram[pix] = d->newdata[pix];
+    memcpy(&d->ram[MLX_PIXNO], &d->newdata[MLX_PIXNO], (MLX_PIXARRSZ - MLX_PIXNO) * sizeof(uint16_t));
+    d->status = (d->status & ~REG_STATUS_SPMASK) | REG_STATUS_NEWDATA | sp;
+    d->changed = 1;
+}
+
+// subpage was read by DMA: put it into queue of device
+static void pushread(mock_dev *d){
+    ++mock_stats.reads;
+    if(d->nreads == MOCK_MAXREADS){ // driver lost subpages: forget the oldest
+        memmove(d->reads[0], d->reads[1], sizeof(d->reads[0]) * (MOCK_MAXREADS - 1));
+        memmove(d->readsp, d->readsp + 1, MOCK_MAXREADS - 1);
+        memmove(d->readlate, d->readlate + 1, MOCK_MAXREADS - 1);
+        --d->nreads;
+    }
+    memcpy(d->reads[d->nreads], dmacopy, sizeof(dmacopy));
+    d->readsp[d->nreads] = (uint8_t)dmaimage;
+    d->readlate[d->nreads++] = dmalate;
+}
+
+// advance time by `ns` nanoseconds: sensor measurements and end of DMA transfer
+static void advance(uint64_t ns){
+    mock_ns += ns;
+    Tms = (uint32_t)(mock_ns / 1000000);
+    if(mock_power != powered){
+        powered = mock_power;
+        if(powered) for(int i = 0; i < ndevs; ++i) devreset(&devs[i]);
+    }
+    if(powered) for(int i = 0; i < ndevs; ++i){
+        mock_dev *d = &devs[i];
+        while(mock_ns >= d->tmeas){
+            measure(d);
+            d->tmeas += period(d);
+        }
+    }
+    if(i2cDMAr == I2C_DMA_BUSY && mock_ns >= dmaend){
+        if(dmafail){
+            ++mock_stats.dmaerrs;
+            i2cDMAr = I2C_DMA_ERROR;
+            return;
+        }
+        i2cDMAr = I2C_DMA_READY;
+        if(dmaimage > -1) pushread(dmadev);
+    }
+}
+
+/**
+ * @brief transfer - model of I2C transfer: time and device answer
+ * @param nbytes - amount of bytes including address
+ * @return FALSE if device doesn't answer
+ */
+static int transfer(int nbytes){
+    ++mock_stats.transfers;
+    advance((uint64_t)nbytes * MOCK_BYTENS);
+    cur = NULL;
+    if(!powered) return FALSE;
+    for(int i = 0; i < ndevs; ++i) if(devs[i].addr == addr) cur = &devs[i];
+    if(!cur) return FALSE;
+    if(fault(mock_nack)){
+        ++mock_stats.nacks;
+        return FALSE;
+    }
+    return TRUE;
+}
+
+static uint16_t getreg(const mock_dev *d, uint16_t reg){
+    if(reg >= REG_CALIDATA && reg < REG_CALIDATA + REG_CALIDATA_LEN) return d->eeprom[reg - REG_CALIDATA];
+    if(reg >= REG_IMAGEDATA && reg < REG_IMAGEDATA + MLX_PIXARRSZ) return d->ram[reg - REG_IMAGEDATA];
+    if(reg == REG_STATUS) return d->status;
+    if(reg == REG_CONTROL) return d->control;
+    if(reg == REG_I2CADDR) return 0xBE00 | d->addr;
+    return 0;
+}
+
+static void setreg(mock_dev *d, uint16_t reg, uint16_t val){
+    if(reg == REG_STATUS){ // only these bits are writable
+        uint16_t mask = REG_STATUS_OVWEN | REG_STATUS_NEWDATA;
+        d->status = (d->status & ~mask) | (val & mask);
+    }else if(reg == REG_CONTROL) d->control = val;
+}
+
+// remove all sensors and turn on power
+void mock_init(){
+    ndevs = 0;
+    mock_power = 1;
+    powered = 1;
+    i2cDMAr = I2C_DMA_NOTINIT;
+    dmadev = cur = NULL;
+    advance(0);
+}
+
+/**
+ * @brief mock_add - connect new sensor to bus (its registers are in power on state)
+ * @param a - I2C address
+ * @param ee - calibration data (REG_CALIDATA_LEN words, should live until end)
+ * @param s - source of measured data
+ * @return number of sensor or -1 if there's too much sensors
+ */
+int mock_add(uint8_t a, const uint16_t *ee, mock_scene s){
+    if(ndevs == MOCK_MAXDEVS) return -1;
+    mock_dev *d = &devs[ndevs];
+    d->addr = a;
+    d->eeprom = ee;
+    d->scene = s;
+    d->nreads = 0;
+    devreset(d);
+    return ndevs++;
+}
+
+// main loop iteration took `us` microseconds
+void mock_step(uint32_t us){
+    advance((uint64_t)us * 1000);
+}
+
+/**
+ * @brief mock_getread - get oldest subpage of sensor read by DMA (in the same order they should be processed)
+ * @param dev - sensor number
+ * @param data (o) - RAM at start of reading
+ * @param subpage (o) - number of subpage measured last before reading
+ * @param late (o) - ==1 if this subpage was measured after driver had read REG_STATUS (so it could take
+ *                   data as previous subpage)
+ * @return FALSE if there's no data
+ */
+int mock_getread(int dev, uint16_t *data, uint8_t *subpage, uint8_t *late){
+    if(dev < 0 || dev >= ndevs) return FALSE;
+    mock_dev *d = &devs[dev];
+    if(d->nreads == 0) return FALSE;
+    memcpy(data, d->reads[0], sizeof(d->reads[0]));
+    *subpage = d->readsp[0];
+    *late = d->readlate[0];
+    --d->nreads;
+    memmove(d->reads[0], d->reads[1], sizeof(d->reads[0]) * d->nreads);
+    memmove(d->readsp, d->readsp + 1, d->nreads);
+    memmove(d->readlate, d->readlate + 1, d->nreads);
+    return TRUE;
+}
+
+// forget all read subpages
+void mock_clearreads(){
+    for(int i = 0; i < ndevs; ++i) devs[i].nreads = 0;
+}
+
+// I2C functions used by driver
+
+void i2c_setup(uint8_t withDMA){
+    i2cDMAr = withDMA ? I2C_DMA_RELAX : I2C_DMA_NOTINIT; // current transfer is aborted
+}
+
+void i2c_set_addr7(uint8_t a){
+    addr = a;
+}
+
+i2c_status i2c_7bit_send(const uint8_t *data, int datalen, uint8_t stop){
+    (void) stop;
+    if(i2cDMAr == I2C_DMA_BUSY) return I2C_LINEBUSY;
+    if(!transfer(datalen + 1)) return I2C_NACK;
+    if(datalen < 2) return I2C_OK;
+    cur->regptr = (data[0] << 8) | data[1];
+    if(datalen > 3) setreg(cur, cur->regptr, (data[2] << 8) | data[3]);
+    return I2C_OK;
+}
+
+i2c_status i2c_7bit_receive_twobytes(uint8_t *data){
+    if(i2cDMAr == I2C_DMA_BUSY) return I2C_LINEBUSY;
+    if(!transfer(3)) return I2C_NACK;
+    uint16_t v = getreg(cur, cur->regptr);
+    if(cur->regptr == REG_STATUS) cur->changed = 0;
+    data[0] = v >> 8;
+    data[1] = v & 0xff;
+    return I2C_OK;
+}
+
+// data is copied at start (sensor doesn't change RAM during reading, so there's no torn subpages)
+i2c_status i2c_7bit_receive_DMA(uint8_t *data, uint16_t nbytes){
+    if(i2cDMAr == I2C_DMA_BUSY) return I2C_LINEBUSY;
+    if(nbytes < 2) return I2C_HWPROBLEM;
+    if(!transfer(1)) return I2C_NACK;
+    uint16_t reg = cur->regptr;
+    for(int i = 0; i < nbytes / 2; ++i, ++reg){
+        uint16_t v = getreg(cur, reg);
+        data[2*i] = v >> 8;
+        data[2*i + 1] = v & 0xff;
+    }
+    dmadev = cur;
+    dmaimage = -1;
+    if(cur->regptr == REG_IMAGEDATA && nbytes == MLX_PIXARRSZ * 2){
+        memcpy(dmacopy, cur->ram, sizeof(cur->ram));
+        dmaimage = cur->status & REG_STATUS_SPNO;
+        dmalate = cur->changed;
+    }
+    dmafail = (uint8_t)fault(mock_dmaerr);
+    dmaend = mock_ns + (uint64_t)nbytes * MOCK_BYTENS;
+    i2cDMAr = I2C_DMA_BUSY;
+    return I2C_OK;
+}
+
+// debugging output of driver (EBUG)
+
+void addtobuf(const char *txt){
+    if(mock_verbose) fputs(txt, stdout);
+}
+
+void bufputchar(char ch){
+    if(mock_verbose) putchar(ch);
+}
+
+void printu(uint32_t val){
+    if(mock_verbose) printf("%u", val);
+}
+
+void sendbuf(){
+    if(mock_verbose) fflush(stdout);
+}
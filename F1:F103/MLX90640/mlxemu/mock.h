@@ -0,0 +1,60 @@
+/*
+ * This file is part of the MLX90640 project.
+ * Copyright 2022 Edward V. Emelianov <edward.emelianoff@gmail.com>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+#ifndef MOCK_H__
+#define MOCK_H__
+
+// model of MLX90640 sensors on I2C bus for host build of ../mlx90640.c:
+// EEPROM and RAM are served by i2c_* functions, new subpages are measured with refresh rate of REG_CONTROL,
+// all time is simulated: transfers advance clock by their duration at 400kHz, main loop calls mock_step()
+
+#include <stdint.h>
+#include "mlx90640_calc.h"
+
+// time of one byte transfer at 400kHz (9 bits), ns
+#define MOCK_BYTENS         (22500)
+// max amount of subpages read by DMA but not processed yet (of each sensor)
+#define MOCK_MAXREADS       (4)
+// max amount of sensors on bus
+#define MOCK_MAXDEVS        (4)
+
+// scene for next measurement of sensor `dev`: fill all RAM words (pixels of both subpages and service data)
+typedef void (*mock_scene)(int dev, uint16_t *data);
+
+typedef struct{
+    uint32_t transfers;     // amount of I2C transfers
+    uint32_t nacks;         // NACKs injected
+    uint32_t dmaerrs;       // DMA errors injected
+    uint32_t measured;      // subpages measured by sensors
+    uint32_t reads;         // subpages read by DMA
+    uint32_t late;          // subpages measured between reading of status and start of DMA
+} mock_stat;
+
+extern volatile uint32_t Tms;
+extern uint8_t mock_power, mock_verbose;
+extern uint16_t mock_nack, mock_dmaerr;
+extern uint64_t mock_ns;
+extern mock_stat mock_stats;
+
+void mock_init();
+int mock_add(uint8_t addr, const uint16_t *eeprom, mock_scene scene);
+void mock_step(uint32_t us);
+int mock_getread(int dev, uint16_t *data, uint8_t *subpage, uint8_t *late);
+void mock_clearreads();
+
+#endif // MOCK_H__
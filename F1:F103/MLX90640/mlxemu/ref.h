@@ -0,0 +1 @@
+../calctest/ref.h
\ No newline at end of file
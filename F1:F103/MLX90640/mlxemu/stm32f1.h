@@ -0,0 +1,44 @@
+/*
+ * This file is part of the MLX90640 project.
+ * Copyright 2022 Edward V. Emelianov <edward.emelianoff@gmail.com>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+#ifndef STM32F1_H__
+#define STM32F1_H__
+
+// host replacement of MCU definitions used by driver
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef TRUE
+#define TRUE    1
+#endif
+#ifndef FALSE
+#define FALSE   0
+#endif
+
+static inline uint32_t __REV16(uint32_t x){
+    return ((x & 0x00ff00ffU) << 8) | ((x >> 8) & 0x00ff00ffU);
+}
+
+typedef struct{
+    volatile uint32_t KR;
+} IWDG_TypeDef;
+extern IWDG_TypeDef *IWDG;
+#define IWDG_REFRESH    (uint32_t)(0x0000AAAA)
+
+#endif // STM32F1_H__
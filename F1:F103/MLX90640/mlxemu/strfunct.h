@@ -0,0 +1 @@
+../strfunct.h
\ No newline at end of file
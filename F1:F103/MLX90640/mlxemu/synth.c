@@ -0,0 +1 @@
+../calctest/synth.c
\ No newline at end of file
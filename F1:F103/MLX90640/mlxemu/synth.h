@@ -0,0 +1 @@
+../calctest/synth.h
\ No newline at end of file
@@ -0,0 +1,153 @@
+/*
+ * This file is part of the MLX90640 project.
+ * Copyright 2022 Edward V. Emelianov <edward.emelianoff@gmail.com>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "mlxroi.h"
+
+mlxroi_cfg mlx_roicfg[MLX_ROI_MAX];
+mlxroi_result mlx_roires[MLX_ROI_MAX];
+uint8_t mlx_roiactive = 0; // bitmask of active ROIs
+
+// accumulators of current frame (separate for each subpage: subpage can be processed again before frame is full)
+typedef struct{
+    int16_t min, max;
+    uint8_t maxx, maxy;     // position of max
+    uint16_t n;             // amount of pixels
+    int32_t sum;            // sum of values
+    uint32_t w, wx, wy;     // sum of excesses over `hi` and sums of coordinates weighted by them
+} roiacc;
+
+static roiacc acc[MLX_ROI_MAX][2];
+
+static void accreset(roiacc *a){
+    a->min = INT16_MAX;
+    a->max = INT16_MIN;
+    a->maxx = a->maxy = 0;
+    a->n = 0;
+    a->sum = 0;
+    a->w = a->wx = a->wy = 0;
+}
+
+/**
+ * @brief mlxroi_set - set and activate ROI
+ * @param n - its number
+ * @param x0, y0, x1, y1 - corners (inclusive)
+ * @param lo, hi - alarm thresholds
+ * @return FALSE if parameters are wrong
+ */
+int mlxroi_set(int n, int x0, int y0, int x1, int y1, int lo, int hi){
+    if(n < 0 || n >= MLX_ROI_MAX) return FALSE;
+    if(x0 < 0 || y0 < 0 || x1 < x0 || y1 < y0 || x1 >= MLX_W || y1 >= MLX_H) return FALSE;
+    if(lo > hi || lo < INT16_MIN || hi > INT16_MAX) return FALSE;
+    mlxroi_cfg *c = &mlx_roicfg[n];
+    c->x0 = x0; c->y0 = y0; c->x1 = x1; c->y1 = y1;
+    c->lo = lo; c->hi = hi;
+    accreset(&acc[n][0]); // values of previous settings are wrong
+    accreset(&acc[n][1]);
+    mlx_roires[n].alarm = 0;
+    mlx_roiactive |= 1 << n;
+    return TRUE;
+}
+
+void mlxroi_off(int n){
+    if(n < 0 || n >= MLX_ROI_MAX) return;
+    mlx_roiactive &= ~(1 << n);
+    mlx_roires[n].alarm = 0;
+}
+
+// start new frame (e.g. when previous one wasn't completed)
+void mlxroi_reset(){
+    for(int i = 0; i < MLX_ROI_MAX; ++i){
+        accreset(&acc[i][0]);
+        accreset(&acc[i][1]);
+    }
+}
+
+/**
+ * @brief mlxroi_rows - add processed pixels of subpage to statistics
+ * @param image - image
+ * @param subpage - subpage number
+ * @param row0, row1 - rows processed: [row0, row1); row0 == 0 starts subpage again
+ */
+void mlxroi_rows(const int16_t *image, uint8_t subpage, int row0, int row1){
+    for(int i = 0; i < MLX_ROI_MAX; ++i){
+        if(!(mlx_roiactive & (1 << i))) continue;
+        const mlxroi_cfg *c = &mlx_roicfg[i];
+        roiacc *a = &acc[i][subpage & 1];
+        if(row0 == 0) accreset(a);
+        int r0 = (row0 > c->y0) ? row0 : c->y0, r1 = (row1 <= c->y1) ? row1 : c->y1 + 1;
+        for(int row = r0; row < r1; ++row){
+            int col = c->x0 + ((row ^ subpage ^ c->x0) & 1); // first pixel of subpage
+            for(const int16_t *p = &image[row*MLX_W + col]; col <= c->x1; col += 2, p += 2){
+                int16_t v = *p;
+                if(v < a->min) a->min = v;
+                if(v > a->max){
+                    a->max = v;
+                    a->maxx = col; a->maxy = row;
+                }
+                a->sum += v;
+                ++a->n;
+                if(v > c->hi){
+                    uint32_t w = v - c->hi;
+                    a->w += w;
+                    a->wx += w * col;
+                    a->wy += w * row;
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief mlxroi_frame - calculate results of full frame and start next one
+ * @return bitmask of ROIs with alarm
+ */
+uint8_t mlxroi_frame(){
+    uint8_t alarms = 0;
+    for(int i = 0; i < MLX_ROI_MAX; ++i){
+        if(!(mlx_roiactive & (1 << i))) continue;
+        const mlxroi_cfg *c = &mlx_roicfg[i];
+        roiacc *a = &acc[i][0], *b = &acc[i][1];
+        mlxroi_result *r = &mlx_roires[i];
+        if(a->n == 0 && b->n == 0) continue; // frame wasn't full
+        // join both subpages into `a`
+        if(b->min < a->min) a->min = b->min;
+        if(b->max > a->max){
+            a->max = b->max;
+            a->maxx = b->maxx; a->maxy = b->maxy;
+        }
+        a->sum += b->sum; a->n += b->n;
+        a->w += b->w; a->wx += b->wx; a->wy += b->wy;
+        r->min = a->min;
+        r->max = a->max;
+        r->mean = (int16_t)((a->sum + (a->sum < 0 ? -(a->n/2) : a->n/2)) / a->n);
+        if(a->w){
+            r->cx = (uint8_t)((((uint64_t)a->wx << 3) + a->w/2) / a->w);
+            r->cy = (uint8_t)((((uint64_t)a->wy << 3) + a->w/2) / a->w);
+        }else{
+            r->cx = a->maxx << 3;
+            r->cy = a->maxy << 3;
+        }
+        r->alarm = 0;
+        if(a->max > c->hi) r->alarm |= MLXROI_ALARM_HI;
+        if(a->min < c->lo) r->alarm |= MLXROI_ALARM_LO;
+        if(r->alarm) alarms |= 1 << i;
+        accreset(a);
+        accreset(b);
+    }
+    return alarms;
+}
@@ -0,0 +1,55 @@
+/*
+ * This file is part of the MLX90640 project.
+ * Copyright 2022 Edward V. Emelianov <edward.emelianoff@gmail.com>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+#ifndef MLXROI_H__
+#define MLXROI_H__
+
+// statistics of regions of interest: accumulated by rows of each processed subpage, ready after full frame
+
+#include "mlx90640_calc.h"
+
+// max amount of ROIs
+#define MLX_ROI_MAX         (4)
+// alarm flags
+#define MLXROI_ALARM_HI     (1<<0)  // max > hi
+#define MLXROI_ALARM_LO     (1<<1)  // min < lo
+
+// ROI settings; all values are in units of image (degrC*MLX_TSCALE)
+typedef struct{
+    uint8_t x0, y0, x1, y1;         // corners (inclusive)
+    int16_t lo, hi;                 // alarm thresholds; pixels above `hi` are used for centroid
+} mlxroi_cfg;
+
+// ROI statistics of last frame
+typedef struct{
+    int16_t min, max, mean;
+    uint8_t cx, cy;                 // centroid of pixels above `hi` weighted by excess (or position of max), 1/8 pixel
+    uint8_t alarm;                  // MLXROI_ALARM_*
+} mlxroi_result;
+
+extern mlxroi_cfg mlx_roicfg[MLX_ROI_MAX];
+extern mlxroi_result mlx_roires[MLX_ROI_MAX];
+extern uint8_t mlx_roiactive;
+
+int mlxroi_set(int n, int x0, int y0, int x1, int y1, int lo, int hi);
+void mlxroi_off(int n);
+void mlxroi_reset();
+void mlxroi_rows(const int16_t *image, uint8_t subpage, int row0, int row1);
+uint8_t mlxroi_frame();
+
+#endif // MLXROI_H__
@@ -0,0 +1,240 @@
+/*
+ * This file is part of the MLX90640 project.
+ * Copyright 2022 Edward V. Emelianov <edward.emelianoff@gmail.com>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stddef.h> // offsetof
+
+#include "crc.h"
+#include "mlxstream.h"
+
+// CRC of header and payload
+#define FRAMECRC(h, payload) crc16_add(crc16((const uint8_t*)(h), offsetof(mlxs_header, crc)), payload, (h)->len)
+
+// loop by pixels of subpage `sp`
+#define FOREACH_SPPIX(sp, pix) \
+    for(int row_ = 0; row_ < MLX_H; ++row_) \
+        for(int pix = row_*MLX_W + ((row_ ^ (sp)) & 1); pix < (row_ + 1)*MLX_W; pix += 2)
+
+// put int16 value in little-endian order
+#define PUT16(o, v) do{*(o)++ = (v) & 0xff; *(o)++ = ((v) >> 8) & 0xff;}while(0)
+// get int16 value
+#define GET16(i)    ((int16_t)((i)[0] | ((i)[1] << 8)))
+
+// fill header of frame and its CRC
+static void mkheader(mlxs_encoder *e, uint8_t *out, uint8_t flags, uint8_t subpage, int len, uint32_t time, int16_t Ta){
+    mlxs_header *h = (mlxs_header*)out;
+    h->magic[0] = MLXS_MAGIC0;
+    h->magic[1] = MLXS_MAGIC1;
+    h->flags = flags;
+    h->subpage = subpage;
+    h->seq = e->seq++;
+    h->len = (uint16_t)len;
+    h->time = time;
+    h->Ta = Ta;
+    h->crc = FRAMECRC(h, out + sizeof(mlxs_header));
+}
+
+// force key frames of both subpages (e.g. after transmission error)
+void mlxs_reset(mlxs_encoder *e){
+    e->valid = 0;
+}
+
+// delta coding of subpage `sp` into `out`; @return its length or 0 if it's not shorter than raw data
+static int delta(const mlxs_encoder *e, const int16_t *image, uint8_t sp, uint8_t *out){
+    uint8_t *o = out, *end = out + MLXS_MAXPAYLOAD;
+    int run = 0;
+    FOREACH_SPPIX(sp, pix){
+        int32_t d = image[pix] - e->prev[pix];
+        if(d == 0){
+            if(++run == 64){
+                if(o == end) return 0;
+                *o++ = 0x80 | 63;
+                run = 0;
+            }
+            continue;
+        }
+        if(end - o < 4) return 0; // run + longest code
+        if(run){
+            *o++ = 0x80 | (run - 1);
+            run = 0;
+        }
+        if(d >= -64 && d < 64) *o++ = d & 0x7f;
+        else if(d >= -4096 && d < 4096){
+            *o++ = 0xc0 | ((d >> 8) & 0x1f);
+            *o++ = d & 0xff;
+        }else{
+            *o++ = 0xe0;
+            PUT16(o, image[pix]);
+        }
+    }
+    if(run){
+        if(o == end) return 0;
+        *o++ = 0x80 | (run - 1);
+    }
+    return o - out;
+}
+
+/**
+ * @brief mlxs_encode - make frame of binary stream
+ * @param e - encoder state
+ * @param image - image with processed subpage
+ * @param subpage - its number
+ * @param flags - MLXS_FLAG_SIMPLE or 0 (MLXS_FLAG_DELTA is set by encoder)
+ * @param time - timestamp
+ * @param Ta - ambient temperature, degrC*MLX_TSCALE
+ * @param out (o) - buffer for frame (MLXS_MAXLEN bytes)
+ * @return length of frame
+ */
+int mlxs_encode(mlxs_encoder *e, const int16_t *image, uint8_t subpage, uint8_t flags, uint32_t time,
+                int16_t Ta, uint8_t *out){
+    uint8_t *payload = out + sizeof(mlxs_header);
+    int len = 0;
+    subpage &= 1;
+    flags &= MLXS_FLAG_SIMPLE;
+    if((e->valid & (1<<subpage)) && e->nkey[subpage] < MLXS_KEYPERIOD)
+        len = delta(e, image, subpage, payload);
+    if(len){
+        flags |= MLXS_FLAG_DELTA;
+        ++e->nkey[subpage];
+    }else{ // key frame
+        uint8_t *o = payload;
+        FOREACH_SPPIX(subpage, pix) PUT16(o, image[pix]);
+        len = MLXS_MAXPAYLOAD;
+        e->nkey[subpage] = 1;
+    }
+    FOREACH_SPPIX(subpage, pix) e->prev[pix] = image[pix];
+    e->valid |= 1 << subpage;
+    mkheader(e, out, flags, subpage, len, time, Ta);
+    return (int)sizeof(mlxs_header) + len;
+}
+
+/**
+ * @brief mlxs_roiframe - make frame with ROI statistics
+ * @param e - encoder state
+ * @param r - results of all ROIs
+ * @param mask - bitmask of ROIs to send
+ * @param flags - MLXS_FLAG_SIMPLE or 0
+ * @param time - timestamp
+ * @param Ta - ambient temperature, degrC*MLX_TSCALE
+ * @param out (o) - buffer for frame (MLXS_MAXLEN bytes)
+ * @return length of frame
+ */
+int mlxs_roiframe(mlxs_encoder *e, const mlxroi_result *r, uint8_t mask, uint8_t flags, uint32_t time,
+                  int16_t Ta, uint8_t *out){
+    uint8_t *o = out + sizeof(mlxs_header);
+    for(int i = 0; i < MLX_ROI_MAX; ++i, ++r){
+        if(!(mask & (1 << i))) continue;
+        *o++ = i;
+        *o++ = r->alarm;
+        PUT16(o, r->min);
+        PUT16(o, r->max);
+        PUT16(o, r->mean);
+        *o++ = r->cx;
+        *o++ = r->cy;
+    }
+    int len = o - out - sizeof(mlxs_header);
+    mkheader(e, out, (flags & MLXS_FLAG_SIMPLE) | MLXS_FLAG_ROI, 0, len, time, Ta);
+    return (int)sizeof(mlxs_header) + len;
+}
+
+/**
+ * @brief mlxs_check - check frame at start of received data
+ * @param buf - data
+ * @param len - its length
+ * @return frame length if it's full and valid, 0 if need more data or -1 if there's no frame at `buf`
+ */
+int mlxs_check(const uint8_t *buf, int len){
+    if(len < 1) return 0;
+    if(buf[0] != MLXS_MAGIC0) return -1;
+    if(len < 2) return 0;
+    if(buf[1] != MLXS_MAGIC1) return -1;
+    if(len < (int)sizeof(mlxs_header)) return 0;
+    const mlxs_header *h = (const mlxs_header*)buf;
+    if(h->subpage > 1 || h->len > MLXS_MAXPAYLOAD) return -1;
+    if(h->flags & MLXS_FLAG_ROI){
+        if(h->len % MLXS_ROISZ || h->len > MLX_ROI_MAX * MLXS_ROISZ) return -1;
+    }else if(!(h->flags & MLXS_FLAG_DELTA) && h->len != MLXS_MAXPAYLOAD) return -1;
+    int flen = (int)sizeof(mlxs_header) + h->len;
+    if(len < flen) return 0;
+    if(h->crc != FRAMECRC(h, buf + sizeof(mlxs_header))) return -1;
+    return flen;
+}
+
+/**
+ * @brief mlxs_decode - decode checked frame
+ * @param frame - frame (checked by mlxs_check)
+ * @param image (io) - image (for delta frame it should contain previous frame of the same subpage)
+ * @return FALSE if payload is broken
+ */
+int mlxs_decode(const uint8_t *frame, int16_t *image){
+    const mlxs_header *h = (const mlxs_header*)frame;
+    const uint8_t *in = frame + sizeof(mlxs_header), *end = in + h->len;
+    int run = 0;
+    if(h->flags & MLXS_FLAG_ROI) return FALSE;
+    if(!(h->flags & MLXS_FLAG_DELTA)){
+        FOREACH_SPPIX(h->subpage, pix){
+            image[pix] = GET16(in);
+            in += 2;
+        }
+        return TRUE;
+    }
+    FOREACH_SPPIX(h->subpage, pix){
+        if(run){ // unchanged pixel
+            --run;
+            continue;
+        }
+        if(in == end) return FALSE;
+        uint8_t c = *in++;
+        if(c < 0x80) image[pix] += (c & 0x40) ? (int)c - 0x80 : c;
+        else if(c < 0xc0) run = c & 0x3f;
+        else if(c < 0xe0){
+            if(in == end) return FALSE;
+            int d = ((c & 0x1f) << 8) | *in++;
+            image[pix] += (d & 0x1000) ? d - 0x2000 : d;
+        }else if(c == 0xe0){
+            if(end - in < 2) return FALSE;
+            image[pix] = GET16(in);
+            in += 2;
+        }else return FALSE;
+    }
+    return (run == 0 && in == end);
+}
+
+/**
+ * @brief mlxs_decode_roi - decode checked frame with ROI statistics
+ * @param frame - frame (checked by mlxs_check)
+ * @param r (o) - results of all ROIs (only received are changed)
+ * @return bitmask of received ROIs
+ */
+uint8_t mlxs_decode_roi(const uint8_t *frame, mlxroi_result *r){
+    const mlxs_header *h = (const mlxs_header*)frame;
+    const uint8_t *in = frame + sizeof(mlxs_header), *end = in + h->len;
+    uint8_t mask = 0;
+    if(!(h->flags & MLXS_FLAG_ROI)) return 0;
+    for(; in < end; in += MLXS_ROISZ){
+        if(in[0] >= MLX_ROI_MAX) continue;
+        mlxroi_result *R = &r[in[0]];
+        mask |= 1 << in[0];
+        R->alarm = in[1];
+        R->min = GET16(in + 2);
+        R->max = GET16(in + 4);
+        R->mean = GET16(in + 6);
+        R->cx = in[8];
+        R->cy = in[9];
+    }
+    return mask;
+}
@@ -0,0 +1,85 @@
+/*
+ * This file is part of the MLX90640 project.
+ * Copyright 2022 Edward V. Emelianov <edward.emelianoff@gmail.com>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+#ifndef MLXSTREAM_H__
+#define MLXSTREAM_H__
+
+// binary stream of thermal images (pure code without hardware, used in host decoder too)
+//
+// Each processed subpage is sent as frame: header + pixels of this subpage (chess pattern, row by row).
+// All values are little-endian. Pixels are int16 (degrC*MLX_TSCALE or Vir*MLX_VIRSCALE for simple image),
+// raw (key frame) or coded as difference with previous frame of the same subpage:
+//   0ddddddd           - 7-bit signed delta (-64..63)
+//   10nnnnnn           - n+1 unchanged pixels (1..64)
+//   110ddddd dddddddd  - 13-bit signed delta (-4096..4095), high bits first
+//   11100000 LL HH     - absolute value
+// Delta frame is decoded only if previous frame of its subpage was decoded (look at `seq` to find losses),
+// so key frames are sent periodically and after each error.
+// Frame with MLXS_FLAG_ROI contains only ROI statistics of full frame (subpage field is 0): MLXS_ROISZ bytes
+// for each active ROI: number, alarm flags, min, max, mean (int16), centroid X and Y (1/8 pixel).
+
+#include "mlx90640_calc.h"
+#include "mlxroi.h"
+
+#define MLXS_MAGIC0         (0x4D) // 'M'
+#define MLXS_MAGIC1         (0x54) // 'T'
+// header flags
+#define MLXS_FLAG_DELTA     (1<<0) // delta coded frame
+#define MLXS_FLAG_SIMPLE    (1<<1) // pixels are Vir*MLX_VIRSCALE instead of degrC*MLX_TSCALE
+#define MLXS_FLAG_ROI       (1<<2) // ROI statistics instead of pixels
+
+// pixels in subpage
+#define MLXS_SPPIX          (MLX_PIXNO/2)
+// max payload (raw frame)
+#define MLXS_MAXPAYLOAD     (MLXS_SPPIX*2)
+// size of ROI record
+#define MLXS_ROISZ          (10)
+// send key frame of each subpage not rarely than once per MLXS_KEYPERIOD frames of it
+#define MLXS_KEYPERIOD      (32)
+
+typedef struct __attribute__((packed)){
+    uint8_t magic[2];   // MLXS_MAGIC0, MLXS_MAGIC1
+    uint8_t flags;      // MLXS_FLAG_*
+    uint8_t subpage;    // subpage number
+    uint16_t seq;       // frame number (to find lost frames)
+    uint16_t len;       // payload length
+    uint32_t time;      // time of frame, ms
+    int16_t Ta;         // ambient temperature, degrC*MLX_TSCALE
+    uint16_t crc;       // CRC16-CCITT of header (before this field) and payload
+} mlxs_header;
+
+// maximal frame length
+#define MLXS_MAXLEN         (sizeof(mlxs_header) + MLXS_MAXPAYLOAD)
+
+typedef struct{
+    int16_t prev[MLX_PIXNO];    // values sent last time
+    uint16_t seq;               // number of next frame
+    uint8_t valid;              // bitmask of subpages with valid `prev`
+    uint8_t nkey[2];            // frames of each subpage after its last key frame
+} mlxs_encoder;
+
+void mlxs_reset(mlxs_encoder *e);
+int mlxs_encode(mlxs_encoder *e, const int16_t *image, uint8_t subpage, uint8_t flags, uint32_t time,
+                int16_t Ta, uint8_t *out);
+int mlxs_roiframe(mlxs_encoder *e, const mlxroi_result *r, uint8_t mask, uint8_t flags, uint32_t time,
+                  int16_t Ta, uint8_t *out);
+int mlxs_check(const uint8_t *buf, int len);
+int mlxs_decode(const uint8_t *frame, int16_t *image);
+uint8_t mlxs_decode_roi(const uint8_t *frame, mlxroi_result *r);
+
+#endif // MLXSTREAM_H__
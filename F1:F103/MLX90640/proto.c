@@ -18,13 +18,32 @@
 
 #include "i2c.h"
 #include "mlx90640.h"
+#include "mlxroi.h"
+#include "mlxstream.h"
 #include "proto.h"
 #include "strfunct.h"
 #include "usb.h"
+#include "usb_lib.h"
 #include "version.inc"
 
 extern uint32_t Tms;
 
+// binary stream modes
+enum{
+    STREAM_OFF,     // text alarms of ROIs only
+    STREAM_RAW,     // key frames only
+    STREAM_DELTA,   // delta coding
+    STREAM_ROI,     // ROI statistics of each frame
+    STREAM_AMOUNT
+};
+static uint8_t streammode = STREAM_OFF;
+static uint8_t sensor = 0; // current sensor (for all commands, stream and ROI)
+static uint32_t streamed = 0; // value of `mlx_subpages` for last subpage sent
+static uint32_t lastframe = 0; // value of `frames` of current sensor for last frame analyzed
+static uint8_t roialarm[MLX_ROI_MAX]; // alarm flags reported last time
+static mlxs_encoder encoder;
+static uint8_t streambuf[MLXS_MAXLEN];
+
 static const char* _states[M_STATES_AMOUNT] = {
     [M_ERROR]       = "error",
     [M_RELAX]       = "do nothing",
@@ -38,70 +57,161 @@ static const char* _states[M_STATES_AMOUNT] = {
     [M_POWEROFF]    = "wait without power",
 };
 
-// dump floating point array 24x32
-static void dumpfarr(float *arr){
-    for(int row = 0; row < 24; ++row){
-        for(int col = 0; col < 32; ++col){
-            float2str(*arr++, 2); bufputchar(' ');
+// dump integer array 24x32
+// print int16 (or uint16 if `u`) array of calibration values
+static void dumpiarr(const int16_t *arr, uint8_t u){
+    for(int row = 0; row < MLX_H; ++row){
+        for(int col = 0; col < MLX_W; ++col, ++arr){
+            if(u) printu((uint16_t)*arr);
+            else printi(*arr);
+            bufputchar(' ');
         }
         newline();
     }
 }
 
 static void dumpparams(){
-    SEND("\nkVdd="); printi(params.kVdd);
-    SEND("\nvdd25="); printi(params.vdd25);
-    SEND("\nKvPTAT="); float2str(params.KvPTAT, 4);
-    SEND("\nKtPTAT="); float2str(params.KtPTAT, 4);
-    SEND("\nvPTAT25="); printi(params.vPTAT25);
-    SEND("\nalphaPTAT="); float2str(params.alphaPTAT, 2);
-    SEND("\ngainEE="); printi(params.gainEE);
-    SEND("\nPixel offset parameters:\n");
-    float *offset = params.offset;
-    for(int row = 0; row < 24; ++row){
-        for(int col = 0; col < 32; ++col){
-            float2str(*offset++, 2); bufputchar(' ');
-        }
-        newline();
-    }
-    SEND("K_talpha:\n");
-    dumpfarr(params.kta);
+    const MLX90640_params *p = &mlx_sensors[sensor].params;
+    SEND("\nkVdd="); printi(p->kVdd);
+    SEND("\nvdd25="); printi(p->vdd25);
+    SEND("\nKvPTAT="); printfloat(p->KvPTAT, 4);
+    SEND("\nKtPTAT="); printfloat(p->KtPTAT, 4);
+    SEND("\nvPTAT25="); printi(p->vPTAT25);
+    SEND("\nalphaPTAT="); printfloat(p->alphaPTAT, 2);
+    SEND("\ngainEE="); printi(p->gainEE);
+    SEND("\nPixel offset (Q"); printi(p->off_q); SEND("):\n");
+    dumpiarr(p->offset, 0);
+    SEND("Offset*K_ta (Q"); printu(p->okta_q); SEND("):\n");
+    dumpiarr(p->offkta, 0);
     SEND("Kv: ");
     for(int i = 0; i < 4; ++i){
-        float2str(params.kv[i], 2); bufputchar(' ');
+        printfloat(p->kv[i], 2); bufputchar(' ');
     }
     SEND("\ncpOffset=");
-    printi(params.cpOffset[0]); SEND(", "); printi(params.cpOffset[1]);
-    SEND("\ncpKta="); float2str(params.cpKta, 2);
-    SEND("\ncpKv="); float2str(params.cpKv, 2);
-    SEND("\ntgc="); float2str(params.tgc, 2);
-    SEND("\ncpALpha="); float2str(params.cpAlpha[0], 2);
-    SEND(", "); float2str(params.cpAlpha[1], 2);
-    SEND("\nKsTa="); float2str(params.KsTa, 2);
-    SEND("\nAlpha:\n");
-    dumpfarr(params.alpha);
-    SEND("\nCT3="); float2str(params.CT[1], 2);
-    SEND("\nCT4="); float2str(params.CT[2], 2);
+    printi(p->cpOffset[0]); SEND(", "); printi(p->cpOffset[1]);
+    SEND("\ncpKta="); printfloat(p->cpKta, 2);
+    SEND("\ncpKv="); printfloat(p->cpKv, 2);
+    SEND("\ntgc="); printfloat(p->tgc, 2);
+    SEND("\ncpALpha="); printfloat(p->cpAlpha[0], 2);
+    SEND(", "); printfloat(p->cpAlpha[1], 2);
+    SEND("\nKsTa="); printfloat(p->KsTa, 2);
+    SEND("\n1/alpha (shift="); printu(p->ia_shift); SEND("):\n");
+    dumpiarr((const int16_t*)p->ialpha, 1);
+    SEND("\nCT3="); printfloat(p->CT[1], 2);
+    SEND("\nCT4="); printfloat(p->CT[2], 2);
     for(int i = 0; i < 4; ++i){
         SEND("\nKsTo"); bufputchar('0'+i); bufputchar('=');
-        float2str(params.ksTo[i], 2);
+        printfloat(p->ksTo[i], 2);
         SEND("\nalphacorr"); bufputchar('0'+i); bufputchar('=');
-        float2str(params.alphacorr[i], 2);
+        printfloat(p->alphacorr[i], 2);
     }
     NL();
 }
 
 static void dumpimage(){
-    float *idata = mlx_image;
+    const mlx_sensor *s = &mlx_sensors[sensor];
+    const int16_t *idata = MLX_IMAGE(s);
+    float scale = s->simpleimage ? 1.f/MLX_VIRSCALE : 1.f/MLX_TSCALE;
     for(int row = 0; row < MLX_H; ++row){
         for(int col = 0; col < MLX_W; ++col, ++idata){
-            float2str(*idata,1); bufputchar(' ');
+            printfloat(*idata * scale, s->simpleimage ? 1 : 2); bufputchar(' ');
         }
         newline();
     }
     NL();
 }
 
+// print `n` values of registers starting from `reg`
+static void dumpregs(uint16_t reg, const uint16_t *data, uint16_t n){
+    for(uint16_t i = 0; i < n; ++i){
+        printuhex(reg + i);
+        addtobuf(" ");
+        printuhex(data[i]);
+        newline();
+    }
+    sendbuf();
+}
+
+// Ta in units of image
+static int16_t Ta_i16(){
+    float Ta = mlx_sensors[sensor].Ta * MLX_TSCALE;
+    return (int16_t)(Ta < 0.f ? Ta - 0.5f : Ta + 0.5f);
+}
+
+// print changes of ROI alarms: "ALARM n HI|LO|HILO|OFF"
+static void roi_alarms(){
+    for(int i = 0; i < MLX_ROI_MAX; ++i){
+        uint8_t a = mlx_roires[i].alarm;
+        if(a == roialarm[i]) continue;
+        roialarm[i] = a;
+        SEND("ALARM "); printu(i); bufputchar(' ');
+        if(a & MLXROI_ALARM_HI) SEND("HI");
+        if(a & MLXROI_ALARM_LO) SEND("LO");
+        if(!a) SEND("OFF");
+        NL();
+    }
+}
+
+/**
+ * @brief stream_proc - send new subpage or ROI statistics of current sensor in binary stream (if it's on) or ROI alarms
+ * Should be called in main loop after mlx90640_process()
+ */
+void stream_proc(){
+    const mlx_sensor *s = &mlx_sensors[sensor];
+    int len = 0;
+    if(lastframe != s->frames){ // new full frame
+        lastframe = s->frames;
+        if(streammode != STREAM_ROI) roi_alarms();
+        else if(usbON && mlx_roiactive)
+            len = mlxs_roiframe(&encoder, mlx_roires, mlx_roiactive, s->simpleimage ? MLXS_FLAG_SIMPLE : 0, Tms,
+                                Ta_i16(), streambuf);
+    }
+    if((streammode == STREAM_RAW || streammode == STREAM_DELTA) && streamed != mlx_subpages && mlx_spimage){
+        streamed = mlx_subpages;
+        if(mlx_spsensor != sensor) return; // subpage of other sensor
+        if(!usbON || streammode == STREAM_RAW){ // no previous frames on host side or no delta coding
+            mlxs_reset(&encoder);
+            if(!usbON) return;
+        }
+        len = mlxs_encode(&encoder, mlx_spimage, mlx_lastsp, mlx_spsimple ? MLXS_FLAG_SIMPLE : 0, Tms,
+                          Ta_i16(), streambuf);
+    }
+    if(!len) return;
+    sendbuf(); // text should be sent before frame
+    // host didn't get whole frame: next frames shouldn't be delta-coded against it
+    if(!USB_send_blk(streambuf, (uint16_t)len)) mlxs_reset(&encoder);
+}
+
+// print ROI settings and statistics of last frame
+static void dumproi(){
+    for(int i = 0; i < MLX_ROI_MAX; ++i){
+        if(!(mlx_roiactive & (1 << i))) continue;
+        const mlxroi_cfg *c = &mlx_roicfg[i];
+        const mlxroi_result *r = &mlx_roires[i];
+        printu(i); SEND(": ("); printu(c->x0); bufputchar(','); printu(c->y0); SEND(")-(");
+        printu(c->x1); bufputchar(','); printu(c->y1); SEND("), lo="); printfloat(c->lo / (float)MLX_TSCALE, 2);
+        SEND(", hi="); printfloat(c->hi / (float)MLX_TSCALE, 2);
+        SEND("; min="); printfloat(r->min / (float)MLX_TSCALE, 2);
+        SEND(", max="); printfloat(r->max / (float)MLX_TSCALE, 2);
+        SEND(", mean="); printfloat(r->mean / (float)MLX_TSCALE, 2);
+        SEND(", centroid=("); printfloat(r->cx / 8.f, 3); bufputchar(',');
+        printfloat(r->cy / 8.f, 3); SEND("), alarm=");
+        printu(r->alarm);
+        newline();
+    }
+    NL();
+}
+
+// make sensor `n` current: its subpages are streamed and its frames are used for ROI
+static void select_sensor(uint8_t n){
+    sensor = n;
+    mlx_roisensor = n;
+    mlxroi_reset();
+    mlxs_reset(&encoder);
+    streamed = mlx_subpages;
+    lastframe = mlx_sensors[n].frames;
+}
+
 const char *parse_cmd(char *buf){
     int32_t Num = 0;
     uint16_t r, d;
@@ -110,50 +220,73 @@ const char *parse_cmd(char *buf){
     char *ptr, cmd = *buf++;
     switch(cmd){
         case 'a':
-            if(buf != getnum(buf, &Num)){
-                if(Num & 0x80) return "Enter 7bit address";
-                i2c_set_addr7(Num);
+            if(buf != getint(buf, &Num)){
+                if(Num < 1 || Num > 0x7f) return "Enter 7bit address";
+                if(!mlx90640_setaddr(sensor, Num)) return "Can't change";
                 return "Changed";
             }else return "Wrong address";
         break;
+        case 'B':
+            if(buf == getint(buf, &Num)) Num = STREAM_OFF; // stop
+            else if(Num < 0 || Num >= STREAM_AMOUNT) return "Mode should be from 0 to 3";
+            streammode = (uint8_t)Num;
+            streamed = mlx_subpages;
+            lastframe = mlx_sensors[sensor].frames;
+            mlxs_reset(&encoder);
+            return "OK";
+        break;
+        case 'c':
+            if(buf == getint(buf, &Num)) Num = -1; // stop
+            else if(Num < 0 || Num > 7) return "Rate should be from 0 to 7";
+            if(!mlx90640_continuous(sensor, Num)) return "FAILED";
+            else return "OK";
+        break;
         case 'd':
-            if(buf != (ptr = getnum(buf, &Num))){
+            if(buf != (ptr = getint(buf, &Num))){
                 r = Num;
-                if(ptr != getnum(ptr, &Num)){
+                if(ptr != getint(ptr, &Num)){
                     if(Num < 1 || Num > MLX_DMA_MAXLEN) return "0<N<=832";
-                    if(!read_data_dma(r, Num)) return("Can't read");
-                    else return "OK";
+                    if(!(data = read_data_dma(sensor, r, Num))) return "Can't read";
+                    dumpregs(r, data, Num);
+                    return NULL;
                 }else return "Need amount";
             }else return "Need reg";
         break;
         case 'E':
         case 'e':
-            if(!mlx90640_take_image(cmd == 'e')) return "FAILED";
+            if(!mlx90640_take_image(sensor, cmd == 'e')) return "FAILED";
             else return "OK";
         break;
+        case 'F':
+            Num = mlx90640_discover();
+            if(Num < 0) return "Sensors are busy";
+            SEND("Found "); printi(Num); NL();
+            if(sensor >= mlx_nsensors) select_sensor(0);
+            return NULL;
+        break;
         case 'f':
             SEND("Float test: ");
-            float2str(0.f, 2); addtobuf(", ");
-            float2str(pi, 1); addtobuf(", ");
-            float2str(-e, 2); addtobuf(", ");
-            float2str(-pi, 3); addtobuf(", ");
-            float2str(e, 4); addtobuf(", ");
+            printfloat(0.f, 2); addtobuf(", ");
+            printfloat(pi, 1); addtobuf(", ");
+            printfloat(-e, 2); addtobuf(", ");
+            printfloat(-pi, 3); addtobuf(", ");
+            printfloat(e, 4); addtobuf(", ");
             uint32_t uu = INF | 0x80000000;
             float *f = (float*)&uu;
-            float2str(*f, 4); addtobuf(", ");
+            printfloat(*f, 4); addtobuf(", ");
             uu = NAN;
             f = (float*)&uu;
-            float2str(*f, 4);
+            printfloat(*f, 4);
             NL();
             return NULL;
         break;
         case 'g':
-            if(buf != (ptr = getnum(buf, &Num))){
+            if(buf != (ptr = getint(buf, &Num))){
                 r = Num;
-                if(ptr != getnum(ptr, &Num)){
+                if(ptr != getint(ptr, &Num)){
                     if(Num < 1 || Num > MLX_DMA_MAXLEN) return "N from 0 to 832";
                     uint16_t od = d = Num;
-                    if(!(data = read_data(r, &d))){
+                    if(!(data = read_data(sensor, r, &d))){
                         SEND("Can't read\n");
                         return NULL;
                     }
@@ -162,26 +295,65 @@ const char *parse_cmd(char *buf){
                         printu(d);
                         addtobuf(" values\n");
                     }
-                    for(uint16_t i = 0; i < d; ++i){
-                        printuhex(r + i);
-                        addtobuf(" ");
-                        printuhex(data[i]);
-                        newline();
-                    }
-                    sendbuf();
+                    dumpregs(r, data, d);
                     return NULL;
                 }else return "Need amount";
             }else return "Need reg";
         break;
+        case 'i':
+            if(buf == (ptr = getint(buf, &Num))){
+                dumproi();
+                return NULL;
+            }
+            if(Num < 0 || Num >= MLX_ROI_MAX) return "Wrong ROI number";
+            int32_t roi[6]; // x0, y0, x1, y1, lo, hi
+            for(int i = 0; i < 6; ++i){
+                buf = ptr;
+                if(buf == (ptr = getint(buf, &roi[i]))){
+                    if(i) return "Need x0 y0 x1 y1 lo hi";
+                    mlxroi_off(Num);
+                    return "OFF";
+                }
+            }
+            if(roi[4] < -300 || roi[5] > 320) return "Thresholds should be from -300 to 320 degrC";
+            if(!mlxroi_set(Num, roi[0], roi[1], roi[2], roi[3], roi[4] * MLX_TSCALE, roi[5] * MLX_TSCALE))
+                return "Wrong ROI";
+            return "OK";
+        break;
         case 'I':
             i2c_setup(TRUE);
             return "I2C restarted";
         break;
         case 'M':
-            SEND("MLX state: "); SEND(_states[mlx_state]);
-            SEND("\npower="); printu(MLXPOW_VAL()); NL();
+            const mlx_sensor *s = &mlx_sensors[sensor];
+            SEND("MLX "); printu(sensor); SEND(" (addr "); printuhex(s->addr); SEND(") state: ");
+            SEND(_states[s->state]);
+            SEND("\npower="); printu(MLXPOW_VAL());
+            SEND("\nsubpages="); printu(s->subpages);
+            SEND("\nframes="); printu(s->frames);
+            SEND("\nroialarm="); printuhex(mlx_roialarm);
+            SEND("\ntread="); printu(s->tread);
+            SEND("\ntproc="); printu(s->tproc);
+            SEND("\nTa="); printfloat(s->Ta, 2);
+            SEND("\nVdd="); printfloat(s->Vdd, 3); NL();
             return NULL;
         break;
+        case 'n':
+            if(buf == getint(buf, &Num)){ // list of sensors
+                for(uint8_t i = 0; i < mlx_nsensors; ++i){
+                    bufputchar(i == sensor ? '*' : ' ');
+                    printu(i); SEND(": addr="); printuhex(mlx_sensors[i].addr);
+                    SEND(", state="); SEND(_states[mlx_sensors[i].state]);
+                    SEND(", frames="); printu(mlx_sensors[i].frames);
+                    newline();
+                }
+                NL();
+                return NULL;
+            }
+            if(Num < 0 || Num >= mlx_nsensors) return "Wrong sensor number";
+            select_sensor(Num);
+            return "OK";
+        break;
         case 'O':
             mlx90640_restart();
             return "Power off/on";
@@ -191,8 +363,8 @@ const char *parse_cmd(char *buf){
             return NULL;
         break;
         case 'r':
-            if(buf != (ptr = getnum(buf, &Num))){
-                if(read_reg(Num, &d)){
+            if(buf != (ptr = getint(buf, &Num))){
+                if(read_reg(sensor, Num, &d)){
                     printuhex(d); NL();
                     return NULL;
                 }else return "Can't read";
@@ -211,23 +383,28 @@ const char *parse_cmd(char *buf){
             return NULL;
         break;
         case 'w':
-            if(buf == (ptr = getnum(buf, &Num))) return "Need register";
+            if(buf == (ptr = getint(buf, &Num))) return "Need register";
             r = Num;
-            if(ptr == getnum(ptr, &Num)) return "Need data";
-            if(write_reg(r, Num)) return "OK";
+            if(ptr == getint(ptr, &Num)) return "Need data";
+            if(write_reg(sensor, r, Num)) return "OK";
             else return "Failed";
         break;
         default: // help
             addtobuf(
             "MLX90640 build #" BUILD_NUMBER " @" BUILD_DATE "\n\n"
-            "'a addr' - change MLX I2C address to `addr`\n"
-            "'d reg N' - read  registers starting from `reg` using DMA\n"
+            "'a addr' - set I2C address of current sensor to `addr`\n"
+            "'B [mode]' - binary stream (mode: 0 - off, 1 - raw subpages, 2 - delta coding, 3 - ROI statistics), without arg - off\n"
+            "'c [rate]' - continuous readout with refresh `rate` (0 - 0.5Hz, 1 - 1Hz, ..., 5 - 16Hz, 7 - 64Hz), without arg - stop\n"
+            "'d reg N' - read N registers starting from `reg` using DMA\n"
             "'Ee' - expose image: E - full, e - simple\n"
+            "'F' - find sensors on I2C bus\n"
             "'f' - test float printf (0.00, 3.1, -2.72, -3.142, 2.7183, -INF, NAN)\n"
             "'g reg N' - read N registers starting from `reg`\n"
+            "'i [n [x0 y0 x1 y1 lo hi]]' - set ROI `n` (thresholds in degrC), `i n` - turn it off, `i` - show ROIs\n"
             "'I' - restart I2C\n"
-            "'M' - MLX state\n"
-            "'O' - turn On or restart MLX sensor\n"
+            "'M' - state and statistics of current sensor (subpages, frames, ROI alarms, readout and processing time in ms, Ta, Vdd)\n"
+            "'n [N]' - make sensor `N` current (for all commands, stream and ROI), without arg - list sensors\n"
+            "'O' - turn On or restart MLX sensors (they have common power)\n"
             "'P' - dump params\n"
             "'r reg' - read `reg`\n"
             "'R' - software reset\n"
@@ -20,5 +20,6 @@
 #define PROTO_H__
 
 const char *parse_cmd(char *buf);
+void stream_proc();
 
 #endif // PROTO_H__
@@ -0,0 +1,331 @@
+/*
+ * This file is part of the MLX90640 project.
+ * Copyright 2022 Edward V. Emelianov <edward.emelianoff@gmail.com>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// decoder of binary stream ('B' command) and its test
+// usage: ./streamdec [-s] file - decode stream from file or tty (after `stty -F /dev/ttyACM0 raw`),
+//                                print images and ROI statistics (or only statistics of stream with -s)
+//        ./streamdec -t [N [seed]] - encode/decode N synthetic subpages with losses and garbage,
+//                                    check ROI statistics of N/2 frames
+
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "mlxstream.h"
+
+typedef struct{
+    int16_t image[MLX_PIXNO];   // current image
+    mlxroi_result roi[MLX_ROI_MAX]; // last ROI statistics
+    uint8_t roimask;            // ROIs in last ROI frame
+    uint8_t valid;              // bitmask of subpages with valid data in `image`
+    int seq;                    // expected number of next frame (-1 - unknown)
+    long frames, decoded, lost, skipped, broken, garbage;
+} decoder;
+
+typedef void (*frame_cb)(const decoder *d, const mlxs_header *h);
+
+static void dec_init(decoder *d){
+    memset(d, 0, sizeof(decoder));
+    d->seq = -1;
+}
+
+// decode all full frames in `buf`; @return amount of bytes processed
+static int dec_feed(decoder *d, const uint8_t *buf, int len, frame_cb cb){
+    int pos = 0;
+    while(pos < len){
+        int r = mlxs_check(buf + pos, len - pos);
+        if(r == 0) break; // need more data
+        if(r < 0){ // text output of device or broken data
+            ++pos; ++d->garbage;
+            continue;
+        }
+        const mlxs_header *h = (const mlxs_header*)(buf + pos);
+        if(d->seq > -1 && h->seq != (uint16_t)d->seq){ // we don't know subpages of lost frames
+            d->lost += (uint16_t)(h->seq - d->seq);
+            d->valid = 0;
+        }
+        d->seq = (uint16_t)(h->seq + 1);
+        ++d->frames;
+        uint8_t bit = 1 << h->subpage;
+        if(h->flags & MLXS_FLAG_ROI){
+            d->roimask = mlxs_decode_roi(buf + pos, d->roi);
+            ++d->decoded;
+            if(cb) cb(d, h);
+        }else if((h->flags & MLXS_FLAG_DELTA) && !(d->valid & bit)) ++d->skipped; // wait for key frame
+        else if(mlxs_decode(buf + pos, d->image)){
+            d->valid |= bit;
+            ++d->decoded;
+            if(cb) cb(d, h);
+        }else{
+            d->valid &= ~bit;
+            ++d->broken;
+        }
+        pos += r;
+    }
+    return pos;
+}
+
+// decode rest of data at the end of stream: part of broken frame can look like beginning of frame
+static void dec_flush(decoder *d, const uint8_t *buf, int len, frame_cb cb){
+    while(len > 0){
+        int n = dec_feed(d, buf, len, cb);
+        if(n < len){ // skip first byte of unfinished "frame"
+            ++n; ++d->garbage;
+        }
+        buf += n; len -= n;
+    }
+}
+
+static void dec_stat(const decoder *d){
+    printf("frames: %ld, decoded: %ld, lost: %ld, skipped (waiting for key frame): %ld, broken: %ld, "
+           "garbage bytes: %ld\n", d->frames, d->decoded, d->lost, d->skipped, d->broken, d->garbage);
+}
+
+static void print_image(const decoder *d, const mlxs_header *h){
+    int simple = h->flags & MLXS_FLAG_SIMPLE;
+    double scale = simple ? MLX_VIRSCALE : MLX_TSCALE;
+    if(h->flags & MLXS_FLAG_ROI){
+        printf("# seq=%u time=%u Ta=%.2f ROI\n", h->seq, h->time, h->Ta / (double)MLX_TSCALE);
+        for(int i = 0; i < MLX_ROI_MAX; ++i){
+            const mlxroi_result *r = &d->roi[i];
+            if(!(d->roimask & (1 << i))) continue;
+            printf("%d: min=%.2f max=%.2f mean=%.2f centroid=(%.3f, %.3f)%s%s\n", i, r->min / scale, r->max / scale,
+                   r->mean / scale, r->cx / 8., r->cy / 8., (r->alarm & MLXROI_ALARM_HI) ? " HI" : "",
+                   (r->alarm & MLXROI_ALARM_LO) ? " LO" : "");
+        }
+        return;
+    }
+    printf("# seq=%u time=%u subpage=%u Ta=%.2f%s%s\n", h->seq, h->time, h->subpage, h->Ta / (double)MLX_TSCALE,
+           (h->flags & MLXS_FLAG_DELTA) ? " delta" : "", simple ? " simple" : "");
+    if(d->valid != 3) return; // wait for both subpages
+    const int16_t *p = d->image;
+    for(int row = 0; row < MLX_H; ++row){
+        for(int col = 0; col < MLX_W; ++col) printf("%.*f ", simple ? 1 : 2, *p++ / scale);
+        printf("\n");
+    }
+}
+
+static int decode_file(const char *name, int statonly){
+    static uint8_t buf[4*MLXS_MAXLEN];
+    static decoder d;
+    int fd = open(name, O_RDONLY), len = 0;
+    if(fd < 0){
+        perror(name);
+        return 1;
+    }
+    dec_init(&d);
+    for(;;){
+        ssize_t r = read(fd, buf + len, sizeof(buf) - len);
+        if(r <= 0) break;
+        len += r;
+        int n = dec_feed(&d, buf, len, statonly ? NULL : print_image);
+        memmove(buf, buf + n, len - n);
+        len -= n;
+    }
+    close(fd);
+    dec_flush(&d, buf, len, statonly ? NULL : print_image);
+    dec_stat(&d);
+    return 0;
+}
+
+/******************************** test ********************************/
+
+static int16_t (*sent)[MLX_PIXNO]; // all encoded images by seq
+static long mismatch = 0;
+
+static void check_image(const decoder *d, const mlxs_header *h){
+    int row, col;
+    if(h->flags & MLXS_FLAG_ROI) return;
+    for(int pix = 0; pix < MLX_PIXNO; ++pix){
+        row = pix / MLX_W; col = pix % MLX_W;
+        if(((row ^ col) & 1) != h->subpage) continue;
+        if(d->image[pix] != sent[h->seq][pix]){
+            if(++mismatch < 10) printf("seq %u pix %d: %d instead of %d\n", h->seq, pix, d->image[pix], sent[h->seq][pix]);
+        }
+    }
+}
+
+static double drand(double min, double max){
+    return min + (max - min) * random() / (double)RAND_MAX;
+}
+
+// synthetic scene: background with noise (some pixels unchanged), moving hot spot and rare spikes
+static void synth_image(int16_t *image, int n){
+    double x0 = MLX_W/2 + 10*sin(n * 0.05), y0 = MLX_H/2 + 6*cos(n * 0.07);
+    for(int row = 0; row < MLX_H; ++row) for(int col = 0; col < MLX_W; ++col){
+        int16_t *p = &image[row*MLX_W + col];
+        double r2 = (col - x0)*(col - x0) + (row - y0)*(row - y0);
+        int base = 2500 + (r2 < 9. ? 6000 : 0);
+        if(random() % 2) *p = (int16_t)(base + drand(-15., 15.));
+        else if(abs(*p - base) > 100) *p = (int16_t)base; // spot moved
+        if(random() % 1000 == 0) *p = (int16_t)(random() % 65536 - 32768);
+    }
+}
+
+// compare incremental ROI statistics with direct calculation and check its coding; @return amount of errors
+static long test_roi(long N){
+    static int16_t image[MLX_PIXNO];
+    static uint8_t frame[MLXS_MAXLEN];
+    static mlxs_encoder e;
+    static decoder d;
+    long errors = 0;
+    mlxroi_reset();
+    dec_init(&d);
+    for(long n = 0; n < N; ++n){
+        if(n % 16 == 0){ // new ROIs
+            for(int i = 0; i < MLX_ROI_MAX; ++i){
+                if(random() % 4 == 0){
+                    mlxroi_off(i);
+                    continue;
+                }
+                int x0 = random() % MLX_W, y0 = random() % MLX_H, x1 = x0 + random() % (MLX_W - x0),
+                    y1 = y0 + random() % (MLX_H - y0), lo = random() % 3000, hi = lo + random() % 6000;
+                if(!mlxroi_set(i, x0, y0, x1, y1, lo, hi)) ++errors;
+            }
+        }
+        synth_image(image, n);
+        for(int sp = 0; sp < 2; ++sp) for(int row = 0; row < MLX_H;){ // by random portions of rows
+            int nrows = 1 + random() % 6;
+            if(row + nrows > MLX_H) nrows = MLX_H - row;
+            mlxroi_rows(image, sp, row, row + nrows);
+            row += nrows;
+        }
+        mlxroi_frame();
+        for(int i = 0; i < MLX_ROI_MAX; ++i){
+            if(!(mlx_roiactive & (1 << i))) continue;
+            const mlxroi_cfg *c = &mlx_roicfg[i];
+            const mlxroi_result *r = &mlx_roires[i];
+            int min = INT16_MAX, max = INT16_MIN, np = 0;
+            double sum = 0., w = 0., wx = 0., wy = 0.;
+            for(int y = c->y0; y <= c->y1; ++y) for(int x = c->x0; x <= c->x1; ++x){
+                int v = image[y*MLX_W + x];
+                if(v < min) min = v;
+                if(v > max) max = v;
+                sum += v; ++np;
+                if(v > c->hi){ w += v - c->hi; wx += (v - c->hi) * x; wy += (v - c->hi) * y; }
+            }
+            // without hot pixels centroid is position of any pixel with max value
+            int mx = r->cx / 8, my = r->cy / 8, ismax = (mx >= c->x0 && mx <= c->x1 && my >= c->y0 && my <= c->y1
+                    && image[my*MLX_W + mx] == max);
+            double cx = w > 0. ? 8. * wx / w : (ismax ? r->cx : -1), cy = w > 0. ? 8. * wy / w : (ismax ? r->cy : -1);
+            int alarm = (max > c->hi ? MLXROI_ALARM_HI : 0) | (min < c->lo ? MLXROI_ALARM_LO : 0);
+            if(r->min != min || r->max != max || fabs(r->mean - sum / np) > 0.5 || fabs(r->cx - cx) > 0.5
+                    || fabs(r->cy - cy) > 0.5 || r->alarm != alarm){
+                if(++errors < 10) printf("frame %ld, ROI %d: min=%d/%d max=%d/%d mean=%d/%.2f cx=%d/%.2f cy=%d/%.2f"
+                                         " alarm=%d/%d\n", n, i, r->min, min, r->max, max, r->mean, sum / np,
+                                         r->cx, cx, r->cy, cy, r->alarm, alarm);
+            }
+        }
+        int l = mlxs_roiframe(&e, mlx_roires, mlx_roiactive, 0, n, 2500, frame);
+        int bad = (l != dec_feed(&d, frame, l, NULL) || d.roimask != mlx_roiactive);
+        for(int i = 0; i < MLX_ROI_MAX; ++i)
+            if((mlx_roiactive & (1 << i)) && memcmp(&d.roi[i], &mlx_roires[i], sizeof(mlxroi_result))) bad = 1;
+        if(bad && ++errors < 10) printf("frame %ld: ROI frame decoding error\n", n);
+    }
+    printf("ROI statistics of %ld frames: %ld errors\n", N, errors);
+    return errors;
+}
+
+#define MAXSTREAM   (1<<20)
+static int test(long N, unsigned seed){
+    static mlxs_encoder e;
+    static decoder d;
+    static int16_t image[MLX_PIXNO];
+    static uint8_t frame[MLXS_MAXLEN];
+    uint8_t *stream = malloc(MAXSTREAM);
+    long len = 0, total = 0, expected = 0, nkey = 0;
+    uint8_t valid = 0;
+    if(N > 65536) N = 65536; // `seq` is 16-bit
+    sent = malloc(N * sizeof(*sent));
+    srandom(seed);
+    dec_init(&d);
+    memset(&e, 0, sizeof(e));
+    for(long n = 0; n < N; ++n){
+        uint8_t sp = n & 1;
+        synth_image(image, n);
+        memcpy(sent[n], image, sizeof(image));
+        int l = mlxs_encode(&e, image, sp, (n / 100) % 2 ? MLXS_FLAG_SIMPLE : 0, (uint32_t)n * 16,
+                            (int16_t)(2500 + n % 100), frame);
+        const mlxs_header *h = (const mlxs_header*)frame;
+        if(!(h->flags & MLXS_FLAG_DELTA)) ++nkey;
+        total += l;
+        long r = random() % 100;
+        if(r == 1){ // broken byte
+            frame[random() % l] ^= 1 << (random() % 8);
+        }else if(r < 5){ // text output
+            memcpy(stream + len, "OK\n", 3);
+            len += 3;
+        }
+        if(r == 0) mlxs_reset(&e); // lost frame: device knows about USB timeout (see stream_proc() in ../proto.c)
+        if(r < 2) valid = 0; // lost or broken frame
+        else if((h->flags & MLXS_FLAG_DELTA) == 0 || (valid & (1 << sp))){
+            valid |= 1 << sp;
+            ++expected;
+        }
+        if(r){
+            memcpy(stream + len, frame, l);
+            len += l;
+        }
+        if(len > MAXSTREAM - 2*(long)MLXS_MAXLEN || n == N - 1){ // decode by random portions
+            long pos = 0, rest = 0;
+            static uint8_t buf[4*MLXS_MAXLEN];
+            while(pos < len){
+                long portion = 1 + random() % MLXS_MAXLEN;
+                if(portion > len - pos) portion = len - pos;
+                memcpy(buf + rest, stream + pos, portion);
+                pos += portion; rest += portion;
+                int used = dec_feed(&d, buf, rest, check_image);
+                memmove(buf, buf + used, rest - used);
+                rest -= used;
+            }
+            if(n == N - 1) dec_flush(&d, buf, rest, check_image);
+            else if(rest){ // keep unfinished data for next portion
+                memmove(stream, buf, rest);
+            }
+            len = rest;
+        }
+    }
+    dec_stat(&d);
+    printf("%.1f bytes per subpage (%.1f for raw stream), %ld key frames of %ld\n", (double)total / N,
+           (double)MLXS_MAXLEN, nkey, N);
+    free(stream);
+    free(sent);
+    long roierr = test_roi(N / 2);
+    if(mismatch || d.decoded != expected || roierr){
+        printf("FAIL (seed %u): %ld wrong pixels, %ld of %ld frames decoded\n", seed, mismatch, d.decoded, expected);
+        return 1;
+    }
+    printf("Test passed (%ld subpages, seed %u)\n", N, seed);
+    return 0;
+}
+
+int main(int argc, char **argv){
+    if(argc > 1 && 0 == strcmp(argv[1], "-t")){
+        long N = (argc > 2) ? atol(argv[2]) : 1000;
+        unsigned seed = (argc > 3) ? (unsigned)atol(argv[3]) : (unsigned)time(NULL);
+        return test(N, seed);
+    }
+    if(argc > 2 && 0 == strcmp(argv[1], "-s")) return decode_file(argv[2], 1);
+    if(argc == 2) return decode_file(argv[1], 0);
+    printf("Usage: %s [-s] file - decode stream (-s - only statistics)\n"
+           "       %s -t [N [seed]] - test on N synthetic subpages\n", argv[0], argv[0]);
+    return 1;
+}
@@ -0,0 +1 @@
+../mlxroi.h
\ No newline at end of file
@@ -0,0 +1 @@
+../mlxstream.c
\ No newline at end of file
@@ -0,0 +1 @@
+../mlxstream.h
\ No newline at end of file
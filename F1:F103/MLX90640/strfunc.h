@@ -0,0 +1 @@
+../../snippets/strfunc.h
\ No newline at end of file
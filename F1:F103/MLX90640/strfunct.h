@@ -21,6 +21,7 @@
 #define STRFUNCT_H__
 
 #include "stm32f1.h"
+#include "strfunc.h"
 
 #ifndef DENORM
 #define DENORM  (0x007FFFFF)
@@ -60,8 +61,6 @@ void printu(uint32_t val);
 void printi(int32_t val);
 void printuhex(uint32_t val);
 void sendbuf();
-char *omit_spaces(char *buf);
-char *getnum(char *buf, int32_t *N);
-void float2str(float x, uint8_t prec);
+void printfloat(float x, uint8_t prec);
 
 #endif // STRFUNCT_H__
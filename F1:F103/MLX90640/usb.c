@@ -110,9 +110,10 @@ void USB_sendstr(const char *str){
     USB_send((uint8_t*)str, l);
 }
 
-// blocking sending
-void USB_send_blk(const uint8_t *buf, uint16_t len){
-    if(!usbON || !len) return; // USB disconnected
+// blocking sending; @return FALSE if USB is disconnected or data wasn't sent by timeout
+int USB_send_blk(const uint8_t *buf, uint16_t len){
+    if(!len) return TRUE;
+    if(!usbON) return FALSE; // USB disconnected
     if(buflen){
         usbwr(usbbuff, buflen);
         buflen = 0;
@@ -121,13 +122,14 @@ void USB_send_blk(const uint8_t *buf, uint16_t len){
     while(len){
         if(len == USB_TXBUFSZ) needzlp = 1;
         uint16_t s = (len > USB_TXBUFSZ) ? USB_TXBUFSZ : len;
-        if(usbwr(buf, s)) return;
+        if(usbwr(buf, s)) return FALSE;
         len -= s;
         buf += s;
     }
     if(needzlp){
-        usbwr(NULL, 0);
+        if(usbwr(NULL, 0)) return FALSE;
     }
+    return TRUE;
 }
 
 void usb_proc(){
@@ -28,7 +28,7 @@ void USB_setup();
 void usb_proc();
 void USB_send(const uint8_t *buf, uint16_t len);
 void USB_sendstr(const char *str);
-void USB_send_blk(const uint8_t *buf, uint16_t len);
+int USB_send_blk(const uint8_t *buf, uint16_t len);
 uint8_t USB_receive(uint8_t *buf);
 
 #endif // __USB_H__
@@ -18,6 +18,7 @@
 
 #include "stm32f1.h"
 
+#include "cfgjournal.h"
 #include "flash.h"
 #include "proto.h"
 #include "usb.h"    // printout
@@ -25,7 +26,6 @@
 
 extern const uint32_t __varsstart, _BLOCKSIZE;
 static const uint32_t FLASH_blocksize = (uint32_t)&_BLOCKSIZE;
-static uint32_t maxCnum = 1024 / sizeof(user_conf); // can't use blocksize here
 
 #define USERCONF_INITIALIZER  {         \
      .userconf_sz = sizeof(user_conf)   \
@@ -39,11 +39,23 @@ static uint32_t maxCnum = 1024 / sizeof(user_conf); // can't use blocksize here
     ,.shtrVdiv = 25                     \
     }
 
-static int write2flash(const void*, const void*, uint32_t);
 const user_conf *Flash_Data = (const user_conf *)(&__varsstart);
 user_conf the_conf = USERCONF_INITIALIZER;
 
-static int currentconfidx = -1; // index of current configuration
+// configuration journal (see cfgjournal.h), bank size is 2k or flash page if it's larger
+#define JBANKSZ     (2048)
+static user_conf storedconf; // data stored in flash
+static uint16_t jbuf[CJ_BUFSZ(sizeof(user_conf))];
+static int write2flash(const void *addr, const uint16_t *data, uint32_t n);
+static int erase_page(const void *addr);
+static cj_journal journal = {
+    .write = write2flash,
+    .erase = erase_page,
+    .image = (uint8_t*)&the_conf,
+    .shadow = (uint8_t*)&storedconf,
+    .buf = jbuf,
+    .size = sizeof(user_conf)
+};
 
 /**
  * @brief binarySearch - binary search in flash for last non-empty cell
@@ -72,36 +84,42 @@ static int binarySearch(int r, const uint8_t *start, int stor_size){
     return -1; // not found
 }
 
+// size of storage in bytes (0 if FLASH_SIZE is wrong)
+static uint32_t storagesize(){
+    if(FLASH_SIZE < 1 || FLASH_SIZE > 20000) return 0;
+    uint32_t flsz = FLASH_SIZE * 1024 - ((uint32_t)Flash_Data - FLASH_BASE);
+    return flsz - flsz % FLASH_blocksize;
+}
+
 /**
  * @brief flashstorage_init - initialization of user conf storage
  * run in once @ start
  */
 void flashstorage_init(){
-    if(FLASH_SIZE > 0 && FLASH_SIZE < 20000){
-        uint32_t flsz = FLASH_SIZE * 1024; // size in bytes
-        flsz -= (uint32_t)(&__varsstart) - FLASH_BASE;
-        maxCnum = flsz / sizeof(user_conf);
+    journal.base = (const uint8_t*)Flash_Data;
+    journal.pagesize = FLASH_blocksize;
+    journal.banksize = (FLASH_blocksize > JBANKSZ) ? FLASH_blocksize : JBANKSZ;
+    if(storagesize() < 2 * journal.banksize){ // no place for two banks
+        journal.base = NULL;
+        return;
     }
-    // -1 if there's no data at all & flash is clear; maxnum-1 if flash is full
-    currentconfidx = binarySearch((int)maxCnum-2, (const uint8_t*)Flash_Data, sizeof(user_conf));
-    if(currentconfidx > -1){
-        memcpy(&the_conf, &Flash_Data[currentconfidx], sizeof(user_conf));
+    if(cj_mount(&journal) == CJ_EMPTY){
+        // old storage format: array of full user_conf copies (it will be replaced at first saving)
+        if(Flash_Data->userconf_sz != sizeof(user_conf)) return;
+        int idx = binarySearch((int)(storagesize() / sizeof(user_conf)) - 2, (const uint8_t*)Flash_Data, sizeof(user_conf));
+        if(idx > -1) memcpy(&the_conf, &Flash_Data[idx], sizeof(user_conf));
     }
 }
 
-// store new configuration
+// save changes of configuration
 // @return 0 if all OK
 int store_userconf(){
-    // maxnum - 3 means that there always should be at least one empty record after last data
-    // for binarySearch() checking that there's nothing more after it!
-    if(currentconfidx > (int)maxCnum - 3){ // there's no more place
-        currentconfidx = 0;
-        if(erase_storage(-1)) return 1;
-    }else ++currentconfidx; // take next data position (0 - within first run after firmware flashing)
-    return write2flash((const void*)&Flash_Data[currentconfidx], &the_conf, sizeof(the_conf));
+    if(!journal.base) return 1;
+    return (CJ_OK != cj_save(&journal));
 }
 
-static int write2flash(const void *start, const void *wrdata, uint32_t stor_size){
+// program `n` halfwords; @return 0 if OK
+static int write2flash(const void *addr, const uint16_t *data, uint32_t n){
     int ret = 0;
     if (FLASH->CR & FLASH_CR_LOCK){ // unloch flash
         FLASH->KEYR = FLASH_KEY1;
@@ -110,13 +128,11 @@ static int write2flash(const void *start, const void *wrdata, uint32_t stor_size
     while (FLASH->SR & FLASH_SR_BSY)  IWDG->KR = IWDG_REFRESH;
     FLASH->SR = FLASH_SR_EOP | FLASH_SR_PGERR | FLASH_SR_WRPRTERR; // clear all flags
     FLASH->CR |= FLASH_CR_PG;
-    const uint16_t *data = (const uint16_t*) wrdata;
-    volatile uint16_t *address = (volatile uint16_t*) start;
-    uint32_t i, count = (stor_size + 1) / 2;
-    for(i = 0; i < count; ++i){
-        *(volatile uint16_t*)(address + i) = data[i];
+    volatile uint16_t *address = (volatile uint16_t*) addr;
+    for(uint32_t i = 0; i < n; ++i){
+        address[i] = data[i];
         while(FLASH->SR & FLASH_SR_BSY) IWDG->KR = IWDG_REFRESH;
-        if(*(volatile uint16_t*)(address + i) != data[i]){
+        if(address[i] != data[i]){
             USB_sendstr("Error: flash is corrupted\n");
             ret = 1;
             break;
@@ -128,14 +144,22 @@ static int write2flash(const void *start, const void *wrdata, uint32_t stor_size
         }
         FLASH->SR = FLASH_SR_EOP | FLASH_SR_PGERR | FLASH_SR_WRPRTERR;
     }
+    FLASH->SR = FLASH_SR_EOP | FLASH_SR_PGERR | FLASH_SR_WRPRTERR;
     FLASH->CR &= ~(FLASH_CR_PG);
     return ret;
 }
 
-// erase Nth page of flash storage (flash should be prepared!)
-static int erase_pageN(int N){
+// erase page @ `addr`; @return 0 if OK
+static int erase_page(const void *addr){
     int ret = 0;
-    FLASH->AR = (uint32_t)Flash_Data + N*FLASH_blocksize;
+    if((FLASH->CR & FLASH_CR_LOCK) != 0){
+        FLASH->KEYR = FLASH_KEY1;
+        FLASH->KEYR = FLASH_KEY2;
+    }
+    while(FLASH->SR & FLASH_SR_BSY) IWDG->KR = IWDG_REFRESH;
+    FLASH->SR = FLASH_SR_EOP | FLASH_SR_PGERR | FLASH_SR_WRPRTERR;
+    FLASH->CR |= FLASH_CR_PER;
+    FLASH->AR = (uint32_t)addr;
     FLASH->CR |= FLASH_CR_STRT;
     while(FLASH->SR & FLASH_SR_BSY) IWDG->KR = IWDG_REFRESH;
     FLASH->SR = FLASH_SR_EOP;
@@ -143,43 +167,34 @@ static int erase_pageN(int N){
         ret = 1;
         FLASH->SR = FLASH_SR_WRPRTERR; /* Clear the flag by software by writing it at 1*/
     }
+    FLASH->CR &= ~FLASH_CR_PER;
     return ret;
 }
 
 // erase full storage (npage < 0) or its nth page; @return 0 if all OK
 int erase_storage(int npage){
     int ret = 0;
-    uint32_t end = 1, start = 0, flsz = 0;
-    if(FLASH_SIZE > 0 && FLASH_SIZE < 20000){
-        flsz = FLASH_SIZE * 1024; // size in bytes
-        flsz -= (uint32_t)Flash_Data - FLASH_BASE;
-    }
-    end = flsz / FLASH_blocksize;
+    uint32_t end = storagesize() / FLASH_blocksize, start = 0;
     if(end == 0 || end >= FLASH_SIZE) return 1;
     if(npage > -1){ // erase only one page
         if((uint32_t)npage >= end) return 1;
         start = npage;
         end = start + 1;
     }
-    if((FLASH->CR & FLASH_CR_LOCK) != 0){
-        FLASH->KEYR = FLASH_KEY1;
-        FLASH->KEYR = FLASH_KEY2;
-    }
-    while(FLASH->SR & FLASH_SR_BSY) IWDG->KR = IWDG_REFRESH;
-    FLASH->SR = FLASH_SR_EOP | FLASH_SR_PGERR | FLASH_SR_WRPRTERR;
-    FLASH->CR |= FLASH_CR_PER;
     for(uint32_t i = start; i < end; ++i){
-        if(erase_pageN(i)){
+        if(erase_page((const uint8_t*)Flash_Data + i * FLASH_blocksize)){
             ret = 1;
             break;
         }
     }
-    FLASH->CR &= ~FLASH_CR_PER;
+    if(journal.base) cj_mount(&journal); // find what rests
     return ret;
 }
 
 void dump_userconf(){
-    USB_sendstr("userconf_sz="); USB_sendstr(u2str(the_conf.userconf_sz));
+    USB_sendstr("userconf_bank="); USB_sendstr(u2str(journal.bank));
+    USB_sendstr("\nuserconf_tail="); USB_sendstr(u2str(journal.tail));
+    USB_sendstr("\nuserconf_sz="); USB_sendstr(u2str(the_conf.userconf_sz));
     USB_sendstr("\nccdactive="); USB_putbyte('0' + the_conf.ccdactive);
     USB_sendstr("\nhallactive="); USB_putbyte('0' + the_conf.hallactive);
     USB_sendstr("\nminvoltage="); USB_sendstr(u2str(the_conf.minvoltage));
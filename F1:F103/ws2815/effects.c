@@ -0,0 +1,103 @@
+/*
+ * This file is part of the ws2815 project.
+ * Copyright 2021 Edward V. Emelianov <edward.emelianoff@gmail.com>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// frame-based effects: each frame is rendered into linear GRB buffer, then gamma corrected (8.8 fixed point)
+// and sent to colorbuf with temporal dithering of fractional part (error is accumulated for each LED channel)
+
+#include "effects.h"
+#include "hardware.h"
+#include "hsv.h"
+#include "ws2815.h"
+
+// hue step between LEDs in rainbow (8.8 fixed point: full circle by all strip)
+#define HUESTEP     ((256 << 8) / LEDS_NUM)
+// tail of comet: each frame its channels are multiplied by COMETDECAY/256
+#define COMETDECAY  (230)
+
+uint8_t eff_dither = 1; // ==1 to dither low bits of gamma-corrected values
+static effect_t effect = EFF_RAINBOW;
+static uint32_t frame = 0; // frame counter of current effect
+static uint8_t framebuf[LEDS_NUM][3]; // linear G, R, B
+static uint8_t ditherr[LEDS_NUM][3]; // accumulated fractional parts
+
+// restart effect `e`
+void effects_set(effect_t e){
+    if(e >= EFF_AMOUNT) e = EFF_RAINBOW;
+    effect = e;
+    frame = 0;
+    for(int i = 0; i < LEDS_NUM; ++i)
+        for(int c = 0; c < 3; ++c) framebuf[i][c] = ditherr[i][c] = 0;
+}
+
+effect_t effects_get(){
+    return effect;
+}
+
+static inline void setlinear(int i, uint32_t grb){
+    framebuf[i][0] = grb & 0xff;
+    framebuf[i][1] = (grb >> 8) & 0xff;
+    framebuf[i][2] = grb >> 16;
+}
+
+/**
+ * @brief effects_render - render next frame of current effect
+ * @param s - saturation (0..255)
+ * @param v - max value (0..255)
+ */
+void effects_render(uint8_t s, uint8_t v){
+    switch(effect){
+        case EFF_FADE:{ // triangle of brightness by 512 frames, hue changes each 4 frames
+            uint16_t t = frame & 0x1ff;
+            uint8_t val = ((t < 256 ? t : 511 - t) * (v + 1)) >> 8;
+            uint32_t grb = hsv2grb(frame >> 2, s, val);
+            for(int i = 0; i < LEDS_NUM; ++i) setlinear(i, grb);
+        }
+        break;
+        case EFF_COMET:{
+            for(int i = 0; i < LEDS_NUM; ++i)
+                for(int c = 0; c < 3; ++c) framebuf[i][c] = (framebuf[i][c] * COMETDECAY) >> 8;
+            setlinear(frame % LEDS_NUM, hsv2grb(frame >> 1, s, v));
+        }
+        break;
+        default: // rainbow
+            for(int i = 0; i < LEDS_NUM; ++i)
+                setlinear(i, hsv2grb(((i * HUESTEP) >> 8) + frame, s, v));
+    }
+    ++frame;
+}
+
+/**
+ * @brief effects_output - gamma correction and dithering of current frame into colorbuf
+ * Should be called each frame (even if rendering is paused) for dithering
+ */
+void effects_output(){
+    for(int i = 0; i < LEDS_NUM; ++i){
+        uint32_t grb = 0;
+        for(int c = 2; c > -1; --c){
+            uint16_t g = gamma88[framebuf[i][c]];
+            uint8_t val = g >> 8;
+            if(eff_dither){
+                uint16_t e = ditherr[i][c] + (g & 0xff);
+                ditherr[i][c] = e & 0xff;
+                if(e > 0xff && val < 0xff) ++val;
+            }
+            grb = (grb << 8) | val;
+        }
+        ws2815setpix(i, grb);
+    }
+}
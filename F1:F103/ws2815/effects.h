@@ -0,0 +1,39 @@
+/*
+ * This file is part of the ws2815 project.
+ * Copyright 2021 Edward V. Emelianov <edward.emelianoff@gmail.com>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#ifndef EFFECTS_H__
+#define EFFECTS_H__
+
+#include <stm32f1.h>
+
+typedef enum{
+    EFF_RAINBOW,    // running rainbow
+    EFF_FADE,       // all LEDs fade in and out changing hue
+    EFF_COMET,      // moving head with fading tail
+    EFF_AMOUNT
+} effect_t;
+
+extern uint8_t eff_dither;
+
+void effects_set(effect_t e);
+effect_t effects_get();
+void effects_render(uint8_t s, uint8_t v);
+void effects_output();
+
+#endif // EFFECTS_H__
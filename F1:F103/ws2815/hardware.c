@@ -22,10 +22,14 @@
 // DMA for data transfer
 DMA_Channel_TypeDef * const WS2815DMAch = DMA1_Channel5;
 DMA_TypeDef * const WS2815DMA = DMA1;
+// DMA for parallel output
+DMA_Channel_TypeDef * const PAR_DMAset = DMA1_Channel3;
+DMA_Channel_TypeDef * const PAR_DMAdata = DMA1_Channel6;
+DMA_Channel_TypeDef * const PAR_DMAreset = DMA1_Channel2;
 
 static inline void gpio_setup(){
     // Enable clocks to the GPIO subsystems (PB for ADC), turn on AFIO clocking to disable SWD/JTAG
-    RCC->APB2ENR |= RCC_APB2ENR_IOPAEN | RCC_APB2ENR_IOPCEN | RCC_APB2ENR_AFIOEN;
+    RCC->APB2ENR |= RCC_APB2ENR_IOPAEN | RCC_APB2ENR_IOPBEN | RCC_APB2ENR_IOPCEN | RCC_APB2ENR_AFIOEN;
     // turn off SWJ/JTAG
 //    AFIO->MAPR = AFIO_MAPR_SWJ_CFG_DISABLE;
     AFIO->MAPR = AFIO_MAPR_SWJ_CFG_JTAGDISABLE; // for PA15
@@ -33,6 +37,12 @@ static inline void gpio_setup(){
     GPIOC->CRH |= CRH(13, CNF_ODOUTPUT|MODE_SLOW);
     // USB pullup (PA15) - pushpull output; timer output: pushpull (PA8)
     GPIOA->CRH = CRH(15, CNF_PPOUTPUT|MODE_SLOW) | CRH(8, CNF_AFPP | MODE_FAST);
+    // parallel strips: pushpull outputs PB0..
+    PAR_port->BRR = PAR_MASK;
+    for(int i = 0; i < PAR_STRIPS; ++i){
+        if(i < 8) PAR_port->CRL = (PAR_port->CRL & ~CRL(i, 0xf)) | CRL(i, CNF_PPOUTPUT|MODE_FAST);
+        else PAR_port->CRH = (PAR_port->CRH & ~CRH(i, 0xf)) | CRH(i, CNF_PPOUTPUT|MODE_FAST);
+    }
 }
 
 /*
@@ -44,12 +54,12 @@ TIM1->CCR1: T0H, T1L - 3 (333ns), T0L, T1H - 6 (667ns)
 TIM1->ARR = (3+6-1) = 8
 ****
 Tres > 280mks
-CCR1 = 0, PSC = 3599
+CCR1 = 0, ARR = 2699 (300us), one pulse mode with update interrupt
  */
 // PWM @PA8 (T1Ch1 -> DMA1Ch2)
 static inline void tim1_setup(){
     RCC->APB2ENR |= RCC_APB2ENR_TIM1EN; // enable TIM1 clocking
-    TIM1->ARR = 8; // 9 ticks till UEV
+    TIM1->ARR = BITTICKS - 1; // 9 ticks till UEV
     TIM1->PSC = 7; // 9MHz
     // PWM mode 1 (active->inactive)
     TIM1->CCMR1 = TIM_CCMR1_OC1M_2 | TIM_CCMR1_OC1M_1;
@@ -58,17 +68,40 @@ static inline void tim1_setup(){
     // main PWM output
     TIM1->CCER = TIM_CCER_CC1E;
     TIM1->DIER = TIM_DIER_UDE; // enable DMA requests
-    //NVIC_EnableIRQ(TIM1_CC_IRQn);
+    NVIC_EnableIRQ(TIM1_UP_IRQn); // end of reset pulse
     RCC->AHBENR |= RCC_AHBENR_DMA1EN; // DMA1 clocking
-    // memsize 8bit, periphsize 16bit, memincr, circular, mem2periph, half & full transfer interrupt
-    WS2815DMAch->CCR = DMA_CCR_PSIZE_0 | DMA_CCR_MINC | DMA_CCR_CIRC | DMA_CCR_DIR | DMA_CCR_HTIE | DMA_CCR_TCIE;
+    // memsize 16bit, periphsize 16bit, memincr, circular, mem2periph, half & full transfer interrupt
+    WS2815DMAch->CCR = DMA_CCR_MSIZE_0 | DMA_CCR_PSIZE_0 | DMA_CCR_MINC | DMA_CCR_CIRC | DMA_CCR_DIR |
+            DMA_CCR_HTIE | DMA_CCR_TCIE;
     WS2815DMAch->CPAR = (uint32_t)&TIM1->CCR1;
     NVIC_EnableIRQ(DMA1_Channel5_IRQn);
 }
 
+// parallel output: TIM3 makes three DMA requests per bit (T = 9 ticks @9MHz), CC outputs aren't used
+static inline void tim3_setup(){
+    RCC->APB1ENR |= RCC_APB1ENR_TIM3EN;
+    PAR_TIM->ARR = BITTICKS - 1;
+    PAR_TIM->PSC = 7; // 9MHz (APB1 timers clock is 72MHz)
+    PAR_TIM->CCR1 = SHORTPULSE; // T0H
+    PAR_TIM->CCR3 = LONGPULSE; // T1H
+    PAR_TIM->DIER = TIM_DIER_UDE | TIM_DIER_CC1DE | TIM_DIER_CC3DE;
+    NVIC_EnableIRQ(TIM3_IRQn); // end of reset pulse
+    // constant masks: mem 32bit without increment, circular -> BSRR/BRR
+    PAR_DMAset->CCR = DMA_CCR_PSIZE_1 | DMA_CCR_MSIZE_1 | DMA_CCR_CIRC | DMA_CCR_DIR;
+    PAR_DMAset->CPAR = (uint32_t)&PAR_port->BSRR;
+    PAR_DMAreset->CCR = DMA_CCR_PSIZE_1 | DMA_CCR_MSIZE_1 | DMA_CCR_CIRC | DMA_CCR_DIR;
+    PAR_DMAreset->CPAR = (uint32_t)&PAR_port->BRR;
+    // data: mem 16bit -> periph 32bit (zero-padded), memincr, circular, half & full transfer interrupt
+    PAR_DMAdata->CCR = DMA_CCR_PSIZE_1 | DMA_CCR_MSIZE_0 | DMA_CCR_MINC | DMA_CCR_CIRC | DMA_CCR_DIR |
+            DMA_CCR_HTIE | DMA_CCR_TCIE;
+    PAR_DMAdata->CPAR = (uint32_t)&PAR_port->BRR;
+    NVIC_EnableIRQ(DMA1_Channel6_IRQn);
+}
+
 void hw_setup(){
     gpio_setup();
     tim1_setup();
+    tim3_setup();
 }
 
 void iwdg_setup(){
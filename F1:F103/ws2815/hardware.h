@@ -24,6 +24,8 @@
 
 // LEDs amount in strip
 #define LEDS_NUM    (60)
+// LEDs in each half of DMA buffer (DMA interrupt after each DMALEDS LEDs sent), 96 bytes of RAM per LED
+#define DMALEDS     (8)
 
 // LED0 - PC13 (bluepill), blinking each second
 #define LED0_port   GPIOC
@@ -49,8 +51,28 @@ extern DMA_TypeDef * const WS2815DMA;
 // defines for timer CCR1 values:
 #define SHORTPULSE  (3)
 #define LONGPULSE   (6)
-// timer cc interrupt
-#define WSTMCCISR   tim1_cc_isr
+// timer ticks (111ns) per bit
+#define BITTICKS    (9)
+// timer ticks of reset pulse (300us)
+#define RESETTICKS  (2700)
+// timer update interrupt (end of reset pulse)
+#define WSTMUPISR   tim1_up_isr
+
+// parallel output: PAR_STRIPS strips (PB0..PB15) by PAR_LEDS LEDs
+#define PAR_STRIPS  (16)
+#define PAR_LEDS    (60)
+#define PAR_MASK    ((1 << PAR_STRIPS) - 1)
+#define PAR_port    GPIOB
+// TIM3: update -> DMA1Ch3 (set pins), CC1 -> DMA1Ch6 (data), CC3 -> DMA1Ch2 (reset pins)
+#define PAR_TIM     TIM3
+extern DMA_Channel_TypeDef * const PAR_DMAset;
+extern DMA_Channel_TypeDef * const PAR_DMAdata;
+extern DMA_Channel_TypeDef * const PAR_DMAreset;
+#define PAR_DMA     DMA1
+#define PAR_DMA_ISR_HTIF DMA_ISR_HTIF6
+#define PAR_DMA_IFCR_CLR DMA_IFCR_CGIF6
+#define PARTIMISR   tim3_isr
+#define PARDMAISR   dma1_channel6_isr
 // DMA interrupt
 #define WSDMAISR    dma1_channel5_isr
 
@@ -22,6 +22,8 @@
 
 #include <stm32f1.h>
 
-uint32_t hsv2grb(uint16_t h, uint8_t s, uint8_t v);
+extern const uint16_t gamma88[256];
+
+uint32_t hsv2grb(uint8_t h, uint8_t s, uint8_t v);
 
 #endif // HSV_H__
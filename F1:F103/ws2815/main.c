@@ -16,12 +16,13 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include "effects.h"
 #include "hardware.h"
 #include "proto.h"
 #include "usb.h"
 #include "usb_lib.h"
 #include "ws2815.h"
-#include "hsv.h"
+#include "wsparallel.h"
 
 volatile uint32_t Tms = 0;
 
@@ -50,17 +51,6 @@ char *get_USB(){
     return NULL;
 }
 
-static uint16_t Harray[LEDS_NUM]; // Hue
-
-static void rstarray(){
-    rstcounter = 0;
-    for(uint16_t i = 0; i < LEDS_NUM; ++i){
-        Harray[i] = i;
-        ws2815setpix(i, hsv2grb(Harray[i], S, V));
-    }
-    ws2815start();
-}
-
 int main(void){
     uint32_t lastT = 0, lastTc = 0;
     sysreset();
@@ -75,7 +65,7 @@ int main(void){
     iwdg_setup();
     USBPU_ON();
 
-    rstarray();
+    effects_set(EFF_RAINBOW);
     while (1){
         IWDG->KR = IWDG_REFRESH; // refresh watchdog
         if(Tms - lastT > 499){
@@ -85,14 +75,17 @@ int main(void){
         if(Tms - lastTc > 9){
             lastTc = Tms;
             if(rstcounter){
-                rstarray();
-            }else if(!pause){
-                for(uint16_t i = 0; i < LEDS_NUM; ++i){
-                    if(++Harray[i] > 359) Harray[i] = 0;
-                    uint16_t H = Harray[i];
-                       ws2815setpix(i, hsv2grb(H, S, V));
-                }
-                ws2815start();
+                rstcounter = 0;
+                effects_set(effects_get());
+            }
+            if(!pause) effects_render(S, V);
+            effects_output(); // dithering works in pause too
+            ws2815start();
+            if(parallel){ // the same picture on all strips with shift
+                for(uint8_t s = 0; s < PAR_STRIPS; ++s)
+                    for(uint16_t i = 0; i < PAR_LEDS; ++i)
+                        wsparsetpix(s, i, ws2815getpix((i + s*(LEDS_NUM/PAR_STRIPS)) % LEDS_NUM));
+                wsparstart();
             }
         }
         usb_proc();
@@ -0,0 +1,46 @@
+/*
+ * This file is part of the ws2815 project.
+ * Copyright 2021 Edward V. Emelianov <edward.emelianoff@gmail.com>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+#ifndef __HARDWARE_H__
+#define __HARDWARE_H__
+
+// host replacement of hardware.h: only parallel output (values are the same as in ../hardware.h)
+
+#include "stm32f1.h"
+
+#define DMALEDS     (8)
+#define SHORTPULSE  (3)
+#define LONGPULSE   (6)
+#define BITTICKS    (9)
+#define RESETTICKS  (2700)
+
+#define PAR_STRIPS  (16)
+#define PAR_LEDS    (60)
+#define PAR_MASK    ((1 << PAR_STRIPS) - 1)
+#define PAR_port    GPIOB
+#define PAR_TIM     TIM3
+extern DMA_Channel_TypeDef * const PAR_DMAset;
+extern DMA_Channel_TypeDef * const PAR_DMAdata;
+extern DMA_Channel_TypeDef * const PAR_DMAreset;
+#define PAR_DMA     DMA1
+#define PAR_DMA_ISR_HTIF DMA_ISR_HTIF6
+#define PAR_DMA_IFCR_CLR DMA_IFCR_CGIF6
+#define PARTIMISR   tim3_isr
+#define PARDMAISR   dma1_channel6_isr
+
+#endif // __HARDWARE_H__
@@ -0,0 +1,203 @@
+/*
+ * This file is part of the ws2815 project.
+ * Copyright 2021 Edward V. Emelianov <edward.emelianoff@gmail.com>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// test of parallel output (../wsparallel.c): bit-planes of convertLED() against per-bit reference and whole
+// frame through model of TIM3 + three DMA channels + GPIOB, pulses of each pin are decoded back into colors
+// usage: ./partest [N [seed]] - N random frames (default 100)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "wsparallel.c"
+
+static TIM_TypeDef tim3;
+static DMA_TypeDef dma1;
+static GPIO_TypeDef gpiob;
+static DMA_Channel_TypeDef dmach[3];
+TIM_TypeDef *TIM3 = &tim3;
+DMA_TypeDef *DMA1 = &dma1;
+GPIO_TypeDef *GPIOB = &gpiob;
+DMA_Channel_TypeDef * const PAR_DMAset = &dmach[0];
+DMA_Channel_TypeDef * const PAR_DMAdata = &dmach[1];
+DMA_Channel_TypeDef * const PAR_DMAreset = &dmach[2];
+
+// bits sent to each strip: LEDs + zero bits after them (no more than three halves of buffer)
+#define MAXBITS     (24*PAR_LEDS + 3*DMAHALFBUFSIZE)
+
+static uint8_t bits[PAR_STRIPS][MAXBITS];
+static int nbits[PAR_STRIPS], hightime[PAR_STRIPS];
+
+static uint32_t rand_color(){
+    switch(random() & 3){ // some extreme values
+        case 0: return 0;
+        case 1: return 0xffffff;
+        default: return random() & 0xffffff;
+    }
+}
+
+// BRR value of bit-plane `bit` (0 - MSB of G) by reference: pins of strips with zero bit
+static uint16_t refplane(const uint32_t *c, int bit){
+    int shift = (bit & ~7) + 7 - (bit & 7);
+    uint16_t brr = 0;
+    for(int s = 0; s < 16; ++s) if(!((c[s] >> shift) & 1)) brr |= 1 << s;
+    return brr & PAR_MASK;
+}
+
+// @return amount of wrong bit-planes
+static int check_convert(const uint32_t *c){
+    uint16_t d[24];
+    int bad = 0;
+    convertLED(d, c);
+    for(int i = 0; i < 24; ++i) if(d[i] != refplane(c, i)){
+        if(++bad == 1) printf("plane %d: 0x%04x instead of 0x%04x\n", i, d[i], refplane(c, i));
+    }
+    return bad;
+}
+
+// DMA request of channel `ch`: move next value to its register
+static void dmareq(DMA_Channel_TypeDef *ch){
+    if(!(ch->CCR & DMA_CCR_EN)) return;
+    if(ch == PAR_DMAset) gpiob.ODR |= setmask & 0xffff; // BSRR
+    else if(ch == PAR_DMAreset) gpiob.ODR &= ~resetmask;
+    else{ // data -> BRR, circular with half/full transfer interrupts
+        gpiob.ODR &= ~dmabuf[DMABUFSIZE - ch->CNDTR];
+        if(--ch->CNDTR == DMABUFSIZE/2) dma1.ISR |= PAR_DMA_ISR_HTIF;
+        else if(ch->CNDTR == 0){
+            ch->CNDTR = DMABUFSIZE;
+            dma1.ISR |= DMA_ISR_TCIF6;
+        }else return;
+        PARDMAISR();
+        if(dma1.IFCR & PAR_DMA_IFCR_CLR) dma1.ISR = 0;
+        dma1.IFCR = 0;
+    }
+}
+
+// one tick of timer: update event on overflow, then compare events
+static void timtick(){
+    if(!(tim3.CR1 & TIM_CR1_CEN)) return;
+    if(tim3.CNT >= tim3.ARR){
+        tim3.CNT = 0;
+        if(tim3.CR1 & TIM_CR1_OPM) tim3.CR1 &= ~TIM_CR1_CEN;
+        if(tim3.DIER & TIM_DIER_UDE) dmareq(PAR_DMAset);
+        if(tim3.DIER & TIM_DIER_UIE){
+            tim3.SR |= TIM_SR_UIF;
+            PARTIMISR();
+        }
+    }else ++tim3.CNT;
+    if(tim3.CNT == tim3.CCR1 && (tim3.DIER & TIM_DIER_CC1DE)) dmareq(PAR_DMAdata);
+    if(tim3.CNT == tim3.CCR3 && (tim3.DIER & TIM_DIER_CC3DE)) dmareq(PAR_DMAreset);
+}
+
+// send frame and decode pulses of all pins; @return 0 if something is wrong
+static int check_frame(){
+    static uint32_t colors[PAR_LEDS][PAR_STRIPS];
+    uint16_t prev = 0;
+    long ticks = 0, lowticks = 0;
+    for(int l = 0; l < PAR_LEDS; ++l) for(int s = 0; s < PAR_STRIPS; ++s){
+        colors[l][s] = rand_color();
+        wsparsetpix(s, l, colors[l][s]);
+    }
+    memset(nbits, 0, sizeof(nbits));
+    memset(hightime, 0, sizeof(hightime));
+    if(!wsparstart()){
+        printf("wsparstart() failed: previous frame is still being sent\n");
+        return 0;
+    }
+    if(wsparstart()){
+        printf("wsparstart() doesn't return 0 while frame is being sent\n");
+        return 0;
+    }
+    while(busy){
+        if(++ticks > 10L*BITTICKS*MAXBITS + RESETTICKS){
+            printf("frame isn't finished after %ld ticks\n", ticks);
+            return 0;
+        }
+        timtick();
+        uint16_t odr = gpiob.ODR;
+        for(int s = 0; s < PAR_STRIPS; ++s){
+            if(odr & (1 << s)) ++hightime[s];
+            else if(prev & (1 << s)){ // falling edge: end of bit
+                if(nbits[s] == MAXBITS){
+                    printf("strip %d: too many bits\n", s);
+                    return 0;
+                }
+                bits[s][nbits[s]++] = hightime[s] > (SHORTPULSE + LONGPULSE) / 2;
+                hightime[s] = 0;
+            }
+        }
+        lowticks = odr ? 0 : lowticks + 1;
+        prev = odr;
+    }
+    if(lowticks < RESETTICKS){
+        printf("reset pulse is too short: %ld ticks\n", lowticks);
+        return 0;
+    }
+    if(tim3.ARR != BITTICKS - 1 || tim3.CR1 & TIM_CR1_CEN){
+        printf("timer isn't restored after reset pulse\n");
+        return 0;
+    }
+    for(int s = 0; s < PAR_STRIPS; ++s){
+        if(nbits[s] != nbits[0] || nbits[s] < 24*PAR_LEDS){
+            printf("strip %d: %d bits received\n", s, nbits[s]);
+            return 0;
+        }
+        for(int b = 0; b < nbits[s]; ++b){
+            int l = b / 24, shift = (b % 24 & ~7) + 7 - (b & 7);
+            int ref = (l < PAR_LEDS) ? (colors[l][s] >> shift) & 1 : 0; // zero bits after last LED
+            if(bits[s][b] != ref){
+                printf("strip %d, LED %d, bit %d: got %d\n", s, l, b % 24, bits[s][b]);
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+int main(int argc, char **argv){
+    int N = 100, bad = 0;
+    long seed = time(NULL);
+    if(argc > 1) N = atoi(argv[1]);
+    if(argc > 2) seed = atol(argv[2]);
+    printf("seed %ld\n", seed);
+    srandom(seed);
+    // single bits through the whole matrix
+    uint32_t c[16];
+    for(int s = 0; s < 16; ++s) for(int b = 0; b < 24; ++b){
+        memset(c, 0, sizeof(c));
+        c[s] = 1 << b;
+        bad += check_convert(c);
+        for(int i = 0; i < 16; ++i) c[i] = ~c[i] & 0xffffff;
+        bad += check_convert(c);
+    }
+    for(int i = 0; i < 100000; ++i){
+        for(int s = 0; s < 16; ++s) c[s] = rand_color();
+        bad += check_convert(c);
+    }
+    printf("convertLED(): %d wrong bit-planes\n", bad);
+    // the same as tim3_setup()
+    tim3.ARR = BITTICKS - 1;
+    tim3.CCR1 = SHORTPULSE;
+    tim3.CCR3 = LONGPULSE;
+    tim3.DIER = TIM_DIER_UDE | TIM_DIER_CC1DE | TIM_DIER_CC3DE;
+    int badframes = 0;
+    for(int i = 0; i < N; ++i) if(!check_frame()) ++badframes;
+    printf("%d of %d frames are wrong (%d bits per strip)\n", badframes, N, nbits[0]);
+    return (bad || badframes) ? 1 : 0;
+}
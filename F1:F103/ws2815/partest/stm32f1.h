@@ -0,0 +1,60 @@
+/*
+ * This file is part of the ws2815 project.
+ * Copyright 2021 Edward V. Emelianov <edward.emelianoff@gmail.com>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+#ifndef STM32F1_H__
+#define STM32F1_H__
+
+// host replacement of MCU registers used by wsparallel.c
+
+#include <stdint.h>
+
+typedef struct{
+    volatile uint32_t CR1, DIER, SR, CNT, PSC, ARR, CCR1, CCR3;
+} TIM_TypeDef;
+
+typedef struct{
+    volatile uint32_t CCR, CNDTR, CPAR, CMAR;
+} DMA_Channel_TypeDef;
+
+typedef struct{
+    volatile uint32_t ISR, IFCR;
+} DMA_TypeDef;
+
+typedef struct{
+    volatile uint32_t ODR, BSRR, BRR;
+} GPIO_TypeDef;
+
+extern TIM_TypeDef *TIM3;
+extern DMA_TypeDef *DMA1;
+extern GPIO_TypeDef *GPIOB;
+
+#define TIM_CR1_CEN     (1<<0)
+#define TIM_CR1_URS     (1<<2)
+#define TIM_CR1_OPM     (1<<3)
+#define TIM_DIER_UIE    (1<<0)
+#define TIM_DIER_UDE    (1<<8)
+#define TIM_DIER_CC1DE  (1<<9)
+#define TIM_DIER_CC3DE  (1<<11)
+#define TIM_SR_UIF      (1<<0)
+
+#define DMA_CCR_EN      (1<<0)
+#define DMA_ISR_HTIF6   (1<<22)
+#define DMA_ISR_TCIF6   (1<<21)
+#define DMA_IFCR_CGIF6  (1<<20)
+
+#endif // STM32F1_H__
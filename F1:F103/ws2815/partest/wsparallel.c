@@ -0,0 +1 @@
+../wsparallel.c
\ No newline at end of file
@@ -0,0 +1 @@
+../wsparallel.h
\ No newline at end of file
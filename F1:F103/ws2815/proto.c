@@ -16,14 +16,15 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include "effects.h"
 #include "proto.h"
 #include "usb.h"
 #include "ws2815.h"
 
 #define USND(str)  do{USB_send((uint8_t*)str, sizeof(str)-1);}while(0)
 
-uint8_t S = 100, V = 50; // saturation and value
-uint8_t pause = 0, rstcounter = 0;
+uint8_t S = 255, V = 128; // saturation and value
+uint8_t pause = 0, rstcounter = 0, parallel = 0;
 
 const char *parse_cmd(const char *buf){
     if(buf[1] != '\n') return buf;
@@ -31,26 +32,37 @@ const char *parse_cmd(const char *buf){
         case 'c':
             rstcounter = 1;
         break;
+        case 'd':
+            eff_dither = !eff_dither;
+        break;
+        case 'e':
+            effects_set(effects_get() + 1);
+        break;
         case 'p':
             pause = !pause;
         break;
+        case 'P':
+            parallel = !parallel;
+        break;
         case 'R':
             USND("Soft reset\n");
             NVIC_SystemReset();
         break;
         case 's':
-            if(S > 9) S -= 10;
+            if(S > 15) S -= 16;
             else S = 0;
         break;
         case 'S':
-            if(S < 91) S += 10;
-            else S = 100;
+            if(S < 239) S += 16;
+            else S = 255;
         break;
         case 'v':
-            if(V > 9) V -= 10;
+            if(V > 15) V -= 16;
+            else V = 0;
         break;
         case 'V':
-            if(V < 91) V += 10;
+            if(V < 239) V += 16;
+            else V = 255;
         break;
         case 'W':
             USND("Wait for reboot\n");
@@ -58,8 +70,11 @@ const char *parse_cmd(const char *buf){
         break;
         default: // help
             return
-            "'c' - reset counter\n"
+            "'c' - restart effect\n"
+            "'d' - toggle temporal dithering\n"
+            "'e' - next effect (rainbow, fade, comet)\n"
             "'p' - toggle pause\n"
+            "'P' - toggle parallel output to strips on PB0..PB15\n"
             "'R' - software reset\n"
             "'s/S' - decrement/increment Saturation\n"
             "'v/V' - decrement/increment Value\n"
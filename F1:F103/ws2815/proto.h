@@ -22,6 +22,6 @@
 #include <stm32f1.h>
 
 const char *parse_cmd(const char *buf);
-extern uint8_t S, V, pause, rstcounter;
+extern uint8_t S, V, pause, rstcounter, parallel;
 
 #endif // PROTO_H__
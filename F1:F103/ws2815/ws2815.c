@@ -20,17 +20,28 @@
 #include "hardware.h"
 #include "usb.h"
 
-// DMA buffer size (24*2*N)
-// if DMAHALFBUFSIZE differs from 24, convertcolor should be changed!!!
-#define DMABUFSIZE  (48)
-#define DMAHALFBUFSIZE (24)
+// half of DMA buffer: DMALEDS LEDs, 24 bits each
+#define DMAHALFBUFSIZE  (24*DMALEDS)
+#define DMABUFSIZE      (2*DMAHALFBUFSIZE)
 
-// buffer for DMA transfers (two LEDs)
-static uint8_t dmabuf[DMABUFSIZE];
+// buffer for DMA transfers (timer CCR1 values, two halves by DMALEDS LEDs)
+static uint16_t dmabuf[DMABUFSIZE] __attribute__((aligned(4)));
 
 // buffer for GRB colors
 static uint32_t colorbuf[LEDS_NUM];
-static int currLED = 0; // currrent led number
+static int currLED = 0; // next LED to convert
+static uint8_t tail = 0; // halves of buffer sent after last LED
+static volatile uint8_t busy = 0; // ==1 while frame or reset pulse is being sent
+
+// CCR1 values for 4 bits (high bit first), packed by two into words: one nibble = two word stores
+#define P(b)        ((b) ? LONGPULSE : SHORTPULSE)
+#define NIB(n)      {P((n)&8) | (P((n)&4) << 16), P((n)&2) | (P((n)&1) << 16)}
+static const uint32_t niblut[16][2] = {
+    NIB(0),  NIB(1),  NIB(2),  NIB(3),  NIB(4),  NIB(5),  NIB(6),  NIB(7),
+    NIB(8),  NIB(9),  NIB(10), NIB(11), NIB(12), NIB(13), NIB(14), NIB(15)
+};
+#undef NIB
+#undef P
 
 // change color of led with number LEDno
 /**
@@ -52,64 +63,77 @@ uint32_t ws2815getpix(uint16_t LEDno){
 }
 
 /**
- * @brief convertcolor - convert color from XXRRGGBB to dmabuf
- * @param halfno - number of buffer half (0/1)
- * @param colr - 24bit color
+ * @brief convertcolor - convert GRB color (G in low byte, sent first) into 24 CCR1 values
+ * @param dptr - buffer (aligned to 4 bytes)
+ * @param colr - color
  */
-static void convertcolor(int halfno, uint32_t colr){
-    // check LED number
-    if(++currLED > LEDS_NUM){
-        TIM1->CR1 |= TIM_CR1_OPM;
-        // THIS IS A DIRTY HACK! IT WORKS ONLY @ HIGH SPEEDS, WHEN THERE'S NO TIME TO GO INTO IRQ
-        // On small frequencies comment this line and allow CC1 IRQ
-        TIM1->CCR1 = 0;
-        currLED = 0;
-        return;
-    }
-#if 0
-    // XXRRGGBB - 8bit
-    uint8_t GRB[3], X;
-    X = (colr >> 5)&6; // number to bits for shift (XX*2)
-    GRB[1] = (colr>>4) << X; // R
-    GRB[0] = ((colr>>2) & 3) << X; // G
-    GRB[2] = (colr & 3) << X; // B
-#endif
-    uint8_t *dptr = &dmabuf[DMAHALFBUFSIZE*halfno], *cptr = (uint8_t*)&colr; //*cptr = GRB;
-    for(int i = 0; i < DMAHALFBUFSIZE; i+=8){
-        uint8_t octet = *cptr++;
-        for(int j = 7; j > -1; --j){
-            *dptr++ = (octet & (1<<j)) ? LONGPULSE : SHORTPULSE;
-        }
+static inline void convertcolor(uint16_t *dptr, uint32_t colr){
+    uint32_t *d = (uint32_t*)dptr;
+    for(int i = 0; i < 3; ++i, colr >>= 8){
+        const uint32_t *h = niblut[(colr >> 4) & 0xf], *l = niblut[colr & 0xf];
+        *d++ = h[0]; *d++ = h[1];
+        *d++ = l[0]; *d++ = l[1];
     }
 }
 
-void ws2815start(){
+// fill half of DMA buffer by next LEDs, rest of it (after last LED) - by zeros (low level)
+static void fillhalf(int halfno){
+    uint16_t *dptr = &dmabuf[DMAHALFBUFSIZE*halfno], *end = dptr + DMAHALFBUFSIZE;
+    for(; dptr < end && currLED < LEDS_NUM; dptr += 24) convertcolor(dptr, colorbuf[currLED++]);
+    for(uint32_t *d = (uint32_t*)dptr; d < (uint32_t*)end; ++d) *d = 0;
+}
+
+/**
+ * @brief ws2815start - start sending of colorbuf
+ * @return 0 if previous frame isn't sent yet
+ */
+int ws2815start(){
+    if(busy) return 0;
+    busy = 1;
     WS2815TIM->CR1 = 0; // stop timer
     WS2815DMAch->CCR &= ~DMA_CCR_EN; // disable DMA to reconfigure
-    convertcolor(0, colorbuf[currLED]);
-    if(currLED < LEDS_NUM - 1)
-        convertcolor(1, colorbuf[currLED]);
+    currLED = 0;
+    tail = 0;
+    fillhalf(0);
+    fillhalf(1);
+    WS2815TIM->CCR1 = 0;
+    WS2815TIM->CNT = 0;
     WS2815DMA->IFCR = WS2815DMA_IFCR_CLR; // clear interrupt flags
     WS2815DMAch->CNDTR = DMABUFSIZE;
     WS2815DMAch->CMAR = (uint32_t)dmabuf;
     WS2815DMAch->CCR |= DMA_CCR_EN; // start DMA
     WS2815TIM->CR1 = TIM_CR1_CEN | TIM_CR1_URS;
+    return 1;
 }
 
-/*
-// timer update event (end of reset pulse -> start data sending process)
-void WSTMCCISR(){
-    TIM1->SR = 0;
-    TIM1->CCR1 = 0;
-    TIM1->DIER = 0;
-}*/
+// all data is sent: stop DMA and hold low level for reset pulse
+static void resetpulse(){
+    WS2815DMAch->CCR &= ~DMA_CCR_EN;
+    WS2815TIM->CR1 = 0;
+    WS2815TIM->CCR1 = 0;
+    WS2815TIM->DIER = 0;
+    WS2815TIM->ARR = RESETTICKS - 1;
+    WS2815TIM->CNT = 0;
+    WS2815TIM->SR = 0;
+    WS2815TIM->DIER = TIM_DIER_UIE;
+    WS2815TIM->CR1 = TIM_CR1_CEN | TIM_CR1_URS | TIM_CR1_OPM;
+}
 
-// DMA half/full transfer interrupts: fill another half of buffer
+// timer update event (end of reset pulse): restore bit timing, ready for next frame
+void WSTMUPISR(){
+    WS2815TIM->SR = 0;
+    WS2815TIM->CR1 = 0;
+    WS2815TIM->ARR = BITTICKS - 1;
+    WS2815TIM->DIER = TIM_DIER_UDE;
+    busy = 0;
+}
+
+// DMA half/full transfer interrupts: fill half of buffer which was sent
+// After last LED two halves of zeros are sent (so last bit isn't cut and data isn't repeated), then reset
 void WSDMAISR(){
-    if(WS2815DMA->ISR & WS2815DMA_ISR_HTIF){ // half transfer - fill first half
-        convertcolor(0, colorbuf[currLED]);
-    }else if(WS2815DMA->ISR & WS2815DMA_ISR_TCIF){ // transfer complete - fill second half
-        convertcolor(1, colorbuf[currLED]);
-    }
+    int halfno = (WS2815DMA->ISR & WS2815DMA_ISR_HTIF) ? 0 : 1;
     WS2815DMA->IFCR = WS2815DMA_IFCR_CLR;
+    if(currLED < LEDS_NUM) fillhalf(halfno);
+    else if(++tail < 3) fillhalf(halfno); // zeros
+    else resetpulse();
 }
@@ -23,6 +23,6 @@
 #include <stm32f1.h>
 
 int ws2815setpix(uint16_t LEDno, uint32_t colr);
-void ws2815start();
+int ws2815start();
 uint32_t ws2815getpix(uint16_t LEDno);
 #endif // WS2815_H__
@@ -0,0 +1,163 @@
+/*
+ * This file is part of the ws2815 project.
+ * Copyright 2021 Edward V. Emelianov <edward.emelianoff@gmail.com>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// parallel output of PAR_STRIPS strips (PB0..PB15) through GPIOB->BSRR/BRR by TIM3 DMA requests:
+// update (start of bit) - set all pins, CC1 (T0H) - reset pins with zero bits, CC3 (T1H) - reset all pins;
+// so all strips get their LEDs at the same time and frame time depends only on PAR_LEDS
+
+#include "hardware.h"
+#include "wsparallel.h"
+
+// half of DMA buffer: DMALEDS LEDs, 24 bit-planes each
+#define DMAHALFBUFSIZE  (24*DMALEDS)
+#define DMABUFSIZE      (2*DMAHALFBUFSIZE)
+
+// pins to reset at T0H for each bit (halfword for each bit-plane, zero-padded by DMA to BRR)
+static uint16_t dmabuf[DMABUFSIZE] __attribute__((aligned(4)));
+
+// GRB colors: all strips for each LED in a row to take them at once
+static uint32_t colorbuf[PAR_LEDS][16];
+static int currLED = 0; // next LED to convert
+static uint8_t tail = 0; // halves of buffer sent after last LED
+static volatile uint8_t busy = 0; // ==1 while frame or reset pulse is being sent
+// values for DMA from memory without increment: pins set at start of bit and reset at T1H
+static uint32_t setmask = PAR_MASK, resetmask = PAR_MASK;
+
+/**
+ * @brief wsparsetpix - change color of LED `LEDno` in strip `strip`
+ * @param colr  - XXRRGGBB color
+ * @return 1 if all OK
+ */
+int wsparsetpix(uint8_t strip, uint16_t LEDno, uint32_t colr){
+    if(strip >= PAR_STRIPS || LEDno >= PAR_LEDS) return 0;
+    colorbuf[LEDno][strip] = colr & 0xffffff;
+    return 1;
+}
+
+uint32_t wspargetpix(uint8_t strip, uint16_t LEDno){
+    if(strip >= PAR_STRIPS || LEDno >= PAR_LEDS) return 0;
+    return colorbuf[LEDno][strip];
+}
+
+/**
+ * @brief transpose8 - transpose 8x8 bit matrix (Hacker's Delight, 7.3)
+ * @param x - bytes of strips 7..4 (strip 7 in high byte)
+ * @param y - bytes of strips 3..0
+ * @param out (o) - 8 bit-planes (most significant bit first), bit N is bit of strip N
+ */
+static inline void transpose8(uint32_t x, uint32_t y, uint8_t *out){
+    uint32_t t;
+    t = (x ^ (x >> 7)) & 0x00AA00AA; x = x ^ t ^ (t << 7);
+    t = (y ^ (y >> 7)) & 0x00AA00AA; y = y ^ t ^ (t << 7);
+    t = (x ^ (x >> 14)) & 0x0000CCCC; x = x ^ t ^ (t << 14);
+    t = (y ^ (y >> 14)) & 0x0000CCCC; y = y ^ t ^ (t << 14);
+    t = (x & 0xF0F0F0F0) | ((y >> 4) & 0x0F0F0F0F);
+    y = ((x << 4) & 0xF0F0F0F0) | (y & 0x0F0F0F0F);
+    x = t;
+    out[0] = x >> 24; out[1] = x >> 16; out[2] = x >> 8; out[3] = x;
+    out[4] = y >> 24; out[5] = y >> 16; out[6] = y >> 8; out[7] = y;
+}
+
+// byte of color `c` at shift `s`
+#define BYTE(c, s)  (((c) >> (s)) & 0xff)
+// 4 bytes of colors c[n+3]..c[n] packed into word
+#define PACK4(c, n, s)  (BYTE(c[n+3], s) << 24 | BYTE(c[n+2], s) << 16 | BYTE(c[n+1], s) << 8 | BYTE(c[n], s))
+
+/**
+ * @brief convertLED - convert colors of one LED of all strips into 24 BRR values
+ * @param d - buffer
+ * @param c - GRB colors of strips (G in low byte, sent first)
+ */
+static inline void convertLED(uint16_t *d, const uint32_t *c){
+    uint8_t lo[8], hi[8];
+    for(int sh = 0; sh < 24; sh += 8){
+        transpose8(PACK4(c, 4, sh), PACK4(c, 0, sh), lo);
+        transpose8(PACK4(c, 12, sh), PACK4(c, 8, sh), hi);
+        for(int i = 0; i < 8; ++i) *d++ = ~(lo[i] | (hi[i] << 8)) & PAR_MASK; // zero bits are reset at T0H
+    }
+}
+
+// fill half of DMA buffer by next LEDs, rest of it (after last LED) - by zero bits
+static void fillhalf(int halfno){
+    uint16_t *dptr = &dmabuf[DMAHALFBUFSIZE*halfno], *end = dptr + DMAHALFBUFSIZE;
+    for(; dptr < end && currLED < PAR_LEDS; dptr += 24) convertLED(dptr, colorbuf[currLED++]);
+    for(; dptr < end; ++dptr) *dptr = PAR_MASK;
+}
+
+/**
+ * @brief wsparstart - start sending of colors to all strips
+ * @return 0 if previous frame isn't sent yet
+ */
+int wsparstart(){
+    if(busy) return 0;
+    busy = 1;
+    currLED = 0;
+    tail = 0;
+    fillhalf(0);
+    fillhalf(1);
+    setmask = PAR_MASK;
+    PAR_DMA->IFCR = PAR_DMA_IFCR_CLR;
+    PAR_DMAset->CNDTR = 1;
+    PAR_DMAset->CMAR = (uint32_t)&setmask;
+    PAR_DMAdata->CNDTR = DMABUFSIZE;
+    PAR_DMAdata->CMAR = (uint32_t)dmabuf;
+    PAR_DMAreset->CNDTR = 1;
+    PAR_DMAreset->CMAR = (uint32_t)&resetmask;
+    PAR_DMAset->CCR |= DMA_CCR_EN;
+    PAR_DMAdata->CCR |= DMA_CCR_EN;
+    PAR_DMAreset->CCR |= DMA_CCR_EN;
+    PAR_TIM->CNT = BITTICKS - 1; // first request should be update (set pins), not CC1 with data of first bit
+    PAR_TIM->CR1 = TIM_CR1_CEN | TIM_CR1_URS;
+    return 1;
+}
+
+// all data is sent: stop DMA and hold low level for reset pulse
+static void resetpulse(){
+    PAR_TIM->CR1 = 0;
+    PAR_DMAset->CCR &= ~DMA_CCR_EN;
+    PAR_DMAdata->CCR &= ~DMA_CCR_EN;
+    PAR_DMAreset->CCR &= ~DMA_CCR_EN;
+    PAR_port->BRR = PAR_MASK;
+    PAR_TIM->DIER = 0;
+    PAR_TIM->ARR = RESETTICKS - 1;
+    PAR_TIM->CNT = 0;
+    PAR_TIM->SR = 0;
+    PAR_TIM->DIER = TIM_DIER_UIE;
+    PAR_TIM->CR1 = TIM_CR1_CEN | TIM_CR1_URS | TIM_CR1_OPM;
+}
+
+// timer update event (end of reset pulse): restore bit timing, ready for next frame
+void PARTIMISR(){
+    PAR_TIM->SR = 0;
+    PAR_TIM->CR1 = 0;
+    PAR_TIM->ARR = BITTICKS - 1;
+    PAR_TIM->DIER = TIM_DIER_UDE | TIM_DIER_CC1DE | TIM_DIER_CC3DE;
+    busy = 0;
+}
+
+// DMA half/full transfer interrupts of data channel: fill half of buffer which was sent
+// When the half with last LED is sent, pins aren't set anymore (strips only get zero bits after their end if
+// this interrupt is late), then reset pulse
+void PARDMAISR(){
+    int halfno = (PAR_DMA->ISR & PAR_DMA_ISR_HTIF) ? 0 : 1;
+    PAR_DMA->IFCR = PAR_DMA_IFCR_CLR;
+    if(currLED < PAR_LEDS) fillhalf(halfno);
+    else if(++tail == 1) fillhalf(halfno); // zero bits
+    else if(tail == 2) setmask = 0;
+    else resetpulse();
+}
@@ -0,0 +1,29 @@
+/*
+ * This file is part of the ws2815 project.
+ * Copyright 2021 Edward V. Emelianov <edward.emelianoff@gmail.com>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#ifndef WSPARALLEL_H__
+#define WSPARALLEL_H__
+
+#include <stm32f1.h>
+
+int wsparsetpix(uint8_t strip, uint16_t LEDno, uint32_t colr);
+uint32_t wspargetpix(uint8_t strip, uint16_t LEDno);
+int wsparstart();
+
+#endif // WSPARALLEL_H__
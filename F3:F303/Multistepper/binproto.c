@@ -0,0 +1,87 @@
+/*
+ * This file is part of the multistepper project.
+ * Copyright 2023 Edward V. Emelianov <edward.emelianoff@gmail.com>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "binproto.h"
+#include "commonproto.h"
+#include "crc.h"
+#include "hardware.h"
+#include "usb.h"
+
+static uint8_t frame[BIN_FRAMEMAX];
+
+// run all records of frame with length `len` and send answer
+static void runframe(uint8_t len){
+    uint8_t *crcp = frame + 2 + len;
+    if(crc16(frame + 2, len) != (crcp[0] | (crcp[1] << 8))) len = 1; // answer without records
+    else for(bin_record *r = (bin_record*)(frame + 3); (uint8_t*)r < crcp; ++r){
+        uint16_t cmd = r->cmd;
+        int32_t val = r->val;
+        errcodes e = ERR_BADCMD;
+        if(cmd < CCMD_AMOUNT) e = runcmd(&cancmdlist[cmd], r->par, &val);
+        r->err = (uint8_t)e;
+        r->val = val;
+    }
+    frame[1] = len;
+    uint16_t crc = crc16(frame + 2, len);
+    frame[2 + len] = crc & 0xff;
+    frame[3 + len] = crc >> 8;
+    USB_send(frame, len + 4);
+}
+
+// drop all incoming data
+static void flushin(){
+    while(USB_receive(frame, sizeof(frame)));
+}
+
+/**
+ * @brief binproto_process - check incoming data for binary frame and run it when it's full
+ * (call it from main loop before reading text commands)
+ * @return 1 if incoming data belongs to binary frame (so it shouldn't be read as text)
+ */
+int binproto_process(){
+    static uint32_t Tstart = 0;
+    static uint8_t waiting = 0; // first bytes of frame are received
+    int got = USB_rxpeek(frame, sizeof(frame));
+    if(got < 1 || frame[0] != BIN_SYNC){
+        waiting = 0;
+        return 0;
+    }
+    if(!waiting){
+        waiting = 1;
+        Tstart = Tms;
+    }
+    if(got > 1){
+        uint8_t len = frame[1];
+        if(len < 1 || len > 1 + BIN_MAXRECS * sizeof(bin_record) || (len - 1) % sizeof(bin_record)){
+            flushin(); // can't find end of frame
+            waiting = 0;
+            return 1;
+        }
+        if(got >= len + 4){
+            USB_receive(frame, len + 4);
+            waiting = 0;
+            runframe(len);
+            return 1;
+        }
+    }
+    if(Tms - Tstart > BIN_TIMEOUT){ // incomplete frame
+        flushin();
+        waiting = 0;
+    }
+    return 1;
+}
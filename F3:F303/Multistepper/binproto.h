@@ -0,0 +1,44 @@
+/*
+ * This file is part of the multistepper project.
+ * Copyright 2023 Edward V. Emelianov <edward.emelianoff@gmail.com>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+// sync byte of request and answer frames (can't be met in text commands)
+#define BIN_SYNC            (0xB5)
+// max amount of records in one frame
+#define BIN_MAXRECS         (31)
+// max time between first and last bytes of frame, ms
+#define BIN_TIMEOUT         (100)
+
+// record of frame: the same as data of CAN message (little endian)
+typedef struct __attribute__((packed)){
+    uint16_t cmd;       // CCMD_xx
+    uint8_t par;        // parameter (e.g. motor number or CANMESG_NOPAR) | SETTERFLAG for setters
+    uint8_t err;        // errcodes of answer (ignored in request)
+    int32_t val;        // value to set / value got
+} bin_record;
+
+// frame: [BIN_SYNC][len][seq][bin_record x N][crc16]
+// `len` - amount of bytes from `seq` to `crc` (1 + 8*N), CRC16-CCITT of the same bytes (little endian).
+// Answer has the same `seq` and records with filled `err` and `val`; answer without records means
+// that request had wrong checksum.
+#define BIN_FRAMEMAX        (3 + BIN_MAXRECS * sizeof(bin_record) + 2)
+
+int binproto_process();
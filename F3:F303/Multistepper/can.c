@@ -367,7 +367,7 @@ TRUE_INLINE void parseCANcommand(CAN_message *msg){
 #ifdef EBUG
     USB_sendstr("Run command\n");
 #endif
-    errcodes ec = cancmdlist[Index](par, val);
+    errcodes ec = runcmd(&cancmdlist[Index], par, val);
     if(ec != ERR_OK){
         formerr(msg, ec);
     }
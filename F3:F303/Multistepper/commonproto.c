@@ -22,17 +22,14 @@
 #include "flash.h"
 #include "hardware.h"
 #include "hdr.h"
+#include "macro.h"
 #include "pdnuart.h"
 #include "proto.h"
 #include "steppers.h"
+#include "telemetry.h"
 #include "usb.h"
 
 
-#define NOPARCHK(par) do{if(PARBASE(par) != CANMESG_NOPAR) return ERR_BADPAR;}while(0)
-
-#define CHECKN(val, par) do{val = PARBASE(par); \
-    if(val > MOTORSNO-1) return ERR_BADPAR;}while(0)
-
 extern volatile uint32_t Tms;
 
 // common functions for CAN and USB (or CAN only functions)
@@ -42,7 +39,7 @@ static errcodes cu_nosuchfn(uint8_t _U_ par, int32_t _U_ *val){
 }
 
 errcodes cu_abspos(uint8_t _U_ par, int32_t _U_ *val){
-    uint8_t n; CHECKN(n, par);
+    uint8_t n = PARBASE(par);
     errcodes ret = ERR_OK;
     if(ISSETTER(par)){
         ret = setmotpos(n, *val);
@@ -52,9 +49,9 @@ errcodes cu_abspos(uint8_t _U_ par, int32_t _U_ *val){
 }
 
 errcodes cu_accel(uint8_t _U_ par, int32_t _U_ *val){
-    uint8_t n; CHECKN(n, par);
+    uint8_t n = PARBASE(par);
     if(ISSETTER(par)){
-        if(*val/the_conf.microsteps[n] > ACCELMAXSTEPS || *val < 1) return ERR_BADVAL;
+        if(*val/the_conf.microsteps[n] > ACCELMAXSTEPS) return ERR_BADVAL;
         the_conf.accel[n] = *val;
         update_stepper(n);
     }
@@ -66,7 +63,6 @@ static const uint8_t extADCchnl[NUMBER_OF_EXT_ADC_CHANNELS] = {ADC_AIN0, ADC_AIN
 // V*100
 errcodes cu_adc(uint8_t par, int32_t *val){
     uint8_t n = PARBASE(par);
-    if(n > NUMBER_OF_EXT_ADC_CHANNELS - 1) return ERR_BADPAR;
     float v = getADCvoltage(extADCchnl[n])*100.f;
     *val = (int32_t)v;
     return ERR_OK;
@@ -83,15 +79,32 @@ errcodes cu_button(uint8_t par, int32_t *val){
     return (uint8_t) keystate(n, (uint32_t*)val);
 }
 
-errcodes cu_diagn(uint8_t _U_ par, int32_t _U_ *val){
-    return ERR_BADCMD;
+// stall (DIAG) state of motor N or bitmask of all motors; DIAG multiplexer isn't switched: EXTI events would be lost
+errcodes cu_diagn(uint8_t par, int32_t *val){
+    uint8_t n = PARBASE(par);
+    if(n == CANMESG_NOPAR){
+        *val = 0;
+        for(int i = 0; i < MOTORSNO; ++i) if(motor_stall(i)) *val |= 1<<i;
+        return ERR_OK;
+    }
+    if(n > MOTORSNO-1) return ERR_BADPAR;
+    *val = motor_stall(n);
+    return ERR_OK;
+}
+
+// cached value of DRV_STATUS, ERR_CANTRUN if driver not answered
+errcodes cu_drvstatus(uint8_t par, int32_t *val){
+    uint8_t n = PARBASE(par);
+    const pdnstatus_t *s = pdnuart_status(n);
+    *val = (int32_t)s->drv_status;
+    if(s->notfound || the_conf.motflags[n].drvtype != DRVTYPE_UART) return ERR_CANTRUN;
+    return ERR_OK;
 }
 
 errcodes cu_drvtype(uint8_t par, int32_t *val){
-    uint8_t n; CHECKN(n, par);
+    uint8_t n = PARBASE(par);
     motflags_t *fl = &the_conf.motflags[n];
     if(ISSETTER(par)){
-        if(*val >= DRVTYPE_AMOUNT) return ERR_BADVAL;
         fl->drvtype = *val;
     }
     *val = fl->drvtype;
@@ -99,13 +112,12 @@ errcodes cu_drvtype(uint8_t par, int32_t *val){
 }
 
 errcodes cu_emstop(uint8_t _U_ par, int32_t _U_ *val){
-    uint8_t n; CHECKN(n, par);
+    uint8_t n = PARBASE(par);
     emstopmotor(n);
     return ERR_OK;
 }
 
 errcodes cu_eraseflash(uint8_t _U_ par, int32_t _U_ *val){
-    NOPARCHK(par);
     if(ISSETTER(par)){
         if(erase_storage(*val)) return ERR_BADVAL;
     }else if(erase_storage(-1)) return ERR_CANTRUN;
@@ -114,15 +126,14 @@ errcodes cu_eraseflash(uint8_t _U_ par, int32_t _U_ *val){
 
 // par - motor number
 errcodes cu_esw(uint8_t par, int32_t *val){
-    uint8_t n; CHECKN(n, par);
+    uint8_t n = PARBASE(par);
     *val = ESW_state(n);
     return ERR_OK;
 }
 
 errcodes cu_eswreact(uint8_t _U_ par, int32_t _U_ *val){
-    uint8_t n; CHECKN(n, par);
+    uint8_t n = PARBASE(par);
     if(ISSETTER(par)){
-        if(*val < 0 || *val > ESW_AMOUNT-1) return ERR_BADVAL;
         the_conf.ESW_reaction[n] = *val;
         update_stepper(n);
     }
@@ -131,13 +142,13 @@ errcodes cu_eswreact(uint8_t _U_ par, int32_t _U_ *val){
 }
 
 errcodes cu_goto(uint8_t _U_ par, int32_t _U_ *val){
-    uint8_t n; CHECKN(n, par);
+    uint8_t n = PARBASE(par);
     if(ISSETTER(par)) return motor_absmove(n, *val);
     return getpos(n, val);
 }
 
 errcodes cu_gotoz(uint8_t _U_ par, int32_t _U_ *val){
-    uint8_t n; CHECKN(n, par);
+    uint8_t n = PARBASE(par);
     return motor_goto0(n);
 }
 
@@ -200,7 +211,7 @@ static uint16_t getSPD(uint8_t n, int32_t speed){
 }
 
 errcodes cu_maxspeed(uint8_t _U_ par, int32_t _U_ *val){
-    uint8_t n; CHECKN(n, par);
+    uint8_t n = PARBASE(par);
     if(ISSETTER(par)){
         if(*val <= the_conf.minspd[n]) return ERR_BADVAL;
         the_conf.maxspd[n] = getSPD(n, *val);
@@ -211,43 +222,39 @@ errcodes cu_maxspeed(uint8_t _U_ par, int32_t _U_ *val){
 }
 
 errcodes cu_maxsteps(uint8_t _U_ par, int32_t _U_ *val){
-    uint8_t n; CHECKN(n, par);
+    uint8_t n = PARBASE(par);
     if(ISSETTER(par)){
-        if(*val < 1) return ERR_BADVAL;
         the_conf.maxsteps[n] = *val;
     }
     *val = the_conf.maxsteps[n];
     return ERR_OK;
 }
 
-errcodes cu_mcut(uint8_t par, int32_t *val){
-    NOPARCHK(par);
+errcodes cu_mcut(uint8_t _U_ par, int32_t *val){
     float f = getMCUtemp();
     *val = (uint32_t)(f*10.f);
     return ERR_OK;
 }
 
-errcodes cu_mcuvdd(uint8_t par, int32_t *val){
-    NOPARCHK(par);
+errcodes cu_mcuvdd(uint8_t _U_ par, int32_t *val){
     float f = getVdd();
     *val = (uint32_t)(f*10.f);
     return ERR_OK;
 }
 
 errcodes cu_microsteps(uint8_t _U_ par, int32_t _U_ *val){
-    uint8_t n; CHECKN(n, par);
+    uint8_t n = PARBASE(par);
     USB_sendstr("===> val="); printi(*val); newline();
     if(ISSETTER(par)){
 #if MICROSTEPSMAX > 512
 #error "Change the code anywhere!"
 #endif
         uint16_t m = (uint16_t)*val;
-        if(m < 1 || m > MICROSTEPSMAX) return ERR_BADVAL;
         // find most significant bit
         if(m != 1<<MSB(m)) return ERR_BADVAL;
         if(the_conf.maxspd[n] * m > PCLK/(MOTORTIM_PSC+1)/(MOTORTIM_ARRMIN+1)) return ERR_BADVAL;
         the_conf.microsteps[n] = m;
-        motflags_t *f = the_conf.motflags;
+        motflags_t *f = &the_conf.motflags[n];
         if(f->drvtype == DRVTYPE_UART){
             if(!pdnuart_microsteps(n, m)) return ERR_CANTRUN;
         }
@@ -258,9 +265,9 @@ errcodes cu_microsteps(uint8_t _U_ par, int32_t _U_ *val){
 }
 
 errcodes cu_minspeed(uint8_t _U_ par, int32_t _U_ *val){
-    uint8_t n; CHECKN(n, par);
+    uint8_t n = PARBASE(par);
     if(ISSETTER(par)){
-        if(*val >= the_conf.maxspd[n] || *val < 0) return ERR_BADVAL;
+        if(*val >= the_conf.maxspd[n]) return ERR_BADVAL;
         the_conf.minspd[n] = getSPD(n, *val);
         update_stepper(n);
     }
@@ -269,11 +276,10 @@ errcodes cu_minspeed(uint8_t _U_ par, int32_t _U_ *val){
 }
 
 errcodes cu_motcurrent(uint8_t par, int32_t *val){
-    uint8_t n; CHECKN(n, par);
+    uint8_t n = PARBASE(par);
     if(ISSETTER(par)){
-        if(*val < 0 || *val > 31) return ERR_BADVAL;
         the_conf.motcurrent[n] = *val;
-        motflags_t *f = the_conf.motflags;
+        motflags_t *f = &the_conf.motflags[n];
         if(f->drvtype == DRVTYPE_UART){
             if(!pdnuart_setcurrent(n, *val)) return ERR_CANTRUN;
         }
@@ -283,7 +289,7 @@ errcodes cu_motcurrent(uint8_t par, int32_t *val){
 }
 
 errcodes cu_motflags(uint8_t _U_ par, int32_t _U_ *val){
-    uint8_t n; CHECKN(n, par);
+    uint8_t n = PARBASE(par);
     if(ISSETTER(par)){
         the_conf.motflags[n] = *((motflags_t*)val);
         update_stepper(n);
@@ -293,7 +299,6 @@ errcodes cu_motflags(uint8_t _U_ par, int32_t _U_ *val){
 }
 
 errcodes cu_motno(uint8_t _U_ par, int32_t _U_ *val){
-    if(*val < 0 || *val >= MOTORSNO) return ERR_BADVAL;
     if(ISSETTER(par)){
         if(!pdnuart_setmotno(*val)) return ERR_CANTRUN;
     }
@@ -306,7 +311,6 @@ errcodes cu_motmul(uint8_t _U_ par, int32_t _U_ *val){
 }
 
 errcodes cu_motreinit(uint8_t _U_ par, int32_t _U_ *val){
-    NOPARCHK(par);
     init_steppers();
     return ERR_OK;
 }
@@ -325,25 +329,23 @@ errcodes cu_ping(uint8_t _U_ par, int32_t _U_ *val){
 }
 
 errcodes cu_relpos(uint8_t _U_ par, int32_t _U_ *val){
-    uint8_t n; CHECKN(n, par);
+    uint8_t n = PARBASE(par);
     if(ISSETTER(par)) return motor_relmove(n, *val);
     return getremainsteps(n, val);
 }
 
 errcodes cu_relslow(uint8_t _U_ par, int32_t _U_ *val){
-    uint8_t n; CHECKN(n, par);
+    uint8_t n = PARBASE(par);
     if(ISSETTER(par)) return motor_relslow(n, *val);
     return getremainsteps(n, val);
 }
 
-static errcodes cu_reset(uint8_t par, int32_t _U_ *val){
-    NOPARCHK(par);
+static errcodes cu_reset(uint8_t _U_ par, int32_t _U_ *val){
     NVIC_SystemReset();
     return ERR_OK;
 }
 
 errcodes cu_saveconf(uint8_t _U_ par, int32_t _U_ *val){
-    NOPARCHK(par);
     if(store_userconf()) return ERR_CANTRUN;
     return ERR_OK;
 }
@@ -352,26 +354,72 @@ errcodes cu_screen(uint8_t _U_ par, int32_t _U_ *val){
     return ERR_BADCMD;
 }
 
+// cached value of SG_RESULT, ERR_CANTRUN if driver not answered
+errcodes cu_sgresult(uint8_t par, int32_t *val){
+    uint8_t n = PARBASE(par);
+    const pdnstatus_t *s = pdnuart_status(n);
+    *val = s->sg_result;
+    if(s->notfound || the_conf.motflags[n].drvtype != DRVTYPE_UART) return ERR_CANTRUN;
+    return ERR_OK;
+}
+
+// StallGuard threshold: DIAG activates when SG_RESULT <= 2*sgthrs; 0 - don't detect stall
+errcodes cu_sgthrs(uint8_t par, int32_t *val){
+    uint8_t n = PARBASE(par);
+    if(ISSETTER(par)){
+        the_conf.sgthrs[n] = *val;
+        if(the_conf.motflags[n].drvtype == DRVTYPE_UART){
+            if(!pdnuart_sgthrs(n)) return ERR_CANTRUN;
+        }
+    }
+    *val = the_conf.sgthrs[n];
+    return ERR_OK;
+}
+
 errcodes cu_speedlimit(uint8_t _U_ par, int32_t _U_ *val){
-    uint8_t n; CHECKN(n, par);
+    uint8_t n = PARBASE(par);
     *val = getSPD(n, 0xffff);
     return ERR_OK;
 }
 
 errcodes cu_state(uint8_t _U_ par, int32_t _U_ *val){
-    uint8_t n; CHECKN(n, par);
+    uint8_t n = PARBASE(par);
     *val = getmotstate(n);
     return ERR_OK;
 }
 
 errcodes cu_stop(uint8_t _U_ par, int32_t _U_ *val){
-    uint8_t n; CHECKN(n, par);
+    uint8_t n = PARBASE(par);
     stopmotor(n);
     return ERR_OK;
 }
 
-static errcodes cu_time(uint8_t par, int32_t *val){
-    NOPARCHK(par);
+errcodes cu_telemdest(uint8_t par, int32_t *val){
+    if(ISSETTER(par)){
+        if(!telemetry_setdest(*val)) return ERR_BADVAL;
+    }
+    *val = telemetry_dest();
+    return ERR_OK;
+}
+
+errcodes cu_telemetry(uint8_t par, int32_t *val){
+    if(ISSETTER(par)){
+        if(!telemetry_setperiod(*val)) return ERR_BADVAL;
+    }
+    *val = (int32_t)telemetry_period();
+    return ERR_OK;
+}
+
+errcodes cu_mrun(uint8_t par, int32_t *val){
+    if(ISSETTER(par)){
+        errcodes e = macro_run(*val);
+        if(e != ERR_OK) return e;
+    }
+    *val = macro_running();
+    return ERR_OK;
+}
+
+static errcodes cu_time(uint8_t _U_ par, int32_t *val){
     *val = Tms;
     return ERR_OK;
 }
@@ -389,69 +437,99 @@ errcodes cu_usartstatus(uint8_t _U_ par, int32_t _U_ *val){
 }
 
 // V*10
-errcodes cu_vdrive(uint8_t par, int32_t _U_ *val){
-    NOPARCHK(par);
+errcodes cu_vdrive(uint8_t _U_ par, int32_t _U_ *val){
     float v = getADCvoltage(ADC_VDRIVE)*1000.f;
     *val = (int32_t)v;
     return ERR_OK;
 }
 
-errcodes cu_vfive(uint8_t par, int32_t *val){
-    NOPARCHK(par);
+errcodes cu_vfive(uint8_t _U_ par, int32_t *val){
     float v = getADCvoltage(ADC_VFIVE)*200.f;
     *val = (int32_t)v;
     return ERR_OK;
 }
 
-const fpointer cancmdlist[CCMD_AMOUNT] = {
+// motor number
+#define NMOT        MOTORSNO
+#define CMD(f, n)               {f, n, VAL_ANY}
+#define CMDR(f, n, min, max)    {f, n, {min, max, 0}}
+
+const cmddesc_t cancmdlist[CCMD_AMOUNT] = {
     // different commands
-    [CCMD_PING] = cu_ping,
-    [CCMD_RELAY] = cu_nosuchfn,
-    [CCMD_BUZZER] = cu_nosuchfn,
-    [CCMD_ADC] = cu_adc,
-    [CCMD_BUTTONS] = cu_button,
-    [CCMD_ESWSTATE] = cu_esw,
-    [CCMD_MCUT] = cu_mcut,
-    [CCMD_MCUVDD] = cu_mcuvdd,
-    [CCMD_RESET] = cu_reset,
-    [CCMD_TIMEFROMSTART] = cu_time,
-    [CCMD_PWM] = cu_nosuchfn,
-    [CCMD_EXT] = cu_gpio,
+    [CCMD_PING] = CMD(cu_ping, NPAR_ANY),
+    [CCMD_RELAY] = CMD(cu_nosuchfn, NPAR_ANY),
+    [CCMD_BUZZER] = CMD(cu_nosuchfn, NPAR_ANY),
+    [CCMD_ADC] = CMD(cu_adc, NUMBER_OF_EXT_ADC_CHANNELS),
+    [CCMD_BUTTONS] = CMD(cu_button, NPAR_ANY),
+    [CCMD_ESWSTATE] = CMD(cu_esw, NMOT),
+    [CCMD_MCUT] = CMD(cu_mcut, NPAR_NONE),
+    [CCMD_MCUVDD] = CMD(cu_mcuvdd, NPAR_NONE),
+    [CCMD_RESET] = CMD(cu_reset, NPAR_NONE),
+    [CCMD_TIMEFROMSTART] = CMD(cu_time, NPAR_NONE),
+    [CCMD_PWM] = CMD(cu_nosuchfn, NPAR_ANY),
+    [CCMD_EXT] = CMD(cu_gpio, NPAR_ANY),
     // configuration
-    [CCMD_SAVECONF] = cu_saveconf,
-    [CCMD_ENCSTEPMIN] = cu_nosuchfn,
-    [CCMD_ENCSTEPMAX] = cu_nosuchfn,
-    [CCMD_MICROSTEPS] = cu_microsteps,
-    [CCMD_ACCEL] = cu_accel,
-    [CCMD_MAXSPEED] = cu_maxspeed,
-    [CCMD_MINSPEED] = cu_minspeed,
-    [CCMD_SPEEDLIMIT] = cu_speedlimit,
-    [CCMD_MAXSTEPS] = cu_maxsteps,
-    [CCMD_ENCREV] = cu_nosuchfn,
-    [CCMD_MOTFLAGS] = cu_motflags,
-    [CCMD_ESWREACT] = cu_eswreact,
+    [CCMD_SAVECONF] = CMD(cu_saveconf, NPAR_NONE),
+    [CCMD_ENCSTEPMIN] = CMD(cu_nosuchfn, NPAR_ANY),
+    [CCMD_ENCSTEPMAX] = CMD(cu_nosuchfn, NPAR_ANY),
+    [CCMD_MICROSTEPS] = CMDR(cu_microsteps, NMOT, 1, MICROSTEPSMAX),
+    [CCMD_ACCEL] = CMDR(cu_accel, NMOT, 1, INT32_MAX),
+    [CCMD_MAXSPEED] = CMD(cu_maxspeed, NMOT),
+    [CCMD_MINSPEED] = CMDR(cu_minspeed, NMOT, 0, INT32_MAX),
+    [CCMD_SPEEDLIMIT] = CMD(cu_speedlimit, NMOT),
+    [CCMD_MAXSTEPS] = CMDR(cu_maxsteps, NMOT, 1, INT32_MAX),
+    [CCMD_ENCREV] = CMD(cu_nosuchfn, NPAR_ANY),
+    [CCMD_MOTFLAGS] = CMD(cu_motflags, NMOT),
+    [CCMD_ESWREACT] = CMDR(cu_eswreact, NMOT, 0, ESW_AMOUNT-1),
     // motor's commands
-    [CCMD_ABSPOS] = cu_goto,
-    [CCMD_RELPOS] = cu_relpos,
-    [CCMD_RELSLOW] = cu_relslow,
-    [CCMD_EMERGSTOP] = cu_emstop,
-    [CCMD_EMERGSTOPALL] = cu_emstop, // without args
-    [CCMD_STOP] = cu_stop,
-    [CCMD_REINITMOTORS] = cu_motreinit,
-    [CCMD_MOTORSTATE] = cu_state,
-    [CCMD_ENCPOS] = cu_nosuchfn,
-    [CCMD_SETPOS] = cu_abspos,
-    [CCMD_GOTOZERO] = cu_gotoz,
-    [CCMD_MOTMUL] = cu_motmul,
-    [CCMD_DIAGN] = cu_diagn,
-    [CCMD_ERASEFLASH] = cu_eraseflash,
-    [CCMD_UDATA] = cu_udata,
-    [CCMD_USARTSTATUS] = cu_usartstatus,
-    [CCMD_VDRIVE] = cu_vdrive,
-    [CCMD_VFIVE] = cu_vfive
+    [CCMD_ABSPOS] = CMD(cu_goto, NMOT),
+    [CCMD_RELPOS] = CMD(cu_relpos, NMOT),
+    [CCMD_RELSLOW] = CMD(cu_relslow, NMOT),
+    [CCMD_EMERGSTOP] = CMD(cu_emstop, NMOT),
+    [CCMD_EMERGSTOPALL] = CMD(cu_emstop, NMOT), // without args
+    [CCMD_STOP] = CMD(cu_stop, NMOT),
+    [CCMD_REINITMOTORS] = CMD(cu_motreinit, NPAR_NONE),
+    [CCMD_MOTORSTATE] = CMD(cu_state, NMOT),
+    [CCMD_ENCPOS] = CMD(cu_nosuchfn, NPAR_ANY),
+    [CCMD_SETPOS] = CMD(cu_abspos, NMOT),
+    [CCMD_GOTOZERO] = CMD(cu_gotoz, NMOT),
+    [CCMD_MOTMUL] = CMD(cu_motmul, NPAR_ANY),
+    [CCMD_DIAGN] = CMD(cu_diagn, NPAR_ANY),
+    [CCMD_ERASEFLASH] = CMD(cu_eraseflash, NPAR_NONE),
+    [CCMD_UDATA] = CMD(cu_udata, NPAR_ANY),
+    [CCMD_USARTSTATUS] = CMD(cu_usartstatus, NPAR_ANY),
+    [CCMD_VDRIVE] = CMD(cu_vdrive, NPAR_NONE),
+    [CCMD_VFIVE] = CMD(cu_vfive, NPAR_NONE),
     // Leave all commands upper for back-compatability with 3steppers
+    [CCMD_PDN] = CMD(cu_pdn, NPAR_ANY),
+    [CCMD_MOTNO] = CMDR(cu_motno, NPAR_ANY, 0, MOTORSNO-1),
+    [CCMD_DRVTYPE] = CMDR(cu_drvtype, NMOT, 0, DRVTYPE_AMOUNT-1),
+    [CCMD_MOTCURRENT] = CMDR(cu_motcurrent, NMOT, 0, 31),
+    [CCMD_DRVSTATUS] = CMD(cu_drvstatus, NMOT),
+    [CCMD_SGRESULT] = CMD(cu_sgresult, NMOT),
+    [CCMD_SGTHRS] = CMDR(cu_sgthrs, NMOT, 0, 255),
+    [CCMD_TELEMETRY] = CMDR(cu_telemetry, NPAR_NONE, 0, INT32_MAX),
+    [CCMD_TELEMDEST] = CMDR(cu_telemdest, NPAR_NONE, 0, TELEM_USB|TELEM_CAN),
+    [CCMD_MACRO] = CMDR(cu_mrun, NPAR_NONE, INT32_MIN, MACRO_NO-1),
 };
 
+/**
+ * @brief runcmd - check parameter and setter value of command and run it
+ * @param c - command
+ * @param par - parameter (| SETTERFLAG for setter)
+ * @param val - value
+ * @return error code
+ */
+errcodes runcmd(const cmddesc_t *c, uint8_t par, int32_t *val){
+    if(!c->fn) return ERR_BADCMD;
+    uint8_t n = PARBASE(par);
+    if(c->npar == NPAR_NONE){
+        if(n != CANMESG_NOPAR) return ERR_BADPAR;
+    }else if(c->npar != NPAR_ANY && n >= c->npar) return ERR_BADPAR;
+    if(ISSETTER(par) && c->val.min <= c->val.max && (*val < c->val.min || *val > c->val.max)) return ERR_BADVAL;
+    return c->fn(par, val);
+}
+
 const char* cancmds[CCMD_AMOUNT] = {
     [CCMD_PING] = "ping",
     [CCMD_ADC] = "adc",
@@ -492,4 +570,10 @@ const char* cancmds[CCMD_AMOUNT] = {
     [CCMD_MOTNO] = "motno",
     [CCMD_DRVTYPE] = "drvtype",
     [CCMD_MOTCURRENT] = "motcurrent",
+    [CCMD_DRVSTATUS] = "drvstatus",
+    [CCMD_SGRESULT] = "sgresult",
+    [CCMD_SGTHRS] = "sgthrs",
+    [CCMD_TELEMETRY] = "telemetry",
+    [CCMD_TELEMDEST] = "telemdest",
+    [CCMD_MACRO] = "mrun",
 };
@@ -19,6 +19,7 @@
 #pragma once
 
 #include <stdint.h>
+#include "strfunc.h"
 
 #ifndef _U_
 #define _U_         __attribute__((unused))
@@ -49,6 +50,20 @@ typedef enum{
 // @return CANERR_OK (0) if OK or error code
 typedef errcodes (*fpointer)(uint8_t par, int32_t *val);
 
+// command has no parameter
+#define NPAR_NONE       (0)
+// parameter is checked by command function
+#define NPAR_ANY        (0xff)
+// any setter value
+#define VAL_ANY         {1, 0, 0}
+
+// command and ranges of its arguments (checked by runcmd() before function call)
+typedef struct{
+    fpointer fn;
+    uint8_t npar;       // PARBASE(par) should be < npar (or NPAR_NONE/NPAR_ANY)
+    argrange_t val;     // allowed range of setter value
+} cmddesc_t;
+
 enum{
      CCMD_NONE               // omit zero
     ,CCMD_PING               // ping device
@@ -97,13 +112,21 @@ enum{
     ,CCMD_MOTNO              // motor number for next PDN command
     ,CCMD_DRVTYPE            // driver type (0 - only step/dir, 1 - UART, 2 - SPI, 3 - reserved)
     ,CCMD_MOTCURRENT         // motor current (1..32 for 1/32..32/32 of max current)
+    ,CCMD_DRVSTATUS          // cached DRV_STATUS of TMC2209
+    ,CCMD_SGRESULT           // cached SG_RESULT of TMC2209
+    ,CCMD_SGTHRS             // StallGuard threshold (0 - disabled)
+    ,CCMD_TELEMETRY          // telemetry period, ms (0 - off)
+    ,CCMD_TELEMDEST          // telemetry destination (bit0 - USB, bit1 - CAN)
+    ,CCMD_MACRO              // run macro (<0 - stop) or get number of running
     // should be the last:
     ,CCMD_AMOUNT             // amount of common commands
 };
 
-extern const fpointer cancmdlist[CCMD_AMOUNT];
+extern const cmddesc_t cancmdlist[CCMD_AMOUNT];
 extern const char* cancmds[CCMD_AMOUNT];
 
+errcodes runcmd(const cmddesc_t *c, uint8_t par, int32_t *val);
+
 // all common functions
 errcodes cu_abspos(uint8_t par, int32_t *val);
 errcodes cu_accel(uint8_t par, int32_t *val);
@@ -111,6 +134,7 @@ errcodes cu_adc(uint8_t par, int32_t *val);
 errcodes cu_button(uint8_t par, int32_t *val);
 errcodes cu_canid(uint8_t par, int32_t *val);
 errcodes cu_diagn(uint8_t par, int32_t *val);
+errcodes cu_drvstatus(uint8_t par, int32_t *val);
 errcodes cu_drvtype(uint8_t par, int32_t *val);
 errcodes cu_emstop(uint8_t par, int32_t *val);
 errcodes cu_eraseflash(uint8_t par, int32_t *val);
@@ -131,15 +155,20 @@ errcodes cu_motflags(uint8_t par, int32_t *val);
 errcodes cu_motno(uint8_t par, int32_t *val);
 errcodes cu_motmul(uint8_t par, int32_t *val);
 errcodes cu_motreinit(uint8_t par, int32_t *val);
+errcodes cu_mrun(uint8_t par, int32_t *val);
 errcodes cu_pdn(uint8_t par, int32_t *val);
 errcodes cu_ping(uint8_t par, int32_t *val);
 errcodes cu_relpos(uint8_t par, int32_t *val);
 errcodes cu_relslow(uint8_t par, int32_t *val);
 errcodes cu_saveconf(uint8_t par, int32_t *val);
 errcodes cu_screen(uint8_t par, int32_t *val);
+errcodes cu_sgresult(uint8_t par, int32_t *val);
+errcodes cu_sgthrs(uint8_t par, int32_t *val);
 errcodes cu_speedlimit(uint8_t par, int32_t *val);
 errcodes cu_state(uint8_t par, int32_t *val);
 errcodes cu_stop(uint8_t par, int32_t *val);
+errcodes cu_telemdest(uint8_t par, int32_t *val);
+errcodes cu_telemetry(uint8_t par, int32_t *val);
 errcodes cu_tmcbus(uint8_t par, int32_t *val);
 errcodes cu_udata(uint8_t par, int32_t *val);
 errcodes cu_usartstatus(uint8_t par, int32_t *val);
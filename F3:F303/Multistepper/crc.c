@@ -0,0 +1 @@
+../../snippets/crc.c
\ No newline at end of file
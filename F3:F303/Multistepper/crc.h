@@ -0,0 +1 @@
+../../snippets/crc.h
\ No newline at end of file
@@ -18,6 +18,7 @@
 
 #include <stm32f3.h>
 #include <string.h> // memcpy
+#include "cfgjournal.h"
 #include "flash.h"
 #include "hdr.h"
 #include "proto.h"
@@ -29,9 +30,6 @@ extern const uint32_t __varsstart, _BLOCKSIZE;
 
 static const uint32_t FLASH_blocksize = (uint32_t)&_BLOCKSIZE;
 
-// max amount of Config records stored (will be recalculate in flashstorage_init()
-static uint32_t maxCnum = 1024 / sizeof(user_conf); // can't use blocksize here
-
 #define DEFMF   {.donthold = 1, .drvtype = DRVTYPE_UART}
 
 #define USERCONF_INITIALIZER  {             \
@@ -47,14 +45,35 @@ static uint32_t maxCnum = 1024 / sizeof(user_conf); // can't use blocksize here
     ,.ESW_reaction = {ESW_IGNORE,ESW_IGNORE,ESW_IGNORE,ESW_IGNORE,ESW_IGNORE,ESW_IGNORE,ESW_IGNORE,ESW_IGNORE} \
     }
 
-static int write2flash(const void*, const void*, uint32_t);
 // don't write `static` here, or get error:
 //      'memcpy' forming offset 8 is out of the bounds [0, 4] of object '__varsstart' with type 'uint32_t'
 const user_conf *Flash_Data = (const user_conf *)(&__varsstart);
 
 user_conf the_conf = USERCONF_INITIALIZER;
 
-static int currentconfidx = -1; // index of current configuration
+// configuration journal (see cfgjournal.h), bank size is 2k or flash page if it's larger
+#define JBANKSZ     (2048)
+static user_conf storedconf; // data stored in flash
+static uint16_t jbuf[CJ_BUFSZ(sizeof(user_conf))];
+static int write2flash(const void *addr, const uint16_t *data, uint32_t n);
+static int erase_page(const void *addr);
+static cj_journal journal = {
+    .write = write2flash,
+    .erase = erase_page,
+    .image = (uint8_t*)&the_conf,
+    .shadow = (uint8_t*)&storedconf,
+    .buf = jbuf,
+    .size = sizeof(user_conf)
+};
+
+// background writer: records from `jbuf` are written by EOP interrupts
+static volatile flash_state flstate = FLS_IDLE;
+static const uint16_t *wrsrc;       // next halfword to write
+static volatile uint16_t *wrdst;    // its address
+static uint32_t wrrest;             // amount of halfwords rest
+static int wrlen;                   // length of records being written
+static volatile uint8_t wrerr;      // write error occured
+static uint8_t savepending;         // configuration changed while writing - save it again
 
 /**
  * @brief binarySearch - binary search in flash for last non-empty cell
@@ -83,120 +102,230 @@ static int binarySearch(int r, const uint8_t *start, int stor_size){
     return -1; // not found
 }
 
+// amount of pages in storage (0 if FLASH_SIZE is wrong)
+static uint32_t storagepages(){
+    if(FLASH_SIZE < 1 || FLASH_SIZE > 20000) return 0;
+    uint32_t flsz = FLASH_SIZE * 1024 - ((uint32_t)Flash_Data - FLASH_BASE);
+    return flsz / FLASH_blocksize;
+}
+
 /**
  * @brief flashstorage_init - initialization of user conf storage
  * run in once @ start
  */
 void flashstorage_init(){
-    if(FLASH_SIZE > 0 && FLASH_SIZE < 20000){
-        uint32_t flsz = FLASH_SIZE * 1024; // size in bytes
-        flsz -= (uint32_t)(&__varsstart) - FLASH_BASE;
-        maxCnum = flsz / sizeof(user_conf);
+    journal.base = (const uint8_t*)Flash_Data;
+    journal.pagesize = FLASH_blocksize;
+    journal.banksize = (FLASH_blocksize > JBANKSZ) ? FLASH_blocksize : JBANKSZ;
+    if(storagepages() * FLASH_blocksize < 2 * journal.banksize){ // no place for two banks
+        journal.base = NULL;
+        return;
     }
-    // -1 if there's no data at all & flash is clear; maxnum-1 if flash is full
-    currentconfidx = binarySearch((int)maxCnum-2, (const uint8_t*)Flash_Data, sizeof(user_conf));
-    if(currentconfidx > -1){
-        memcpy(&the_conf, &Flash_Data[currentconfidx], sizeof(user_conf));
+    if(cj_mount(&journal) == CJ_EMPTY){
+        // old storage format: array of full user_conf copies (it will be replaced at first saving)
+        uint32_t flsz = storagepages() * FLASH_blocksize;
+        if(Flash_Data->userconf_sz != sizeof(user_conf)) return;
+        int idx = binarySearch((int)(flsz / sizeof(user_conf)) - 2, (const uint8_t*)Flash_Data, sizeof(user_conf));
+        if(idx > -1) memcpy(&the_conf, &Flash_Data[idx], sizeof(user_conf));
     }
+    NVIC_EnableIRQ(FLASH_IRQn);
 }
 
-// store new configuration
-// @return 0 if all OK
-int store_userconf(){
-    // maxnum - 3 means that there always should be at least one empty record after last data
-    // for binarySearch() checking that there's nothing more after it!
-    if(currentconfidx > (int)maxCnum - 3){ // there's no more place
-        currentconfidx = 0;
-        if(erase_storage(-1)) return 1;
-    }else ++currentconfidx; // take next data position (0 - within first run after firmware flashing)
-    return write2flash((const void*)&Flash_Data[currentconfidx], &the_conf, sizeof(the_conf));
-}
-
-static int write2flash(const void *start, const void *wrdata, uint32_t stor_size){
-    int ret = 0;
-    if (FLASH->CR & FLASH_CR_LOCK){ // unloch flash
+TRUE_INLINE void unlock(){
+    if(FLASH->CR & FLASH_CR_LOCK){
         FLASH->KEYR = FLASH_KEY1;
         FLASH->KEYR = FLASH_KEY2;
     }
+}
+
+// blocking writing (used for compaction): program `n` halfwords; @return 0 if OK
+static int write2flash(const void *addr, const uint16_t *data, uint32_t n){
+    int ret = 0;
+    unlock();
     while(FLASH->SR & FLASH_SR_BSY) IWDG->KR = IWDG_REFRESH;
     FLASH->SR = FLASH_SR_EOP | FLASH_SR_PGERR | FLASH_SR_WRPERR; // clear all flags
-    FLASH->CR |= FLASH_CR_PG;
-    const uint16_t *data = (const uint16_t*) wrdata;
-    volatile uint16_t *address = (volatile uint16_t*) start;
-    USB_sendstr("Start address="); printuhex((uint32_t)start); newline();
-    uint32_t i, count = (stor_size + 1) / 2;
-    for(i = 0; i < count; ++i){
-        IWDG->KR = IWDG_REFRESH;
-        *(volatile uint16_t*)(address + i) = data[i];
-        while (FLASH->SR & FLASH_SR_BSY) IWDG->KR = IWDG_REFRESH;
-        if(*(volatile uint16_t*)(address + i) != data[i]){
-            USB_sendstr("DON'T MATCH!\n");
+    FLASH->CR = (FLASH->CR & ~(FLASH_CR_PER | FLASH_CR_EOPIE | FLASH_CR_ERRIE)) | FLASH_CR_PG;
+    volatile uint16_t *address = (volatile uint16_t*) addr;
+    for(uint32_t i = 0; i < n; ++i){
+        address[i] = data[i];
+        while(FLASH->SR & FLASH_SR_BSY) IWDG->KR = IWDG_REFRESH;
+        if((FLASH->SR & (FLASH_SR_PGERR | FLASH_SR_WRPERR)) || address[i] != data[i]){
             ret = 1;
             break;
         }
-#ifdef EBUG
-        else{ USB_sendstr("Written "); printuhex(data[i]); newline();}
-#endif
-        if(FLASH->SR & FLASH_SR_PGERR){
-            USB_sendstr("Prog err\n");
-            ret = 1; // program error - meet not 0xffff
-            break;
-        }
-        FLASH->SR = FLASH_SR_EOP | FLASH_SR_PGERR | FLASH_SR_WRPERR;
+        FLASH->SR = FLASH_SR_EOP;
     }
+    FLASH->SR = FLASH_SR_EOP | FLASH_SR_PGERR | FLASH_SR_WRPERR;
     FLASH->CR &= ~(FLASH_CR_PG);
     return ret;
 }
 
-// erase Nth page of flash storage (flash should be prepared!)
-static int erase_pageN(int N){
+// erase page @ `addr`; @return 0 if OK
+static int erase_page(const void *addr){
     int ret = 0;
 #ifdef EBUG
-    USB_sendstr("Erase block #"); printu(N); newline();
+    USB_sendstr("Erase page @"); printuhex((uint32_t)addr); newline();
 #endif
-    FLASH->AR = (uint32_t)Flash_Data + N*FLASH_blocksize;
+    unlock();
+    while(FLASH->SR & FLASH_SR_BSY) IWDG->KR = IWDG_REFRESH;
+    FLASH->SR = FLASH_SR_EOP | FLASH_SR_PGERR | FLASH_SR_WRPERR;
+    FLASH->CR = (FLASH->CR & ~(FLASH_CR_PG | FLASH_CR_EOPIE | FLASH_CR_ERRIE)) | FLASH_CR_PER;
+    FLASH->AR = (uint32_t)addr;
     FLASH->CR |= FLASH_CR_STRT;
     while(FLASH->SR & FLASH_SR_BSY) IWDG->KR = IWDG_REFRESH;
-    FLASH->SR = FLASH_SR_EOP;
-    if(FLASH->SR & FLASH_SR_WRPERR){ /* Check Write protection error */
-        ret = 1;
-        FLASH->SR = FLASH_SR_WRPERR; /* Clear the flag by software by writing it at 1*/
-    }
+    if(FLASH->SR & FLASH_SR_WRPERR) ret = 1;
+    FLASH->SR = FLASH_SR_EOP | FLASH_SR_PGERR | FLASH_SR_WRPERR;
+    FLASH->CR &= ~FLASH_CR_PER;
     return ret;
 }
 
+// start programming of `n` halfwords from `jbuf` to journal tail; next halfwords are written in `flash_isr`
+static void startwrite(int n){
+    wrlen = n;
+    wrsrc = jbuf;
+    wrdst = (volatile uint16_t*)cj_tailaddr(&journal);
+    wrrest = n;
+    unlock();
+    FLASH->SR = FLASH_SR_EOP | FLASH_SR_PGERR | FLASH_SR_WRPERR;
+    FLASH->CR = (FLASH->CR & ~FLASH_CR_PER) | FLASH_CR_PG | FLASH_CR_EOPIE | FLASH_CR_ERRIE;
+    flstate = FLS_WRITE;
+    *wrdst = *wrsrc;
+}
+
+// make records of changed data and start writing them
+static void startsave(){
+    savepending = 0;
+    if(!journal.base) return; // storage isn't initialized
+    if(wrerr){ // previous records could be damaged: don't append more to this bank
+        wrerr = 0;
+        cj_fail(&journal);
+    }
+    int n = journal.tail ? cj_delta(&journal) : -1;
+    if(n == 0){ // nothing changed
+        flstate = FLS_IDLE;
+        return;
+    }
+    if(cj_fits(&journal, n)) startwrite(n);
+    else flstate = FLS_COMPACT; // no place in bank: full copy into other bank
+}
+
+/**
+ * @brief store_userconf - save changes of current configuration in background
+ * If writer is busy, configuration will be saved again after current operation.
+ * @return 0 if all OK
+ */
+int store_userconf(){
+    switch(flstate){
+        case FLS_IDLE:
+        case FLS_ERROR:
+            startsave();
+        break;
+        default:
+            savepending = 1;
+    }
+    return 0;
+}
+
+// @return TRUE if any motor is moving
+static int motorsmoving(){
+    for(int i = 0; i < MOTORSNO; ++i) if(getmotspeed(i)) return TRUE;
+    return FALSE;
+}
+
+/**
+ * @brief flash_process - background flash writer (run in main loop)
+ * Compaction erases page, which stalls CPU for tens of milliseconds, so it starts only when all motors are stopped.
+ */
+void flash_process(){
+    switch(flstate){
+        case FLS_COMPACT:
+            if(motorsmoving()) break;
+            if(CJ_OK == cj_compact(&journal)){
+                flstate = FLS_IDLE;
+                if(savepending) startsave();
+            }else flstate = FLS_ERROR;
+        break;
+        case FLS_DONE:
+            cj_commit(&journal, wrlen);
+            flstate = FLS_IDLE;
+            if(savepending) startsave();
+        break;
+        default:
+        break;
+    }
+}
+
+flash_state flash_getstate(){
+    return flstate;
+}
+
+// EOP or error of flash programming
+void flash_isr(){
+    uint32_t sr = FLASH->SR;
+    FLASH->SR = sr & (FLASH_SR_EOP | FLASH_SR_PGERR | FLASH_SR_WRPERR);
+    if(flstate != FLS_WRITE) return;
+    if((sr & (FLASH_SR_PGERR | FLASH_SR_WRPERR)) || *wrdst != *wrsrc){ // error or verification failed
+        FLASH->CR &= ~(FLASH_CR_PG | FLASH_CR_EOPIE | FLASH_CR_ERRIE);
+        wrerr = 1;
+        flstate = FLS_ERROR;
+        return;
+    }
+    if(--wrrest == 0){
+        FLASH->CR &= ~(FLASH_CR_PG | FLASH_CR_EOPIE | FLASH_CR_ERRIE);
+        flstate = FLS_DONE;
+        return;
+    }
+    *(++wrdst) = *(++wrsrc);
+}
+
+// area of macros (one bank after two banks of journal)
+static const uint8_t *macroarea(){
+    if(!journal.base || storagepages() * FLASH_blocksize < 3 * journal.banksize) return NULL;
+    return journal.base + 2 * journal.banksize;
+}
+
+/**
+ * @brief macro_storage - address of stored macros
+ * @param size (o) - size of area
+ * @return address or NULL if there's no place in flash
+ */
+const void *macro_storage(uint32_t *size){
+    if(size) *size = journal.banksize;
+    return macroarea();
+}
+
+/**
+ * @brief macro_save - blocking write of macros (`size` bytes from `data`) into their area
+ * Erasing stalls CPU, so it's refused while motors are moving or background writer is busy.
+ * @return 0 if all OK
+ */
+int macro_save(const void *data, uint32_t size){
+    const uint8_t *area = macroarea();
+    if(!area || size > journal.banksize || motorsmoving()) return 1;
+    if(flstate != FLS_IDLE && flstate != FLS_ERROR) return 1;
+    for(uint32_t a = 0; a < journal.banksize; a += FLASH_blocksize)
+        if(erase_page(area + a)) return 1;
+    return write2flash(area, (const uint16_t*)data, (size + 1) / 2);
+}
+
 // erase full storage (npage < 0) or its nth page; @return 0 if all OK
 int erase_storage(int npage){
     int ret = 0;
-    uint32_t end = 1, start = 0, flsz = 0;
-    if(FLASH_SIZE > 0 && FLASH_SIZE < 20000){
-        flsz = FLASH_SIZE * 1024; // size in bytes
-        flsz -= (uint32_t)Flash_Data - FLASH_BASE;
-    }
-    end = flsz / FLASH_blocksize;
+    uint32_t end = storagepages(), start = 0;
+    if(flstate != FLS_IDLE && flstate != FLS_ERROR) return 1; // background writer is busy
     if(end == 0 || end >= FLASH_SIZE) return 1;
     if(npage > -1){ // erase only one page
         if((uint32_t)npage >= end) return 1;
         start = npage;
         end = start + 1;
     }
-    if((FLASH->CR & FLASH_CR_LOCK) != 0){
-        FLASH->KEYR = FLASH_KEY1;
-        FLASH->KEYR = FLASH_KEY2;
-    }
-    /*USB_sendstr("size/block size/nblocks/FLASH_SIZE: "); printu(flsz);
-    USB_putbyte('/'); printu(FLASH_blocksize); USB_putbyte('/');
-    printu(nblocks); USB_putbyte('/'); printu(FLASH_SIZE); newline(); USB_sendall();*/
-    while(FLASH->SR & FLASH_SR_BSY) IWDG->KR = IWDG_REFRESH;
-    FLASH->SR = FLASH_SR_EOP | FLASH_SR_PGERR | FLASH_SR_WRPERR;
-    FLASH->CR |= FLASH_CR_PER;
     for(uint32_t i = start; i < end; ++i){
-        if(erase_pageN(i)){
+        if(erase_page((const uint8_t*)Flash_Data + i * FLASH_blocksize)){
             ret = 1;
             break;
         }
     }
-    FLASH->CR &= ~FLASH_CR_PER;
+    if(journal.base) cj_mount(&journal); // find what rests
     return ret;
 }
 
@@ -208,7 +337,9 @@ int fn_dumpconf(uint32_t _U_ hash, char _U_ *args){ // "dumpconf" (3271513185)
     newline();
 #endif
     USB_sendstr("userconf_addr="); printuhex((uint32_t)Flash_Data);
-    USB_sendstr("\nuserconf_idx="); printi(currentconfidx);
+    USB_sendstr("\nuserconf_bank="); printu(journal.bank);
+    USB_sendstr("\nuserconf_tail="); printu(journal.tail);
+    USB_sendstr("\nflash_state="); printu(flstate);
     USB_sendstr("\nuserconf_sz="); printu(the_conf.userconf_sz);
     USB_sendstr("\ncanspeed="); printu(the_conf.CANspeed);
     USB_sendstr("\ncanid="); printu(the_conf.CANID);
@@ -228,6 +359,8 @@ int fn_dumpconf(uint32_t _U_ hash, char _U_ *args){ // "dumpconf" (3271513185)
         printu(the_conf.maxsteps[i]);
         PROPNAME("motcurrent");
         printu(the_conf.motcurrent[i]);
+        PROPNAME("sgthrs");
+        printu(the_conf.sgthrs[i]);
         PROPNAME("motflags");
         printuhex(*((uint8_t*)&the_conf.motflags[i]));
         PROPNAME("eswreaction");
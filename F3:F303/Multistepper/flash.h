@@ -74,6 +74,7 @@ typedef struct __attribute__((packed, aligned(4))){
     motflags_t motflags[MOTORSNO];  // motor's flags
     uint8_t ESW_reaction[MOTORSNO]; // end-switches reaction (esw_react)
     uint8_t motcurrent[MOTORSNO];   // IRUN as fraction of max current (1..32)
+    uint8_t sgthrs[MOTORSNO];       // StallGuard threshold (0 - don't detect stall)
     uint8_t isSPI;                  // ==1 if there's SPI drivers instead of UART
 } user_conf;
 
@@ -81,7 +82,20 @@ extern user_conf the_conf; // global user config (read from FLASH to RAM)
 
 // data from ld-file: start address of storage
 
+// background flash writer states
+typedef enum{
+    FLS_IDLE,
+    FLS_COMPACT,    // copying configuration into other bank (waiting for all motors stop)
+    FLS_WRITE,      // writing records
+    FLS_DONE,       // records written
+    FLS_ERROR       // write error
+} flash_state;
+
 void flashstorage_init();
 int store_userconf();
+void flash_process();
+flash_state flash_getstate();
 int erase_storage(int npage);
+const void *macro_storage(uint32_t *size);
+int macro_save(const void *data, uint32_t size);
 
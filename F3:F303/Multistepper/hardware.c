@@ -70,8 +70,12 @@ const uint32_t DIRpins[MOTORSNO] = {
 volatile TIM_TypeDef *mottimers[MOTORSNO] = {
     TIM15, TIM16, TIM17, TIM2, TIM8, TIM4, TIM1, TIM3};
 const uint8_t mottchannels[MOTORSNO] = {1,1,1,1,1,1,1,3};
+// advanced timers (1/8/15/16/17) count microsteps by RCR and interrupt by update event,
+// TIM2/3/4 have no RCR, so they interrupt on each CC event
+// RCR of TIM15/16/17 is 8-bit, of TIM1/8 - 16-bit
+const uint32_t mottrepmax[MOTORSNO] = {256, 256, 256, 1, 65536, 1, 65536, 1};
 static IRQn_Type motirqs[MOTORSNO] = {
-    TIM15_IRQn, TIM16_IRQn, TIM17_IRQn, TIM2_IRQn, TIM8_CC_IRQn, TIM4_IRQn, TIM1_CC_IRQn, TIM3_IRQn};
+    TIM15_IRQn, TIM16_IRQn, TIM17_IRQn, TIM2_IRQn, TIM8_UP_IRQn, TIM4_IRQn, TIM1_UP_TIM16_IRQn, TIM3_IRQn};
 
 // return two bits: 0 - ESW0, 1 - ESW1 (if inactive -> 1; if active -> 0)
 uint8_t ESW_state(uint8_t MOTno){
@@ -193,43 +197,146 @@ TRUE_INLINE void iwdg_setup(){
 // motor's PWM
 static void setup_mpwm(int i){
     volatile TIM_TypeDef *TIM = mottimers[i];
-    TIM->CR1 = TIM_CR1_ARPE; // buffered ARR
+    // buffered ARR; UG won't generate interrupt
+    TIM->CR1 = TIM_CR1_ARPE | TIM_CR1_URS;
     TIM->PSC = MOTORTIM_PSC; // 16MHz
-    // PWM mode 1 (active -> inactive)
     uint8_t n = mottchannels[i];
+    uint32_t ccmr;
+    // PWM mode 1 (active -> inactive) for CC interrupt: pulse ends @ CC event;
+    // PWM mode 2 (inactive -> active) for update interrupt: pulse ends @ update event
+    if(mottrepmax[i] > 1) ccmr = TIM_CCMR1_OC1M_2 | TIM_CCMR1_OC1M_1 | TIM_CCMR1_OC1M_0 | TIM_CCMR1_OC1PE;
+    else ccmr = TIM_CCMR1_OC1M_2 | TIM_CCMR1_OC1M_1;
     switch(n){
         case 1:
-            TIM->CCMR1 = TIM_CCMR1_OC1M_2 | TIM_CCMR1_OC1M_1;
+            TIM->CCMR1 = ccmr;
         break;
         case 2:
-            TIM->CCMR1 = TIM_CCMR1_OC2M_2 | TIM_CCMR1_OC2M_1;
+            TIM->CCMR1 = ccmr << 8;
         break;
         case 3:
-            TIM->CCMR2 = TIM_CCMR2_OC3M_2 | TIM_CCMR2_OC3M_1;
+            TIM->CCMR2 = ccmr;
         break;
         default:
-            TIM->CCMR2 = TIM_CCMR2_OC4M_2 | TIM_CCMR2_OC4M_1;
+            TIM->CCMR2 = ccmr << 8;
     }
 #if MOTORTIM_ARRMIN < 5
 #error "change the code!"
 #endif
-    TIM->CCR1 = MOTORTIM_ARRMIN - 3; // ~10us for pulse duration
-    TIM->ARR = 0xffff;
+#if MOTORTIM_PULSE >= MOTORTIM_ARRMIN
+#error "MOTORTIM_PULSE should be less than MOTORTIM_ARRMIN"
+#endif
+    TIM->RCR = 0;
+    mottimer_setARR(i, 0xffff);
 //    TIM->EGR = TIM_EGR_UG; // generate update to refresh ARR
     TIM->BDTR |= TIM_BDTR_MOE; // enable main output
     TIM->CCER = 1<<((n-1)*4); // turn it on, active high
-    TIM->DIER = 1<<n; // allow CC interrupt (we should count steps)
+    if(mottrepmax[i] > 1) TIM->DIER = TIM_DIER_UIE; // count steps by update events
+    else TIM->DIER = 1<<n; // allow CC interrupt (we should count steps)
     NVIC_EnableIRQ(motirqs[i]);
 }
 
+// set new ARR value (and CCR for timers with RCR)
+void mottimer_setARR(uint8_t i, uint32_t ARR){
+    volatile TIM_TypeDef *TIM = mottimers[i];
+    volatile uint32_t *CCR = &TIM->CCR1 + (mottchannels[i] - 1);
+    TIM->ARR = ARR;
+    if(mottrepmax[i] > 1) *CCR = ARR + 1 - MOTORTIM_PULSE;
+    else *CCR = MOTORTIM_ARRMIN - 3; // ~10us for pulse duration
+}
+
+/**
+ * @brief mottimer_usteps - set amount of microsteps counted by hardware for one interrupt
+ * @param i - motor number
+ * @param microsteps - microsteps per step
+ * @return amount of microsteps per interrupt
+ */
+uint16_t mottimer_usteps(uint8_t i, uint16_t microsteps){
+    uint32_t n = microsteps;
+    if(n > mottrepmax[i]) n = mottrepmax[i];
+    if(n == 0) n = 1;
+    // new RCR value will be loaded on next update event (or by UG when starting)
+    mottimers[i]->RCR = n - 1;
+    return (uint16_t)n;
+}
 
 void mottimers_setup(){
     for(int i = 0; i < MOTORSNO; ++i) setup_mpwm(i);
 }
 
+// DIAG input (PE2) -> EXTI2 (rising edge); ESW0 lines are configured in `esw_latch_arm`
+TRUE_INLINE void exti_setup(){
+    RCC->APB2ENR |= RCC_APB2ENR_SYSCFGEN;
+    diag_select(-1);
+    SYSCFG->EXTICR[0] = (SYSCFG->EXTICR[0] & ~SYSCFG_EXTICR1_EXTI2) | SYSCFG_EXTICR1_EXTI2_PE;
+    EXTI->RTSR |= EXTI_RTSR_TR2;
+    EXTI->PR = EXTI_PR_PR2;
+    EXTI->IMR |= EXTI_IMR_MR2;
+    NVIC_EnableIRQ(EXTI2_TSC_IRQn);
+    NVIC_EnableIRQ(EXTI9_5_IRQn);
+    NVIC_EnableIRQ(EXTI15_10_IRQn);
+}
+
+// EXTI lines of zero end-switches (ESW0) are shared between several motors (e.g. PB7/PC7/PD7/PE7),
+// so line is used only by one motor at a time (while moving to zero)
+// number of motor + 1 which owns EXTI line (0 - line is free)
+static uint8_t eswlineown[16] = {0};
+
+/**
+ * @brief esw_latch_arm - connect ESW0 of given motor to EXTI to latch position of switch activation
+ * @param motno - motor number
+ * @return FALSE if EXTI line is busy by other motor
+ */
+int esw_latch_arm(uint8_t motno){
+    uint8_t line = MSB(ESWpins[motno][0]);
+    if(line == 2 || (eswlineown[line] && eswlineown[line] != motno + 1)) return FALSE;
+    uint32_t port = ((uint32_t)ESWports[motno][0] - GPIOA_BASE) >> 10; // 0 - GPIOA, 1 - GPIOB etc
+    uint32_t mask = 1 << line, shift = (line & 3) * 4;
+    eswlineown[line] = motno + 1;
+    EXTI->IMR &= ~mask;
+    SYSCFG->EXTICR[line >> 2] = (SYSCFG->EXTICR[line >> 2] & ~(0xf << shift)) | (port << shift);
+    EXTI->RTSR |= mask;
+    EXTI->FTSR |= mask;
+    EXTI->PR = mask;
+    EXTI->IMR |= mask;
+    return TRUE;
+}
+
+// free EXTI line of ESW0
+void esw_latch_release(uint8_t motno){
+    uint8_t line = MSB(ESWpins[motno][0]);
+    if(eswlineown[line] != motno + 1) return;
+    uint32_t mask = 1 << line;
+    EXTI->IMR &= ~mask;
+    EXTI->RTSR &= ~mask;
+    EXTI->FTSR &= ~mask;
+    eswlineown[line] = 0;
+}
+
+// currently selected DIAG channel (-1 if none)
+static volatile int8_t diagchannel = -1;
+
+/**
+ * @brief diag_select - connect DIAG output of given driver to PE2
+ * @param motno - motor number or -1 to disable multiplexer
+ */
+void diag_select(int8_t motno){
+    EXTI->IMR &= ~EXTI_IMR_MR2; // don't catch glitches while switching
+    if(motno < 0 || motno >= MOTORSNO){
+        diagchannel = -1;
+        pin_set(GPIOE, 1<<6);
+        return;
+    }
+    GPIOE->BSRR = (7 << (3+16)) | ((motno & 7) << 3); // MUL0..2: PE3..PE5
+    pin_clear(GPIOE, 1<<6); // MUL EN is active low
+    diagchannel = motno;
+    EXTI->PR = EXTI_PR_PR2;
+    EXTI->IMR |= EXTI_IMR_MR2;
+}
+
 void hw_setup(){
     gpio_setup();
     mottimers_setup();
+    exti_setup();
 #ifndef EBUG
     iwdg_setup();
 #endif
@@ -237,10 +344,6 @@ void hw_setup(){
 
 
 // timers for motors: 0:t15c1, 1:t16c1, 2:t17c1, 3:t2ch1, 4:t8ch1, 5:t4c1, 6:t1c1, 7:t3c3
-void tim1_cc_isr(){
-    addmicrostep(6);
-    TIM1->SR = 0;
-}
 void tim2_isr(){
     addmicrostep(3);
     TIM2->SR = 0;
@@ -253,7 +356,7 @@ void tim4_isr(){
     addmicrostep(5);
     TIM4->SR = 0;
 }
-void tim8_cc_isr(){
+void tim8_up_isr(){
     addmicrostep(4);
     TIM8->SR = 0;
 }
@@ -261,11 +364,39 @@ void tim1_brk_tim15_isr(){
     addmicrostep(0);
     TIM15->SR = 0;
 }
+// TIM1 update and TIM16 share the same IRQ
 void tim1_up_tim16_isr(){
-    addmicrostep(1);
-    TIM16->SR = 0;
+    if(TIM16->SR & TIM_SR_UIF){
+        addmicrostep(1);
+        TIM16->SR = 0;
+    }
+    if(TIM1->SR & TIM_SR_UIF){
+        addmicrostep(6);
+        TIM1->SR = 0;
+    }
 }
 void tim1_trg_com_tim17_isr(){
     addmicrostep(2);
     TIM17->SR = 0;
 }
+
+// zero end-switches
+static void eswlines_isr(uint32_t lines){
+    uint32_t pr = EXTI->PR & lines;
+    EXTI->PR = pr;
+    for(int l = 0; pr; ++l, pr >>= 1){
+        if((pr & 1) && eswlineown[l]) esw_latch(eswlineown[l] - 1);
+    }
+}
+void exti9_5_isr(){
+    eswlines_isr(0x03e0);
+}
+void exti15_10_isr(){
+    eswlines_isr(0xfc00);
+}
+
+// DIAG: StallGuard event of selected driver
+void exti2_tsc_isr(){
+    EXTI->PR = EXTI_PR_PR2;
+    if(diagchannel > -1) motor_stalled(diagchannel);
+}
@@ -30,6 +30,8 @@
 #define MOTORTIM_PSC    (2)
 // minimal ARR value - 99 for 5000 steps per second @ 32 microsteps/step
 #define MOTORTIM_ARRMIN (99)
+// STEP pulse length for timers with repetition counter (ticks of 16MHz), should be less than MOTORTIM_ARRMIN
+#define MOTORTIM_PULSE  (80)
 
 // USB pullup: PA8
 #define USBPU_port  GPIOA
@@ -67,6 +69,9 @@ extern const uint32_t DIRpins[MOTORSNO];
 // amount of full steps per revolution
 #define STEPSPERREV         (200)
 
+// DIAG input (PE2) of drivers through multiplexer (PE3..PE5 - address, PE6 - enable)
+#define DIAG_state()    ((GPIOE->IDR & (1<<2)) ? 1 : 0)
+
 // Limit switches: 2 for each motor
 #define ESWNO       (2)
 // ESW ports & pins
@@ -83,6 +88,8 @@ extern const uint32_t   EXTpins[EXTNO];
 #define EXT_CHK(x)      (pin_read(EXTports[x], EXTpins[x]))
 
 extern volatile TIM_TypeDef *mottimers[MOTORSNO];
+// max amount of microsteps counted by repetition counter per one interrupt (1 - timer have no RCR)
+extern const uint32_t mottrepmax[MOTORSNO];
 
 extern volatile uint32_t Tms;
 
@@ -90,3 +97,8 @@ uint8_t ESW_state(uint8_t MOTno);
 uint8_t MSB(uint16_t val);
 void hw_setup();
 void mottimers_setup();
+uint16_t mottimer_usteps(uint8_t i, uint16_t microsteps);
+void mottimer_setARR(uint8_t i, uint32_t ARR);
+void diag_select(int8_t motno);
+int esw_latch_arm(uint8_t motno);
+void esw_latch_release(uint8_t motno);
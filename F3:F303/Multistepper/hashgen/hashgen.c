@@ -27,6 +27,7 @@ typedef struct{
     char *headerfile;
     char *sourcefile;
     int genfunc;
+    int perfect;
 } glob_pars;
 
 static glob_pars G = {.headerfile = "hash.h", .sourcefile = "hash.c"};
@@ -37,6 +38,7 @@ static myoption cmdlnopts[] = {
     {"header",  NEED_ARG,   NULL,   'H',    arg_string, APTR(&G.headerfile),"output header filename"},
     {"source",  NEED_ARG,   NULL,   'S',    arg_string, APTR(&G.sourcefile),"output source filename"},
     {"genfunc", NO_ARGS,    NULL,   'F',    arg_int,    APTR(&G.genfunc),   "generate function bodys"},
+    {"perfect", NO_ARGS,    NULL,   'P',    arg_int,    APTR(&G.perfect),   "generate minimal perfect hash and table of commands instead of switch"},
     end_option
 };
 static void parse_args(int argc, char **argv){
@@ -112,6 +114,19 @@ static const char *hashsources[HASHFNO] = {
 }\n"
 };
 
+// the same functions by steps (to calculate hash while copying command)
+static const char *hashsteps[HASHFNO] = {
+"#define HASHINIT        (5381)\n\
+#define HASHSTEP(h, c)  do{h = ((h << 7) + h) + c;}while(0)\n\
+#define HASHFINAL(h)\n",
+"#define HASHINIT        (5381)\n\
+#define HASHSTEP(h, c)  do{h = c + (h << 6) + (h << 16) - h;}while(0)\n\
+#define HASHFINAL(h)\n",
+"#define HASHINIT        (0)\n\
+#define HASHSTEP(h, c)  do{h += c; h += (h << 10); h ^= (h >> 6);}while(0)\n\
+#define HASHFINAL(h)    do{h += (h << 3); h ^= (h >> 11); h += (h << 15);}while(0)\n"
+};
+
 static uint32_t (*hash[HASHFNO])(const char *str) = {djb2, sdbm, jenkins};
 static const char *hashnames[HASHFNO] = {"DJB2", "SDBM", "Jenkins"};
 
@@ -119,6 +134,7 @@ typedef struct{
     char str[32];       // string command
     char fname[32];     // function namee
     uint32_t hash;      // command hash
+    int idx;            // index in table of minimal perfect hash
 } strhash;
 
 static int sorthashesH(const void *a, const void *b){ // sort by hash
@@ -212,12 +228,135 @@ static const char *srchdr =
 // Licensed by GPLv3\n\
 #include <stdint.h>\n\
 #include <stddef.h>\n\
-#include \"%s\"\n\n\
+%s#include \"%s\"\n\n\
 #ifndef WAL\n\
 #define WAL __attribute__ ((weak, alias (\"__f1\")))\n\
 #endif\n\nstatic int __f1(uint32_t _U_ h, char _U_ *a){return 1;}\n\n"
 ;
 
+/*
+ * Minimal perfect hash ("hash and displace"): hash is divided into buckets by its bits,
+ * for each bucket (from largest) displacement is selected to put all its keys into free slots.
+ * The same functions are generated for MCU (see mphsource), slot calculation is division-free.
+ */
+#define MPH_DISPMAX     (256)
+static uint32_t mph_bucket(uint32_t h, uint32_t nbuckets){
+    return (h ^ (h >> 16)) & (nbuckets - 1);
+}
+static uint32_t mph_slot(uint32_t h, uint32_t d, uint32_t nkeys){
+    uint32_t x = h ^ (d * 0x9e3779b9U);
+    x ^= x >> 16;
+    x *= 0x85ebca6bU;
+    x ^= x >> 13;
+    return (uint32_t)(((uint64_t)x * nkeys) >> 32);
+}
+
+static int *bucketsz; // for sorting buckets by size
+static int sortbuckets(const void *a, const void *b){
+    return bucketsz[*(int*)b] - bucketsz[*(int*)a];
+}
+
+/**
+ * @brief mkmph - find displacements for minimal perfect hash
+ * @param H - hashes, H[i].idx will be filled with slot numbers
+ * @param hlen - amount of hashes
+ * @param disp (o) - displacements (allocated here)
+ * @return amount of buckets or 0 if failed
+ */
+static int mkmph(strhash *H, int hlen, uint8_t **disp){
+    int nb = 1;
+    while(nb < hlen / 2) nb <<= 1;
+    char *used = MALLOC(char, hlen);
+    int *slots = MALLOC(int, hlen);
+    for(; nb <= 4 * hlen; nb <<= 1){
+        uint8_t *d = MALLOC(uint8_t, nb);
+        int *order = MALLOC(int, nb);
+        bucketsz = MALLOC(int, nb);
+        for(int i = 0; i < hlen; ++i) ++bucketsz[mph_bucket(H[i].hash, nb)];
+        for(int i = 0; i < nb; ++i) order[i] = i;
+        qsort(order, nb, sizeof(int), sortbuckets);
+        memset(used, 0, hlen);
+        int b = 0;
+        for(; b < nb && bucketsz[order[b]]; ++b){
+            uint32_t bucket = order[b];
+            int dd = 0;
+            for(; dd < MPH_DISPMAX; ++dd){
+                int n = 0, good = 1;
+                for(int i = 0; i < hlen && good; ++i){
+                    if(mph_bucket(H[i].hash, nb) != bucket) continue;
+                    int s = mph_slot(H[i].hash, dd, hlen);
+                    if(used[s]) good = 0;
+                    for(int j = 0; j < n && good; ++j) if(slots[j] == s) good = 0;
+                    slots[n++] = s;
+                }
+                if(good) break;
+            }
+            if(dd == MPH_DISPMAX) break;
+            d[bucket] = dd;
+            for(int i = 0; i < hlen; ++i){
+                if(mph_bucket(H[i].hash, nb) != bucket) continue;
+                H[i].idx = mph_slot(H[i].hash, dd, hlen);
+                used[H[i].idx] = 1;
+            }
+        }
+        FREE(order);
+        FREE(bucketsz);
+        int ok = 1;
+        for(int i = 0; i < hlen; ++i) if(!used[i]) ok = 0;
+        if(ok){
+            FREE(used); FREE(slots);
+            *disp = d;
+            return nb;
+        }
+        FREE(d);
+        WARNX("Can't build perfect hash with %d buckets", nb);
+    }
+    FREE(used); FREE(slots);
+    return 0;
+}
+
+static const char *mphsource =
+"// index of command in `cmdtable` (minimal perfect hash)\n\
+static inline uint32_t mph(uint32_t h){\n\
+    uint32_t x = h ^ (mph_disp[(h ^ (h >> 16)) & (MPH_BUCKETS - 1)] * 0x9e3779b9U);\n\
+    x ^= x >> 16;\n\
+    x *= 0x85ebca6bU;\n\
+    x ^= x >> 13;\n\
+    return (uint32_t)(((uint64_t)x * CMD_AMOUNT) >> 32);\n\
+}\n\n\
+// @return index of command with given hash or -1\n\
+int cmd_index(uint32_t hash){\n\
+    uint32_t i = mph(hash);\n\
+    return (cmdtable[i].hash == hash) ? (int)i : -1;\n\
+}\n\n\
+int parsecmd(const char *str){\n\
+    char cmd[CMD_MAXLEN + 1];\n\
+    if(!str || !*str) return RET_CMDNOTFOUND;\n\
+    uint32_t h = HASHINIT;\n\
+    int i = 0;\n\
+    while(*str > '@' && i < CMD_MAXLEN){\n\
+        char c = *str++;\n\
+        cmd[i++] = c;\n\
+        HASHSTEP(h, (uint32_t)c);\n\
+    }\n\
+    cmd[i] = 0;\n\
+    HASHFINAL(h);\n\
+    while(*str && *str <= ' ') ++str;\n\
+    const cmdrec *r = &cmdtable[mph(h)];\n\
+    if(r->hash != h || strcmp(r->name, cmd)) return RET_CMDNOTFOUND;\n\
+    return r->fn(h, (char*)str);\n\
+}\n\n"
+;
+
+static const char *tblhdr =
+"typedef struct{\n\
+    const char *name;\n\
+    int (*fn)(uint32_t hash, char *args);\n\
+    uint32_t hash;\n\
+} cmdrec;\n\n\
+static const cmdrec cmdtable[CMD_AMOUNT] = {\n"
+;
+
 static void build(strhash *H, int hno, int hlen){
     green("Generate files for hash function '%s'\n", hashnames[hno]);
     int lmax = 1;
@@ -229,16 +368,49 @@ static void build(strhash *H, int hno, int hlen){
     }
     lmax = (lmax + 3)/4;
     lmax *= 4;
+    uint8_t *disp = NULL;
+    int nbuckets = 0;
+    if(G.perfect){
+        nbuckets = mkmph(H, hlen, &disp);
+        if(!nbuckets) ERRX("Can't build minimal perfect hash");
+        green("Minimal perfect hash: %d keys, %d buckets\n", hlen, nbuckets);
+    }
     // resort H by strings
     qsort(H, hlen, sizeof(strhash), sorthashesS);
     FILE *source = openoutp(G.sourcefile), *header = openoutp(G.headerfile);
-    fprintf(source, srchdr, G.headerfile);
+    fprintf(source, srchdr, G.perfect ? "#include <string.h>\n" : "", G.headerfile);
     if(G.genfunc){
         for(int i = 0; i < hlen; ++i){
             fprintf(source, fns, H[i].fname, H[i].str, H[i].hash);
         }
+    }else if(G.perfect){ // table needs prototypes
+        for(int i = 0; i < hlen; ++i)
+            fprintf(source, "int fn_%s(uint32_t hash, char *args);\n", H[i].fname);
+        fprintf(source, "\n");
     }
+    if(G.perfect) fprintf(header, "#include <stdint.h>\n\n");
     fprintf(header, "%s", headercontent);
+    if(G.perfect){
+        fprintf(header, "#define CMD_AMOUNT  (%d)\nint cmd_index(uint32_t hash);\n\n", hlen);
+        fprintf(source, "%s\n", hashsteps[hno]);
+        fprintf(source, "#define MPH_BUCKETS     (%d)\nstatic const uint8_t mph_disp[MPH_BUCKETS] = {", nbuckets);
+        for(int i = 0; i < nbuckets; ++i)
+            fprintf(source, "%s%d", (i % 16) ? ", " : (i ? ",\n    " : "\n    "), disp[i]);
+        fprintf(source, "\n};\n\n%s", tblhdr);
+        for(int i = 0; i < hlen; ++i){
+            char *m = macroname(H[i].str);
+            fprintf(source, "    [CMDIDX_%s] = {\"%s\", fn_%s, CMD_%s},\n", m, H[i].str, H[i].fname, m);
+            fprintf(header, "#define CMD_%-*s    (%u)\n", lmax, m, H[i].hash);
+        }
+        fprintf(source, "};\n\n%s", mphsource);
+        fprintf(header, "\n// indexes in table of commands\n");
+        for(int i = 0; i < hlen; ++i)
+            fprintf(header, "#define CMDIDX_%-*s (%d)\n", lmax, macroname(H[i].str), H[i].idx);
+        FREE(disp);
+        fclose(source);
+        fclose(header);
+        return;
+    }
     fprintf(source, "%s\n", hashsources[hno]);
     fprintf(source, "%s", fhdr);
     for(int i = 0; i < hlen; ++i){
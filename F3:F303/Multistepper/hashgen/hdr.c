@@ -2,6 +2,7 @@
 // Licensed by GPLv3
 #include <stdint.h>
 #include <stddef.h>
+#include <string.h>
 #include "hdr.h"
 
 #ifndef WAL
@@ -46,6 +47,8 @@ int fn_canstat(uint32_t _U_ hash, char _U_ *args) WAL; // "canstat" (237384179)
 
 int fn_diagn(uint32_t _U_ hash, char _U_ *args) WAL; // "diagn" (2334137736)
 
+int fn_drvstatus(uint32_t _U_ hash, char _U_ *args) WAL; // "drvstatus" (917747701)
+
 int fn_drvtype(uint32_t _U_ hash, char _U_ *args) WAL; // "drvtype" (3930242451)
 
 int fn_dumpcmd(uint32_t _U_ hash, char _U_ *args) WAL; // "dumpcmd" (1223955823)
@@ -78,14 +81,20 @@ int fn_maxspeed(uint32_t _U_ hash, char _U_ *args) WAL; // "maxspeed" (149807881
 
 int fn_maxsteps(uint32_t _U_ hash, char _U_ *args) WAL; // "maxsteps" (1506667002)
 
+int fn_mbtn(uint32_t _U_ hash, char _U_ *args) WAL; // "mbtn" (4005942)
+
 int fn_mcut(uint32_t _U_ hash, char _U_ *args) WAL; // "mcut" (4022718)
 
 int fn_mcuvdd(uint32_t _U_ hash, char _U_ *args) WAL; // "mcuvdd" (2517587080)
 
+int fn_mdef(uint32_t _U_ hash, char _U_ *args) WAL; // "mdef" (4037281)
+
 int fn_microsteps(uint32_t _U_ hash, char _U_ *args) WAL; // "microsteps" (3974395854)
 
 int fn_minspeed(uint32_t _U_ hash, char _U_ *args) WAL; // "minspeed" (3234848090)
 
+int fn_mlist(uint32_t _U_ hash, char _U_ *args) WAL; // "mlist" (538051118)
+
 int fn_motcurrent(uint32_t _U_ hash, char _U_ *args) WAL; // "motcurrent" (1926997848)
 
 int fn_motflags(uint32_t _U_ hash, char _U_ *args) WAL; // "motflags" (2153634658)
@@ -96,6 +105,10 @@ int fn_motno(uint32_t _U_ hash, char _U_ *args) WAL; // "motno" (544673586)
 
 int fn_motreinit(uint32_t _U_ hash, char _U_ *args) WAL; // "motreinit" (199682784)
 
+int fn_mrun(uint32_t _U_ hash, char _U_ *args) WAL; // "mrun" (4272327)
+
+int fn_msave(uint32_t _U_ hash, char _U_ *args) WAL; // "msave" (552945185)
+
 int fn_pdn(uint32_t _U_ hash, char _U_ *args) WAL; // "pdn" (2963275719)
 
 int fn_ping(uint32_t _U_ hash, char _U_ *args) WAL; // "ping" (10561715)
@@ -110,12 +123,20 @@ int fn_saveconf(uint32_t _U_ hash, char _U_ *args) WAL; // "saveconf" (141102426
 
 int fn_screen(uint32_t _U_ hash, char _U_ *args) WAL; // "screen" (2100809349)
 
+int fn_sgresult(uint32_t _U_ hash, char _U_ *args) WAL; // "sgresult" (1954755198)
+
+int fn_sgthrs(uint32_t _U_ hash, char _U_ *args) WAL; // "sgthrs" (3212845856)
+
 int fn_speedlimit(uint32_t _U_ hash, char _U_ *args) WAL; // "speedlimit" (1654184245)
 
 int fn_state(uint32_t _U_ hash, char _U_ *args) WAL; // "state" (2216628902)
 
 int fn_stop(uint32_t _U_ hash, char _U_ *args) WAL; // "stop" (17184971)
 
+int fn_telemdest(uint32_t _U_ hash, char _U_ *args) WAL; // "telemdest" (2685054924)
+
+int fn_telemetry(uint32_t _U_ hash, char _U_ *args) WAL; // "telemetry" (2687451104)
+
 int fn_time(uint32_t _U_ hash, char _U_ *args) WAL; // "time" (19148340)
 
 int fn_tmcbus(uint32_t _U_ hash, char _U_ *args) WAL; // "tmcbus" (1906135955)
@@ -128,206 +149,126 @@ int fn_vdrive(uint32_t _U_ hash, char _U_ *args) WAL; // "vdrive" (2172773525)
 
 int fn_vfive(uint32_t _U_ hash, char _U_ *args) WAL; // "vfive" (3017477285)
 
-static uint32_t hashf(const char *str){
-    uint32_t hash = 5381;
-    uint32_t c;
-    while((c = (uint32_t)*str++))
-        hash = ((hash << 7) + hash) + c;
-    return hash;
+#define HASHINIT        (5381)
+#define HASHSTEP(h, c)  do{h = ((h << 7) + h) + c;}while(0)
+#define HASHFINAL(h)
+
+#define MPH_BUCKETS     (64)
+static const uint8_t mph_disp[MPH_BUCKETS] = {
+    0, 2, 2, 0, 1, 0, 0, 0, 1, 2, 1, 1, 0, 1, 3, 0,
+    1, 2, 3, 0, 0, 0, 0, 0, 3, 0, 0, 1, 0, 17, 1, 0,
+    0, 2, 1, 0, 0, 0, 0, 0, 2, 0, 2, 1, 3, 19, 0, 0,
+    4, 0, 3, 4, 0, 11, 0, 14, 0, 19, 2, 0, 19, 13, 42, 3
+};
+
+typedef struct{
+    const char *name;
+    int (*fn)(uint32_t hash, char *args);
+    uint32_t hash;
+} cmdrec;
+
+static const cmdrec cmdtable[CMD_AMOUNT] = {
+    [CMDIDX_ABSPOS] = {"abspos", fn_abspos, CMD_ABSPOS},
+    [CMDIDX_ACCEL] = {"accel", fn_accel, CMD_ACCEL},
+    [CMDIDX_ADC] = {"adc", fn_adc, CMD_ADC},
+    [CMDIDX_BUTTON] = {"button", fn_button, CMD_BUTTON},
+    [CMDIDX_CANERRCODES] = {"canerrcodes", fn_canerrcodes, CMD_CANERRCODES},
+    [CMDIDX_CANFILTER] = {"canfilter", fn_canfilter, CMD_CANFILTER},
+    [CMDIDX_CANFLOOD] = {"canflood", fn_canflood, CMD_CANFLOOD},
+    [CMDIDX_CANFLOODT] = {"canfloodT", fn_canfloodt, CMD_CANFLOODT},
+    [CMDIDX_CANID] = {"canid", fn_canid, CMD_CANID},
+    [CMDIDX_CANIGNORE] = {"canignore", fn_canignore, CMD_CANIGNORE},
+    [CMDIDX_CANINCRFLOOD] = {"canincrflood", fn_canincrflood, CMD_CANINCRFLOOD},
+    [CMDIDX_CANPAUSE] = {"canpause", fn_canpause, CMD_CANPAUSE},
+    [CMDIDX_CANREINIT] = {"canreinit", fn_canreinit, CMD_CANREINIT},
+    [CMDIDX_CANRESUME] = {"canresume", fn_canresume, CMD_CANRESUME},
+    [CMDIDX_CANSEND] = {"cansend", fn_cansend, CMD_CANSEND},
+    [CMDIDX_CANSPEED] = {"canspeed", fn_canspeed, CMD_CANSPEED},
+    [CMDIDX_CANSTAT] = {"canstat", fn_canstat, CMD_CANSTAT},
+    [CMDIDX_DIAGN] = {"diagn", fn_diagn, CMD_DIAGN},
+    [CMDIDX_DRVSTATUS] = {"drvstatus", fn_drvstatus, CMD_DRVSTATUS},
+    [CMDIDX_DRVTYPE] = {"drvtype", fn_drvtype, CMD_DRVTYPE},
+    [CMDIDX_DUMPCMD] = {"dumpcmd", fn_dumpcmd, CMD_DUMPCMD},
+    [CMDIDX_DUMPCONF] = {"dumpconf", fn_dumpconf, CMD_DUMPCONF},
+    [CMDIDX_DUMPERR] = {"dumperr", fn_dumperr, CMD_DUMPERR},
+    [CMDIDX_DUMPMOTFLAGS] = {"dumpmotflags", fn_dumpmotflags, CMD_DUMPMOTFLAGS},
+    [CMDIDX_DUMPSTATES] = {"dumpstates", fn_dumpstates, CMD_DUMPSTATES},
+    [CMDIDX_EMSTOP] = {"emstop", fn_emstop, CMD_EMSTOP},
+    [CMDIDX_ERASEFLASH] = {"eraseflash", fn_eraseflash, CMD_ERASEFLASH},
+    [CMDIDX_ESW] = {"esw", fn_esw, CMD_ESW},
+    [CMDIDX_ESWREACT] = {"eswreact", fn_eswreact, CMD_ESWREACT},
+    [CMDIDX_GOTO] = {"goto", fn_goto, CMD_GOTO},
+    [CMDIDX_GOTOZ] = {"gotoz", fn_gotoz, CMD_GOTOZ},
+    [CMDIDX_GPIO] = {"gpio", fn_gpio, CMD_GPIO},
+    [CMDIDX_GPIOCONF] = {"gpioconf", fn_gpioconf, CMD_GPIOCONF},
+    [CMDIDX_MAXSPEED] = {"maxspeed", fn_maxspeed, CMD_MAXSPEED},
+    [CMDIDX_MAXSTEPS] = {"maxsteps", fn_maxsteps, CMD_MAXSTEPS},
+    [CMDIDX_MBTN] = {"mbtn", fn_mbtn, CMD_MBTN},
+    [CMDIDX_MCUT] = {"mcut", fn_mcut, CMD_MCUT},
+    [CMDIDX_MCUVDD] = {"mcuvdd", fn_mcuvdd, CMD_MCUVDD},
+    [CMDIDX_MDEF] = {"mdef", fn_mdef, CMD_MDEF},
+    [CMDIDX_MICROSTEPS] = {"microsteps", fn_microsteps, CMD_MICROSTEPS},
+    [CMDIDX_MINSPEED] = {"minspeed", fn_minspeed, CMD_MINSPEED},
+    [CMDIDX_MLIST] = {"mlist", fn_mlist, CMD_MLIST},
+    [CMDIDX_MOTCURRENT] = {"motcurrent", fn_motcurrent, CMD_MOTCURRENT},
+    [CMDIDX_MOTFLAGS] = {"motflags", fn_motflags, CMD_MOTFLAGS},
+    [CMDIDX_MOTMUL] = {"motmul", fn_motmul, CMD_MOTMUL},
+    [CMDIDX_MOTNO] = {"motno", fn_motno, CMD_MOTNO},
+    [CMDIDX_MOTREINIT] = {"motreinit", fn_motreinit, CMD_MOTREINIT},
+    [CMDIDX_MRUN] = {"mrun", fn_mrun, CMD_MRUN},
+    [CMDIDX_MSAVE] = {"msave", fn_msave, CMD_MSAVE},
+    [CMDIDX_PDN] = {"pdn", fn_pdn, CMD_PDN},
+    [CMDIDX_PING] = {"ping", fn_ping, CMD_PING},
+    [CMDIDX_RELPOS] = {"relpos", fn_relpos, CMD_RELPOS},
+    [CMDIDX_RELSLOW] = {"relslow", fn_relslow, CMD_RELSLOW},
+    [CMDIDX_RESET] = {"reset", fn_reset, CMD_RESET},
+    [CMDIDX_SAVECONF] = {"saveconf", fn_saveconf, CMD_SAVECONF},
+    [CMDIDX_SCREEN] = {"screen", fn_screen, CMD_SCREEN},
+    [CMDIDX_SGRESULT] = {"sgresult", fn_sgresult, CMD_SGRESULT},
+    [CMDIDX_SGTHRS] = {"sgthrs", fn_sgthrs, CMD_SGTHRS},
+    [CMDIDX_SPEEDLIMIT] = {"speedlimit", fn_speedlimit, CMD_SPEEDLIMIT},
+    [CMDIDX_STATE] = {"state", fn_state, CMD_STATE},
+    [CMDIDX_STOP] = {"stop", fn_stop, CMD_STOP},
+    [CMDIDX_TELEMDEST] = {"telemdest", fn_telemdest, CMD_TELEMDEST},
+    [CMDIDX_TELEMETRY] = {"telemetry", fn_telemetry, CMD_TELEMETRY},
+    [CMDIDX_TIME] = {"time", fn_time, CMD_TIME},
+    [CMDIDX_TMCBUS] = {"tmcbus", fn_tmcbus, CMD_TMCBUS},
+    [CMDIDX_UDATA] = {"udata", fn_udata, CMD_UDATA},
+    [CMDIDX_USARTSTATUS] = {"usartstatus", fn_usartstatus, CMD_USARTSTATUS},
+    [CMDIDX_VDRIVE] = {"vdrive", fn_vdrive, CMD_VDRIVE},
+    [CMDIDX_VFIVE] = {"vfive", fn_vfive, CMD_VFIVE},
+};
+
+// index of command in `cmdtable` (minimal perfect hash)
+static inline uint32_t mph(uint32_t h){
+    uint32_t x = h ^ (mph_disp[(h ^ (h >> 16)) & (MPH_BUCKETS - 1)] * 0x9e3779b9U);
+    x ^= x >> 16;
+    x *= 0x85ebca6bU;
+    x ^= x >> 13;
+    return (uint32_t)(((uint64_t)x * CMD_AMOUNT) >> 32);
+}
+
+// @return index of command with given hash or -1
+int cmd_index(uint32_t hash){
+    uint32_t i = mph(hash);
+    return (cmdtable[i].hash == hash) ? (int)i : -1;
 }
 
 int parsecmd(const char *str){
-        char cmd[CMD_MAXLEN + 1];
-        if(!str || !*str) return RET_CMDNOTFOUND;
-        int i = 0;
-        while(*str > '@' && i < CMD_MAXLEN){ cmd[i++] = *str++; }
-        cmd[i] = 0;
-        if(*str){
-            while(*str <= ' ') ++str;
-        }
-        char *args = (char*) str;
-        uint32_t h = hashf(cmd);
-        switch(h){
-
-        case CMD_ABSPOS:
-            return fn_abspos(h, args);
-        break;
-        case CMD_ACCEL:
-            return fn_accel(h, args);
-        break;
-        case CMD_ADC:
-            return fn_adc(h, args);
-        break;
-        case CMD_BUTTON:
-            return fn_button(h, args);
-        break;
-        case CMD_CANERRCODES:
-            return fn_canerrcodes(h, args);
-        break;
-        case CMD_CANFILTER:
-            return fn_canfilter(h, args);
-        break;
-        case CMD_CANFLOOD:
-            return fn_canflood(h, args);
-        break;
-        case CMD_CANFLOODT:
-            return fn_canfloodt(h, args);
-        break;
-        case CMD_CANID:
-            return fn_canid(h, args);
-        break;
-        case CMD_CANIGNORE:
-            return fn_canignore(h, args);
-        break;
-        case CMD_CANINCRFLOOD:
-            return fn_canincrflood(h, args);
-        break;
-        case CMD_CANPAUSE:
-            return fn_canpause(h, args);
-        break;
-        case CMD_CANREINIT:
-            return fn_canreinit(h, args);
-        break;
-        case CMD_CANRESUME:
-            return fn_canresume(h, args);
-        break;
-        case CMD_CANSEND:
-            return fn_cansend(h, args);
-        break;
-        case CMD_CANSPEED:
-            return fn_canspeed(h, args);
-        break;
-        case CMD_CANSTAT:
-            return fn_canstat(h, args);
-        break;
-        case CMD_DIAGN:
-            return fn_diagn(h, args);
-        break;
-        case CMD_DRVTYPE:
-            return fn_drvtype(h, args);
-        break;
-        case CMD_DUMPCMD:
-            return fn_dumpcmd(h, args);
-        break;
-        case CMD_DUMPCONF:
-            return fn_dumpconf(h, args);
-        break;
-        case CMD_DUMPERR:
-            return fn_dumperr(h, args);
-        break;
-        case CMD_DUMPMOTFLAGS:
-            return fn_dumpmotflags(h, args);
-        break;
-        case CMD_DUMPSTATES:
-            return fn_dumpstates(h, args);
-        break;
-        case CMD_EMSTOP:
-            return fn_emstop(h, args);
-        break;
-        case CMD_ERASEFLASH:
-            return fn_eraseflash(h, args);
-        break;
-        case CMD_ESW:
-            return fn_esw(h, args);
-        break;
-        case CMD_ESWREACT:
-            return fn_eswreact(h, args);
-        break;
-        case CMD_GOTO:
-            return fn_goto(h, args);
-        break;
-        case CMD_GOTOZ:
-            return fn_gotoz(h, args);
-        break;
-        case CMD_GPIO:
-            return fn_gpio(h, args);
-        break;
-        case CMD_GPIOCONF:
-            return fn_gpioconf(h, args);
-        break;
-        case CMD_MAXSPEED:
-            return fn_maxspeed(h, args);
-        break;
-        case CMD_MAXSTEPS:
-            return fn_maxsteps(h, args);
-        break;
-        case CMD_MCUT:
-            return fn_mcut(h, args);
-        break;
-        case CMD_MCUVDD:
-            return fn_mcuvdd(h, args);
-        break;
-        case CMD_MICROSTEPS:
-            return fn_microsteps(h, args);
-        break;
-        case CMD_MINSPEED:
-            return fn_minspeed(h, args);
-        break;
-        case CMD_MOTCURRENT:
-            return fn_motcurrent(h, args);
-        break;
-        case CMD_MOTFLAGS:
-            return fn_motflags(h, args);
-        break;
-        case CMD_MOTMUL:
-            return fn_motmul(h, args);
-        break;
-        case CMD_MOTNO:
-            return fn_motno(h, args);
-        break;
-        case CMD_MOTREINIT:
-            return fn_motreinit(h, args);
-        break;
-        case CMD_PDN:
-            return fn_pdn(h, args);
-        break;
-        case CMD_PING:
-            return fn_ping(h, args);
-        break;
-        case CMD_RELPOS:
-            return fn_relpos(h, args);
-        break;
-        case CMD_RELSLOW:
-            return fn_relslow(h, args);
-        break;
-        case CMD_RESET:
-            return fn_reset(h, args);
-        break;
-        case CMD_SAVECONF:
-            return fn_saveconf(h, args);
-        break;
-        case CMD_SCREEN:
-            return fn_screen(h, args);
-        break;
-        case CMD_SPEEDLIMIT:
-            return fn_speedlimit(h, args);
-        break;
-        case CMD_STATE:
-            return fn_state(h, args);
-        break;
-        case CMD_STOP:
-            return fn_stop(h, args);
-        break;
-        case CMD_TIME:
-            return fn_time(h, args);
-        break;
-        case CMD_TMCBUS:
-            return fn_tmcbus(h, args);
-        break;
-        case CMD_UDATA:
-            return fn_udata(h, args);
-        break;
-        case CMD_USARTSTATUS:
-            return fn_usartstatus(h, args);
-        break;
-        case CMD_VDRIVE:
-            return fn_vdrive(h, args);
-        break;
-        case CMD_VFIVE:
-            return fn_vfive(h, args);
-        break;
-        default: break;
+    char cmd[CMD_MAXLEN + 1];
+    if(!str || !*str) return RET_CMDNOTFOUND;
+    uint32_t h = HASHINIT;
+    int i = 0;
+    while(*str > '@' && i < CMD_MAXLEN){
+        char c = *str++;
+        cmd[i++] = c;
+        HASHSTEP(h, (uint32_t)c);
     }
-    return RET_CMDNOTFOUND;
+    cmd[i] = 0;
+    HASHFINAL(h);
+    while(*str && *str <= ' ') ++str;
+    const cmdrec *r = &cmdtable[mph(h)];
+    if(r->hash != h || strcmp(r->name, cmd)) return RET_CMDNOTFOUND;
+    return r->fn(h, (char*)str);
 }
 
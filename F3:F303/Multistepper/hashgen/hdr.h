@@ -1,3 +1,5 @@
+#include <stdint.h>
+
 #ifndef _U_
 #define _U_ __attribute__((__unused__))
 #endif
@@ -13,6 +15,9 @@ enum{
 
 int parsecmd(const char *cmdwargs);
 
+#define CMD_AMOUNT  (69)
+int cmd_index(uint32_t hash);
+
 #define CMD_ABSPOS          (3056382221)
 #define CMD_ACCEL           (1490521981)
 #define CMD_ADC             (2963026093)
@@ -31,6 +36,7 @@ int parsecmd(const char *cmdwargs);
 #define CMD_CANSPEED        (549265992)
 #define CMD_CANSTAT         (237384179)
 #define CMD_DIAGN           (2334137736)
+#define CMD_DRVSTATUS       (917747701)
 #define CMD_DRVTYPE         (3930242451)
 #define CMD_DUMPCMD         (1223955823)
 #define CMD_DUMPCONF        (3271513185)
@@ -47,15 +53,20 @@ int parsecmd(const char *cmdwargs);
 #define CMD_GPIOCONF        (1309721562)
 #define CMD_MAXSPEED        (1498078812)
 #define CMD_MAXSTEPS        (1506667002)
+#define CMD_MBTN            (4005942)
 #define CMD_MCUT            (4022718)
 #define CMD_MCUVDD          (2517587080)
+#define CMD_MDEF            (4037281)
 #define CMD_MICROSTEPS      (3974395854)
 #define CMD_MINSPEED        (3234848090)
+#define CMD_MLIST           (538051118)
 #define CMD_MOTCURRENT      (1926997848)
 #define CMD_MOTFLAGS        (2153634658)
 #define CMD_MOTMUL          (1543400099)
 #define CMD_MOTNO           (544673586)
 #define CMD_MOTREINIT       (199682784)
+#define CMD_MRUN            (4272327)
+#define CMD_MSAVE           (552945185)
 #define CMD_PDN             (2963275719)
 #define CMD_PING            (10561715)
 #define CMD_RELPOS          (1278646042)
@@ -63,12 +74,87 @@ int parsecmd(const char *cmdwargs);
 #define CMD_RESET           (1907803304)
 #define CMD_SAVECONF        (141102426)
 #define CMD_SCREEN          (2100809349)
+#define CMD_SGRESULT        (1954755198)
+#define CMD_SGTHRS          (3212845856)
 #define CMD_SPEEDLIMIT      (1654184245)
 #define CMD_STATE           (2216628902)
 #define CMD_STOP            (17184971)
+#define CMD_TELEMDEST       (2685054924)
+#define CMD_TELEMETRY       (2687451104)
 #define CMD_TIME            (19148340)
 #define CMD_TMCBUS          (1906135955)
 #define CMD_UDATA           (2736127636)
 #define CMD_USARTSTATUS     (4007098968)
 #define CMD_VDRIVE          (2172773525)
 #define CMD_VFIVE           (3017477285)
+
+// indexes in table of commands
+#define CMDIDX_ABSPOS       (68)
+#define CMDIDX_ACCEL        (26)
+#define CMDIDX_ADC          (30)
+#define CMDIDX_BUTTON       (34)
+#define CMDIDX_CANERRCODES  (52)
+#define CMDIDX_CANFILTER    (22)
+#define CMDIDX_CANFLOOD     (14)
+#define CMDIDX_CANFLOODT    (0)
+#define CMDIDX_CANID        (27)
+#define CMDIDX_CANIGNORE    (16)
+#define CMDIDX_CANINCRFLOOD (31)
+#define CMDIDX_CANPAUSE     (11)
+#define CMDIDX_CANREINIT    (5)
+#define CMDIDX_CANRESUME    (33)
+#define CMDIDX_CANSEND      (45)
+#define CMDIDX_CANSPEED     (1)
+#define CMDIDX_CANSTAT      (24)
+#define CMDIDX_DIAGN        (20)
+#define CMDIDX_DRVSTATUS    (37)
+#define CMDIDX_DRVTYPE      (32)
+#define CMDIDX_DUMPCMD      (64)
+#define CMDIDX_DUMPCONF     (2)
+#define CMDIDX_DUMPERR      (43)
+#define CMDIDX_DUMPMOTFLAGS (13)
+#define CMDIDX_DUMPSTATES   (25)
+#define CMDIDX_EMSTOP       (3)
+#define CMDIDX_ERASEFLASH   (49)
+#define CMDIDX_ESW          (54)
+#define CMDIDX_ESWREACT     (42)
+#define CMDIDX_GOTO         (55)
+#define CMDIDX_GOTOZ        (63)
+#define CMDIDX_GPIO         (62)
+#define CMDIDX_GPIOCONF     (67)
+#define CMDIDX_MAXSPEED     (38)
+#define CMDIDX_MAXSTEPS     (8)
+#define CMDIDX_MBTN         (56)
+#define CMDIDX_MCUT         (7)
+#define CMDIDX_MCUVDD       (59)
+#define CMDIDX_MDEF         (47)
+#define CMDIDX_MICROSTEPS   (46)
+#define CMDIDX_MINSPEED     (40)
+#define CMDIDX_MLIST        (60)
+#define CMDIDX_MOTCURRENT   (36)
+#define CMDIDX_MOTFLAGS     (39)
+#define CMDIDX_MOTMUL       (66)
+#define CMDIDX_MOTNO        (58)
+#define CMDIDX_MOTREINIT    (57)
+#define CMDIDX_MRUN         (48)
+#define CMDIDX_MSAVE        (65)
+#define CMDIDX_PDN          (15)
+#define CMDIDX_PING         (19)
+#define CMDIDX_RELPOS       (17)
+#define CMDIDX_RELSLOW      (44)
+#define CMDIDX_RESET        (51)
+#define CMDIDX_SAVECONF     (9)
+#define CMDIDX_SCREEN       (6)
+#define CMDIDX_SGRESULT     (18)
+#define CMDIDX_SGTHRS       (29)
+#define CMDIDX_SPEEDLIMIT   (4)
+#define CMDIDX_STATE        (10)
+#define CMDIDX_STOP         (50)
+#define CMDIDX_TELEMDEST    (12)
+#define CMDIDX_TELEMETRY    (53)
+#define CMDIDX_TIME         (23)
+#define CMDIDX_TMCBUS       (61)
+#define CMDIDX_UDATA        (21)
+#define CMDIDX_USARTSTATUS  (41)
+#define CMDIDX_VDRIVE       (28)
+#define CMDIDX_VFIVE        (35)
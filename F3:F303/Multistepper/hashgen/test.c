@@ -1,62 +1,86 @@
+// benchmark of command dispatching: parsecmd() for all words of dictionary and for unknown words
+// usage: ./test [dictionary [iterations]]
+// build with hdr.c for perfect hash (hashgen -P) or with -DSWITCHHDR and hdrsw.c for old switch
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
+#include <time.h>
+#ifdef __x86_64__
+#include <x86intrin.h>
+#endif
 
+#ifdef SWITCHHDR
+#include "hdrsw.h"
+#else
 #include "hdr.h"
-#include "strfunc.h"
+#endif
 
-static int noargs(uint32_t hash){
-    switch(hash){
-        case CMD_REBOOT: printf("REBOOT\n"); break;
-        case CMD_TIME: printf("TIME!\n"); break;
-        case CMD_TEMP: printf("Temp\n"); break;
-        default: printf("Unknown hash 0x%x\n", hash); return 0;
-    }
-    return 1;
+#define MAXWORDS    (256)
+
+static char words[MAXWORDS][CMD_MAXLEN + 8];
+static char bad[MAXWORDS][CMD_MAXLEN + 8];
+static int nwords = 0;
+
+static double nsnow(){
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e9 + t.tv_nsec;
 }
-static int withparno(uint32_t hash, char *args){
-    uint32_t N;
-    //printf("args=%s\n", args);
-    const char *nxt = getnum((const char*)args, &N);
-    if(nxt == args){ printf("need arg\n");  return RET_WRONGCMD; }
-    args = (char*)omit_spaces(nxt);
-    if(*args){
-        if(*args != '='){ printf("need nothing or '=' after par\n"); return RET_WRONGCMD; }
-        args = (char*)omit_spaces(args+1);
-        // we can check in next functions what if `args` will be an empty string
-    }
-    else args = NULL;
-    const char *fname = NULL;
-    switch(hash){
-        case CMD_ESW: fname = "ESW"; break;
-        case CMD_GOTO: fname = "GOTO"; break;
-        case CMD_POS: fname = "POS"; break;
-        case CMD_STOP: fname = "STOP"; break;
-        default: fname = "unknown";
-    }
-    if(!args) printf("We want a getter '%s' with par %u\n", fname, N);
-    else printf("We want a setter '%s' with par %u and arg '%s'\n", fname, N, args);
-    if(N > 255){ printf("N should be 0..255\n"); return RET_BAD;}
-    return RET_GOOD;
+
+static uint64_t ticks(){
+#ifdef __x86_64__
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+// run parsecmd() `N` times for each of `n` strings; @return amount of RET_CMDNOTFOUND
+static long bench(char (*str)[CMD_MAXLEN + 8], int n, long N, const char *name){
+    long notfound = 0;
+    double t0 = nsnow();
+    uint64_t c0 = ticks();
+    for(long k = 0; k < N; ++k)
+        for(int i = 0; i < n; ++i)
+            if(parsecmd(str[i]) == RET_CMDNOTFOUND) ++notfound;
+    uint64_t c1 = ticks();
+    double t1 = nsnow(), calls = (double)N * n;
+    printf("%-8s: %.1f ns", name, (t1 - t0) / calls);
+    if(c1 != c0) printf(", %.1f TSC ticks", (c1 - c0) / calls);
+    printf(" per command\n");
+    return notfound;
 }
-// these functions should be global to substitute weak aliases
-int fn_esw(uint32_t hash,  char *args){return withparno(hash, args);}
-int fn_goto(uint32_t hash,  char *args){return withparno(hash, args);}
-int fn_pos(uint32_t hash,  char *args){return withparno(hash, args);}
-int fn_stop(uint32_t hash,  char *args){return withparno(hash, args);}
-int fn_voltage(uint32_t hash,  char *args){return withparno(hash, args);}
-int fn_reboot(uint32_t hash,  _U_ char *args){return noargs(hash);}
-int fn_time(uint32_t hash,  _U_ char *args){return noargs(hash);}
-int fn_temp(uint32_t hash,  _U_ char *args){return noargs(hash);}
 
 int main(int argc, char **argv){
-    if(argc != 2) return 1;
-    int ret = parsecmd(argv[1]);
-    switch(ret){
-        case RET_CMDNOTFOUND: printf("'%s' not found\n", argv[1]); break;
-        case RET_WRONGCMD: printf("Wrong sintax of '%s'\n", argv[1]); break;
-        case RET_GOOD: printf("'%s' - OK\n", argv[1]); break;
-        default: printf("'%s' - bad\n", argv[1]);
+    const char *dic = (argc > 1) ? argv[1] : "testdic";
+    long N = (argc > 2) ? atol(argv[2]) : 200000;
+    FILE *f = fopen(dic, "r");
+    if(!f){ perror(dic); return 1; }
+    char w[256];
+    while(nwords < MAXWORDS && fscanf(f, "%255s", w) == 1){
+        if(strlen(w) > CMD_MAXLEN) continue;
+        // command with parameter and setter like "relpos0=1000"
+        snprintf(words[nwords], sizeof(words[0]), "%s0=1000", w);
+        // unknown word: last letter changed
+        size_t l = strlen(w);
+        w[l - 1] = (w[l - 1] == 'z') ? 'a' : w[l - 1] + 1;
+        snprintf(bad[nwords], sizeof(bad[0]), "%s0=1000", w);
+        ++nwords;
     }
+    fclose(f);
+    if(!nwords){ fprintf(stderr, "Empty dictionary\n"); return 1; }
+#ifdef SWITCHHDR
+    printf("switch dispatch, ");
+#else
+    printf("perfect hash dispatch, ");
+#endif
+    printf("%d commands, %ld iterations\n", nwords, N);
+    long nf = bench(words, nwords, N, "known");
+    if(nf){ printf("FAIL: %ld known commands not found\n", nf / N); return 1; }
+    // mutated word could occasionally be a command too
+    nf = bench(bad, nwords, N, "unknown");
+    if(nf < (long)(nwords - 1) * N){ printf("FAIL: unknown commands found\n"); return 1; }
+    printf("OK\n");
     return 0;
 }
@@ -0,0 +1,310 @@
+/*
+ * This file is part of the multistepper project.
+ * Copyright 2023 Edward V. Emelianov <edward.emelianoff@gmail.com>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#include "buttons.h"
+#include "flash.h"
+#include "hdr.h"
+#include "macro.h"
+#include "proto.h"
+#include "steppers.h"
+
+static macro_store macros;
+
+static int8_t running = -1;     // macro running now
+static uint8_t curstep;         // its current step
+static uint8_t stepstarted;     // current step (delay) is started
+static uint32_t Tstep;          // time of step start
+static int8_t lastmacro = -1;   // last finished or aborted macro
+static uint8_t laststep;        // its step (== nsteps if finished normally)
+static errcodes lasterr = ERR_OK; // error of aborted step
+
+static void clearall(){
+    memset(&macros, 0, sizeof(macros));
+    macros.magick = MACRO_MAGICK;
+    macros.size = sizeof(macro_store);
+    for(int i = 0; i < BTNSNO; ++i) macros.button[i] = -1;
+}
+
+// read macros from flash
+void macro_init(){
+    uint32_t sz;
+    const macro_store *m = (const macro_store*)macro_storage(&sz);
+    if(m && sz >= sizeof(macro_store) && m->magick == MACRO_MAGICK && m->size == sizeof(macro_store))
+        memcpy(&macros, m, sizeof(macro_store));
+    else clearall();
+}
+
+/**
+ * @brief macro_run - start macro (or stop current)
+ * @param n - macro number (<0 to stop running)
+ * @return ERR_OK if started
+ */
+errcodes macro_run(int32_t n){
+    if(n < 0){
+        if(running > -1){
+            lastmacro = running;
+            laststep = curstep;
+            lasterr = ERR_CANTRUN;
+        }
+        running = -1;
+        return ERR_OK;
+    }
+    if(n >= MACRO_NO) return ERR_BADVAL;
+    if(!macros.nsteps[n] || running > -1) return ERR_CANTRUN;
+    running = (int8_t)n;
+    curstep = 0;
+    stepstarted = 0;
+    return ERR_OK;
+}
+
+// @return number of running macro or -1
+int32_t macro_running(){
+    return running;
+}
+
+static void finish(errcodes e){
+    lastmacro = running;
+    laststep = curstep;
+    lasterr = e;
+    running = -1;
+}
+
+// run current step; @return TRUE if it's done
+static int runstep(const macro_step *s){
+    int32_t val = s->val;
+    stp_state st;
+    switch(s->op){
+        case MOP_CMD:
+            if(s->cmd >= CCMD_AMOUNT){
+                finish(ERR_BADCMD);
+                return FALSE;
+            }
+            errcodes e = runcmd(&cancmdlist[s->cmd], s->par, &val);
+            if(e != ERR_OK){
+                finish(e);
+                return FALSE;
+            }
+        break;
+        case MOP_WAIT:
+            st = getmotstate(s->par);
+            if(st == (stp_state)s->val && !motor_homing(s->par)) break;
+            if(st == STP_ERR || (st == STP_STALL && s->val != STP_STALL)) finish(ERR_CANTRUN);
+            return FALSE;
+        break;
+        case MOP_DELAY:
+            if(!stepstarted){
+                stepstarted = 1;
+                Tstep = Tms;
+            }
+            if(Tms - Tstep < (uint32_t)val) return FALSE;
+        break;
+        default:
+            finish(ERR_BADCMD);
+            return FALSE;
+    }
+    stepstarted = 0;
+    return TRUE;
+}
+
+// check buttons and run steps of current macro until first waiting step (call it from main loop)
+void macro_process(){
+    static keyevent oldevt[BTNSNO] = {0};
+    for(int i = 0; i < BTNSNO; ++i){
+        keyevent e = keyevt(i);
+        if(e == EVT_PRESS && oldevt[i] != EVT_PRESS && macros.button[i] > -1 && running < 0)
+            macro_run(macros.button[i]);
+        oldevt[i] = e;
+    }
+    while(running > -1){
+        if(curstep >= macros.nsteps[running]){
+            finish(ERR_OK);
+            break;
+        }
+        if(!runstep(&macros.steps[running][curstep])) break;
+        ++curstep;
+    }
+}
+
+// find common command by its name; @return CCMD_NONE if not found
+static uint16_t cmdbyname(const char *name){
+    for(uint16_t i = 1; i < CCMD_AMOUNT; ++i)
+        if(cancmds[i] && 0 == strcmp(cancmds[i], name)) return i;
+    return CCMD_NONE;
+}
+
+/**
+ * @brief parsestep - convert text like "relpos0=1000", "wait0", "delay=100" into macro step
+ * @param str - text
+ * @param s (o) - step
+ * @return pointer to next symbol after step or NULL if error
+ */
+static const char *parsestep(const char *str, macro_step *s){
+    char name[CMD_MAXLEN + 1];
+    int l = 0;
+    str = omit_spaces(str);
+    while(*str >= 'a' && *str <= 'z' && l < CMD_MAXLEN) name[l++] = *str++;
+    name[l] = 0;
+    if(!l) return NULL;
+    uint32_t N;
+    s->par = CANMESG_NOPAR;
+    s->val = 0;
+    const char *nxt = getnum(str, &N);
+    if(nxt != str){
+        if(N >= CANMESG_NOPAR) return NULL;
+        s->par = (uint8_t)N;
+    }
+    str = omit_spaces(nxt);
+    if(*str == '='){
+        ++str;
+        nxt = getint(str, &s->val);
+        if(nxt == str) return NULL;
+        s->par |= SETTERFLAG;
+        str = nxt;
+    }
+    s->cmd = CCMD_NONE;
+    if(0 == strcmp(name, "wait")){ // waitN[=state]
+        if(PARBASE(s->par) >= MOTORSNO) return NULL;
+        if(!ISSETTER(s->par)) s->val = STP_RELAX;
+        else if(s->val < 0 || s->val >= STP_STATE_AMOUNT) return NULL;
+        s->op = MOP_WAIT;
+        s->par = PARBASE(s->par);
+    }else if(0 == strcmp(name, "delay")){ // delay=ms
+        if(!ISSETTER(s->par) || s->val < 0) return NULL;
+        s->op = MOP_DELAY;
+    }else{
+        s->cmd = cmdbyname(name);
+        if(s->cmd == CCMD_NONE || !cancmdlist[s->cmd].fn) return NULL;
+        s->op = MOP_CMD;
+    }
+    return omit_spaces(str);
+}
+
+static void printstep(const macro_step *s){
+    switch(s->op){
+        case MOP_CMD:
+            USB_sendstr(cancmds[s->cmd]);
+        break;
+        case MOP_WAIT:
+            USB_sendstr("wait"); printu(s->par);
+            if(s->val != STP_RELAX){ USB_putbyte('='); printi(s->val); }
+            return;
+        break;
+        case MOP_DELAY:
+            USB_sendstr("delay");
+        break;
+        default:
+            USB_sendstr("??");
+            return;
+    }
+    if(PARBASE(s->par) != CANMESG_NOPAR) printu(PARBASE(s->par));
+    if(ISSETTER(s->par)){ USB_putbyte('='); printi(s->val); }
+}
+
+static void printmacro(int n){
+    USB_sendstr("mdef"); printu(n); USB_putbyte('=');
+    if(macros.name[n][0]){ USB_sendstr(macros.name[n]); USB_sendstr(": "); }
+    for(int i = 0; i < macros.nsteps[n]; ++i){
+        if(i) USB_sendstr("; ");
+        printstep(&macros.steps[n][i]);
+    }
+    newline();
+}
+
+// mdefN=[name:] step; step; ... - define macro N (clear it if there's no steps)
+int fn_mdef(uint32_t _U_ hash, char *args){ // "mdef" (4037281)
+    uint32_t N;
+    const char *nxt = getnum(args, &N);
+    if(nxt == args || N >= MACRO_NO) return RET_WRONGCMD;
+    nxt = omit_spaces(nxt);
+    if(*nxt != '='){ // getter
+        printmacro(N);
+        return RET_GOOD;
+    }
+    if(running == (int8_t)N) return RET_BAD;
+    static macro_step steps[MACRO_STEPS];
+    char name[MACRO_NAMELEN] = {0};
+    nxt = omit_spaces(nxt + 1);
+    const char *colon = strchr(nxt, ':');
+    if(colon){
+        int l = colon - nxt;
+        if(l >= MACRO_NAMELEN) return RET_WRONGCMD;
+        memcpy(name, nxt, l);
+        while(l && name[l-1] <= ' ') name[--l] = 0;
+        nxt = colon + 1;
+    }
+    int n = 0;
+    nxt = omit_spaces(nxt);
+    while(*nxt){
+        if(n == MACRO_STEPS){
+            USB_sendstr("Max "); printu(MACRO_STEPS); USND(" steps");
+            return RET_BAD;
+        }
+        const char *e = parsestep(nxt, &steps[n]);
+        if(!e || (*e && *e != ';')){
+            USB_sendstr("Bad step "); printu(n); newline();
+            return RET_WRONGCMD;
+        }
+        ++n;
+        nxt = omit_spaces(*e ? e + 1 : e);
+    }
+    memcpy(macros.name[N], name, MACRO_NAMELEN);
+    memcpy(macros.steps[N], steps, n * sizeof(macro_step));
+    macros.nsteps[N] = (uint8_t)n;
+    printmacro(N);
+    return RET_GOOD;
+}
+
+// mbtnN=M - run macro M by press of button N (M<0 - none)
+int fn_mbtn(uint32_t _U_ hash, char *args){ // "mbtn" (4005942)
+    uint32_t N;
+    int32_t M;
+    const char *nxt = getnum(args, &N);
+    if(nxt == args || N >= BTNSNO) return RET_WRONGCMD;
+    nxt = omit_spaces(nxt);
+    if(*nxt == '='){
+        ++nxt;
+        if(getint(nxt, &M) == nxt || M >= MACRO_NO) return RET_WRONGCMD;
+        macros.button[N] = (M < 0) ? -1 : (int8_t)M;
+    }
+    USB_sendstr("mbtn"); printu(N); USB_putbyte('='); printi(macros.button[N]); newline();
+    return RET_GOOD;
+}
+
+// mlist - list all macros and state of running
+int fn_mlist(uint32_t _U_ hash, char _U_ *args){ // "mlist" (538051118)
+    for(int i = 0; i < MACRO_NO; ++i) if(macros.nsteps[i]) printmacro(i);
+    for(int i = 0; i < BTNSNO; ++i) if(macros.button[i] > -1){
+        USB_sendstr("mbtn"); printu(i); USB_putbyte('='); printi(macros.button[i]); newline();
+    }
+    USB_sendstr("running="); printi(running);
+    if(running > -1){ USB_sendstr(", step="); printu(curstep); }
+    newline();
+    if(lastmacro > -1){
+        USB_sendstr("last="); printi(lastmacro); USB_sendstr(", step="); printu(laststep);
+        USB_sendstr(", err="); printu(lasterr); newline();
+    }
+    return RET_GOOD;
+}
+
+// msave - store macros in flash
+int fn_msave(uint32_t _U_ hash, char _U_ *args){ // "msave" (552945185)
+    if(macro_save(&macros, sizeof(macros))) return RET_BAD;
+    return RET_GOOD;
+}
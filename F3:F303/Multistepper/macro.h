@@ -0,0 +1,62 @@
+/*
+ * This file is part of the multistepper project.
+ * Copyright 2023 Edward V. Emelianov <edward.emelianoff@gmail.com>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "commonproto.h"
+#include "hardware.h"
+
+// amount of macros
+#define MACRO_NO            (8)
+// max amount of steps in one macro
+#define MACRO_STEPS         (24)
+// max length of macro name (with trailing zero)
+#define MACRO_NAMELEN       (12)
+// "magick number" of stored macros
+#define MACRO_MAGICK        (0x4D43)
+
+// operations of macro step
+enum{
+    MOP_CMD,        // run common command `cmd` (as CAN does) with `par` and `val`
+    MOP_WAIT,       // wait while motor `par` gets state `val` (and isn't finding zero)
+    MOP_DELAY,      // wait `val` ms
+    MOP_AMOUNT
+};
+
+typedef struct{
+    uint8_t op;     // MOP_xx
+    uint8_t par;    // parameter (as in CAN commands: motor number | SETTERFLAG)
+    uint16_t cmd;   // CCMD_xx
+    int32_t val;    // value
+} macro_step;
+
+// macros storage (the same in RAM and flash)
+typedef struct __attribute__((aligned(4))){
+    uint16_t magick;                            // MACRO_MAGICK
+    uint16_t size;                              // sizeof(macro_store)
+    int8_t button[BTNSNO];                      // macro to run by button press (-1 - none)
+    uint8_t nsteps[MACRO_NO];                   // amount of steps in each macro
+    char name[MACRO_NO][MACRO_NAMELEN];         // macro names (could be empty)
+    macro_step steps[MACRO_NO][MACRO_STEPS];    // macros
+} macro_store;
+
+void macro_init();
+void macro_process();
+errcodes macro_run(int32_t n);
+int32_t macro_running();
@@ -17,13 +17,16 @@
  */
 
 #include "adc.h"
+#include "binproto.h"
 #include "buttons.h"
 #include "can.h"
 #include "flash.h"
 #include "hardware.h"
+#include "macro.h"
 #include "pdnuart.h"
 #include "proto.h"
 #include "steppers.h"
+#include "telemetry.h"
 #include "usb.h"
 
 #define MAXSTRLEN    RBINSZ
@@ -44,6 +47,7 @@ int main(void){
     }
     USBPU_OFF(); // make a reconnection
     flashstorage_init();
+    macro_init();
     hw_setup(); // GPIO, ADC, timers, watchdog etc.
     init_steppers();
     USB_setup();
@@ -62,6 +66,10 @@ int main(void){
         CAN_proc();
         USB_proc();
         process_steppers();
+        pdnuart_process();
+        telemetry_process();
+        flash_process();
+        macro_process();
         if(CAN_get_status() == CAN_FIFO_OVERRUN){
             USB_sendstr("CAN bus fifo overrun occured!\n");
         }
@@ -81,11 +89,13 @@ int main(void){
                 }
             }
         }
-        int l = USB_receivestr(inbuff, MAXSTRLEN);
-        if(l < 0) USB_sendstr("ERROR: USB buffer overflow or string was too long\n");
-        else if(l){
-            const char *ans = cmd_parser(inbuff);
-            if(ans) USB_sendstr(ans);
+        if(!binproto_process()){
+            int l = USB_receivestr(inbuff, MAXSTRLEN);
+            if(l < 0) USB_sendstr("ERROR: USB buffer overflow or string was too long\n");
+            else if(l){
+                const char *ans = cmd_parser(inbuff);
+                if(ans) USB_sendstr(ans);
+            }
         }
         process_keys();
     }
@@ -20,125 +20,396 @@
 
 #include "flash.h"
 #include "hardware.h"
+#include "pdnuart.h"
 #include "proto.h"
 #include "tmc2209.h"
 
 extern volatile uint32_t Tms;
 static uint8_t motorno = 0;
 
-#define MAXBUFLEN           (8)
-// timeout, milliseconds
+// datagrams: write - 8 bytes, read request - 4 bytes, answer - 8 bytes
+#define WRBUFLEN            (8)
+#define RDRQLEN             (4)
+// Rx buffer: echo of Tx (single wire) + answer
+#define MAXBUFLEN           (RDRQLEN + 8)
+// timeout of one transaction, milliseconds
 #define PDNU_TMOUT          (5)
+// queue length for each USART (should be power of 2)
+#define PDNQ_LEN            (16)
+#define PDNQ_MASK           (PDNQ_LEN - 1)
 
-// buffers format: 0 - sync+reserved, 1 - address (0..3 - slave, 0xff - master)
-//      2 - register<<1 | RW, 3 - CRC (r) or [ 3..6 - MSB data, 7 - CRC ]
-// buf[0] - USART2, buf[1] - USART3
-//static uint8_t notfound = 0; // not found mask (LSB - 0, MSB - 7)
+// queue entry flags
+#define PDNQ_WRITE          (1<<0)  // write register (or read if not set)
+#define PDNQ_COMPOSE        (1<<1)  // compose data to write from shadow registers just before sending
+#define PDNQ_USER           (1<<2)  // store result into `userrq`
+
+typedef struct{
+    uint8_t motno;      // motor number (0..7)
+    uint8_t reg;        // register address
+    uint8_t flags;      // PDNQ_xx
+    uint32_t data;      // data to write
+} pdnq_entry;
+
+// UART states
+typedef enum{
+    PDU_IDLE,
+    PDU_BUSY,           // transaction in progress
+    PDU_READY           // Rx DMA done, need to parse data
+} pdnuart_state;
+
+typedef struct{
+    pdnq_entry q[PDNQ_LEN];
+    uint8_t head;       // first entry to send
+    uint8_t tail;       // first free entry
+    uint8_t nrx;        // amount of bytes to receive in current transaction
+    volatile pdnuart_state state;
+    uint32_t Tstart;    // transaction start time
+    uint8_t outbuf[WRBUFLEN];
+    uint8_t inbuf[MAXBUFLEN];
+} pdnbus;
+
+// buses: [0] - USART2 (motors 0..3), [1] - USART3 (motors 4..7)
+static pdnbus bus[2] = {0};
+
+// result of user request (blocking pdnuart_readreg)
+static struct{
+    volatile uint8_t busy;  // 1 while waiting for answer
+    uint8_t ok;             // 1 if answer is good
+    uint32_t data;
+} userrq = {0};
+
+// cached registers & statistics
+static pdnstatus_t drvstat[MOTORSNO] = {0};
+
+// shadow copies of configuration registers
+static uint32_t gconf[MOTORSNO], chopconf[MOTORSNO];
+static uint8_t haveshadow[MOTORSNO] = {0}; // bit0 - GCONF, bit1 - CHOPCONF, bit2 - IFCNT were read from driver
+// last IFCNT value and amount of writes sent after it was read
+static uint8_t ifcnt[MOTORSNO], wrsent[MOTORSNO];
+// drivers waiting for full (re)initialization (when queue will have enough space)
+static uint8_t initpending[MOTORSNO] = {0};
+
+// default values after reset
+#define GCONF_DEFAULT       (0x00000041)
+#define CHOPCONF_DEFAULT    (0x10000053)
+#define IHOLD_IRUN_DEFAULT  (0x00011F10)
 
 // datalen == 3 for read request or 7 for writing
-static void calcCRC(uint8_t *outbuf, int datalen){
+static uint8_t calcCRC(const uint8_t *buf, int datalen){
     uint8_t crc = 0;
     for(int i = 0; i < datalen; ++i){
-        uint8_t currentByte = outbuf[i];
+        uint8_t currentByte = buf[i];
         for(int j = 0; j < 8; ++j){
             if((crc >> 7) ^ (currentByte & 0x01)) crc = (crc << 1) ^ 0x07;
             else crc <<= 1;
             currentByte = currentByte >> 1;
         }
     }
-    outbuf[datalen] = crc;
+    return crc;
 }
 
+static volatile DMA_Channel_TypeDef *TxDMA[2] = {DMA1_Channel7, DMA1_Channel2};
+static volatile DMA_Channel_TypeDef *RxDMA[2] = {DMA1_Channel6, DMA1_Channel3};
 static volatile USART_TypeDef *USART[2] = {USART2, USART3};
 
 static void setup_usart(int no){
     USART[no]->ICR = 0xffffffff; // clear all flags
+    TxDMA[no]->CCR = 0;
+    TxDMA[no]->CPAR = (uint32_t) &USART[no]->TDR; // periph
+    TxDMA[no]->CMAR = (uint32_t) bus[no].outbuf;
+    TxDMA[no]->CCR = DMA_CCR_MINC | DMA_CCR_DIR; // 8bit, mem++, mem->per
+    RxDMA[no]->CCR = 0;
+    RxDMA[no]->CPAR = (uint32_t) &USART[no]->RDR; // periph
+    RxDMA[no]->CMAR = (uint32_t) bus[no].inbuf;
+    RxDMA[no]->CCR = DMA_CCR_MINC | DMA_CCR_TCIE; // 8bit, mem++, per->mem, transcompl irq
     USART[no]->BRR = 72000000 / 256000; // 256 kbaud
-    USART[no]->CR3 = USART_CR3_HDSEL; // enable DMA Tx/Rx, single wire
+    // enable DMA Tx/Rx, single wire, don't stop on overrun
+    USART[no]->CR3 = USART_CR3_DMAT | USART_CR3_DMAR | USART_CR3_HDSEL | USART_CR3_OVRDIS;
     USART[no]->CR1 = USART_CR1_TE | USART_CR1_RE | USART_CR1_UE; // 1start,8data,nstop; enable Rx,Tx,USART
     uint32_t tmout = 16000000;
     while(!(USART[no]->ISR & USART_ISR_TC)){if(--tmout == 0) break;} // polling idle frame Transmission
     USART[no]->ICR = 0xffffffff; // clear all flags again
 }
 
-// USART2 (ch0..3), USART3 (ch4..7)
+// USART2 (ch0..3): DMA1ch6 (Rx), DMA1_ch7 (Tx)
+// USART3 (ch4..7): DMA1ch3 (Rx), DMA1_ch2 (Tx)
 // pins are setting up in `hardware.c`
 void pdnuart_setup(){
     RCC->APB1ENR |= RCC_APB1ENR_USART2EN | RCC_APB1ENR_USART3EN;
+    RCC->AHBENR |= RCC_AHBENR_DMA1EN;
     setup_usart(0);
     setup_usart(1);
+    NVIC_EnableIRQ(DMA1_Channel3_IRQn);
+    NVIC_EnableIRQ(DMA1_Channel6_IRQn);
+    for(int i = 0; i < MOTORSNO; ++i) drvstat[i].notfound = 1; // until first answer
 }
 
-static int rwreg(uint8_t reg, uint32_t data, int w){
-    if(motorno >= MOTORSNO || reg & 0x80) return FALSE;
-    uint32_t x = Tms;
-    while(Tms - x < 1);
-    int no = motorno >> 2;
-    uint8_t outbuf[MAXBUFLEN];
-    outbuf[0] = 0x05;
-    outbuf[1] = motorno - (no << 2);
-    outbuf[2] = reg;
-    int nbytes = 3;
-    if(w){
-        outbuf[2] |= 0x80;
+// amount of free entries in queue
+TRUE_INLINE int qfree(pdnbus *b){
+    return PDNQ_LEN - 1 - ((b->tail - b->head) & PDNQ_MASK);
+}
+
+// put new transaction into queue; @return FALSE if queue is full
+static int enqueue(uint8_t no, uint8_t reg, uint32_t data, uint8_t flags){
+    if(no >= MOTORSNO || reg & 0x80) return FALSE;
+    pdnbus *b = &bus[no >> 2];
+    if(qfree(b) < 1){
+        ++drvstat[no].qoverflows;
+        return FALSE;
+    }
+    pdnq_entry *e = &b->q[b->tail];
+    e->motno = no;
+    e->reg = reg;
+    e->flags = flags;
+    e->data = data;
+    b->tail = (b->tail + 1) & PDNQ_MASK;
+    return TRUE;
+}
+
+// compose value of configuration register from shadow copy and current settings
+static uint32_t composereg(uint8_t no, uint8_t reg){
+    switch(reg){
+        case TMC2209Reg_GCONF:{
+            TMC2209_gconf_reg_t r = {.value = gconf[no]};
+            r.pdn_disable = 1; // PDN now is UART
+            r.mstep_reg_select = 1; // microsteps are by MSTEP
+            return gconf[no] = r.value;
+        }
+        case TMC2209Reg_CHOPCONF:{
+            TMC2209_chopconf_reg_t r = {.value = chopconf[no]};
+            uint16_t m = the_conf.microsteps[no];
+            if(m >= 256) r.mres = 0;
+            else r.mres = 8 - MSB(m);
+            return chopconf[no] = r.value;
+        }
+        case TMC2209Reg_IHOLD_IRUN:{ // write-only register
+            TMC2209_ihold_irun_reg_t r = {.value = IHOLD_IRUN_DEFAULT};
+            r.irun = the_conf.motcurrent[no];
+            return r.value;
+        }
+        case TMC2209Reg_SGTHRS:{ // write-only register
+            TMC2209_sgthrs_reg_t r = {.value = 0};
+            r.threshold = the_conf.sgthrs[no];
+            return r.value;
+        }
+        case TMC2209Reg_TCOOLTHRS:{ // enable StallGuard DIAG output at any speed (speed is checked by `steppers.c`)
+            TMC2209_tcoolthrs_reg_t r = {.value = 0};
+            if(the_conf.sgthrs[no]) r.tcoolthrs = 0xFFFFF;
+            return r.value;
+        }
+        default:
+        break;
+    }
+    return 0;
+}
+
+// start next transaction from queue
+static void startnext(int n){
+    pdnbus *b = &bus[n];
+    if(b->state != PDU_IDLE || b->head == b->tail) return;
+    pdnq_entry *e = &b->q[b->head];
+    uint8_t *o = b->outbuf;
+    o[0] = 0x05;
+    o[1] = e->motno & 3;
+    o[2] = e->reg;
+    int nbytes = RDRQLEN - 1;
+    if(e->flags & PDNQ_WRITE){
+        uint32_t data = (e->flags & PDNQ_COMPOSE) ? composereg(e->motno, e->reg) : e->data;
+        o[2] |= 0x80;
         for(int i = 6; i > 2; --i){
-            outbuf[i] = data & 0xff;
+            o[i] = data & 0xff;
             data >>= 8;
         }
-        nbytes = 7;
-    }
-    calcCRC(outbuf, nbytes);
+        nbytes = WRBUFLEN - 1;
+        b->nrx = WRBUFLEN; // only echo
+    }else b->nrx = MAXBUFLEN; // echo + answer
+    o[nbytes] = calcCRC(o, nbytes);
     ++nbytes;
-    for(int i = 0; i < nbytes; ++i){
-        USB_sendstr("Send byte "); USB_putbyte('0'+i); USB_sendstr(": "); printuhex(outbuf[i]); newline();
-        USART[no]->TDR = outbuf[i]; // transmit
-        while(!(USART[no]->ISR & USART_ISR_TXE));
-        int l = 0;
-        for(; l < 10000; ++l) if(USART[no]->ISR & USART_ISR_RXNE) break;
-        if(l == 10000) USND("Nothing received");
-        else {USB_sendstr("Rcv: "); printuhex(USART[no]->RDR); newline();}
+    volatile USART_TypeDef *U = USART[n];
+    U->ICR = 0xffffffff;
+    (void) U->RDR; // flush garbage
+    // Rx first: we receive our own echo in single-wire mode
+    RxDMA[n]->CCR &= ~DMA_CCR_EN;
+    RxDMA[n]->CNDTR = b->nrx;
+    RxDMA[n]->CCR |= DMA_CCR_EN;
+    TxDMA[n]->CCR &= ~DMA_CCR_EN;
+    TxDMA[n]->CNDTR = nbytes;
+    b->Tstart = Tms;
+    b->state = PDU_BUSY;
+    TxDMA[n]->CCR |= DMA_CCR_EN; // start transmission
+}
+
+static void disableDMA(int n){
+    TxDMA[n]->CCR &= ~DMA_CCR_EN;
+    RxDMA[n]->CCR &= ~DMA_CCR_EN;
+}
+
+// finish current transaction: check answer and store data
+static void parseRx(int n){
+    pdnbus *b = &bus[n];
+    pdnq_entry *e = &b->q[b->head];
+    uint8_t no = e->motno;
+    pdnstatus_t *s = &drvstat[no];
+    int good = FALSE; // write gives only echo, so driver could be checked by read answer only
+    uint32_t data = 0;
+    if(e->flags & PDNQ_WRITE) ++wrsent[no]; // will be checked by IFCNT
+    else{ // check answer
+        const uint8_t *a = &b->inbuf[RDRQLEN];
+        if(a[0] != 0x05 || a[1] != 0xff || a[2] != e->reg || calcCRC(a, 7) != a[7]){
+            ++s->crcerrors;
+        }else{
+            good = TRUE;
+            for(int i = 3; i < 7; ++i){
+                data <<= 8;
+                data |= a[i];
+            }
+            switch(e->reg){
+                case TMC2209Reg_DRV_STATUS:
+                    s->drv_status = data;
+                    s->Tupd = Tms;
+                break;
+                case TMC2209Reg_SG_RESULT:
+                    s->sg_result = (uint16_t)data;
+                    s->Tupd = Tms;
+                break;
+                case TMC2209Reg_GCONF:
+                    gconf[no] = data;
+                    haveshadow[no] |= 1;
+                break;
+                case TMC2209Reg_CHOPCONF:
+                    chopconf[no] = data;
+                    haveshadow[no] |= 2;
+                break;
+                case TMC2209Reg_IFCNT: // driver counts good writes: reinit it if some were lost (or it was reset)
+                    if((haveshadow[no] & 4) && (uint8_t)(data - ifcnt[no]) != wrsent[no]){
+                        ++s->wrerrors;
+                        initpending[no] = 1;
+                    }
+                    ifcnt[no] = (uint8_t)data;
+                    wrsent[no] = 0;
+                    haveshadow[no] |= 4;
+                break;
+                default:
+                break;
+            }
+        }
+    }
+    if(good) s->notfound = 0;
+    if(e->flags & PDNQ_USER){
+        userrq.ok = good;
+        userrq.data = data;
+        userrq.busy = 0;
     }
+    b->head = (b->head + 1) & PDNQ_MASK;
+}
+
+// transaction timed out: mark driver as absent and drop request
+static void droptransaction(int n){
+    pdnbus *b = &bus[n];
+    pdnq_entry *e = &b->q[b->head];
+    disableDMA(n);
+    drvstat[e->motno].notfound = 1;
+    ++drvstat[e->motno].timeouts;
+    if(e->flags & PDNQ_USER){
+        userrq.ok = FALSE;
+        userrq.busy = 0;
+    }
+    b->head = (b->head + 1) & PDNQ_MASK;
+}
+
+// init driver number `no`: read configuration (once) and write new
+// @return FALSE if there's no enough space in queue
+static int initdriver(uint8_t no){
+    pdnbus *b = &bus[no >> 2];
+    if(!(haveshadow[no] & 3)){ // first run: read current configuration and writes counter
+        if(qfree(b) < 9) return FALSE;
+        gconf[no] = GCONF_DEFAULT;
+        chopconf[no] = CHOPCONF_DEFAULT;
+        enqueue(no, TMC2209Reg_IFCNT, 0, 0);
+        enqueue(no, TMC2209Reg_GCONF, 0, 0);
+        enqueue(no, TMC2209Reg_CHOPCONF, 0, 0);
+    }else if(qfree(b) < 6) return FALSE;
+    enqueue(no, TMC2209Reg_GCONF, 0, PDNQ_WRITE | PDNQ_COMPOSE);
+    enqueue(no, TMC2209Reg_CHOPCONF, 0, PDNQ_WRITE | PDNQ_COMPOSE);
+    enqueue(no, TMC2209Reg_IHOLD_IRUN, 0, PDNQ_WRITE | PDNQ_COMPOSE);
+    enqueue(no, TMC2209Reg_TCOOLTHRS, 0, PDNQ_WRITE | PDNQ_COMPOSE);
+    enqueue(no, TMC2209Reg_SGTHRS, 0, PDNQ_WRITE | PDNQ_COMPOSE);
+    enqueue(no, TMC2209Reg_IFCNT, 0, 0);
     return TRUE;
 }
 
-// return FALSE if failed
-int pdnuart_writereg(uint8_t reg, uint32_t data){
-    return rwreg(reg, data, 1);
+// poll DRV_STATUS and SG_RESULT of all UART drivers when queues are empty
+static void pollstatus(){
+    static uint32_t Tlast = 0;
+    if(Tms - Tlast < PDNU_POLLINTERVAL) return;
+    Tlast = Tms;
+    for(int i = 0; i < MOTORSNO; ++i){
+        if(the_conf.motflags[i].drvtype != DRVTYPE_UART) continue;
+        pdnbus *b = &bus[i >> 2];
+        if(qfree(b) < PDNQ_LEN/2) continue; // configuration transactions have priority
+        enqueue(i, TMC2209Reg_DRV_STATUS, 0, 0);
+        enqueue(i, TMC2209Reg_SG_RESULT, 0, 0);
+    }
 }
 
-// return FALSE if failed
-int pdnuart_readreg(uint8_t reg, uint32_t *data){
-    if(!rwreg(reg, 0, 0)) return FALSE;
-    uint32_t Tstart = Tms;
-    uint8_t buf[8];
-    int no = motorno >> 2;
-    for(int i = 0; i < 8; ++i){
-        while(!(USART[no]->ISR & USART_ISR_RXNE))
-            if(Tms - Tstart > PDNU_TMOUT) return FALSE;
-        buf[i] = USART[no]->RDR;
-        USB_sendstr("byte: "); printuhex(buf[i]); newline();
+/**
+ * @brief pdnuart_process - PDN-UART transactions processing (in main loop)
+ */
+void pdnuart_process(){
+    for(int i = 0; i < MOTORSNO; ++i){
+        if(initpending[i] && initdriver(i)) initpending[i] = 0;
     }
-    uint32_t o = 0;
-    for(int i = 3; i < 7; ++i){
-        o <<= 8;
-        o |= buf[i];
+    for(int i = 0; i < 2; ++i){
+        pdnbus *b = &bus[i];
+        switch(b->state){
+            case PDU_BUSY:
+                if(Tms - b->Tstart > PDNU_TMOUT){
+                    droptransaction(i);
+                    b->state = PDU_IDLE;
+                }
+            break;
+            case PDU_READY:
+                parseRx(i);
+                b->state = PDU_IDLE;
+            break;
+            default:
+            break;
+        }
+        startnext(i);
     }
-    *data = o;
-    return TRUE;
+    pollstatus();
 }
 
-static int readregister(uint8_t no, uint8_t reg, uint32_t *data){
-    int n = motorno; motorno = no;
-    int r = pdnuart_readreg(reg, data);
-    motorno = n;
-    return r;
+// write data into register of current motor; return FALSE if failed
+int pdnuart_writereg(uint8_t reg, uint32_t data){
+    if(!enqueue(motorno, reg, data, PDNQ_WRITE)) return FALSE;
+    enqueue(motorno, TMC2209Reg_IFCNT, 0, 0);
+    if(reg == TMC2209Reg_GCONF) gconf[motorno] = data;
+    else if(reg == TMC2209Reg_CHOPCONF) chopconf[motorno] = data;
+    return TRUE;
 }
 
-static int writeregister(uint8_t no, uint8_t reg, uint32_t data){
-    int n = motorno; motorno = no;
-    int r = pdnuart_writereg(reg, data);
-    motorno = n;
-    return r;
+// read register of current motor (wait for all transactions before it)
+// return FALSE if failed
+int pdnuart_readreg(uint8_t reg, uint32_t *data){
+    if(userrq.busy) return FALSE;
+    userrq.busy = 1;
+    if(!enqueue(motorno, reg, 0, PDNQ_USER)){
+        userrq.busy = 0;
+        return FALSE;
+    }
+    uint32_t Tstart = Tms;
+    while(userrq.busy){
+        IWDG->KR = IWDG_REFRESH;
+        pdnuart_process();
+        if(Tms - Tstart > PDNU_TMOUT * PDNQ_LEN){ // something really wrong
+            userrq.busy = 0;
+            return FALSE;
+        }
+    }
+    if(!userrq.ok) return FALSE;
+    *data = userrq.data;
+    return TRUE;
 }
 
 uint8_t pdnuart_getmotno(){
@@ -151,43 +422,60 @@ int pdnuart_setmotno(uint8_t no){
     return TRUE;
 }
 
-// write val into IHOLD_IRUN over UART to n'th motor
-int pdnuart_setcurrent(uint8_t no, uint8_t val){
-    TMC2209_ihold_irun_reg_t regval;
-    if(!readregister(no, TMC2209Reg_IHOLD_IRUN, &regval.value)) return FALSE;
-    regval.irun = val;
-    return writeregister(no, TMC2209Reg_IHOLD_IRUN, regval.value);
+// write motor current into IHOLD_IRUN over UART to n'th motor (value taken from the_conf)
+int pdnuart_setcurrent(uint8_t no, uint8_t _U_ val){
+    if(!enqueue(no, TMC2209Reg_IHOLD_IRUN, 0, PDNQ_WRITE | PDNQ_COMPOSE)) return FALSE;
+    enqueue(no, TMC2209Reg_IFCNT, 0, 0);
+    return TRUE;
 }
 
-// set microsteps over UART
+// set microsteps over UART (value taken from the_conf)
 int pdnuart_microsteps(uint8_t no, uint32_t val){
     if(val > 256) return FALSE;
-    TMC2209_chopconf_reg_t regval;
-    if(!readregister(no, TMC2209Reg_CHOPCONF, &regval.value)) return FALSE;
-    if(val == 256) regval.mres = 0;
-    else regval.mres = 8 - MSB(val);
-    return writeregister(no, TMC2209Reg_CHOPCONF, regval.value);
+    if(!enqueue(no, TMC2209Reg_CHOPCONF, 0, PDNQ_WRITE | PDNQ_COMPOSE)) return FALSE;
+    enqueue(no, TMC2209Reg_IFCNT, 0, 0);
+    return TRUE;
 }
 
-// init driver number `no`
+// (re)init driver: all transactions will be queued in `pdnuart_process` as soon as possible
 int pdnuart_init(uint8_t no){
-    TMC2209_gconf_reg_t gconf;
-    if(!readregister(no, TMC2209Reg_GCONF, &gconf.value)) return FALSE;
-    gconf.pdn_disable = 1; // PDN now is UART
-    gconf.mstep_reg_select = 1; // microsteps are by MSTEP
-    if(!writeregister(no, TMC2209Reg_GCONF, gconf.value)) return FALSE;
-    if(!pdnuart_microsteps(no, the_conf.microsteps[no])) return FALSE;
-    if(!pdnuart_setcurrent(no, the_conf.motcurrent[no])) return FALSE;
+    if(no >= MOTORSNO) return FALSE;
+    initpending[no] = 1;
     return TRUE;
 }
 
-/*
-static void parseRx(int no){
-    USB_sendstr("Got from ");
-    USB_putbyte('#'); printu(curslaveaddr[no] + no*4); USB_sendstr(": ");
-    for(int i = 0; i < 8; ++i){
-        printuhex(inbuf[no][i]); USB_putbyte(' ');
-    }
-    newline();
+// write StallGuard threshold and TCOOLTHRS (values taken from the_conf)
+int pdnuart_sgthrs(uint8_t no){
+    if(no >= MOTORSNO) return FALSE;
+    if(qfree(&bus[no >> 2]) < 3) return FALSE;
+    enqueue(no, TMC2209Reg_TCOOLTHRS, 0, PDNQ_WRITE | PDNQ_COMPOSE);
+    enqueue(no, TMC2209Reg_SGTHRS, 0, PDNQ_WRITE | PDNQ_COMPOSE);
+    enqueue(no, TMC2209Reg_IFCNT, 0, 0);
+    return TRUE;
+}
+
+/**
+ * @brief pdnuart_status - get cached DRV_STATUS, SG_RESULT and error counters
+ * @param no - motor number
+ * @return pointer to status or NULL if no is wrong
+ */
+const pdnstatus_t *pdnuart_status(uint8_t no){
+    if(no >= MOTORSNO) return NULL;
+    return &drvstat[no];
+}
+
+// USART3 Rx complete (echo + answer)
+void dma1_channel3_isr(){
+    DMA1_Channel3->CCR &= ~DMA_CCR_EN;
+    DMA1->IFCR = DMA_IFCR_CTCIF3;
+    DMA1_Channel2->CCR &= ~DMA_CCR_EN;
+    bus[1].state = PDU_READY;
+}
+
+// USART2 Rx complete (echo + answer)
+void dma1_channel6_isr(){
+    DMA1_Channel6->CCR &= ~DMA_CCR_EN;
+    DMA1->IFCR = DMA_IFCR_CTCIF6;
+    DMA1_Channel7->CCR &= ~DMA_CCR_EN;
+    bus[0].state = PDU_READY;
 }
-*/
@@ -20,7 +20,24 @@
 
 #include <stdint.h>
 
+// interval of DRV_STATUS/SG_RESULT polling, ms
+#define PDNU_POLLINTERVAL   (50)
+
+// cached driver status
+typedef struct{
+    uint32_t drv_status;    // last DRV_STATUS value
+    uint32_t Tupd;          // time of last update
+    uint16_t sg_result;     // last SG_RESULT value
+    uint16_t crcerrors;     // amount of bad answers
+    uint16_t timeouts;      // amount of timeouts
+    uint16_t qoverflows;    // amount of transactions lost due to full queue
+    uint16_t wrerrors;      // amount of times when IFCNT didn't confirm writes
+    uint8_t notfound;       // ==1 if there's no good answer to read request after timeout (or no answers at all)
+} pdnstatus_t;
+
 void pdnuart_setup();
+void pdnuart_process();
+const pdnstatus_t *pdnuart_status(uint8_t no);
 int pdnuart_writereg(uint8_t reg, uint32_t data);
 int pdnuart_readreg(uint8_t reg, uint32_t *data);
 int pdnuart_setmotno(uint8_t no);
@@ -28,3 +45,4 @@ uint8_t pdnuart_getmotno();
 int pdnuart_setcurrent(uint8_t no, uint8_t val);
 int pdnuart_microsteps(uint8_t no, uint32_t val);
 int pdnuart_init(uint8_t no);
+int pdnuart_sgthrs(uint8_t no);
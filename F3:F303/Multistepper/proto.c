@@ -416,7 +416,9 @@ static const char* motfl[MOTFLAGS_AMOUNT] = {
 static const char *eswfl[ESW_AMOUNT] = {
     [ESW_IGNORE] = "ignore end-switches",
     [ESW_ANYSTOP] = "stop @ esw in any moving direction",
-    [ESW_STOPMINUS] = "stop only when moving in given direction (e.g. to minus @ESW0)"
+    [ESW_STOPMINUS] = "stop only when moving in given direction (e.g. to minus @ESW0)",
+    [ESW_SGZERO] = "ignore end-switches, zero is where motor stalls moving to minus (StallGuard)",
+    [ESW_FASTZERO] = "like 2, but zero is latched by ESW0 interrupt at fast moving (no slow pass)"
 };
 int fn_dumpmotflags(uint32_t _U_ hash,  char _U_ *args){ // "dumpmotflags" (36159640)
     USB_sendstr("Motor flags:");
@@ -455,7 +457,7 @@ static const char* motstates[STP_STATE_AMOUNT] = {
     [STP_MOVE] = "moving",
     [STP_MVSLOW] = "moving at lowest speed",
     [STP_DECEL] = "deceleration",
-    [STP_STALL] = "stalled (not used here!)",
+    [STP_STALL] = "stalled (StallGuard)",
     [STP_ERR] = "error"
 };
 int fn_dumpstates(uint32_t _U_ hash,  char _U_ *args){ // "dumpstates" (4235564367)
@@ -484,37 +486,114 @@ int fn_canid(uint32_t _U_ hash, char *args){ // "canid" (2040257924)
     return RET_GOOD;
 }
 
+// commands absent in CAN protocol
+static const cmddesc_t cmd_gpioconf = {cu_gpioconf, NPAR_ANY, VAL_ANY};
+static const cmddesc_t cmd_screen = {cu_screen, NPAR_ANY, VAL_ANY};
+static const cmddesc_t cmd_tmcbus = {cu_tmcbus, NPAR_ANY, VAL_ANY};
+
+// commands common with CAN (indexes are given by hashgen's minimal perfect hash)
+static const cmddesc_t *const usbcmdlist[CMD_AMOUNT] = {
+    [CMDIDX_ABSPOS]      = &cancmdlist[CCMD_SETPOS],
+    [CMDIDX_ACCEL]       = &cancmdlist[CCMD_ACCEL],
+    [CMDIDX_DIAGN]       = &cancmdlist[CCMD_DIAGN],
+    [CMDIDX_DRVSTATUS]   = &cancmdlist[CCMD_DRVSTATUS],
+    [CMDIDX_DRVTYPE]     = &cancmdlist[CCMD_DRVTYPE],
+    [CMDIDX_EMSTOP]      = &cancmdlist[CCMD_EMERGSTOP],
+    [CMDIDX_ERASEFLASH]  = &cancmdlist[CCMD_ERASEFLASH],
+    [CMDIDX_ESW]         = &cancmdlist[CCMD_ESWSTATE],
+    [CMDIDX_ESWREACT]    = &cancmdlist[CCMD_ESWREACT],
+    [CMDIDX_GOTO]        = &cancmdlist[CCMD_ABSPOS],
+    [CMDIDX_GOTOZ]       = &cancmdlist[CCMD_GOTOZERO],
+    [CMDIDX_GPIO]        = &cancmdlist[CCMD_EXT],
+    [CMDIDX_GPIOCONF]    = &cmd_gpioconf,
+    [CMDIDX_MAXSPEED]    = &cancmdlist[CCMD_MAXSPEED],
+    [CMDIDX_MAXSTEPS]    = &cancmdlist[CCMD_MAXSTEPS],
+    [CMDIDX_MICROSTEPS]  = &cancmdlist[CCMD_MICROSTEPS],
+    [CMDIDX_MINSPEED]    = &cancmdlist[CCMD_MINSPEED],
+    [CMDIDX_MOTCURRENT]  = &cancmdlist[CCMD_MOTCURRENT],
+    [CMDIDX_MOTFLAGS]    = &cancmdlist[CCMD_MOTFLAGS],
+    [CMDIDX_MOTMUL]      = &cancmdlist[CCMD_MOTMUL],
+    [CMDIDX_MOTNO]       = &cancmdlist[CCMD_MOTNO],
+    [CMDIDX_MOTREINIT]   = &cancmdlist[CCMD_REINITMOTORS],
+    [CMDIDX_MRUN]        = &cancmdlist[CCMD_MACRO],
+    [CMDIDX_PDN]         = &cancmdlist[CCMD_PDN],
+    [CMDIDX_PING]        = &cancmdlist[CCMD_PING],
+    [CMDIDX_RELPOS]      = &cancmdlist[CCMD_RELPOS],
+    [CMDIDX_RELSLOW]     = &cancmdlist[CCMD_RELSLOW],
+    [CMDIDX_SAVECONF]    = &cancmdlist[CCMD_SAVECONF],
+    [CMDIDX_SCREEN]      = &cmd_screen,
+    [CMDIDX_SGRESULT]    = &cancmdlist[CCMD_SGRESULT],
+    [CMDIDX_SGTHRS]      = &cancmdlist[CCMD_SGTHRS],
+    [CMDIDX_SPEEDLIMIT]  = &cancmdlist[CCMD_SPEEDLIMIT],
+    [CMDIDX_STATE]       = &cancmdlist[CCMD_MOTORSTATE],
+    [CMDIDX_STOP]        = &cancmdlist[CCMD_STOP],
+    [CMDIDX_TELEMDEST]   = &cancmdlist[CCMD_TELEMDEST],
+    [CMDIDX_TELEMETRY]   = &cancmdlist[CCMD_TELEMETRY],
+    [CMDIDX_TMCBUS]      = &cmd_tmcbus,
+    [CMDIDX_UDATA]       = &cancmdlist[CCMD_UDATA],
+    [CMDIDX_USARTSTATUS] = &cancmdlist[CCMD_USARTSTATUS],
+    [CMDIDX_VDRIVE]      = &cancmdlist[CCMD_VDRIVE],
+    [CMDIDX_VFIVE]       = &cancmdlist[CCMD_VFIVE],
+};
+
+// print error of argument parsing
+static void parserr(const char *what, parse_err e, const argrange_t *r){
+    USB_sendstr(what);
+    switch(e){
+        case PARSE_OVERFLOW:
+            USB_sendstr(" overflow");
+        break;
+        case PARSE_PREC:
+            USB_sendstr(" has too much decimals");
+        break;
+        case PARSE_RANGE:
+            USB_sendstr(" should be in ["); printi(r->min);
+            USB_sendstr(", "); printi(r->max); USB_putbyte(']');
+        break;
+        default:
+            USB_sendstr(" isn't a number");
+        break;
+    }
+    newline();
+}
+
 
 static int canusb_function(uint32_t hash, char *args){
+    static const argrange_t parrange = {0, CANMESG_NOPAR - 1, 0};
     errcodes e = ERR_BADCMD;
-    uint32_t N;
     int32_t val = 0;
     uint8_t par = CANMESG_NOPAR;
     float f;
+    int idx = cmd_index(hash);
+    if(idx < 0) return RET_CMDNOTFOUND;
+    const cmddesc_t *c = usbcmdlist[idx];
     USB_sendstr("CMD: hash="); printu(hash); USB_sendstr(", args=");
     USND(args);
     if(*args){
-        const char *n = getnum(args, &N);
-        if(n != args){ // get parameter
-            if(N >= CANMESG_NOPAR){
-                USND("Wrong parameter value");
-                return RET_GOOD;
-            }
-            par = (uint8_t) N;
+        const char *n = args;
+        int32_t N;
+        parse_err pe = getarg(&n, &parrange, &N);
+        if(pe == PARSE_OK) par = (uint8_t) N;
+        else if(pe != PARSE_NONUM){
+            parserr("Parameter", pe, &parrange);
+            return RET_GOOD;
         }
         n = strchr(n, '=');
-        if(n){
+        if(n){ // setter: value is checked by range from command table
             ++n;
-            const char *nxt = getint(n, &val);
-            if(nxt != n){ // set setter flag
-                par |= SETTERFLAG;
+            const argrange_t *vr = c ? &c->val : NULL;
+            pe = getarg(&n, vr, &val);
+            if(pe != PARSE_OK){
+                parserr("Value", pe, vr);
+                return RET_GOOD;
             }
+            par |= SETTERFLAG;
         }
     }
     USB_sendstr("par="); printuhex(par);
     USB_sendstr(", val="); printi(val); newline();
-    switch(hash){
-        case CMD_ADC:
+    switch(idx){
+        case CMDIDX_ADC:
             par = PARBASE(par);
             if(par >= NUMBER_OF_ADC_CHANNELS){
                 USB_sendstr("Wrong channel number\n");
@@ -528,7 +607,7 @@ static int canusb_function(uint32_t hash, char *args){
             newline();
             return RET_GOOD;
         break;
-        case CMD_BUTTON:
+        case CMDIDX_BUTTON:
             e = cu_button(par, &val);
             if(val == CANMESG_NOPAR){
                 USB_sendstr("Wrong button number\n");
@@ -554,127 +633,22 @@ static int canusb_function(uint32_t hash, char *args){
             newline();
             return RET_GOOD;
         break;
-        case CMD_ESW:
-            e = cu_esw(par, &val);
-        break;
-        case CMD_ERASEFLASH:
-            e = cu_eraseflash(par, &val);
-        break;
-        case CMD_ACCEL:
-            e = cu_accel(par, &val);
-        break;
-        case CMD_ABSPOS:
-            e = cu_abspos(par, &val);
-        break;
-        case CMD_DIAGN:
-            e = cu_diagn(par, &val);
-        break;
-        case CMD_DRVTYPE:
-            e = cu_drvtype(par, &val);
-        break;
-        case CMD_EMSTOP:
-            e = cu_emstop(par, &val);
-        break;
-        case CMD_ESWREACT:
-            e = cu_eswreact(par, &val);
-        break;
-        case CMD_GOTO:
-            e = cu_goto(par, &val);
-        break;
-        case CMD_GOTOZ:
-            e = cu_gotoz(par, &val);
-        break;
-        case CMD_GPIO:
-            e = cu_gpio(par, &val);
-        break;
-        case CMD_GPIOCONF:
-            e = cu_gpioconf(par, &val);
-        break;
-        case CMD_MAXSPEED:
-            e = cu_maxspeed(par, &val);
-        break;
-        case CMD_MAXSTEPS:
-            e = cu_maxsteps(par, &val);
-        break;
-        case CMD_MCUT:
+        case CMDIDX_MCUT:
             f = getMCUtemp();
             USB_sendstr("T=");
             USB_sendstr(float2str(f, 1));
             newline();
             return RET_GOOD;
         break;
-        case CMD_MCUVDD:
+        case CMDIDX_MCUVDD:
             f = getVdd();
             USB_sendstr("VDD=");
             USB_sendstr(float2str(f, 1));
             newline();
             return RET_GOOD;
         break;
-        case CMD_MICROSTEPS:
-            e = cu_microsteps(par, &val);
-        break;
-        case CMD_MINSPEED:
-            e = cu_minspeed(par, &val);
-        break;
-        case CMD_MOTCURRENT:
-            e = cu_motcurrent(par, &val);
-        break;
-        case CMD_MOTFLAGS:
-            e = cu_motflags(par, &val);
-        break;
-        case CMD_MOTMUL:
-            e = cu_motmul(par, &val);
-        break;
-        case CMD_MOTNO:
-            e = cu_motno(par, &val);
-        break;
-        case CMD_MOTREINIT:
-            e = cu_motreinit(par, &val);
-        break;
-        case CMD_PDN:
-            e = cu_pdn(par, &val);
-        break;
-        case CMD_PING:
-            e = cu_ping(par, &val);
-        break;
-        case CMD_RELPOS:
-            e = cu_relpos(par, &val);
-        break;
-        case CMD_RELSLOW:
-            e = cu_relslow(par, &val);
-        break;
-        case CMD_SAVECONF:
-            e = cu_saveconf(par, &val);
-        break;
-        case CMD_SCREEN:
-            e = cu_screen(par, &val);
-        break;
-        case CMD_SPEEDLIMIT:
-            e = cu_speedlimit(par, &val);
-        break;
-        case CMD_STATE:
-            e = cu_state(par, &val);
-        break;
-        case CMD_STOP:
-            e = cu_stop(par, &val);
-        break;
-        case CMD_TMCBUS:
-            e = cu_tmcbus(par, &val);
-        break;
-        case CMD_UDATA:
-            e = cu_udata(par, &val);
-        break;
-        case CMD_USARTSTATUS:
-            e = cu_usartstatus(par, &val);
-        break;
-        case CMD_VDRIVE:
-            e = cu_vdrive(par, &val);
-        break;
-        case CMD_VFIVE:
-            e = cu_vfive(par, &val);
-        break;
         default:
-            e = ERR_BADCMD;
+            if(c) e = runcmd(c, par, &val);
             break;
     }
 
@@ -699,6 +673,7 @@ int fn_accel(uint32_t _U_ hash,  char _U_ *args) AL; //* "accel" (1490521981)
 int fn_adc(uint32_t _U_ hash,  char _U_ *args) AL; // "adc" (2963026093)
 int fn_button(uint32_t _U_ hash,  char _U_ *args) AL; // "button" (1093508897)
 int fn_diagn(uint32_t _U_ hash,  char _U_ *args) AL; //* "diagn" (2334137736)
+int fn_drvstatus(uint32_t _U_ hash,  char _U_ *args) AL; //* "drvstatus" (917747701)
 int fn_drvtype(uint32_t _U_ hash, char _U_ *args) AL; // "drvtype" (3930242451)
 int fn_emstop(uint32_t _U_ hash,  char _U_ *args) AL; //* "emstop" (2965919005)
 int fn_eraseflash(uint32_t _U_ hash,  char _U_ *args) AL; //* "eraseflash" (3177247267)
@@ -719,15 +694,20 @@ int fn_motflags(uint32_t _U_ hash,  char _U_ *args) AL; //* "motflags" (21536346
 int fn_motmul(uint32_t _U_ hash,  char _U_ *args) AL; //* "motmul" (1543400099)
 int fn_motno(uint32_t _U_ hash, char _U_ *args) AL; // "motno" (544673586)
 int fn_motreinit(uint32_t _U_ hash,  char _U_ *args) AL; //* "motreinit" (199682784)
+int fn_mrun(uint32_t _U_ hash, char _U_ *args) AL; // "mrun" (4272327)
 int fn_pdn(uint32_t _U_ hash, char _U_ *args) AL; // "pdn" (2963275719)
 int fn_ping(uint32_t _U_ hash,  char _U_ *args) AL; // "ping" (10561715)
 int fn_relpos(uint32_t _U_ hash,  char _U_ *args) AL; //* "relpos" (1278646042)
 int fn_relslow(uint32_t _U_ hash,  char _U_ *args) AL; //* "relslow" (1742971917)
 int fn_saveconf(uint32_t _U_ hash,  char _U_ *args) AL; //* "saveconf" (141102426)
 int fn_screen(uint32_t _U_ hash,  char _U_ *args) AL; //* "screen" (2100809349)
+int fn_sgresult(uint32_t _U_ hash,  char _U_ *args) AL; //* "sgresult" (1954755198)
+int fn_sgthrs(uint32_t _U_ hash,  char _U_ *args) AL; //* "sgthrs" (3212845856)
 int fn_speedlimit(uint32_t _U_ hash,  char _U_ *args) AL; //* "speedlimit" (1654184245)
 int fn_state(uint32_t _U_ hash,  char _U_ *args) AL; //* "state" (2216628902)
 int fn_stop(uint32_t _U_ hash,  char _U_ *args) AL; //* "stop" (17184971)
+int fn_telemdest(uint32_t _U_ hash,  char _U_ *args) AL; //* "telemdest" (2685054924)
+int fn_telemetry(uint32_t _U_ hash,  char _U_ *args) AL; //* "telemetry" (2687451104)
 int fn_tmcbus(uint32_t _U_ hash,  char _U_ *args) AL; //* "tmcbus" (1906135955)
 int fn_udata(uint32_t _U_ hash,  char _U_ *args) AL; //* "udata" (2736127636)
 int fn_usartstatus(uint32_t _U_ hash,  char _U_ *args) AL; //* "usartstatus" (4007098968)
@@ -0,0 +1 @@
+../../snippets/ringbuffer.c
\ No newline at end of file
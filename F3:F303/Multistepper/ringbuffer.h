@@ -0,0 +1 @@
+../../snippets/ringbuffer.h
\ No newline at end of file
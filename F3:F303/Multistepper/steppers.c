@@ -53,6 +53,10 @@ static uint16_t curspeed[MOTORSNO];
 static uint16_t startspeed[MOTORSNO]; // speed when deceleration starts
 // ==1 to stop @ nearest step
 static uint8_t stopflag[MOTORSNO];
+// ==1 if stop was caused by StallGuard
+static volatile uint8_t stallflag[MOTORSNO];
+// time when StallGuard became active for given motor (to drop outdated SG_RESULT)
+static uint32_t Tsgon[MOTORSNO];
 // motor state
 static stp_state state[MOTORSNO];
 // move to zero state
@@ -62,18 +66,26 @@ static mvto0state mvzerostate[MOTORSNO];
 //static uint16_t stphighARR[MOTORSNO];
 // microsteps=1<<ustepsshift
 static uint16_t ustepsshift[MOTORSNO];
+// amount of microsteps counted by timer for one interrupt
+static uint16_t ustepsperirq[MOTORSNO];
 // amount of steps for full acceleration/deceleration
 static uint32_t accdecsteps[MOTORSNO];
 
 // time when acceleration or deceleration starts
 static uint32_t Taccel[MOTORSNO] = {0};
 
+// current microsteps position
+static volatile uint16_t ustepctr[MOTORSNO] = {0};
+// position (in microsteps) latched by ESW0 interrupt while moving to zero
+static volatile int32_t eswlatch[MOTORSNO];
+static volatile uint8_t eswlatched[MOTORSNO] = {0};
+
 // recalculate ARR according to new speed
 TRUE_INLINE void recalcARR(int i){
     uint32_t ARR = (((PCLK/(MOTORTIM_PSC+1)) / curspeed[i]) >> ustepsshift[i]) - 1;
     if(ARR < MOTORTIM_ARRMIN) ARR = MOTORTIM_ARRMIN;
     else if(ARR > 0xffff) ARR = 0xffff;
-    mottimers[i]->ARR = ARR;
+    mottimer_setARR(i, ARR);
     curspeed[i] = (((PCLK/(MOTORTIM_PSC+1)) / (ARR+1)) >> ustepsshift[i]); // recalculate speed due to new val
 }
 
@@ -82,6 +94,7 @@ void update_stepper(uint8_t i){
     if(i >= MOTORSNO) return;
     accdecsteps[i] = (the_conf.maxspd[i] * the_conf.maxspd[i]) / the_conf.accel[i] / 2;
     ustepsshift[i] = MSB(the_conf.microsteps[i]);
+    ustepsperirq[i] = mottimer_usteps(i, the_conf.microsteps[i]);
     ESW_reaction[i] = the_conf.ESW_reaction[i];
     switch(the_conf.motflags[i].drvtype){
         case DRVTYPE_UART:
@@ -98,6 +111,7 @@ void init_steppers(){
     // init variables
     for(int i = 0; i < MOTORSNO; ++i){
         stopflag[i] = 0;
+        stallflag[i] = 0;
         motdir[i] = 0;
         curspeed[i] = 0;
         state[i] = STP_RELAX;
@@ -177,6 +191,7 @@ static int esw_block(uint8_t i){
                 ret = TRUE;
             break;
             case ESW_STOPMINUS: // stop only @ given direction
+            case ESW_FASTZERO:
                 if(motdir[i] == -1 && (s & 1)) ret = TRUE; // stop @ESW0
                 if(motdir[i] == 1 && (s & 2)) ret = TRUE; // stop @ESW1
             break;
@@ -211,6 +226,7 @@ errcodes motor_absmove(uint8_t i, int32_t newpos){
         return ERR_CANTRUN; // on end-switch
     }
     stopflag[i] = 0;
+    stallflag[i] = 0;
     targstppos[i] = newpos;
     prevstppos[i] = stppos[i];
     curspeed[i] = the_conf.minspd[i];
@@ -223,6 +239,7 @@ errcodes motor_absmove(uint8_t i, int32_t newpos){
     USB_sendstr(", accdecsteps="); printu(accdecsteps[i]); newline();
 #endif
     MOTOR_EN(i);
+    mottimers[i]->EGR = TIM_EGR_UG; // reload ARR and RCR
     mottimers[i]->CR1 |= TIM_CR1_CEN; // start timer
     return ERR_OK;
 }
@@ -257,16 +274,86 @@ void emstopmotor(uint8_t i){
     stopflag[i] = 1;
 }
 
+// StallGuard works only with UART drivers and on rather high speed (at least half of max)
+static int sgactive(uint8_t i){
+    if(!the_conf.sgthrs[i] || the_conf.motflags[i].drvtype != DRVTYPE_UART) return FALSE;
+    switch(state[i]){
+        case STP_ACCEL:
+        case STP_MOVE:
+        case STP_DECEL:
+        break;
+        default:
+            return FALSE;
+    }
+    if(2*curspeed[i] < the_conf.maxspd[i]) return FALSE;
+    return TRUE;
+}
+
+// DIAG event or too low SG_RESULT: stop motor @ nearest step and go into STP_STALL
+void motor_stalled(uint8_t i){
+    if(i >= MOTORSNO || !sgactive(i)) return; // false alarm
+    stallflag[i] = 1;
+    stopflag[i] = 1;
+}
+
+// check StallGuard state of moving motors: select next DIAG channel and check cached SG_RESULT
+static void chkstall(){
+    static uint8_t lastdiag = 0;
+    int8_t next = -1;
+    for(int i = 0; i < MOTORSNO; ++i){
+        if(!sgactive(i)){
+            Tsgon[i] = 0;
+            continue;
+        }
+        if(!Tsgon[i]) Tsgon[i] = Tms ? Tms : 1;
+        // fallback: DRV_STATUS/SG_RESULT polled after SG became active
+        const pdnstatus_t *s = pdnuart_status(i);
+        if(!s->notfound && (int32_t)(s->Tupd - Tsgon[i]) > PDNU_POLLINTERVAL
+            && s->sg_result <= 2*the_conf.sgthrs[i]) motor_stalled(i);
+    }
+    // round-robin DIAG multiplexer among active motors (only one DIAG could be connected to EXTI)
+    for(int i = 1; i <= MOTORSNO; ++i){
+        uint8_t n = (lastdiag + i) % MOTORSNO;
+        if(Tsgon[n]){ next = n; break; }
+    }
+    if(next > -1) lastdiag = next;
+    diag_select(next);
+}
+
 stp_state getmotstate(uint8_t i){
     return state[i];
 }
 
-// count steps @tim 14/15/16
+// @return TRUE if StallGuard event (DIAG or low SG_RESULT) stops motor or it's stopped by it
+uint8_t motor_stall(uint8_t i){
+    return (stallflag[i] || state[i] == STP_STALL) ? TRUE : FALSE;
+}
+
+// @return TRUE if motor is finding zero (it could be in STP_RELAX state between passes)
+uint8_t motor_homing(uint8_t i){
+    return (mvzerostate[i] != M0RELAX) ? TRUE : FALSE;
+}
+
+// current speed (steps per second) or 0 if motor isn't moving
+uint16_t getmotspeed(uint8_t i){
+    switch(state[i]){
+        case STP_RELAX:
+        case STP_STALL:
+        case STP_ERR:
+            return 0;
+        default:
+            return curspeed[i];
+    }
+}
+
+// count steps @ motors' timers interrupts: timers with RCR call this once per
+// `ustepsperirq` microsteps (usually once per full step), others - on each microstep
 void addmicrostep(uint8_t i){
-    static volatile uint16_t microsteps[MOTORSNO] = {0}; // current microsteps position
-    if(esw_block(i)) stopflag[i] = 1; // turn on stop flag if end-switch was active
-    if(++microsteps[i] == the_conf.microsteps[i]){
-        microsteps[i] = 0;
+    ustepctr[i] += ustepsperirq[i];
+    if(ustepctr[i] >= the_conf.microsteps[i]){
+        ustepctr[i] = 0;
+        // motor could stop only at full step, so there's no sense to check ESW more often
+        if(esw_block(i)) stopflag[i] = 1; // turn on stop flag if end-switch was active
         stppos[i] += motdir[i];
         uint8_t stop_at_pos = 0;
         if(motdir[i] > 0){
@@ -284,7 +371,8 @@ void addmicrostep(uint8_t i){
             stopflag[i] = 0;
             if(the_conf.motflags[i].donthold)
                 MOTOR_DIS(i); // turn off power
-            state[i] = STP_RELAX;
+            state[i] = stallflag[i] ? STP_STALL : STP_RELAX;
+            stallflag[i] = 0;
 #ifdef EBUG
             stp[i] = 1;
 #endif
@@ -292,6 +380,14 @@ void addmicrostep(uint8_t i){
     }
 }
 
+// called from EXTI interrupt: latch position of ESW0 activation
+// (timers with RCR count only whole IRQ periods, so for them accuracy is one full step)
+void esw_latch(uint8_t i){
+    if(eswlatched[i] || !(ESW_state(i) & 1)) return;
+    eswlatch[i] = stppos[i] * the_conf.microsteps[i] + motdir[i] * ustepctr[i];
+    eswlatched[i] = 1;
+}
+
 #ifdef EBUG
 #define TODECEL() do{state[i] = STP_DECEL;  \
         startspeed[i] = curspeed[i];        \
@@ -314,7 +410,7 @@ static void chkstepper(int i){
     if(stp[i]){
         stp[i] = 0;
         // motor state could be changed outside of interrupt, so return it to relax
-        state[i] = STP_RELAX;
+        if(state[i] != STP_STALL) state[i] = STP_RELAX;
         USB_sendstr("MOTOR"); USB_putbyte('0'+i); USB_sendstr(" stop @"); printi(stppos[i]);
         USB_sendstr(", V="); printu(curspeed[i]);
         USB_sendstr(", curstate="); printu(state[i]); newline();
@@ -377,7 +473,34 @@ static void chkstepper(int i){
     }
     switch(mvzerostate[i]){
         case M0FAST:
+            if(ESW_reaction[i] == ESW_SGZERO){ // sensorless homing: zero is where motor stalls
+                if(state[i] == STP_STALL){
+                    state[i] = STP_RELAX;
+                    prevstppos[i] = targstppos[i] = stppos[i] = 0;
+                    mvzerostate[i] = M0RELAX;
+                }else if(state[i] == STP_RELAX || state[i] == STP_ERR){ // moved all range without stall
+                    state[i] = STP_ERR;
+                    mvzerostate[i] = M0RELAX;
+                }
+                break;
+            }
+            if(the_conf.ESW_reaction[i] == ESW_FASTZERO && eswlatched[i] &&
+                (state[i] == STP_RELAX || state[i] == STP_STALL)){ // zero is latched position
+                esw_latch_release(i);
+                int32_t ms = the_conf.microsteps[i], d = stppos[i] * ms - eswlatch[i];
+                if(d < 0) d = -((ms/2 - d) / ms); // round to nearest step
+                else d = (d + ms/2) / ms;
+                state[i] = STP_RELAX;
+                prevstppos[i] = targstppos[i] = stppos[i] = d;
+#ifdef EBUG
+                USB_putbyte('M'); USB_putbyte('0'+i); USB_sendstr("FAST: zero latched, pos="); printi(d); newline();
+#endif
+                ESW_reaction[i] = the_conf.ESW_reaction[i];
+                mvzerostate[i] = M0RELAX;
+                break;
+            }
             if(state[i] == STP_RELAX || state[i] == STP_STALL){ // stopped -> move to +
+                esw_latch_release(i); // not latched (or EXTI line is busy): find zero by slow moving
 #ifdef EBUG
                 USB_putbyte('M'); USB_putbyte('0'+i); USB_sendstr("FAST: motor stopped\n");
 #endif
@@ -414,8 +537,17 @@ static void chkstepper(int i){
 }
 
 errcodes motor_goto0(uint8_t i){
+    if(ESW_reaction[i] == ESW_SGZERO){ // StallGuard homing: single fast move until stall
+        if(!the_conf.sgthrs[i] || the_conf.motflags[i].drvtype != DRVTYPE_UART) return ERR_CANTRUN;
+        errcodes e = motor_absmove(i, -the_conf.maxsteps[i]);
+        if(ERR_OK == e) mvzerostate[i] = M0FAST;
+        return e;
+    }
+    eswlatched[i] = 0;
+    if(the_conf.ESW_reaction[i] == ESW_FASTZERO) esw_latch_arm(i); // if can't - use slow pass
     errcodes e = motor_absmove(i, -the_conf.maxsteps[i]);
     if(ERR_OK != e){
+        esw_latch_release(i);
         if(!ESW_state(i)) return e; // not @ limit switch -> error
     }else  ESW_reaction[i] = ESW_STOPMINUS;
     mvzerostate[i] = M0FAST;
@@ -454,6 +586,7 @@ void process_steppers(){
     for(int i = 0; i < MOTORSNO; ++i){
         chkstepper(i);
     }
+    chkstall();
 }
 
 uint8_t geteswreact(uint8_t i){
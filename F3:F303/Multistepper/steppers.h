@@ -35,7 +35,7 @@ typedef enum{
     STP_MOVE,       // 2 - moving with constant speed
     STP_MVSLOW,     // 3 - moving with slowest constant speed (end of moving)
     STP_DECEL,      // 4 - moving with deceleration
-    STP_STALL,      // 5 - stalled (UNUSED)
+    STP_STALL,      // 5 - stopped by StallGuard
     STP_ERR ,       // 6 - wrong/error state
     STP_STATE_AMOUNT
 } stp_state;
@@ -45,12 +45,16 @@ enum{
     ESW_IGNORE,     // don't stop @ end-switch
     ESW_ANYSTOP,    // stop @ esw in any moving direction
     ESW_STOPMINUS,  // stop only when moving in given direction (e.g. to minus @ESW0)
+    ESW_SGZERO,     // ignore end-switches, find zero by StallGuard (motor stall @ minus)
+    ESW_FASTZERO,   // like ESW_STOPMINUS, but zero is position latched by ESW0 interrupt (no slow pass)
     ESW_AMOUNT      // number of records
 };
 
 // find zero stages: fast -> 0, slow -> +, slow -> 0
 
 void addmicrostep(uint8_t i);
+void motor_stalled(uint8_t i);
+void esw_latch(uint8_t i);
 
 void init_steppers();
 void update_stepper(uint8_t i);
@@ -68,4 +72,7 @@ uint8_t geteswreact(uint8_t i);
 void emstopmotor(uint8_t i);
 void stopmotor(uint8_t i);
 stp_state getmotstate(uint8_t i);
+uint8_t motor_homing(uint8_t i);
+uint8_t motor_stall(uint8_t i);
+uint16_t getmotspeed(uint8_t i);
 void process_steppers();
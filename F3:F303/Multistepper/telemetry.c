@@ -0,0 +1,100 @@
+/*
+ * This file is part of the multistepper project.
+ * Copyright 2023 Edward V. Emelianov <edward.emelianoff@gmail.com>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "can.h"
+#include "crc.h"
+#include "flash.h"
+#include "hardware.h"
+#include "steppers.h"
+#include "telemetry.h"
+#include "usb.h"
+
+static uint32_t period = 0; // 0 - telemetry is off
+static uint8_t dest = TELEM_USB;
+static telem_record rec = {.sync = {TELEM_SYNC0, TELEM_SYNC1},
+                           .len = sizeof(telem_record) - 3 - sizeof(uint16_t)};
+static uint8_t canframe = MOTORSNO; // next motor to send over CAN (MOTORSNO - all sent)
+
+// take time-aligned snapshot of all motors
+static void snapshot(){
+    ++rec.seq;
+    rec.Tms = Tms;
+    for(int i = 0; i < MOTORSNO; ++i){
+        int32_t p;
+        getpos(i, &p);
+        rec.pos[i] = p;
+        rec.speed[i] = getmotspeed(i);
+        rec.state[i] = getmotstate(i);
+        uint8_t f = ESW_state(i) & (TELEMF_ESW0 | TELEMF_ESW1);
+        if(motor_stall(i)) f |= TELEMF_DIAG; // don't switch DIAG multiplexer: EXTI events would be lost
+        rec.flags[i] = f;
+    }
+    rec.crc = crc16(&rec.seq, rec.len);
+}
+
+// send next CAN frame of current snapshot, @return FALSE if mailboxes are busy
+static int sendcan(){
+    uint8_t buf[8];
+    int i = canframe;
+    *((int32_t*)buf) = rec.pos[i];
+    *((uint16_t*)&buf[4]) = rec.speed[i];
+    buf[6] = rec.state[i];
+    buf[7] = rec.flags[i] | (i << 4) | ((rec.seq & 1) << 7);
+    if(CAN_OK != CAN_send(buf, 8, (the_conf.CANID + TELEM_CANIDOFF) & 0x7ff)) return FALSE;
+    ++canframe;
+    return TRUE;
+}
+
+/**
+ * @brief telemetry_process - periodical snapshots (call it from main loop)
+ * USB record is dropped if there's no free space in output buffer; CAN frames are sent when
+ * there's free mailboxes, non-sent frames of previous snapshot are lost.
+ */
+void telemetry_process(){
+    static uint32_t Tlast = 0;
+    while(canframe < MOTORSNO && sendcan());
+    if(!period || Tms - Tlast < period) return;
+    Tlast = Tms;
+    snapshot();
+    if((dest & TELEM_USB) && USB_txfree() >= (int)sizeof(rec))
+        USB_send((uint8_t*)&rec, sizeof(rec));
+    if(dest & TELEM_CAN) canframe = 0;
+}
+
+uint32_t telemetry_period(){
+    return period;
+}
+
+// set period in ms (0 to turn off); @return FALSE if value is bad
+int telemetry_setperiod(uint32_t ms){
+    if(ms && ms < TELEM_PERIOD_MIN) return FALSE;
+    period = ms;
+    return TRUE;
+}
+
+uint8_t telemetry_dest(){
+    return dest;
+}
+
+// set destination: TELEM_USB and/or TELEM_CAN
+int telemetry_setdest(uint8_t d){
+    if(d & ~(TELEM_USB | TELEM_CAN)) return FALSE;
+    dest = d;
+    if(!(dest & TELEM_CAN)) canframe = MOTORSNO;
+    return TRUE;
+}
@@ -0,0 +1,63 @@
+/*
+ * This file is part of the multistepper project.
+ * Copyright 2023 Edward V. Emelianov <edward.emelianoff@gmail.com>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "hardware.h"
+
+// minimal telemetry period, ms
+#define TELEM_PERIOD_MIN    (5)
+// CAN ID of telemetry frames is the_conf.CANID + TELEM_CANIDOFF
+#define TELEM_CANIDOFF      (0x100)
+// USB record sync bytes (can't be met in text output)
+#define TELEM_SYNC0         (0xA5)
+#define TELEM_SYNC1         (0x5A)
+
+// telemetry destination flags
+#define TELEM_USB           (1<<0)
+#define TELEM_CAN           (1<<1)
+
+// flags of motor
+#define TELEMF_ESW0         (1<<0)
+#define TELEMF_ESW1         (1<<1)
+#define TELEMF_DIAG         (1<<2) // stall detected by StallGuard (DIAG event or low SG_RESULT)
+
+// USB record (little endian); CRC16-CCITT (poly 0x1021, init 0xffff) is calculated
+// over all bytes from `seq` to the end of `flags`
+typedef struct __attribute__((packed)){
+    uint8_t sync[2];            // TELEM_SYNC0, TELEM_SYNC1
+    uint8_t len;                // amount of bytes from `seq` to `crc` (exclusive)
+    uint8_t seq;                // record counter
+    uint32_t Tms;               // time of snapshot
+    int32_t pos[MOTORSNO];      // positions (steps)
+    uint16_t speed[MOTORSNO];   // current speeds (steps per second)
+    uint8_t state[MOTORSNO];    // stp_state
+    uint8_t flags[MOTORSNO];    // TELEMF_xx
+    uint16_t crc;
+} telem_record;
+
+// CAN frame for each motor (ID = CANID + TELEM_CANIDOFF):
+// [pos i32][speed u16][state u8][flags u8: bits 0..2 - TELEMF_xx, bits 4..6 - motor number,
+//  bit 7 - lowest bit of record counter (frames with the same bit7 belong to one snapshot)]
+
+void telemetry_process();
+uint32_t telemetry_period();
+int telemetry_setperiod(uint32_t ms);
+uint8_t telemetry_dest();
+int telemetry_setdest(uint8_t dest);
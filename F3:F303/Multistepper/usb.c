@@ -54,6 +54,12 @@ int USB_sendall(){
     return 1;
 }
 
+// amount of free space in output buffer
+int USB_txfree(){
+    if(!usbON) return 0;
+    return RBOUTSZ - 1 - RB_datalen((ringbuffer*)&out);
+}
+
 // put `buf` into queue to send
 int USB_send(const uint8_t *buf, int len){
     if(!buf || !usbON || !len) return 0;
@@ -106,6 +112,16 @@ int USB_receive(uint8_t *buf, int len){
     return sz;
 }
 
+/**
+ * @brief USB_rxpeek - copy data from receiving ring-buffer without removing it
+ * @param buf (i) - buffer for data
+ * @param len - length of `buf`
+ * @return amount of bytes copied
+ */
+int USB_rxpeek(uint8_t *buf, int len){
+    return RB_peek((ringbuffer*)&in, buf, len);
+}
+
 /**
  * @brief USB_receivestr - get string up to '\n' and replace '\n' with 0
  * @param buf - receiving buffer
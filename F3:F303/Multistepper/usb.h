@@ -39,7 +39,9 @@
 void USB_proc();
 int USB_sendall();
 int USB_send(const uint8_t *buf, int len);
+int USB_txfree();
 int USB_putbyte(uint8_t byte);
 int USB_sendstr(const char *string);
 int USB_receive(uint8_t *buf, int len);
+int USB_rxpeek(uint8_t *buf, int len);
 int USB_receivestr(char *buf, int len);
@@ -16,6 +16,8 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <string.h>
+
 #include "cmdproto.h"
 #include "debug.h"
 #include "strfunc.h"
@@ -102,7 +104,7 @@ void parse_cmd(const char *buf){
                 if(Num == 0) SENDN("Wrong USART number");
             }
             nxt = omit_spaces(nxt);
-            usart_sendn(Num, (uint8_t*)nxt, mystrlen(nxt));
+            usart_sendn(Num, (uint8_t*)nxt, strlen(nxt));
             SENDN("OK");
         break;
         default:
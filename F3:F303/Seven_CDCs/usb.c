@@ -91,7 +91,7 @@ int USB_putbyte(int ifNo, uint8_t byte){
 
 int USB_sendstr(int ifNo, const char *string){
     if(!string) return 0;
-    return USB_send(ifNo, (const uint8_t*)string, mystrlen(string));
+    return USB_send(ifNo, (const uint8_t*)string, strlen(string));
 }
 
 /**
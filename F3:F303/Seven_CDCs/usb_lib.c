@@ -32,6 +32,11 @@ config_pack_t *setup_packet = (config_pack_t*) setupdatabuf;
 
 volatile uint8_t usbON = 0;
 
+// send string into debug interface (for hexdump)
+static int dbg_sendstr(const char *s){
+    return USB_sendstr(DBG_IDX, s);
+}
+
 // definition of parts common for USB_DeviceDescriptor & USB_DeviceQualifierDescriptor
 #define bcdUSB_L        0x00
 #define bcdUSB_H        0x02
@@ -759,7 +764,7 @@ static void rxtx_Handler(uint8_t epno){
         /*
         DBG("epno");
         DBGmesg(u2str(epno)); DBGmesg(" ("); DBGmesg(u2str(sz));
-        DBGmesg(") > "); hexdump(DBG_IDX, buf, sz); DBGnl();
+        DBGmesg(") > "); hexdump(dbg_sendstr, buf, sz); DBGnl();
         */
         if(sz){
             switch(epno){
@@ -824,7 +829,7 @@ void EP0_Handler(uint8_t  __attribute__((unused)) epno){
     if(iFno != DBG_IDX){
         DBGmesg(uhex2str(epstatus));
         DBGmesg(" ("); DBGmesg(u2str(iFno));
-        DBGmesg(") - "); hexdump(DBG_IDX, (uint8_t*)setup_packet, sizeof(config_pack_t));
+        DBGmesg(") - "); hexdump(dbg_sendstr, (uint8_t*)setup_packet, sizeof(config_pack_t));
     }
     if(rxflag && SETUP_FLAG(epstatus)){
         if(iFno != DBG_IDX){DBGmesg("setup\n");}
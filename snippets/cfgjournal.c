@@ -0,0 +1,200 @@
+/*
+ * This file is part of the common library.
+ * Copyright 2023 Edward V. Emelianov <edward.emelianoff@gmail.com>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include "cfgjournal.h"
+
+// CRC16-CCITT
+static uint16_t crc16(const uint16_t *buf, uint32_t nhw){
+    uint16_t crc = 0xffff;
+    const uint8_t *b = (const uint8_t*)buf;
+    for(uint32_t n = nhw * 2; n; --n){
+        crc ^= (uint16_t)(*b++) << 8;
+        for(int i = 0; i < 8; ++i){
+            if(crc & 0x8000) crc = (crc << 1) ^ 0x1021;
+            else crc <<= 1;
+        }
+    }
+    return crc;
+}
+
+static const uint16_t *bankaddr(cj_journal *j, int bank){
+    return (const uint16_t*)(j->base + bank * j->banksize);
+}
+
+// @return 1 if bank header is valid
+static int hdrvalid(cj_journal *j, int bank){
+    const uint16_t *h = bankaddr(j, bank);
+    if(h[0] != CJ_MAGICK || h[2] != j->size) return 0;
+    return (crc16(h, 3) == h[3]);
+}
+
+// check record `r` (`rest` - halfwords left in bank); @return its length (halfwords) or 0 if it's bad
+static uint32_t reclen(cj_journal *j, const uint16_t *r, uint32_t rest){
+    uint32_t off = r[0] & 0xff, len = (r[0] >> 8) & CJ_RECMAX;
+    if(len == 0 || len + 2 > rest || (off + len) * 2 > j->size) return 0;
+    if(crc16(r, len + 1) != r[len + 1]) return 0;
+    return len + 2;
+}
+
+// apply `n` halfwords of records from `r` to image `img`
+static void replay(uint8_t *img, const uint16_t *r, uint32_t n){
+    while(n){
+        uint32_t off = r[0] & 0xff, len = (r[0] >> 8) & CJ_RECMAX;
+        memcpy(img + off * 2, r + 1, len * 2);
+        r += len + 2;
+        n -= len + 2;
+    }
+}
+
+// make record in `buf` from `len` halfwords of image since `off`; @return its length
+static uint32_t mkrec(cj_journal *j, uint16_t *buf, uint32_t off, uint32_t len, int end){
+    buf[0] = off | (len << 8) | (end ? CJ_RECEND : 0);
+    memcpy(buf + 1, j->image + off * 2, len * 2);
+    buf[len + 1] = crc16(buf, len + 1);
+    return len + 2;
+}
+
+/**
+ * @brief cj_mount - find active bank and rebuild image from its records
+ * @return CJ_OK if image is restored, CJ_EMPTY if there's no data (image isn't changed), CJ_ERR if bad parameters
+ */
+int cj_mount(cj_journal *j){
+    j->tail = 0;
+    j->bank = 0;
+    j->seq = 0;
+    if((j->size & 1) || j->size > CJ_SIZEMAX || j->banksize < CJ_HDRSZ + CJ_BUFSZ(j->size) * 2U) return CJ_ERR;
+    int v0 = hdrvalid(j, 0), v1 = hdrvalid(j, 1), b;
+    if(!v0 && !v1) return CJ_EMPTY;
+    if(v0 && v1) b = ((int16_t)(bankaddr(j, 1)[1] - bankaddr(j, 0)[1]) > 0) ? 1 : 0;
+    else b = v1;
+    const uint16_t *start = bankaddr(j, b) + CJ_HDRSZ / 2, *r = start;
+    uint32_t rest = (j->banksize - CJ_HDRSZ) / 2, pos = 0, committed = 0;
+    while(rest && *r != 0xffff){
+        uint32_t l = reclen(j, r, rest);
+        if(!l) break;
+        pos += l;
+        if(*r & CJ_RECEND) committed = pos;
+        r += l;
+        rest -= l;
+    }
+    if(!committed) return CJ_EMPTY; // can't be: snapshot is written before header
+    replay(j->shadow, start, committed);
+    memcpy(j->image, j->shadow, j->size);
+    j->bank = b;
+    j->seq = bankaddr(j, b)[1];
+    // broken or incomplete records after last transaction: don't append anything more to this bank
+    if(pos != committed || (rest && *r != 0xffff)) j->tail = j->banksize;
+    else j->tail = CJ_HDRSZ + committed * 2;
+    return CJ_OK;
+}
+
+/**
+ * @brief cj_delta - make records for changed parts of image in `buf`
+ * @return amount of halfwords in `buf` (0 if nothing changed) or -1 if buffer is too small
+ */
+int cj_delta(cj_journal *j){
+    const uint16_t *img = (const uint16_t*)j->image, *sh = (const uint16_t*)j->shadow;
+    uint32_t n = j->size / 2, i = 0, o = 0, last = 0, bufsz = CJ_BUFSZ(j->size);
+    while(i < n){
+        if(img[i] == sh[i]){ ++i; continue; }
+        // gaps less than 3 unchanged halfwords are cheaper to write than new record
+        uint32_t e = i + 1, g = e; // g - end of changed data
+        while(e < n && e - i < CJ_RECMAX){
+            if(img[e] != sh[e]) g = e + 1;
+            else if(e - g >= 2) break;
+            ++e;
+        }
+        uint32_t len = g - i;
+        if(o + len + 2 > bufsz) return -1;
+        last = o;
+        o += mkrec(j, j->buf + o, i, len, 0);
+        i = g;
+    }
+    if(o){ // mark end of transaction
+        uint16_t *r = j->buf + last;
+        uint32_t len = (r[0] >> 8) & CJ_RECMAX;
+        r[0] |= CJ_RECEND;
+        r[len + 1] = crc16(r, len + 1);
+    }
+    return (int)o;
+}
+
+// @return 1 if `n` halfwords of delta can be written into active bank
+int cj_fits(cj_journal *j, int n){
+    return (n > 0 && j->tail && j->tail + (uint32_t)n * 2 <= j->banksize);
+}
+
+// address to write records
+const void *cj_tailaddr(cj_journal *j){
+    return j->base + j->bank * j->banksize + j->tail;
+}
+
+// `n` halfwords from `buf` are written at cj_tailaddr()
+void cj_commit(cj_journal *j, int n){
+    replay(j->shadow, j->buf, n);
+    j->tail += n * 2;
+}
+
+// write error: tail of bank is unusable
+void cj_fail(cj_journal *j){
+    if(j->tail) j->tail = j->banksize;
+}
+
+/**
+ * @brief cj_compact - write full image into other bank and make it active
+ * @return CJ_OK or CJ_ERR
+ */
+int cj_compact(cj_journal *j){
+    int nb = j->tail ? !j->bank : 0;
+    const uint8_t *bank = (const uint8_t*)bankaddr(j, nb);
+    for(uint32_t a = 0; a < j->banksize; a += j->pagesize)
+        if(j->erase(bank + a)) return CJ_ERR;
+    uint32_t n = j->size / 2, o = 0;
+    for(uint32_t i = 0; i < n; i += CJ_RECMAX){
+        uint32_t len = n - i;
+        if(len > CJ_RECMAX) len = CJ_RECMAX;
+        o += mkrec(j, j->buf + o, i, len, i + len == n);
+    }
+    if(j->write(bank + CJ_HDRSZ, j->buf, o)) return CJ_ERR;
+    uint16_t hdr[4] = {CJ_MAGICK, j->seq + 1, j->size, 0};
+    hdr[3] = crc16(hdr, 3);
+    if(j->write(bank, hdr, 4)) return CJ_ERR;
+    memcpy(j->shadow, j->image, j->size);
+    j->bank = nb;
+    j->seq = hdr[1];
+    j->tail = CJ_HDRSZ + o * 2;
+    return CJ_OK;
+}
+
+/**
+ * @brief cj_save - append changes of image to active bank (or compact storage if there's no place)
+ * @return CJ_OK or CJ_ERR
+ */
+int cj_save(cj_journal *j){
+    if(!j->tail) return cj_compact(j); // there's no valid bank yet
+    int n = cj_delta(j);
+    if(n == 0) return CJ_OK;
+    if(!cj_fits(j, n)) return cj_compact(j);
+    if(j->write(cj_tailaddr(j), j->buf, n)){
+        cj_fail(j);
+        return CJ_ERR;
+    }
+    cj_commit(j, n);
+    return CJ_OK;
+}
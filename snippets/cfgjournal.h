@@ -0,0 +1,78 @@
+/*
+ * This file is part of the common library.
+ * Copyright 2023 Edward V. Emelianov <edward.emelianoff@gmail.com>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+/*
+ * Journaled configuration storage. Two banks (one or more flash pages each), bank layout:
+ *   header: magick, seq, size of image, CRC16 of previous three halfwords (written last)
+ *   records: [hdr][data x len][CRC16 of hdr and data]
+ *     hdr: bits 0..7 - offset in image (halfwords), bits 8..14 - len (halfwords), bit 15 - end of transaction
+ * Each save appends records only for changed parts of image; records of one save are applied
+ * at boot only when the last of them (with "end" flag) is valid, so power loss leaves old or new data.
+ * When bank is full, full image is written into other bank ("compaction") and after that its header.
+ * Hardware-independent: flash access is made by functions given in `cj_journal`.
+ */
+
+// bank header magick
+#define CJ_MAGICK       (0x4A43)
+// bank header size (bytes)
+#define CJ_HDRSZ        (8)
+// max record data length (halfwords)
+#define CJ_RECMAX       (127)
+// "end of transaction" flag of record header
+#define CJ_RECEND       (0x8000)
+// max size of image (bytes)
+#define CJ_SIZEMAX      (508)
+// size of working buffer (halfwords) for image of `sz` bytes
+#define CJ_BUFSZ(sz)    ((sz) + 4)
+
+enum{
+    CJ_OK,
+    CJ_EMPTY,       // there's no valid data in storage
+    CJ_ERR          // flash error or bad parameters
+};
+
+typedef struct{
+    // should be filled by user
+    const uint8_t *base;    // storage address (bank 0, then bank 1)
+    uint32_t banksize;      // size of bank, bytes (multiple of `pagesize`)
+    uint32_t pagesize;      // size of flash page
+    int (*write)(const void *addr, const uint16_t *data, uint32_t n); // program `n` halfwords, 0 if OK
+    int (*erase)(const void *addr); // erase page @ `addr`, 0 if OK
+    uint8_t *image;         // configuration in RAM (aligned to 2)
+    uint8_t *shadow;        // its copy which is equal to data stored in flash
+    uint16_t *buf;          // working buffer of CJ_BUFSZ(size) halfwords
+    uint16_t size;          // size of image (even, <= CJ_SIZEMAX)
+    // current state
+    uint8_t bank;           // active bank
+    uint16_t seq;           // its counter
+    uint32_t tail;          // offset of first free byte in active bank (0 - no valid bank)
+} cj_journal;
+
+int cj_mount(cj_journal *j);
+int cj_save(cj_journal *j);
+int cj_compact(cj_journal *j);
+// for asynchronous writers
+int cj_delta(cj_journal *j);
+int cj_fits(cj_journal *j, int n);
+const void *cj_tailaddr(cj_journal *j);
+void cj_commit(cj_journal *j, int n);
+void cj_fail(cj_journal *j);
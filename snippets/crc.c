@@ -0,0 +1,69 @@
+/*
+ * This file is part of the common library.
+ * Copyright 2023 Edward V. Emelianov <edward.emelianoff@gmail.com>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "crc.h"
+
+/*
+ * CRCs are calculated by nibbles: 16-entry tables are small enough even for F0/G0 flash,
+ * and this is more than twice faster than bit-by-bit calculation (see crctest).
+ */
+
+// CRC16-CCITT (poly 0x1021) of all 16 values of high nibble
+static const uint16_t crc16tab[16] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50a5, 0x60c6, 0x70e7,
+    0x8108, 0x9129, 0xa14a, 0xb16b, 0xc18c, 0xd1ad, 0xe1ce, 0xf1ef
+};
+
+/**
+ * @brief crc16_add - continue calculation of CRC16-CCITT
+ * @param crc - CRC of previous data (0xffff for start)
+ * @param buf - data
+ * @param len - its length
+ * @return new CRC value
+ */
+uint16_t crc16_add(uint16_t crc, const uint8_t *buf, int len){
+    while(len-- > 0){
+        uint8_t byte = *buf++;
+        crc = (uint16_t)(crc << 4) ^ crc16tab[(crc >> 12) ^ (byte >> 4)];
+        crc = (uint16_t)(crc << 4) ^ crc16tab[(crc >> 12) ^ (byte & 0x0f)];
+    }
+    return crc;
+}
+
+// CRC16-CCITT (poly 0x1021, init 0xffff)
+uint16_t crc16(const uint8_t *buf, int len){
+    return crc16_add(0xffff, buf, len);
+}
+
+// Dallas/Maxim CRC8 (1-wire, reflected poly 0x8C) of all 16 values of low nibble
+static const uint8_t crc8tab[16] = {
+    0x00, 0x9d, 0x23, 0xbe, 0x46, 0xdb, 0x65, 0xf8,
+    0x8c, 0x11, 0xaf, 0x32, 0xca, 0x57, 0xe9, 0x74
+};
+
+// Dallas/Maxim CRC8 (DS18x20 scratchpad and ROM, init 0); CRC of data with its CRC is 0
+uint8_t crc8_dallas(const uint8_t *buf, int len){
+    uint8_t crc = 0;
+    while(len-- > 0){
+        crc ^= *buf++;
+        crc = (crc >> 4) ^ crc8tab[crc & 0x0f];
+        crc = (crc >> 4) ^ crc8tab[crc & 0x0f];
+    }
+    return crc;
+}
@@ -0,0 +1 @@
+../crc.c
\ No newline at end of file
@@ -0,0 +1 @@
+../crc.h
\ No newline at end of file
@@ -0,0 +1,112 @@
+/*
+ * This file is part of the common library.
+ * Copyright 2023 Edward V. Emelianov <edward.emelianoff@gmail.com>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// test of CRCs against bit-by-bit variants (like in multistepper and DS18) and benchmark
+// usage: ./crctest [N [seed]] (N - amount of random buffers, default 10^6) or ./crctest -b (benchmark)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "crc.h"
+
+// old variants: bit by bit
+static uint16_t old_crc16(const uint8_t *buf, int len){
+    uint16_t crc = 0xffff;
+    while(len--){
+        crc ^= (uint16_t)(*buf++) << 8;
+        for(int i = 0; i < 8; ++i){
+            if(crc & 0x8000) crc = (crc << 1) ^ 0x1021;
+            else crc <<= 1;
+        }
+    }
+    return crc;
+}
+static uint8_t old_crc8(const uint8_t *buf, int len){
+    uint8_t crc = 0;
+    while(len--){
+        crc ^= *buf++;
+        for(int i = 0; i < 8; ++i){
+            if(crc & 1) crc = (crc >> 1) ^ 0x8C;
+            else crc >>= 1;
+        }
+    }
+    return crc;
+}
+
+static long errors = 0;
+#define FAIL(...) do{ if(++errors < 20){ printf(__VA_ARGS__); printf("\n"); } }while(0)
+
+static double nsnow(){
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+#define BUFSZ   (1<<16)
+static uint8_t buf[BUFSZ];
+static volatile uint32_t sink;
+
+// CRC of 64-byte blocks (like protocol frames)
+#define BENCH(name, fn) do{ double t0 = nsnow(); \
+    for(int r = 0; r < 64; ++r) for(int i = 0; i < BUFSZ; i += 64) sink += fn(buf + i, 64); \
+    printf("  %-12s %6.2f ns per byte\n", name, (nsnow() - t0) / (64. * BUFSZ)); }while(0)
+
+static void bench(){
+    for(int i = 0; i < BUFSZ; ++i) buf[i] = (uint8_t)random();
+    printf("Benchmark (64-byte blocks):\n");
+    BENCH("old crc16", old_crc16);
+    BENCH("crc16", crc16);
+    BENCH("old crc8", old_crc8);
+    BENCH("crc8_dallas", crc8_dallas);
+}
+
+int main(int argc, char **argv){
+    if(argc > 1 && 0 == strcmp(argv[1], "-b")){
+        srandom(time(NULL));
+        bench();
+        return 0;
+    }
+    long N = (argc > 1) ? atol(argv[1]) : 1000000;
+    unsigned seed = (argc > 2) ? (unsigned)atol(argv[2]) : (unsigned)time(NULL);
+    srandom(seed);
+    // check values of CRC catalogue: CRC-16/IBM-3740 (CCITT-FALSE) and CRC-8/MAXIM-DOW
+    const uint8_t *chk = (const uint8_t*)"123456789";
+    if(crc16(chk, 9) != 0x29b1) FAIL("crc16(\"123456789\") = 0x%04x instead of 0x29b1", crc16(chk, 9));
+    if(crc8_dallas(chk, 9) != 0xa1) FAIL("crc8_dallas(\"123456789\") = 0x%02x instead of 0xa1", crc8_dallas(chk, 9));
+    if(crc16(chk, 0) != 0xffff || crc8_dallas(chk, 0) != 0) FAIL("wrong CRC of empty buffer");
+    uint8_t b[300];
+    for(long i = 0; i < N; ++i){
+        int len = random() % sizeof(b);
+        for(int k = 0; k < len; ++k) b[k] = (uint8_t)random();
+        uint16_t c16 = crc16(b, len);
+        if(c16 != old_crc16(b, len)) FAIL("crc16 of %d bytes: 0x%04x instead of 0x%04x", len, c16, old_crc16(b, len));
+        int part = len ? random() % len : 0;
+        if(crc16_add(crc16(b, part), b + part, len - part) != c16) FAIL("crc16_add: wrong CRC of %d + %d bytes", part, len - part);
+        uint8_t c8 = crc8_dallas(b, len);
+        if(c8 != old_crc8(b, len)) FAIL("crc8_dallas of %d bytes: 0x%02x instead of 0x%02x", len, c8, old_crc8(b, len));
+        b[len] = c8; // CRC of data with its CRC is zero (like DS18 scratchpad)
+        if(crc8_dallas(b, len + 1)) FAIL("crc8_dallas of data with CRC isn't zero");
+    }
+    if(errors){
+        printf("FAIL: %ld errors (seed %u)\n", errors, seed);
+        return 1;
+    }
+    printf("Test passed (check values and %ld random buffers, seed %u)\n", N, seed);
+    return 0;
+}
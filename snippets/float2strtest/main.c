@@ -0,0 +1,250 @@
+/*
+ * This file is part of the i2cscan project.
+ * Copyright 2023 Edward V. Emelianov <edward.emelianoff@gmail.com>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+// test of float2str_r against snprintf and benchmark vs old variant (float normalisation)
+// usage: ./float2strtest [N] (N - amount of random values for each notation, default 10^7)
+// or ./float2strtest -b (benchmark only)
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef __x86_64__
+#include <x86intrin.h>
+#endif
+#include "strfunc.h"
+
+// old variant (Seven_CDCs, MLX90640)
+static const float pwr10[] = {1.f, 10.f, 100.f, 1000.f, 10000.f};
+static const float rounds[] = {0.5f, 0.05f, 0.005f, 0.0005f, 0.00005f};
+#define P10L  (sizeof(pwr10)/sizeof(uint32_t) - 1)
+static char *old_float2str(float x, uint8_t prec){
+    static char str[16] = {0};
+    if(prec > P10L) prec = P10L;
+    if(isnan(x)){ memcpy(str, "NAN", 4); return str;}
+    else{
+        int i = isinf(x);
+        if(i){memcpy(str, "-INF", 5); if(i == 1) return str+1; else return str;}
+    }
+    char *s = str + 14;
+    uint8_t minus = 0;
+    if(x < 0){
+        x = -x;
+        minus = 1;
+    }
+    int pow = 0;
+    while(x > 1000.f){
+        x /= 1000.f;
+        pow += 3;
+    }
+    if(x > 0.) while(x < 1.){
+        x *= 1000.f;
+        pow -= 3;
+    }
+    if(pow){
+        uint8_t m = 0;
+        if(pow < 0){pow = -pow; m = 1;}
+        while(pow){
+            register int p10 = pow/10;
+            *s-- = '0' + (pow - 10*p10);
+            pow = p10;
+        }
+        if(m) *s-- = '-';
+        *s-- = 'E';
+    }
+    uint32_t units;
+    if(prec){
+        units = (uint32_t) x;
+        uint32_t decimals = (uint32_t)((x-units+rounds[prec])*pwr10[prec]);
+        while(prec){
+            register int d10 = decimals / 10;
+            *s-- = '0' + (decimals - 10*d10);
+            decimals = d10;
+            --prec;
+        }
+        *s-- = '.';
+    }else{
+        units = (uint32_t) (x + 0.5);
+    }
+    if(units == 0) *s-- = '0';
+    else while(units){
+        register uint32_t u10 = units / 10;
+        *s-- = '0' + (units - 10*u10);
+        units = u10;
+    }
+    if(minus) *s-- = '-';
+    return s+1;
+}
+
+// @return decimal exponent of `d` written by snprintf as "%.*e"
+static int expof(const char *s){
+    return atoi(strchr(s, 'e') + 1);
+}
+
+// engineering notation by snprintf: mantissa in [1, 1000), rounded at 10^(e3-prec)
+static void ref_eng(float x, int prec, char *out){
+    char tmp[128], *o = out;
+    double d = fabs((double)x); // double keeps float exactly
+    if(signbit(x)) *o++ = '-';
+    if(d == 0.){
+        sprintf(o, "%.*f", prec, 0.);
+        return;
+    }
+    snprintf(tmp, sizeof(tmp), "%.60e", d); // exact
+    int e10 = expof(tmp);
+    int e3 = (int)floor(e10 / 3.) * 3;
+    int nd = e10 - e3 + 1 + prec; // significant digits
+    snprintf(tmp, sizeof(tmp), "%.*e", nd - 1, d);
+    int ni = e10 - e3 + 1;
+    char dig[128];
+    int n = 0;
+    for(char *p = tmp; *p != 'e'; ++p) if(*p != '.') dig[n++] = *p;
+    if(expof(tmp) != e10){ // carry: 999.99 -> 1000.0
+        dig[n++] = '0';
+        if(++ni > 3){ ni = 1; e3 += 3; }
+    }
+    dig[n] = 0;
+    memcpy(o, dig, ni); o += ni;
+    if(prec){
+        *o++ = '.';
+        memcpy(o, dig + ni, prec); o += prec;
+    }
+    if(e3) o += sprintf(o, "E%d", e3);
+    *o = 0;
+}
+
+static long errors = 0;
+
+static void check(float x, int prec, uint8_t plain){
+    char buf[F2S_BUFSZ], ref[128];
+    if(plain) snprintf(ref, sizeof(ref), "%.*f", prec, (double)x);
+    else ref_eng(x, prec, ref);
+    float2str_r(x, (uint8_t)prec, plain, buf);
+    if(strlen(buf) >= F2S_BUFSZ || strcmp(buf, ref)){
+        if(++errors < 10) printf("float2str_r(%.9g, %d, %s): got '%s', expected '%s'\n",
+            (double)x, prec, plain ? "plain" : "eng", buf, ref);
+    }
+}
+
+static float randbits(){ // any finite float
+    union{ float f; uint32_t u; } v;
+    do v.u = (uint32_t)random() ^ ((uint32_t)random() << 16); while(((v.u >> 23) & 0xff) == 0xff);
+    return v.f;
+}
+static float randsensor(){ // typical measured value: up to 6 digits with random scale
+    float x = (float)(random() % 2000001 - 1000000);
+    return x / (float)pow(10., random() % 10);
+}
+
+static double nsnow(){
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e9 + t.tv_nsec;
+}
+static uint64_t ticks(){
+#ifdef __x86_64__
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+#define NBENCH  (1<<18)
+static float vals[NBENCH];
+static volatile char sink;
+
+#define BENCH(name, expr) do{ double t0 = nsnow(); uint64_t c0 = ticks(); \
+    for(int r = 0; r < 8; ++r) for(int i = 0; i < NBENCH; ++i){ const char *s = expr; sink ^= s[1]; } \
+    uint64_t c1 = ticks(); double t1 = nsnow(); \
+    printf("  %-18s %6.1f ns", name, (t1 - t0) / (8. * NBENCH)); \
+    if(c1 != c0) printf(", %6.1f TSC ticks", (c1 - c0) / (8. * NBENCH)); \
+    printf(" per call\n"); }while(0)
+
+static void bench(const char *title){
+    char buf[F2S_BUFSZ];
+    printf("%s:\n", title);
+    BENCH("old float2str", old_float2str(vals[i], 2));
+    BENCH("float2str_r eng", float2str_r(vals[i], 2, F2S_ENG, buf));
+    BENCH("float2str_r plain", float2str_r(vals[i], 2, F2S_PLAIN, buf));
+    BENCH("snprintf %.2e", (snprintf(buf, sizeof(buf), "%.2e", (double)vals[i]), buf));
+}
+
+int main(int argc, char **argv){
+    if(argc > 1 && 0 == strcmp(argv[1], "-b")){
+        srandom(time(NULL));
+        for(int i = 0; i < NBENCH; ++i) vals[i] = randsensor();
+        bench("sensor values");
+        for(int i = 0; i < NBENCH; ++i) vals[i] = randbits();
+        bench("random floats");
+        return 0;
+    }
+    long N = (argc > 1) ? atol(argv[1]) : 10000000;
+    srandom(time(NULL));
+    // special values and boundaries
+    union{ float f; uint32_t u; } v;
+    const uint32_t spec[] = {0, 0x80000000, 1, 0x80000001, 0x007fffff, 0x00800000, 0x7f7fffff, 0xff7fffff};
+    for(int p = 0; p <= F2S_MAXPREC; ++p){
+        for(size_t i = 0; i < sizeof(spec)/sizeof(spec[0]); ++i){
+            v.u = spec[i];
+            check(v.f, p, F2S_ENG); check(v.f, p, F2S_PLAIN);
+        }
+        for(int e = -45; e < 39; ++e){ // powers of 10, ties and carries like 999.995
+            float c[] = {1.f, 0.5f, 0.25f, 0.125f, 9.99f, 9.995f, 99.995f, 999.995f, 999.9995f};
+            for(size_t i = 0; i < sizeof(c)/sizeof(c[0]); ++i){
+                float x = (float)(c[i] * pow(10., e));
+                if(isinf(x)) continue;
+                for(int k = -1; k < 2; ++k){
+                    float y = k ? nextafterf(x, (k < 0) ? 0.f : INFINITY) : x;
+                    check(y, p, F2S_ENG); check(-y, p, F2S_PLAIN); check(y, p, F2S_PLAIN);
+                }
+            }
+        }
+        for(int i = 0; i < 200000; ++i){ // exact ties: n/2^k
+            float x = (float)(random() % 100000) / (float)(1 << (random() % 12));
+            check(x, p, F2S_ENG); check(x, p, F2S_PLAIN);
+        }
+    }
+    char buf[F2S_BUFSZ];
+    v.u = 0x7fc00000; if(strcmp(float2str_r(v.f, 2, F2S_ENG, buf), "NAN")){ ++errors; printf("bad NAN: %s\n", buf); }
+    v.u = 0x7f800000; if(strcmp(float2str_r(v.f, 2, F2S_ENG, buf), "INF")){ ++errors; printf("bad INF: %s\n", buf); }
+    v.u = 0xff800000; if(strcmp(float2str_r(v.f, 2, F2S_ENG, buf), "-INF")){ ++errors; printf("bad -INF: %s\n", buf); }
+    // random values
+    long olddiff = 0, oldn = 0;
+    for(long i = 0; i < N; ++i){
+        int p = random() % (F2S_MAXPREC + 1);
+        float x = (i & 1) ? randbits() : randsensor();
+        check(x, p, F2S_ENG);
+        check(x, p, F2S_PLAIN);
+        if(p <= (int)P10L && fabsf(x) < 1e30f && fabsf(x) > 1e-30f){ // old variant vs reference
+            char ref[128];
+            ref_eng(x, p, ref);
+            ++oldn;
+            if(strcmp(old_float2str(x, (uint8_t)p), ref)) ++olddiff;
+        }
+    }
+    if(errors){
+        printf("FAIL: %ld errors\n", errors);
+        return 1;
+    }
+    printf("Test passed (boundaries, ties and 2x%ld random values)\n", N);
+    printf("Old float2str differs from correctly rounded value in %ld of %ld cases (%.2f%%)\n",
+           olddiff, oldn, 100. * olddiff / oldn);
+    return 0;
+}
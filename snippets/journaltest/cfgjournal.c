@@ -0,0 +1 @@
+../cfgjournal.c
\ No newline at end of file
@@ -0,0 +1 @@
+../cfgjournal.h
\ No newline at end of file
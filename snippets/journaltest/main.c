@@ -0,0 +1,184 @@
+/*
+ * This file is part of the common library.
+ * Copyright 2023 Edward V. Emelianov <edward.emelianoff@gmail.com>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// test of cfgjournal on simulated flash with power loss injection
+// usage: ./journaltest [iterations [seed]]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "cfgjournal.h"
+
+#define PAGESZ      (1024)
+#define BANKSZ      (2048)
+// size of configuration (like user_conf of multistepper)
+#define CONFSZ      (152)
+
+static uint8_t flash[2*BANKSZ];
+static long budget = -1;        // flash operations left before power loss (-1 - infinite)
+static int dead = 0;            // power is lost
+static long hwwritten = 0, erases = 0, pgerrs = 0;
+
+static void fail(const char *msg, long iter){
+    fprintf(stderr, "FAIL @ iteration %ld: %s\n", iter, msg);
+    exit(1);
+}
+
+static int inflash(const void *addr, uint32_t len){
+    const uint8_t *a = (const uint8_t*)addr;
+    return (a >= flash && a + len <= flash + sizeof(flash) && !((a - flash) & 1));
+}
+
+// programming can only clear bits of erased halfword; interrupted programming gives random bits
+static int fl_write(const void *addr, const uint16_t *data, uint32_t n){
+    if(!inflash(addr, n * 2)) fail("write out of storage", -1);
+    uint16_t *a = (uint16_t*)addr;
+    for(uint32_t i = 0; i < n; ++i){
+        if(dead) return 1;
+        if(budget == 0){
+            dead = 1;
+            a[i] &= data[i] | (uint16_t)random();
+            return 1;
+        }
+        if(budget > 0) --budget;
+        if(a[i] != 0xffff){ ++pgerrs; return 1; }
+        a[i] = data[i];
+        ++hwwritten;
+    }
+    return 0;
+}
+
+// interrupted erasing leaves some bits unerased
+static int fl_erase(const void *addr){
+    if(!inflash(addr, PAGESZ) || ((const uint8_t*)addr - flash) % PAGESZ) fail("bad page address", -1);
+    uint8_t *p = (uint8_t*)addr;
+    if(dead) return 1;
+    if(budget == 0){
+        dead = 1;
+        for(int i = 0; i < PAGESZ; ++i) p[i] |= (uint8_t)random();
+        return 1;
+    }
+    if(budget > 0) --budget;
+    memset(p, 0xff, PAGESZ);
+    ++erases;
+    return 0;
+}
+
+static uint16_t image[CONFSZ/2], shadow[CONFSZ/2], buf[CJ_BUFSZ(CONFSZ)];
+static uint16_t defconf[CONFSZ/2];
+
+static cj_journal J = {
+    .base = flash, .banksize = BANKSZ, .pagesize = PAGESZ,
+    .write = fl_write, .erase = fl_erase,
+    .image = (uint8_t*)image, .shadow = (uint8_t*)shadow, .buf = buf,
+    .size = CONFSZ
+};
+
+// change some fields like user does
+static void mutate(){
+    int what = random() % 16;
+    if(what == 0){ // all changed (e.g. new firmware defaults)
+        for(int i = 0; i < CONFSZ/2; ++i) image[i] = random();
+        return;
+    }
+    int n = (what < 12) ? 1 : 1 + random() % 8;
+    for(int k = 0; k < n; ++k){
+        int i = random() % (CONFSZ/2);
+        image[i] = random();
+    }
+}
+
+// mount from scratch with other RAM buffers and compare to `expected`
+static void checkmount(const uint16_t *expected, long iter){
+    static uint16_t img2[CONFSZ/2], sh2[CONFSZ/2], buf2[CJ_BUFSZ(CONFSZ)];
+    cj_journal j2 = J;
+    j2.image = (uint8_t*)img2; j2.shadow = (uint8_t*)sh2; j2.buf = buf2;
+    if(cj_mount(&j2) != CJ_OK) fail("can't mount", iter);
+    if(memcmp(img2, expected, CONFSZ)) fail("mounted image differs", iter);
+    if(j2.bank != J.bank || j2.tail != J.tail) fail("mounted state differs", iter);
+}
+
+int main(int argc, char **argv){
+    long N = 200000, seed = time(NULL);
+    if(argc > 1) N = atol(argv[1]);
+    if(argc > 2) seed = atol(argv[2]);
+    srandom(seed);
+    printf("iterations: %ld, seed: %ld\n", N, seed);
+    memset(flash, 0xff, sizeof(flash));
+    for(int i = 0; i < CONFSZ/2; ++i) defconf[i] = i;
+    memcpy(image, defconf, CONFSZ);
+    if(cj_mount(&J) != CJ_EMPTY) fail("empty storage isn't empty", 0);
+    static uint16_t committed[CONFSZ/2], newconf[CONFSZ/2];
+    int havedata = 0;
+    long saves = 0, losses = 0, gotold = 0, gotnew = 0;
+    for(long it = 0; it < N; ++it){
+        mutate();
+        memcpy(newconf, image, CONFSZ);
+        if(random() % 3) budget = -1;
+        else budget = random() % ((random() & 1) ? 16 : 400);
+        int r = cj_save(&J);
+        if(pgerrs) fail("programming of non-erased cell", it);
+        if(!dead){
+            if(r != CJ_OK) fail("save error without power loss", it);
+            memcpy(committed, newconf, CONFSZ);
+            havedata = 1;
+            ++saves;
+            if(it % 97 == 0) checkmount(committed, it);
+            budget = -1;
+            continue;
+        }
+        // power loss: reboot
+        ++losses;
+        dead = 0;
+        budget = -1;
+        memcpy(image, defconf, CONFSZ);
+        r = cj_mount(&J);
+        if(r == CJ_EMPTY){
+            if(havedata) fail("data lost", it);
+            continue;
+        }
+        if(r != CJ_OK) fail("mount error", it);
+        if(!memcmp(image, newconf, CONFSZ)){
+            ++gotnew;
+            memcpy(committed, newconf, CONFSZ);
+            havedata = 1;
+        }else if(havedata && !memcmp(image, committed, CONFSZ)) ++gotold;
+        else fail("image is neither old nor new", it);
+    }
+    printf("saves: %ld, power losses: %ld (old data: %ld, new data: %ld)\n", saves, losses, gotold, gotnew);
+    printf("halfwords written: %ld (%.1f bytes per save instead of %d), page erases: %ld\n",
+           hwwritten, 2.*hwwritten / (saves + gotnew), CONFSZ, erases);
+    // boot time: mount of full bank
+    memcpy(image, committed, CONFSZ);
+    while(J.tail + 8 <= BANKSZ){
+        image[random() % (CONFSZ/2)] = random();
+        int n = cj_delta(&J);
+        if(!cj_fits(&J, n)) break;
+        if(cj_save(&J) != CJ_OK) fail("save error", N);
+    }
+    struct timespec t0, t1;
+    int M = 10000;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for(int i = 0; i < M; ++i) cj_mount(&J);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    double us = ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) / 1e3 / M;
+    printf("mount of bank filled by %u bytes: %.2f us\n", J.tail, us);
+    printf("OK\n");
+    return 0;
+}
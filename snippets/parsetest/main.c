@@ -0,0 +1,335 @@
+/*
+ * This file is part of the common library.
+ * Copyright 2023 Edward V. Emelianov <edward.emelianoff@gmail.com>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// fuzzing of getnum/getint/getfixed/getarg against reference parser and benchmark vs old getnum
+// usage: ./parsetest [N [seed]] (N - amount of random strings, default 10^7) or ./parsetest -b (benchmark)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "strfunc.h"
+
+// old variant (character by character with overflow check on each digit)
+static const char *old_getdec(const char *buf, uint32_t *N){
+    const char *start = buf;
+    uint32_t num = 0;
+    while(*buf){
+        char c = *buf;
+        if(c < '0' || c > '9') break;
+        if(num > 429496729 || (num == 429496729 && c > '5')) return start;
+        num = num * 10 + (uint32_t)(c - '0');
+        ++buf;
+    }
+    *N = num;
+    return buf;
+}
+static const char *old_gethex(const char *buf, uint32_t *N){
+    const char *start = buf;
+    uint32_t num = 0;
+    while(*buf){
+        char c = *buf;
+        uint8_t M = 0;
+        if(c >= '0' && c <= '9') M = '0';
+        else if(c >= 'A' && c <= 'F') M = 'A' - 10;
+        else if(c >= 'a' && c <= 'f') M = 'a' - 10;
+        if(!M) break;
+        if(num & 0xf0000000) return start;
+        num = (num << 4) + (uint32_t)(c - M);
+        ++buf;
+    }
+    *N = num;
+    return buf;
+}
+static const char *old_getoct(const char *buf, uint32_t *N){
+    const char *start = buf;
+    uint32_t num = 0;
+    while(*buf){
+        char c = *buf;
+        if(c < '0' || c > '7') break;
+        if(num & 0xe0000000) return start;
+        num = (num << 3) + (uint32_t)(c - '0');
+        ++buf;
+    }
+    *N = num;
+    return buf;
+}
+static const char *old_getbin(const char *buf, uint32_t *N){
+    const char *start = buf;
+    uint32_t num = 0;
+    while(*buf){
+        char c = *buf;
+        if(c < '0' || c > '1') break;
+        if(num & 0x80000000) return start;
+        num = (num << 1) | (uint32_t)(c - '0');
+        ++buf;
+    }
+    *N = num;
+    return buf;
+}
+static const char *old_getnum(const char *txt, uint32_t *N){
+    const char *nxt;
+    const char *s = omit_spaces(txt);
+    if(*s == '0'){
+        if(s[1] == 'x' || s[1] == 'X'){
+            nxt = old_gethex(s+2, N);
+            if(nxt == s+2) nxt = txt;
+        }else if(s[1] > '0'-1 && s[1] < '8'){
+            nxt = old_getoct(s+1, N);
+            if(nxt == s+1) nxt = txt;
+        }else{
+            nxt = s+1;
+            *N = 0;
+        }
+    }else if(*s == 'b' || *s == 'B'){
+        nxt = old_getbin(s+1, N);
+        if(nxt == s+1) nxt = txt;
+    }else{
+        nxt = old_getdec(s, N);
+        if(nxt == s) nxt = txt;
+    }
+    return nxt;
+}
+
+// reference parser: value in 128 bits (saturated), no tricks
+// @return amount of symbols read or -1 (no number), -2 (extra decimals), -3 (integer part overflow)
+typedef __int128 i128;
+#define SATUR   ((i128)1 << 100)
+static int ref_parse(const char *txt, int sign, int decimals, i128 *val, int *base){
+    const char *s = txt;
+    while(*s && *s <= ' ') ++s;
+    int neg = 0;
+    if(sign){
+        if(*s == '-'){ neg = 1; ++s; }
+        else if(*s == '+') ++s;
+        while(*s && *s <= ' ') ++s; // getnum omits spaces after sign too
+    }
+    int b = 10;
+#ifdef STRFUNC_0B
+    if(s[0] == '0'){
+        if(s[1] == 'x' || s[1] == 'X'){ b = 16; s += 2; }
+        else if(s[1] == 'b' || s[1] == 'B'){ b = 2; s += 2; }
+    }
+#else
+    if(s[0] == '0'){
+        if(s[1] == 'x' || s[1] == 'X'){ b = 16; s += 2; }
+        else if(s[1] >= '0' && s[1] <= '7'){ b = 8; ++s; }
+        else{ b = 0; ++s; } // single zero
+    }else if(*s == 'b' || *s == 'B'){ b = 2; ++s; }
+#endif
+    i128 v = 0;
+    if(b){
+        const char *st = s;
+        for(;; ++s){
+            int d;
+            if(*s >= '0' && *s <= '9') d = *s - '0';
+            else if(*s >= 'a' && *s <= 'f') d = *s - 'a' + 10;
+            else if(*s >= 'A' && *s <= 'F') d = *s - 'A' + 10;
+            else break;
+            if(d >= b) break;
+            v = v * b + d;
+            if(v > SATUR) v = SATUR;
+        }
+        if(s == st) return -1;
+    }else b = 10;
+    *base = b;
+    if(decimals){
+        if(v > 0xffffffffU) return -3; // integer part overflow is checked first
+        i128 frac = 0, scale = 1;
+        for(int i = 0; i < decimals; ++i) scale *= 10;
+        int nd = 0;
+        if(*s == '.' && b == 10){
+            ++s;
+            for(; *s >= '0' && *s <= '9'; ++s, ++nd){
+                if(nd < decimals) frac = frac * 10 + (*s - '0');
+                else if(*s != '0') return -2; // PARSE_PREC
+            }
+        }
+        for(; nd < decimals; ++nd) frac *= 10;
+        v = v * scale + frac;
+    }
+    *val = neg ? -v : v;
+    return (int)(s - txt);
+}
+
+static long errors = 0;
+#define FAIL(...) do{ if(++errors < 20){ printf(__VA_ARGS__); printf("\n"); } }while(0)
+
+static void check_getnum(const char *s){
+    uint32_t N = 0, O = 0;
+    i128 v; int b;
+    const char *n = getnum(s, &N), *o = old_getnum(s, &O);
+    int r = ref_parse(s, 0, 0, &v, &b);
+    if(r < 0 || v > 0xffffffffU){ // no number or overflow
+        if(n != s) FAIL("getnum(\"%s\"): must fail, got %u", s, N);
+    }else if(n != s + r || N != (uint32_t)v) FAIL("getnum(\"%s\"): got %u (%d symbols), must be %u (%d)",
+        s, N, (int)(n - s), (uint32_t)v, r);
+#ifndef STRFUNC_0B // old_getnum has octal and 'b' prefix
+    if(n != o || (n != s && N != O)) FAIL("getnum(\"%s\"): differs from old: %u vs %u", s, N, O);
+#else
+    (void)o;
+#endif
+}
+
+static void check_getint(const char *s){
+    int32_t I = 0;
+    i128 v; int b;
+    const char *n = getint(s, &I);
+    int r = ref_parse(s, 1, 0, &v, &b);
+    if(r < 0 || v > INT32_MAX || v < INT32_MIN){
+        if(n != s) FAIL("getint(\"%s\"): must fail, got %d", s, I);
+    }else if(n != s + r || I != (int32_t)v) FAIL("getint(\"%s\"): got %d (%d symbols), must be %d (%d)",
+        s, I, (int)(n - s), (int32_t)v, r);
+}
+
+static void check_getarg(const char *s, const argrange_t *R){
+    int32_t I = 12345;
+    const char *n = s;
+    i128 v; int b;
+    parse_err e = getarg(&n, R, &I);
+    int r = ref_parse(s, 1, R->decimals, &v, &b);
+    parse_err must = PARSE_OK;
+    if(r == -1) must = PARSE_NONUM;
+    else if(r == -2) must = PARSE_PREC;
+    else if(r == -3) must = PARSE_OVERFLOW;
+    else if(v > INT32_MAX || v < INT32_MIN) must = PARSE_OVERFLOW;
+    else if(s[r] == '.' && !R->decimals) must = PARSE_PREC;
+    else if(R->min <= R->max && (v < R->min || v > R->max)) must = PARSE_RANGE;
+    if(e != must){
+        FAIL("getarg(\"%s\", [%d, %d], %d): returns %d instead of %d", s, R->min, R->max, R->decimals, e, must);
+        return;
+    }
+    if(e != PARSE_OK){
+        if(n != s || I != 12345) FAIL("getarg(\"%s\"): changed pointer or value on error", s);
+        return;
+    }
+    if(n != s + r || I != (int32_t)v) FAIL("getarg(\"%s\", %d): got %d (%d symbols), must be %d (%d)",
+        s, R->decimals, I, (int)(n - s), (int32_t)v, r);
+    if(R->decimals){ // getfixed gives the same
+        int32_t F;
+        if(getfixed(s, &F, R->decimals) != n || F != I) FAIL("getfixed(\"%s\", %d) != getarg", s, R->decimals);
+    }
+}
+
+static const char alphabet[] = " -+0123456789abcdefxXbB.=";
+// random string: mostly number-like
+static void randstr(char *s){
+    int l = random() % 24;
+    int k = 0;
+    if(random() & 1) s[k++] = ' ';
+    if(random() & 1) s[k++] = (random() & 1) ? '-' : '+';
+    switch(random() % 6){
+        case 0: s[k++] = '0'; s[k++] = 'x'; break;
+        case 1: s[k++] = '0'; break;
+        case 2: s[k++] = 'b'; break;
+        case 3: s[k++] = '0'; s[k++] = 'b'; break;
+        default: break;
+    }
+    int digs = random() % 12;
+    for(int i = 0; i < digs && k < 40; ++i){
+        int r = random() % 16;
+        s[k++] = (r < 10) ? '0' + r : ((random() & 1) ? 'a' : 'A') + r - 10;
+    }
+    if(random() & 1){
+        s[k++] = '.';
+        int n = random() % 12;
+        for(int i = 0; i < n; ++i) s[k++] = '0' + random() % 10;
+    }
+    for(int i = 0; i < l % 4; ++i) s[k++] = alphabet[random() % (sizeof(alphabet) - 1)];
+    if((random() & 7) == 0){ // totally random
+        k = 0;
+        for(int i = 0; i < l; ++i) s[k++] = alphabet[random() % (sizeof(alphabet) - 1)];
+    }
+    s[k] = 0;
+}
+
+static void randrange(argrange_t *R){
+    R->decimals = (random() & 1) ? 0 : random() % 10;
+    int32_t a = (int32_t)((uint32_t)random() ^ ((uint32_t)random() << 16)), b = (int32_t)random();
+    if(random() & 1) b = -b;
+    switch(random() % 4){
+        case 0: R->min = 1; R->max = 0; break; // any value
+        case 1: R->min = INT32_MIN; R->max = INT32_MAX; break;
+        default: R->min = (a < b) ? a : b; R->max = (a < b) ? b : a; break;
+    }
+}
+
+static double nsnow(){
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+#define NBENCH  (1<<16)
+static char bstr[NBENCH][16];
+static volatile uint32_t sink;
+
+#define BENCH(name, fn) do{ double t0 = nsnow(); uint32_t N; \
+    for(int r = 0; r < 32; ++r) for(int i = 0; i < NBENCH; ++i){ fn(bstr[i], &N); sink += N; } \
+    printf("  %-12s %6.1f ns per call\n", name, (nsnow() - t0) / (32. * NBENCH)); }while(0)
+
+static void bench(){
+    for(int i = 0; i < NBENCH; ++i){
+        switch(i & 3){
+            case 0: sprintf(bstr[i], "%ld", random() % 1000); break;
+            case 1: sprintf(bstr[i], "%ld", random()); break;
+            case 2: sprintf(bstr[i], "0x%lx", random()); break;
+            default: sprintf(bstr[i], "%u", (uint32_t)random() * 2U); break;
+        }
+    }
+    printf("Benchmark (decimal and hex numbers):\n");
+    BENCH("old getnum", old_getnum);
+    BENCH("getnum", getnum);
+}
+
+int main(int argc, char **argv){
+    if(argc > 1 && 0 == strcmp(argv[1], "-b")){
+        srandom(time(NULL));
+        bench();
+        return 0;
+    }
+    long N = (argc > 1) ? atol(argv[1]) : 10000000;
+    unsigned seed = (argc > 2) ? (unsigned)atol(argv[2]) : (unsigned)time(NULL);
+    srandom(seed);
+    // boundaries
+    const char *spec[] = {"", " ", "-", "+", "0", "00", "08", "0x", "0xg", "b", "b2", "0b", "0b101", "0b2", "010", "4294967295", "4294967296",
+        "0xffffffff", "0x100000000", "037777777777", "040000000000", "b11111111111111111111111111111111",
+        "b111111111111111111111111111111111", "2147483647", "2147483648", "-2147483648", "-2147483649",
+        "0x000000000000000001", "000000000000000000017", "99999999999999999999", "1.", "1.5", "-0.0", ".5",
+        "-1.999999999", "0x1.5", "- 5", "--5", "+-5", "1e5", "1=2", "  \t12abc"};
+    argrange_t R = {1, 0, 0};
+    for(size_t i = 0; i < sizeof(spec)/sizeof(spec[0]); ++i){
+        check_getnum(spec[i]);
+        check_getint(spec[i]);
+        for(int d = 0; d < 10; ++d){ R.decimals = d; check_getarg(spec[i], &R); }
+    }
+    char s[64];
+    for(long i = 0; i < N; ++i){
+        randstr(s);
+        check_getnum(s);
+        check_getint(s);
+        randrange(&R);
+        check_getarg(s, &R);
+    }
+    if(errors){
+        printf("FAIL: %ld errors (seed %u)\n", errors, seed);
+        return 1;
+    }
+    printf("Test passed (boundaries and %ld random strings, seed %u)\n", N, seed);
+    return 0;
+}
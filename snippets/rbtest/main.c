@@ -0,0 +1,202 @@
+/*
+ * This file is part of the common library.
+ * Copyright 2023 Edward V. Emelianov <edward.emelianoff@gmail.com>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// random operations on ringbuffer compared with simple FIFO model; benchmark vs old variant (byte loops)
+// usage: ./rbtest [N [seed]] (N - amount of random operations, default 10^7) or ./rbtest -b (benchmark)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "ringbuffer.h"
+
+#define MAXLEN  (300)
+
+// FIFO model: all data ever written, `rd` - index of first unread byte
+static uint8_t model[1<<16];
+static int rd = 0, wr = 0;
+
+static long errors = 0;
+#define FAIL(...) do{ if(++errors < 20){ printf(__VA_ARGS__); printf("\n"); } }while(0)
+
+static void compact(){
+    if(rd < (int)sizeof(model) / 2) return;
+    memmove(model, model + rd, wr - rd);
+    wr -= rd; rd = 0;
+}
+
+// find `byte` in model; @return its distance from start or -1
+static int model_find(uint8_t byte){
+    for(int i = rd; i < wr; ++i) if(model[i] == byte) return i - rd;
+    return -1;
+}
+
+static void test(long N, int blen){
+    uint8_t data[blen], in[MAXLEN], out[MAXLEN];
+    ringbuffer b = {.data = data, .length = blen, .head = 0, .tail = 0};
+    rd = wr = 0;
+    for(long i = 0; i < N; ++i){
+        int len = random() % MAXLEN, l, stored = wr - rd, exp;
+        uint8_t byte = (uint8_t)('a' + random() % 16);
+        compact();
+        switch(random() % 6){
+            case 0: // write
+            case 1:
+                for(int k = 0; k < len; ++k) in[k] = (uint8_t)('a' + random() % 16);
+                l = RB_write(&b, in, len);
+                exp = blen - 1 - stored;
+                if(exp > len) exp = len;
+                if(l != exp) FAIL("RB_write(%d) with %d stored in %d: %d instead of %d", len, stored, blen, l, exp);
+                memcpy(model + wr, in, l); wr += l;
+            break;
+            case 2: // read
+                l = RB_read(&b, out, len);
+                exp = (stored < len) ? stored : len;
+                if(l != exp || memcmp(out, model + rd, l)) FAIL("RB_read(%d) with %d stored: wrong data or length %d", len, stored, l);
+                rd += exp;
+            break;
+            case 3: // peek
+                l = RB_peek(&b, out, len);
+                exp = (stored < len) ? stored : len;
+                if(l != exp || memcmp(out, model + rd, l)) FAIL("RB_peek(%d) with %d stored: wrong data or length %d", len, stored, l);
+            break;
+            case 4: // readto
+                l = RB_readto(&b, byte, out, len);
+                exp = model_find(byte);
+                if(exp < 0){
+                    if(l) FAIL("RB_readto(%c): there's no such byte, but returns %d", byte, l);
+                }else if(exp + 1 > len){ // buffer too small: `len` bytes read
+                    if(l != -len || memcmp(out, model + rd, len)) FAIL("RB_readto(%c, %d) returns %d instead of %d", byte, len, l, -len);
+                    rd += len;
+                }else{
+                    if(l != exp + 1 || memcmp(out, model + rd, l)) FAIL("RB_readto(%c) returns %d instead of %d", byte, l, exp + 1);
+                    rd += exp + 1;
+                }
+            break;
+            default: // hasbyte, datalen and sometimes clear
+                l = RB_hasbyte(&b, byte);
+                exp = model_find(byte);
+                if(exp < 0 ? (l != -1) : (l != (b.head + exp) % blen)) FAIL("RB_hasbyte(%c) returns %d", byte, l);
+                if(RB_datalen(&b) != stored) FAIL("RB_datalen(): %d instead of %d", RB_datalen(&b), stored);
+                if(0 == random() % 64){ RB_clearbuf(&b); rd = wr; }
+            break;
+        }
+    }
+}
+
+// old variant: search and copy by bytes
+static void mcpy(uint8_t *targ, const uint8_t *src, int l){
+    while(l--) *targ++ = *src++;
+}
+static int old_hasbyte(ringbuffer *b, uint8_t byte){
+    if(b->head == b->tail) return -1;
+    int startidx = b->head;
+    if(b->head > b->tail){
+        for(int found = b->head; found < b->length; ++found)
+            if(b->data[found] == byte) return found;
+        startidx = 0;
+    }
+    for(int found = startidx; found < b->tail; ++found)
+        if(b->data[found] == byte) return found;
+    return -1;
+}
+static int old_read(ringbuffer *b, uint8_t *s, int len){
+    int l = RB_datalen(b);
+    if(!l) return 0;
+    if(l > len) l = len;
+    int _1st = b->length - b->head;
+    if(_1st > l) _1st = l;
+    mcpy(s, b->data + b->head, _1st);
+    if(l > _1st) mcpy(s+_1st, b->data, l - _1st);
+    b->head += l;
+    if(b->head >= b->length) b->head -= b->length;
+    return l;
+}
+static int old_readto(ringbuffer *b, uint8_t byte, uint8_t *s, int len){
+    int idx = old_hasbyte(b, byte);
+    if(idx < 0) return 0;
+    int partlen = idx + 1 - b->head;
+    if(idx < b->head) partlen += b->length;
+    if(partlen > len) return -old_read(b, s, len);
+    return old_read(b, s, partlen);
+}
+static int old_write(ringbuffer *b, const uint8_t *str, int l){
+    int r = b->length - 1 - RB_datalen(b);
+    if(l > r) l = r;
+    if(!l) return 0;
+    int _1st = b->length - b->tail;
+    if(_1st > l) _1st = l;
+    mcpy(b->data + b->tail, str, _1st);
+    if(_1st < l) mcpy(b->data, str+_1st, l-_1st);
+    b->tail += l;
+    if(b->tail >= b->length) b->tail -= b->length;
+    return l;
+}
+
+static double nsnow(){
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+// text lines like commands and answers of USB/USART protocols
+#define NLINES  (4096)
+static uint8_t lines[NLINES][64];
+static int linelen[NLINES];
+static volatile int sink;
+
+// write lines into buffer of 1024 bytes and read them back by RB_readto
+#define BENCH(name, wrfn, rdfn) do{ uint8_t data[1024], out[128]; long bytes = 0; \
+    ringbuffer b = {.data = data, .length = sizeof(data), .head = 0, .tail = 0}; \
+    double t0 = nsnow(); \
+    for(int r = 0; r < 256; ++r) for(int i = 0; i < NLINES; ++i){ \
+        wrfn(&b, lines[i], linelen[i]); \
+        int l = rdfn(&b, '\n', out, sizeof(out)); sink += l; bytes += l; } \
+    printf("  %-12s %6.1f ns per line, %6.2f ns per byte\n", name, (nsnow() - t0) / (256. * NLINES), \
+        (nsnow() - t0) / bytes); }while(0)
+
+static void bench(){
+    for(int i = 0; i < NLINES; ++i){
+        int l = 4 + random() % 56;
+        for(int k = 0; k < l - 1; ++k) lines[i][k] = (uint8_t)('0' + random() % 64);
+        lines[i][l - 1] = '\n';
+        linelen[i] = l;
+    }
+    printf("Benchmark (write line and read it by RB_readto):\n");
+    BENCH("old", old_write, old_readto);
+    BENCH("ringbuffer", RB_write, RB_readto);
+}
+
+int main(int argc, char **argv){
+    if(argc > 1 && 0 == strcmp(argv[1], "-b")){
+        srandom(time(NULL));
+        bench();
+        return 0;
+    }
+    long N = (argc > 1) ? atol(argv[1]) : 10000000;
+    unsigned seed = (argc > 2) ? (unsigned)atol(argv[2]) : (unsigned)time(NULL);
+    srandom(seed);
+    const int sizes[] = {2, 3, 17, 64, 256, 1000};
+    for(size_t i = 0; i < sizeof(sizes)/sizeof(sizes[0]); ++i) test(N / 6, sizes[i]);
+    if(errors){
+        printf("FAIL: %ld errors (seed %u)\n", errors, seed);
+        return 1;
+    }
+    printf("Test passed (%ld random operations on buffers of 2..1000 bytes, seed %u)\n", N, seed);
+    return 0;
+}
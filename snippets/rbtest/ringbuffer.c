@@ -0,0 +1 @@
+../ringbuffer.c
\ No newline at end of file
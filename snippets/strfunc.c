@@ -16,7 +16,10 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
-#include <stm32g0.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "strfunc.h"
 
 /**
  * @brief hexdump - dump hex array by 16 bytes in string
@@ -46,68 +49,271 @@ void hexdump(int (*sendfun)(const char *s), uint8_t *arr, uint16_t len){
     }
 }
 
+/*
+ * Cortex-M0 has no hardware divider, so numbers are converted without division:
+ * values > 0xffff are divided by 10 by shifts and adds, less - by multiplication by reciprocal.
+ */
+
+// n / 10 for any uint32_t (Hacker's Delight, divu10)
+static inline uint32_t divu10(uint32_t n){
+    uint32_t q = (n >> 1) + (n >> 2);
+    q += q >> 4;
+    q += q >> 8;
+    q += q >> 16;
+    q >>= 3;
+    uint32_t r = n - ((q << 3) + (q << 1));
+    return q + ((r + 6) >> 4);
+}
+
+static const uint32_t pow10tbl[9] = {10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000};
+
 /**
- * @brief _2str - convert value into string buffer
- * @param val - |value|
- * @param minus - ==0 if value > 0
- * @return buffer with number
+ * @brief u2str_r - convert unsigned value into string
+ * @param val - value
+ * @param buf - buffer of at least STR_BUFSZ bytes
+ * @return `buf`
  */
-static char *_2str(uint32_t  val, uint8_t minus){
-    static char strbuf[12];
-    char *bufptr = &strbuf[11];
+char *u2str_r(uint32_t val, char *buf){
+    int l = 1;
+    while(l < 10 && val >= pow10tbl[l-1]) ++l;
+    char *bufptr = buf + l;
     *bufptr = 0;
-    if(!val){
-        *(--bufptr) = '0';
-    }else{
-        while(val){
-            *(--bufptr) = val % 10 + '0';
-            val /= 10;
-        }
+    while(val > 0xffff){
+        uint32_t x = divu10(val);
+        *(--bufptr) = (char)(val - ((x << 3) + (x << 1))) + '0';
+        val = x;
     }
-    if(minus) *(--bufptr) = '-';
-    return bufptr;
+    while(bufptr != buf){
+        uint32_t x = (val * 0xCCCDU) >> 19; // val / 10 for val < 81920
+        *(--bufptr) = (char)(val - ((x << 3) + (x << 1))) + '0';
+        val = x;
+    }
+    return buf;
 }
 
-// return string with number `val`
-char *u2str(uint32_t val){
-    return _2str(val, 0);
-}
-char *i2str(int32_t i){
-    uint8_t minus = 0;
-    uint32_t val;
+// the same for signed value
+char *i2str_r(int32_t i, char *buf){
     if(i < 0){
-        minus = 1;
-        val = -i;
-    }else val = i;
-    return _2str(val, minus);
+        *buf = '-';
+        u2str_r(0U - (uint32_t)i, buf + 1);
+    }else u2str_r((uint32_t)i, buf);
+    return buf;
 }
 
 /**
- * @brief uhex2str - print 32bit unsigned int as hex
+ * @brief uhex2str_r - print 32bit unsigned int as hex (without leading zero bytes)
  * @param val - value
- * @return string with number
+ * @param buf - buffer of at least STR_BUFSZ bytes
+ * @return `buf`
  */
+char *uhex2str_r(uint32_t val, char *buf){
+    int n = 8; // amount of nibbles
+    while(n > 2 && !(val >> (4*n - 8))) n -= 2;
+    char *bufptr = buf + 2 + n;
+    buf[0] = '0'; buf[1] = 'x';
+    *bufptr = 0;
+    while(n--){
+        int32_t half = val & 0x0f;
+        *(--bufptr) = (char)(half + '0' + (((9 - half) >> 31) & ('a' - '0' - 10)));
+        val >>= 4;
+    }
+    return buf;
+}
+
+// return string with number `val` (in static buffer)
+char *u2str(uint32_t val){
+    static char strbuf[STR_BUFSZ];
+    return u2str_r(val, strbuf);
+}
+char *i2str(int32_t i){
+    static char strbuf[STR_BUFSZ];
+    return i2str_r(i, strbuf);
+}
 char *uhex2str(uint32_t val){
-    static char buf[12] = "0x";
-    int npos = 2;
-    uint8_t *ptr = (uint8_t*)&val + 3;
-    int8_t i, j, z=1;
-    for(i = 0; i < 4; ++i, --ptr){
-        if(*ptr == 0){ // omit leading zeros
-            if(i == 3) z = 0;
-            if(z) continue;
+    static char buf[STR_BUFSZ];
+    return uhex2str_r(val, buf);
+}
+
+/*
+ * float2str_r works with exact value of float in fixed point: 128-bit integer part and 160-bit
+ * fraction (enough for any float including denormals), so there's no float operations at all.
+ * Digits of fraction are got by multiplication by 10, result is rounded to nearest (ties to even)
+ * like printf does.
+ */
+
+#define F2S_IWORDS  (4)
+#define F2S_FWORDS  (5)
+
+// fraction of float: value = frac / 2^(32*F2S_FWORDS)
+typedef struct{
+    uint32_t frac[F2S_FWORDS];
+    int low;                    // lowest nonzero word (F2S_FWORDS if fraction is zero)
+} f2s_frac;
+
+// multiply fraction by `k`; @return integer part (next decimal digit if k == 10)
+static uint32_t frac_mul(f2s_frac *f, uint32_t k){
+    uint32_t carry = 0;
+    for(int i = f->low; i < F2S_FWORDS; ++i){
+        uint64_t t = (uint64_t)f->frac[i] * k + carry;
+        f->frac[i] = (uint32_t)t;
+        carry = (uint32_t)(t >> 32);
+    }
+    while(f->low < F2S_FWORDS && f->frac[f->low] == 0) ++f->low;
+    return carry;
+}
+
+// put `val` shifted left by `sh` bits into array `arr` of `n` words (`val` < 2^24)
+static void setbits(uint32_t *arr, int n, uint32_t val, int sh){
+    uint64_t t = (uint64_t)val << (sh & 31);
+    int w = sh >> 5;
+    arr[w] = (uint32_t)t;
+    if(w + 1 < n) arr[w + 1] = (uint32_t)(t >> 32);
+}
+
+// x / 10000 for any uint32_t by multiplication by reciprocal
+#define DIV10000(x)     ((uint32_t)(((uint64_t)(x) * 0xD1B71759U) >> 45))
+
+// decimal digits (least significant first) of 128-bit integer `I` (it will be destroyed); @return their amount
+static int int2dec(uint32_t *I, char *dig){
+    int n = 0, top = F2S_IWORDS - 1;
+    while(top > -1 && I[top] == 0) --top;
+    while(top > 0){ // divide by 10^4 by 16-bit halves while number is longer than 32 bits
+        uint32_t rem = 0;
+        for(int i = top; i > -1; --i){
+            uint32_t hi = (rem << 16) | (I[i] >> 16), qh = DIV10000(hi);
+            rem = hi - qh * 10000U;
+            uint32_t lo = (rem << 16) | (I[i] & 0xffff), ql = DIV10000(lo);
+            rem = lo - ql * 10000U;
+            I[i] = (qh << 16) | ql;
         }
-        else z = 0;
-        for(j = 1; j > -1; --j){
-            uint8_t half = (*ptr >> (4*j)) & 0x0f;
-            if(half < 10) buf[npos++] = half + '0';
-            else buf[npos++] = half - 10 + 'a';
+        if(I[top] == 0) --top;
+        for(int k = 0; k < 4; ++k){
+            uint32_t x = divu10(rem);
+            dig[n++] = (char)(rem - ((x << 3) + (x << 1)));
+            rem = x;
         }
     }
-    buf[npos] = 0;
+    uint32_t v = I[0];
+    while(v){
+        uint32_t x = divu10(v);
+        dig[n++] = (char)(v - ((x << 3) + (x << 1)));
+        v = x;
+    }
+    return n;
+}
+
+/**
+ * @brief float2str_r - convert float into string
+ * @param x - value
+ * @param prec - amount of decimals (not more than F2S_MAXPREC)
+ * @param plain - F2S_PLAIN for plain notation (like "%.*f"), F2S_ENG for engineering
+ *      (mantissa in [1, 1000) and exponent multiple of 3, like "12.34E-6"; "E0" isn't printed)
+ * @param buf - buffer of at least F2S_BUFSZ bytes
+ * @return `buf`
+ */
+char *float2str_r(float x, uint8_t prec, uint8_t plain, char *buf){
+    union{ float f; uint32_t u; } v = {.f = x};
+    uint32_t e = (v.u >> 23) & 0xff, m = v.u & 0x7fffff;
+    char *s = buf;
+    if(prec > F2S_MAXPREC) prec = F2S_MAXPREC;
+    if(v.u >> 31) *s++ = '-';
+    if(e == 0xff){
+        if(m){ memcpy(buf, "NAN", 4); return buf; }
+        memcpy(s, "INF", 4);
+        return buf;
+    }
+    // x = m * 2^E
+    int E = -149;
+    if(e){ m |= 0x800000; E = (int)e - 150; }
+    uint32_t I[F2S_IWORDS] = {0};
+    f2s_frac F = {.low = F2S_FWORDS};
+    if(E > -1) setbits(I, F2S_IWORDS, m, E);
+    else{
+        uint32_t fr = m;
+        if(E > -24){ I[0] = m >> -E; fr = m & ((1U << -E) - 1); }
+        if(fr){
+            int sh = 32*F2S_FWORDS + E;
+            setbits(F.frac, F2S_FWORDS, fr, sh);
+            F.low = sh >> 5;
+            if(F.frac[F.low] == 0) ++F.low;
+        }
+    }
+    char idig[40], dig[F2S_BUFSZ];
+    int nint = int2dec(I, idig);
+    int fpos = -1;      // position (power of 10) of next fraction digit
+    uint32_t first = 0; // first significant digit of fraction in engineering notation
+    int top, lsd, e3 = 0; // positions of first and last printed digits, exponent
+    if(plain){
+        top = (nint > 0) ? nint - 1 : 0;
+        lsd = -(int)prec;
+    }else{
+        if(nint) top = nint - 1;
+        else if(F.low == F2S_FWORDS) top = 0; // zero
+        else{ // skip leading zeros of fraction: by nine while it's < 4/2^32 < 10^-9, then by one
+            while(F.frac[F2S_FWORDS - 1] < 4){
+                frac_mul(&F, 1000000000U);
+                fpos -= 9;
+            }
+            while(0 == (first = frac_mul(&F, 10))) --fpos;
+            top = fpos--;
+        }
+        // floor(top / 3) * 3; (x * 0xAAAB) >> 17 is x / 3 for small x
+        e3 = (top > -1) ? (int)(((uint32_t)top * 0xAAABU) >> 17) * 3 : -(int)((((uint32_t)(2 - top)) * 0xAAABU) >> 17) * 3;
+        lsd = e3 - (int)prec;
+    }
+    // get digits from `top` to `lsd` and the next one for rounding
+    int n = 0;
+    uint32_t r = 0, sticky = 0;
+    for(int p = top; p >= lsd - 1; --p){
+        uint32_t d;
+        if(p > -1) d = (p < nint) ? (uint32_t)idig[p] : 0;
+        else if(p > fpos) d = first; // first digit in engineering notation
+        else{
+            d = frac_mul(&F, 10);
+            --fpos;
+        }
+        if(p >= lsd) dig[1 + n++] = (char)d + '0';
+        else r = d;
+    }
+    if(F.low != F2S_FWORDS) sticky = 1;
+    else for(int p = lsd - 2; p > -1 && p < nint; --p) if(idig[p]){ sticky = 1; break; }
+    char *d = dig + 1;
+    if(r > 5 || (r == 5 && (sticky || (d[n - 1] & 1)))){ // round up
+        int i = n - 1;
+        while(i > -1 && d[i] == '9') d[i--] = '0';
+        if(i > -1) ++d[i];
+        else{ // 9.99 -> 10.00
+            *(--d) = '1';
+            ++top;
+        }
+    }
+    int ni = top - lsd + 1 - prec; // amount of digits before point
+    if(!plain && ni > 3){ // 999.99 -> 1000.0 -> 1.0000E3
+        ni = 1;
+        e3 += 3;
+    }
+    for(int i = 0; i < ni; ++i) *s++ = *d++;
+    if(prec){
+        *s++ = '.';
+        for(int i = 0; i < prec; ++i) *s++ = *d++;
+    }
+    if(e3){
+        *s++ = 'E';
+        if(e3 < 0){ *s++ = '-'; e3 = -e3; }
+        uint32_t e10 = divu10((uint32_t)e3);
+        if(e10) *s++ = (char)e10 + '0';
+        *s++ = (char)(e3 - ((e10 << 3) + (e10 << 1))) + '0';
+    }
+    *s = 0;
     return buf;
 }
 
+// convert float into string in engineering notation (in static buffer)
+char *float2str(float x, uint8_t prec){
+    static char buf[F2S_BUFSZ];
+    return float2str_r(x, prec, F2S_ENG, buf);
+}
+
 /**
  * @brief omit_spaces - eliminate leading spaces and other trash in string
  * @param buf - string
@@ -121,128 +327,144 @@ char *omit_spaces(const char *buf){
     return (char*)buf;
 }
 
+// @return value of digit `c` in given base or `base` if it isn't a digit
+static uint32_t digit(char c, uint32_t base){
+    uint32_t d = (uint32_t)(c - '0');
+    if(d > 9){
+        if(base != 16) return base;
+        d = (uint32_t)((c | 0x20) - 'a');
+        if(d > 5) return base;
+        d += 10;
+    }
+    return (d < base) ? d : base;
+}
+
 /**
- * @brief getdec - read decimal number & return pointer to next non-number symbol
- * @param buf - string
+ * @brief parseu - read unsigned number (dec, hex, oct or bin: 127, 0x7f, 0177, b1111111);
+ *      with STRFUNC_0B: dec (leading zeros allowed), hex or bin: 0127, 0x7f, 0b1111111
+ * @param txt - string
  * @param N - number read
- * @return Next non-number symbol. In case of overflow return `buf` and N==0xffffffff
+ * @param end - (return) first symbol after number
+ * @param base - (return) base of number
+ * @return PARSE_OK, PARSE_NONUM or PARSE_OVERFLOW
  */
-static char *getdec(const char *buf, uint32_t *N){
-    char *start = (char*)buf;
-    uint32_t num = 0;
-    while(*buf){
-        char c = *buf;
-        if(c < '0' || c > '9'){
-            break;
-        }
-        if(num > 429496729 || (num == 429496729 && c > '5')){ // overflow
-            *N = 0xffffff;
-            return start;
-        }
-        num *= 10;
-        num += c - '0';
-        ++buf;
-    }
-    *N = num;
-    return (char*)buf;
-}
-// read hexadecimal number (without 0x prefix!)
-static char *gethex(const char *buf, uint32_t *N){
-    char *start = (char*)buf;
-    uint32_t num = 0;
-    while(*buf){
-        char c = *buf;
-        uint8_t M = 0;
-        if(c >= '0' && c <= '9'){
-            M = '0';
-        }else if(c >= 'A' && c <= 'F'){
-            M = 'A' - 10;
-        }else if(c >= 'a' && c <= 'f'){
-            M = 'a' - 10;
-        }
-        if(M){
-            if(num & 0xf0000000){ // overflow
-                *N = 0xffffff;
-                return start;
-            }
-            num <<= 4;
-            num += c - M;
-        }else{
-            break;
-        }
-        ++buf;
+static parse_err parseu(const char *txt, uint32_t *N, const char **end, uint32_t *base){
+    const char *s = omit_spaces(txt);
+    uint32_t b = 10, num = 0, d;
+    int safe = 9; // amount of digits which can't overflow
+#ifdef STRFUNC_0B
+    if(*s == '0'){
+        if(s[1] == 'x' || s[1] == 'X'){ b = 16; safe = 8; s += 2; }
+        else if(s[1] == 'b' || s[1] == 'B'){ b = 2; safe = 32; s += 2; }
     }
-    *N = num;
-    return (char*)buf;
-}
-// read octal number (without 0 prefix!)
-static char *getoct(const char *buf, uint32_t *N){
-    char *start = (char*)buf;
-    uint32_t num = 0;
-    while(*buf){
-        char c = *buf;
-        if(c < '0' || c > '7'){
-            break;
+#else
+    if(*s == '0'){
+        if(s[1] == 'x' || s[1] == 'X'){ b = 16; safe = 8; s += 2; }
+        else if(s[1] >= '0' && s[1] <= '7'){ b = 8; safe = 10; ++s; }
+        else{ // single zero
+            *N = 0; *end = s + 1; *base = 10;
+            return PARSE_OK;
         }
-        if(num & 0xe0000000){ // overflow
-            *N = 0xffffff;
-            return start;
-        }
-        num <<= 3;
-        num += c - '0';
-        ++buf;
+    }else if(*s == 'b' || *s == 'B'){ b = 2; safe = 32; ++s; }
+#endif
+    const char *start = s;
+    while((d = digit(*s, b)) < b){
+        if(--safe < 0){
+            uint64_t t = (uint64_t)num * b + d;
+            if(t >> 32) return PARSE_OVERFLOW;
+            num = (uint32_t)t;
+        }else num = num * b + d;
+        ++s;
     }
-    *N = num;
-    return (char*)buf;
+    if(s == start) return PARSE_NONUM;
+    *N = num; *end = s; *base = b;
+    return PARSE_OK;
 }
-// read binary number (without b prefix!)
-static char *getbin(const char *buf, uint32_t *N){
-    char *start = (char*)buf;
-    uint32_t num = 0;
-    while(*buf){
-        char c = *buf;
-        if(c < '0' || c > '1'){
-            break;
-        }
-        if(num & 0x80000000){ // overflow
-            *N = 0xffffff;
-            return start;
+
+static const uint32_t dec_pow[10] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000};
+
+/**
+ * @brief parsefixed - read signed (fixed-point if `decimals` > 0) number
+ * @param txt - string
+ * @param I - number read multiplied by 10^decimals
+ * @param decimals - amount of digits after decimal point (0..9)
+ * @param end - (return) first symbol after number
+ * @return PARSE_OK, PARSE_NONUM, PARSE_OVERFLOW or PARSE_PREC
+ */
+static parse_err parsefixed(const char *txt, int32_t *I, uint8_t decimals, const char **end){
+    const char *s = omit_spaces(txt);
+    int neg = 0;
+    if(*s == '-'){ neg = 1; ++s; }
+    else if(*s == '+') ++s;
+    uint32_t U, base;
+    parse_err e = parseu(s, &U, &s, &base);
+    if(e != PARSE_OK) return e;
+    uint64_t v = U;
+    if(decimals){
+        v *= dec_pow[decimals];
+        if(*s == '.' && base == 10){
+            uint32_t d, frac = 0;
+            int n = decimals;
+            ++s;
+            while((d = digit(*s, 10)) < 10){
+                if(n) frac += d * dec_pow[--n];
+                else if(d) return PARSE_PREC;
+                ++s;
+            }
+            v += frac;
         }
-        num <<= 1;
-        if(c == '1') num |= 1;
-        ++buf;
     }
-    *N = num;
-    return (char*)buf;
+    if(v > (neg ? 0x80000000U : 0x7fffffffU)) return PARSE_OVERFLOW;
+    *I = neg ? (int32_t)(0U - (uint32_t)v) : (int32_t)v;
+    *end = s;
+    return PARSE_OK;
 }
 
 /**
- * @brief getnum - read uint32_t from string (dec, hex or bin: 127, 0x7f, 0b1111111)
+ * @brief getnum - read uint32_t from string (dec, hex, oct or bin: 127, 0x7f, 0177, b1111111;
+ *      see parseu() for STRFUNC_0B)
  * @param buf - buffer with number and so on
  * @param N   - the number read
- * @return pointer to first non-number symbol in buf
- *      (if it is == buf, there's no number or if *N==0xffffffff there was overflow)
+ * @return pointer to first non-number symbol in buf (if it is == buf, there's no number or overflow)
  */
 char *getnum(const char *txt, uint32_t *N){
-    char *nxt = NULL;
-    char *s = omit_spaces(txt);
-    if(*s == '0'){ // hex, oct or 0
-        if(s[1] == 'x' || s[1] == 'X'){ // hex
-            nxt = gethex(s+2, N);
-            if(nxt == s+2) nxt = (char*)txt;
-        }else if(s[1] > '0'-1 && s[1] < '8'){ // oct
-            nxt = getoct(s+1, N);
-            if(nxt == s+1) nxt = (char*)txt;
-        }else{ // 0
-            nxt = s+1;
-            *N = 0;
-        }
-    }else if(*s == 'b' || *s == 'B'){
-        nxt = getbin(s+1, N);
-        if(nxt == s+1) nxt = (char*)txt;
-    }else{
-        nxt = getdec(s, N);
-        if(nxt == s) nxt = (char*)txt;
-    }
-    return nxt;
+    const char *end;
+    uint32_t b;
+    if(parseu(txt, N, &end, &b) != PARSE_OK) return (char*)txt;
+    return (char*)end;
+}
+
+// get signed integer (the same as getfixed with 0 decimals)
+char *getint(const char *txt, int32_t *I){
+    const char *end;
+    if(parsefixed(txt, I, 0, &end) != PARSE_OK) return (char*)txt;
+    return (char*)end;
+}
+
+// get fixed-point number multiplied by 10^decimals ("-12.5" with 2 decimals is -1250)
+char *getfixed(const char *txt, int32_t *I, uint8_t decimals){
+    const char *end;
+    if(decimals > 9 || parsefixed(txt, I, decimals, &end) != PARSE_OK) return (char*)txt;
+    return (char*)end;
+}
+
+/**
+ * @brief getarg - read argument of command and check its range
+ * @param txt - (in/out) string, pointer moves after number if it was read
+ * @param r - allowed range and amount of decimals (NULL or r->min > r->max - any int32_t integer)
+ * @param val - value read (multiplied by 10^r->decimals); it isn't changed if there was an error
+ * @return PARSE_OK or error code
+ */
+parse_err getarg(const char **txt, const argrange_t *r, int32_t *val){
+    uint8_t decimals = r ? r->decimals : 0;
+    if(decimals > 9) return PARSE_PREC;
+    const char *end;
+    int32_t v;
+    parse_err e = parsefixed(*txt, &v, decimals, &end);
+    if(e != PARSE_OK) return e;
+    if(*end == '.' && !decimals) return PARSE_PREC; // fractional value for integer argument
+    if(r && r->min <= r->max && (v < r->min || v > r->max)) return PARSE_RANGE;
+    *val = v;
+    *txt = end;
+    return PARSE_OK;
 }
@@ -18,9 +18,48 @@
 
 #pragma once
 
+#include <stdint.h>
+
+// numbers syntax: 127, 0x7f, 0177 (octal), b1111111;
+// define STRFUNC_0B (in Makefile of project) for syntax of old parsers: 0127 (decimal), 0x7f, 0b1111111
+
+// errors of numbers parsing
+typedef enum{
+    PARSE_OK,
+    PARSE_NONUM,        // there's no number
+    PARSE_OVERFLOW,     // number doesn't fit into int32_t/uint32_t
+    PARSE_PREC,         // too much digits after decimal point
+    PARSE_RANGE         // number is out of allowed range
+} parse_err;
+
+// allowed range of argument (isn't checked if min > max); values are multiplied by 10^decimals
+typedef struct{
+    int32_t min;
+    int32_t max;
+    uint8_t decimals;   // amount of digits after decimal point (0 - integer, max 9)
+} argrange_t;
+
+// size of buffer for u2str_r, i2str_r and uhex2str_r
+#define STR_BUFSZ   (12)
+// notation of float2str_r: engineering (12.34E-6) or plain (0.00001234)
+#define F2S_ENG     (0)
+#define F2S_PLAIN   (1)
+// max amount of decimals in float2str_r
+#define F2S_MAXPREC (8)
+// size of buffer for float2str_r: sign, 39 digits, point, decimals and trailing zero
+#define F2S_BUFSZ   (52)
+
 void hexdump(int (*sendfun)(const char *s), uint8_t *arr, uint16_t len);
 char *u2str(uint32_t val);
 char *i2str(int32_t i);
 char *uhex2str(uint32_t val);
+char *u2str_r(uint32_t val, char *buf);
+char *i2str_r(int32_t i, char *buf);
+char *uhex2str_r(uint32_t val, char *buf);
+char *float2str(float x, uint8_t prec);
+char *float2str_r(float x, uint8_t prec, uint8_t plain, char *buf);
 char *getnum(const char *txt, uint32_t *N);
+char *getint(const char *txt, int32_t *I);
+char *getfixed(const char *txt, int32_t *I, uint8_t decimals);
+parse_err getarg(const char **txt, const argrange_t *r, int32_t *val);
 char *omit_spaces(const char *buf);
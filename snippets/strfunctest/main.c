@@ -0,0 +1,182 @@
+/*
+ * This file is part of the i2cscan project.
+ * Copyright 2023 Edward V. Emelianov <edward.emelianoff@gmail.com>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+// test of u2str/i2str/uhex2str against snprintf and benchmark vs old (division) variant
+// usage: ./strfunctest [-x | -b] (-x - exhaustive test of all 2^32 values, ~30 minutes; -b - benchmark only)
+// x86 compilers replace division by constant with multiplication, so "softdiv u2str" shows how old
+// variant works on Cortex-M0 (each digit - call of shift-subtract division)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef __x86_64__
+#include <x86intrin.h>
+#endif
+#include "strfunc.h"
+
+// shift-subtract division like libgcc's __aeabi_uidivmod on Cortex-M0 (it has no divider)
+static uint32_t __attribute__((noinline)) softdiv(uint32_t n, uint32_t d, uint32_t *rem){
+    uint32_t q = 0, r = 0;
+    for(int i = 31; i > -1; --i){
+        r = (r << 1) | ((n >> i) & 1);
+        if(r >= d){ r -= d; q |= 1U << i; }
+    }
+    *rem = r;
+    return q;
+}
+static char *soft_2str(uint32_t val){
+    static char strbuf[12];
+    char *bufptr = &strbuf[11];
+    *bufptr = 0;
+    if(!val) *(--bufptr) = '0';
+    while(val){
+        uint32_t r;
+        val = softdiv(val, 10, &r);
+        *(--bufptr) = r + '0';
+    }
+    return bufptr;
+}
+
+// old variant with division
+static char *old_2str(uint32_t val, uint8_t minus){
+    static char strbuf[12];
+    char *bufptr = &strbuf[11];
+    *bufptr = 0;
+    if(!val){
+        *(--bufptr) = '0';
+    }else{
+        while(val){
+            *(--bufptr) = val % 10 + '0';
+            val /= 10;
+        }
+    }
+    if(minus) *(--bufptr) = '-';
+    return bufptr;
+}
+static char *old_uhex2str(uint32_t val){
+    static char buf[12] = "0x";
+    int npos = 2;
+    uint8_t *ptr = (uint8_t*)&val + 3;
+    int8_t i, j, z=1;
+    for(i = 0; i < 4; ++i, --ptr){
+        if(*ptr == 0){ // omit leading zeros
+            if(i == 3) z = 0;
+            if(z) continue;
+        }
+        else z = 0;
+        for(j = 1; j > -1; --j){
+            uint8_t half = (*ptr >> (4*j)) & 0x0f;
+            if(half < 10) buf[npos++] = half + '0';
+            else buf[npos++] = half - 10 + 'a';
+        }
+    }
+    buf[npos] = 0;
+    return buf;
+}
+
+static long errors = 0;
+
+static void cmp(const char *got, const char *exp, const char *what, uint32_t val){
+    if(strcmp(got, exp)){
+        if(++errors < 10) printf("%s(0x%08x): got '%s', expected '%s'\n", what, val, got, exp);
+    }
+}
+
+// check one value with snprintf
+static void check(uint32_t v){
+    char buf[STR_BUFSZ], ref[32];
+    snprintf(ref, sizeof(ref), "%u", v);
+    cmp(u2str_r(v, buf), ref, "u2str", v);
+    snprintf(ref, sizeof(ref), "%d", (int32_t)v);
+    cmp(i2str_r((int32_t)v, buf), ref, "i2str", v);
+    int w = (v > 0xffffff) ? 8 : (v > 0xffff) ? 6 : (v > 0xff) ? 4 : 2; // leading zero bytes omitted
+    snprintf(ref, sizeof(ref), "0x%0*x", w, v);
+    cmp(uhex2str_r(v, buf), ref, "uhex2str", v);
+}
+
+static double nsnow(){
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e9 + t.tv_nsec;
+}
+static uint64_t ticks(){
+#ifdef __x86_64__
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+#define NBENCH  (1<<20)
+static uint32_t vals[NBENCH];
+static volatile char sink;
+
+#define BENCH(name, expr) do{ double t0 = nsnow(); uint64_t c0 = ticks(); \
+    for(int r = 0; r < 8; ++r) for(int i = 0; i < NBENCH; ++i){ const char *s = expr; sink ^= s[1]; } \
+    uint64_t c1 = ticks(); double t1 = nsnow(); \
+    printf("  %-14s %6.1f ns", name, (t1 - t0) / (8. * NBENCH)); \
+    if(c1 != c0) printf(", %6.1f TSC ticks", (c1 - c0) / (8. * NBENCH)); \
+    printf("\n"); }while(0)
+
+static void bench(const char *title){
+    char buf[STR_BUFSZ];
+    printf("%s:\n", title);
+    BENCH("old u2str", old_2str(vals[i], 0));
+    BENCH("softdiv u2str", soft_2str(vals[i]));
+    BENCH("u2str_r", u2str_r(vals[i], buf));
+    BENCH("old uhex2str", old_uhex2str(vals[i]));
+    BENCH("uhex2str_r", uhex2str_r(vals[i], buf));
+}
+
+int main(int argc, char **argv){
+    int exhaustive = (argc > 1 && 0 == strcmp(argv[1], "-x"));
+    int benchonly = (argc > 1 && 0 == strcmp(argv[1], "-b"));
+    srandom(time(NULL));
+    if(benchonly) goto bench;
+    // boundaries: powers of 2 and 10 and their neighbours
+    for(int i = 0; i < 32; ++i) for(int d = -2; d < 3; ++d) check((1U << i) + d);
+    for(uint64_t p = 1; p < (1ULL << 32); p *= 10) for(int d = -2; d < 3; ++d) check((uint32_t)p + d);
+    check(0xffffffffU); check(0x80000000U);
+    if(exhaustive){
+        uint32_t v = 0;
+        do{
+            check(v);
+            if(!(v & 0x0fffffff)){ printf("0x%08x\n", v); fflush(stdout); }
+        }while(++v);
+    }else{
+        for(uint32_t v = 0; v < 2000000; ++v) check(v);
+        for(int i = 0; i < 20000000; ++i) check((uint32_t)random() ^ ((uint32_t)random() << 16));
+    }
+    if(errors){
+        printf("FAIL: %ld errors\n", errors);
+        return 1;
+    }
+    printf("Test passed (%s)\n", exhaustive ? "all values" : "boundaries, 0..2e6 and 2e7 random values");
+    return 0;
+bench: // values with random amount of digits and full 32-bit values
+    for(int i = 0; i < NBENCH; ++i){
+        uint32_t v = (uint32_t)random() ^ ((uint32_t)random() << 16);
+        vals[i] = v >> (random() % 32);
+    }
+    bench("random length");
+    for(int i = 0; i < NBENCH; ++i) vals[i] = (uint32_t)random() ^ ((uint32_t)random() << 16);
+    bench("32-bit values");
+    return 0;
+}
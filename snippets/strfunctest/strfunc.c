@@ -0,0 +1 @@
+../strfunc.c
\ No newline at end of file
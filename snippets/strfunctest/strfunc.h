@@ -0,0 +1 @@
+../strfunc.h
\ No newline at end of file